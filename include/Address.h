@@ -1,7 +1,7 @@
 //*****************************************************************************
 //
 //
-//   ͷļʵֶַķװ
+//   此头文件实现对网络地址的封装功能
 //  
 //
 //*****************************************************************************
@@ -23,7 +23,7 @@ namespace sylar
 {
 
 //****************************************************************************
-// ǰ
+// 前置声明
 //****************************************************************************
 
 class Address;
@@ -45,172 +45,172 @@ class UnknownAddress;
 using UnknownAddress_ptr = std::shared_ptr<UnknownAddress>;
 
 //****************************************************************************
-// ַĻ,
+// 网络地址的基类,抽象类
 //****************************************************************************
 
 class Address {
 public:
     /*!
-     * @brief ͨsockaddrָ봴Address
-     * @param addr sockaddrָ
-     * @param addrlen sockaddrĳ
-     * @return غsockaddrƥAddress,ʧܷnullptr
+     * @brief 通过sockaddr指针创建Address
+     * @param addr sockaddr指针
+     * @param addrlen sockaddr的长度
+     * @return 返回和sockaddr相匹配的Address,失败返回nullptr
      */
     static Address_ptr Create(const sockaddr* addr, socklen_t addrlen);
 
     /*!
-     * @brief ͨhostַضӦAddress
-     * @param result Address
-     * @param host ,.: www.sylar.top[:80] (Ϊѡ)
-     * @param family Э(AF_INT, AF_INT6, AF_UNIX)
-     * @param type socketlSOCK_STREAMSOCK_DGRAM 
-     * @param protocol Э,IPPROTO_TCPIPPROTO_UDP 
-     * @return Ƿתɹ
+     * @brief 通过host地址返回对应条件的所有Address
+     * @param result 保存满足条件的Address
+     * @param host 域名,服务器名等.举例: www.sylar.top[:80] (方括号为可选内容)
+     * @param family 协议族(AF_INT, AF_INT6, AF_UNIX)
+     * @param type socketl类型SOCK_STREAM、SOCK_DGRAM 等
+     * @param protocol 协议,IPPROTO_TCP、IPPROTO_UDP 等
+     * @return 返回是否转换成功
      */
     static bool Lookup(std::vector<Address_ptr>& result, const std::string& host,
                        int family = AF_INET, int type = 0, int protocol = 0);
 
     /*!
-     * @brief ͨhostַضӦAddress
-     * @param host ,.: www.sylar.top[:80] (Ϊѡ)
-     * @param family Э(AF_INT, AF_INT6, AF_UNIX)
-     * @param type socketlSOCK_STREAMSOCK_DGRAM 
-     * @param protocol Э,IPPROTO_TCPIPPROTO_UDP 
-     * @return Address,ʧܷnullptr
+     * @brief 通过host地址返回对应条件的任意Address
+     * @param host 域名,服务器名等.举例: www.sylar.top[:80] (方括号为可选内容)
+     * @param family 协议族(AF_INT, AF_INT6, AF_UNIX)
+     * @param type socketl类型SOCK_STREAM、SOCK_DGRAM 等
+     * @param protocol 协议,IPPROTO_TCP、IPPROTO_UDP 等
+     * @return 返回满足条件的任意Address,失败返回nullptr
      */
     static Address_ptr LookupAny(const std::string& host,
                                   int family = AF_INET, int type = 0, int protocol = 0);
 
     /*!
-     * @brief  ͨhostַضӦIPAddress
-     * @param host ,.: www.sylar.top[:80] (Ϊѡ)
-     * @param family Э(AF_INT, AF_INT6, AF_UNIX)
-     * @param type socketlSOCK_STREAMSOCK_DGRAM 
-     * @param protocol Э,IPPROTO_TCPIPPROTO_UDP 
-     * @return IPAddress,ʧܷnullptr
+     * @brief  通过host地址返回对应条件的任意IPAddress
+     * @param host 域名,服务器名等.举例: www.sylar.top[:80] (方括号为可选内容)
+     * @param family 协议族(AF_INT, AF_INT6, AF_UNIX)
+     * @param type socketl类型SOCK_STREAM、SOCK_DGRAM 等
+     * @param protocol 协议,IPPROTO_TCP、IPPROTO_UDP 等
+     * @return 返回满足条件的任意IPAddress,失败返回nullptr
      */
     static IPAddress_ptr LookupAnyIPAddress(const std::string& host,
                                                          int family = AF_INET, int type = 0, int protocol = 0);
 
     /*!
-     * @brief ر<, ַ, λ>
-     * @param result 汾еַ
-     * @param family Э(AF_INT, AF_INT6, AF_UNIX)
-     * @return Ƿȡɹ
+     * @brief 返回本机所有网卡的<网卡名, 地址, 子网掩码位数>
+     * @param result 保存本机所有地址
+     * @param family 协议族(AF_INT, AF_INT6, AF_UNIX)
+     * @return 是否获取成功
      */
     static bool GetInterfaceAddresses(std::multimap<std::string, 
                                       std::pair<Address_ptr, uint32_t>>& result,
                                       int family = AF_INET);
 
     /*!
-     * @brief ȡָĵַλ
-     * @param result ָеַ
-     * @param iface 
-     * @param family Э(AF_INT, AF_INT6, AF_UNIX)
-     * @return Ƿȡɹ
+     * @brief 获取指定网卡的地址和子网掩码位数
+     * @param result 保存指定网卡所有地址
+     * @param iface 网卡名称
+     * @param family 协议族(AF_INT, AF_INT6, AF_UNIX)
+     * @return 是否获取成功
      */
     static bool GetInterfaceAddresses(std::vector<std::pair<Address_ptr, uint32_t> >& result
                                       , const std::string& iface, int family = AF_INET);
     /*!
-     * @brief 
+     * @brief 虚析构函数
      */
     virtual ~Address();
 
     /*!
-     * @brief Э
+     * @brief 返回协议簇
      */
     int getFamily() const;
 
     /*!
-     * @brief sockaddrָ,ֻ
+     * @brief 返回sockaddr指针,只读
      */
     virtual const sockaddr* getAddr() const = 0;
 
     /*!
-     * @brief sockaddrָ,д
+     * @brief 返回sockaddr指针,读写
      */
     virtual sockaddr* getAddr() = 0;
 
     /*!
-     * @brief sockaddrĳ
+     * @brief 返回sockaddr的长度
      */
     virtual socklen_t getAddrLen() const = 0;
 
     /*!
-     * @brief ɶַ
+     * @brief 可读性输出地址
      */
     virtual std::ostream& insert(std::ostream& os) const = 0;
 
     /*!
-     * @brief ؿɶַ
+     * @brief 返回可读性字符串
      */
     std::string toString() const;
 
     /*!
-     * @brief СںűȽϺ
+     * @brief 小于号比较函数
      */
     bool operator<(const Address& rhs) const;
 
     /*!
-     * @brief ں
+     * @brief 等于函数
      */
     bool operator==(const Address& rhs) const;
 };
 
 //****************************************************************************
-// ʽAddress
+// 流式输出Address
 //****************************************************************************
 
 std::ostream& operator<<(std::ostream& os, const Address& addr);
 
 //****************************************************************************
-// IPַĻ
+// IP地址的基类
 //****************************************************************************
 
 class IPAddress : public Address {
 public:
     /*!
-     * @brief ͨ,IP,IPAddress
-     * @param address ,IP,.: www.sylar.top
-     * @param port ˿ں
-     * @return óɹIPAddress,ʧܷnullptr
+     * @brief 通过域名,IP,服务器名创建IPAddress
+     * @param address 域名,IP,服务器名等.举例: www.sylar.top
+     * @param port 端口号
+     * @return 调用成功返回IPAddress,失败返回nullptr
      */
     static IPAddress_ptr Create(const char* address, uint16_t port = 0);
 
     /*!
-     * @brief ȡõַĹ㲥ַ
-     * @param prefix_len λ
-     * @return óɹIPAddress,ʧܷnullptr
+     * @brief 获取该地址的广播地址
+     * @param prefix_len 子网掩码位数
+     * @return 调用成功返回IPAddress,失败返回nullptr
      */
     virtual IPAddress_ptr broadcastAddress(uint32_t prefix_len) = 0;
 
     /*!
-     * @brief ȡõַ
-     * @param prefix_len λ
-     * @return óɹIPAddress,ʧܷnullptr
+     * @brief 获取该地址的网段
+     * @param prefix_len 子网掩码位数
+     * @return 调用成功返回IPAddress,失败返回nullptr
      */
     virtual IPAddress_ptr networkAddress(uint32_t prefix_len) = 0;
 
     /*!
-     * @brief ȡַ
-     * @param prefix_len λ
-     * @return óɹIPAddress,ʧܷnullptr
+     * @brief 获取子网掩码地址
+     * @param prefix_len 子网掩码位数
+     * @return 调用成功返回IPAddress,失败返回nullptr
      */
     virtual IPAddress_ptr subnetMask(uint32_t prefix_len) = 0;
 
     /*!
-     * @brief ض˿ں
+     * @brief 返回端口号
      */
     virtual uint32_t getPort() const = 0;
 
     /*!
-     * @brief ö˿ں
+     * @brief 设置端口号
      */
     virtual void setPort(uint16_t v) = 0;
 };
 
 //****************************************************************************
-// IPv4ַ
+// IPv4地址
 //****************************************************************************
 
 class IPv4Address : public IPAddress {
@@ -218,23 +218,23 @@ private:
     sockaddr_in __address;
 public:
     /*!
-     * @brief ʹõʮƵַIPv4Address
-     * @param address ʮƵַ,:192.168.1.1
-     * @param port ˿ں
-     * @return IPv4Address,ʧܷnullptr
+     * @brief 使用点分十进制地址创建IPv4Address
+     * @param address 点分十进制地址,如:192.168.1.1
+     * @param port 端口号
+     * @return 返回IPv4Address,失败返回nullptr
      */
     static IPv4Address_ptr Create(const char* address, uint16_t port = 0);
 
     /*!
-     * @brief ͨsockaddr_inIPv4Address
-     * @param address sockaddr_inṹ
+     * @brief 通过sockaddr_in构造IPv4Address
+     * @param address sockaddr_in结构体
      */
     IPv4Address(const sockaddr_in& address);
 
     /*!
-     * @brief ͨƵַIPv4Address
-     * @param address Ƶַaddress
-     * @param port ˿ں
+     * @brief 通过二进制地址构造IPv4Address
+     * @param address 二进制地址address
+     * @param port 端口号
      */
     IPv4Address(uint32_t address = INADDR_ANY, uint16_t port = 0);
 
@@ -251,7 +251,7 @@ public:
 };
 
 //****************************************************************************
-// IPv6ַ
+// IPv6地址
 //****************************************************************************
 
 class IPv6Address : public IPAddress {
@@ -279,7 +279,7 @@ public:
 };
 
 //****************************************************************************
-// UnixSocketַ
+// UnixSocket地址
 //****************************************************************************
 
 class UnixAddress : public Address {
@@ -300,7 +300,7 @@ public:
 };
 
 //****************************************************************************
-// δַ֪
+// 未知地址
 //****************************************************************************
 
 class UnknownAddress : public Address {
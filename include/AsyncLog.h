@@ -0,0 +1,147 @@
+//*****************************************************************************
+//
+//
+//   此头文件实现异步日志：每线程无锁环形队列 + 后台刷写线程
+//
+//
+//*****************************************************************************
+
+#ifndef SYLAR_ASYNCLOG_H
+#define SYLAR_ASYNCLOG_H
+
+#include <memory>
+#include <vector>
+#include <string>
+#include <atomic>
+#include <ostream>
+#include <boost/noncopyable.hpp>
+#include "Log.h"
+#include "Mutex.h"
+#include "Single.h"
+
+namespace sylar
+{
+
+//****************************************************************************
+// 前置声明
+//****************************************************************************
+
+class Thread;
+using Thread_ptr = std::shared_ptr<Thread>;
+
+class AsyncLogRing;
+using AsyncLogRing_ptr = std::shared_ptr<AsyncLogRing>;
+
+class AsyncLogger;
+using AsyncLogger_single = Single<AsyncLogger>;
+
+//****************************************************************************
+// 异步日志
+//****************************************************************************
+
+/*!
+ * @brief 队列满时的处理策略
+ */
+enum class LogFullPolicy {
+    BLOCK = 0,      // 等待刷写线程腾出空间
+    DROP = 1,       // 丢弃并计数
+    SAMPLE = 2      // 队列过半后每 log.async.sample 条只保留一条，满时丢弃
+};
+
+/*!
+ * @brief 异步日志
+ * @details 开启 log.async.enable 后，LogEventWrap 不再在调用线程上同步写各输出地，
+ *          而是把事件放进本线程的单生产者单消费者环形队列；后台线程批量取出，
+ *          按输出地格式化后用 writev 一次写入多条。FATAL 日志先同步刷空所有队列，
+ *          再在调用线程上直接输出
+ */
+class AsyncLogger : public boost::noncopyable {
+public:
+    using MutexType = Mutex;
+private:
+    MutexType __mutex;                          // 保护 __rings
+    MutexType __drainMutex;                     // 保证同一时刻只有一个消费者
+    std::vector<AsyncLogRing_ptr> __rings;      // 各线程的队列
+    Semaphore __semaphore;                      // 刷写线程空闲时等待
+    std::atomic<bool> __sleeping = { false };   // 刷写线程是否在等待
+    std::atomic<bool> __stopping = { false };
+    Thread_ptr __flusher;                       // 刷写线程
+    LogBatch __batch;                           // 复用的批量缓冲，由 __drainMutex 保护
+
+    std::atomic<uint64_t> __dropped = { 0 };    // 队列满被丢弃的日志数
+    std::atomic<uint64_t> __sampled = { 0 };    // 采样丢弃的日志数
+    std::atomic<uint64_t> __blocked = { 0 };    // 队列满等待的次数
+    std::atomic<uint64_t> __batches = { 0 };    // 批量写入的次数
+    std::atomic<uint64_t> __written = { 0 };    // 写出的日志数
+private:
+    /*!
+     * @brief 获取本线程的队列，线程退出阶段返回 nullptr
+     */
+    AsyncLogRing* getRing();
+
+    /*!
+     * @brief 刷写线程主循环，空闲时最多等待到下一次定时刷出
+     */
+    void run();
+public:
+    /*!
+     * @brief 唤醒等待中的刷写线程，定时刷出的间隔改变后也由配置监听调用
+     */
+    void wakeup();
+
+    AsyncLogger();
+
+    /*!
+     * @brief 停止刷写线程并刷空所有队列
+     */
+    ~AsyncLogger();
+
+    /*!
+     * @brief 是否开启异步日志(配置 log.async.enable)
+     */
+    static bool IsEnabled();
+
+    /*!
+     * @brief 确保刷写线程已启动
+     * @details 刷写线程同时每隔 log.file.flush_interval 刷出带缓冲的输出地、
+     *          汇总被抑制的日志，未开启异步日志时也需要它。不能在持有日志相关锁时调用
+     */
+    static void EnsureStarted();
+
+    /*!
+     * @brief 将日志复制到本线程的队列
+     * @details 消息正文复制进槽位中复用的缓冲，稳定后不再分配内存
+     * @return false 表示当前无法异步输出，调用方应同步输出
+     */
+    bool push(const Logger_ptr& logger, const LogEvent& event);
+
+    /*!
+     * @brief 在当前线程上取出所有队列中的日志并写出
+     * @return 写出的日志数
+     */
+    size_t drain();
+
+    /*!
+     * @brief 获取因队列满被丢弃的日志数
+     */
+    uint64_t getDropped() const { return __dropped; }
+
+    /*!
+     * @brief 获取采样丢弃的日志数
+     */
+    uint64_t getSampled() const { return __sampled; }
+
+    /*!
+     * @brief 获取写出的日志数
+     */
+    uint64_t getWritten() const { return __written; }
+
+    /*!
+     * @brief 输出统计
+     */
+    std::ostream& dump(std::ostream& os);
+};
+
+}; /* sylar */
+
+#endif /* SYLAR_ASYNCLOG_H */
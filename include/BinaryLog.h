@@ -0,0 +1,151 @@
+//*****************************************************************************
+//
+//
+//   此头文件实现二进制日志：写入时不格式化文本，离线解码为 LogFormatter 格式
+//
+//
+//*****************************************************************************
+
+#ifndef SYLAR_BINARYLOG_H
+#define SYLAR_BINARYLOG_H
+
+#include <map>
+#include <vector>
+#include <string>
+#include <memory>
+#include "Log.h"
+#include "ByteArray.h"
+
+namespace sylar
+{
+
+//****************************************************************************
+// 前置声明
+//****************************************************************************
+
+class BinaryLogAppender;
+using BinaryLogAppender_ptr = std::shared_ptr<BinaryLogAppender>;
+
+class BinaryLogReader;
+using BinaryLogReader_ptr = std::shared_ptr<BinaryLogReader>;
+
+//****************************************************************************
+// 文件格式
+//****************************************************************************
+
+/*!
+ * @brief 二进制日志的记录类型
+ * @details 文件由若干段组成，每次打开文件追加一段。整数均为 ByteArray 的变长编码，
+ *          字符串为变长长度 + 内容，每条记录以 1 字节类型开始：
+ *          HEADER  "SYLB" 版本号(1 字节)，之后的字典与时间基准重新开始
+ *          SITE    id 行号 文件名          调用处字典，每段中首次出现时写一次
+ *          NAME    id 名称                 日志器名与线程名字典
+ *          EVENT   级别(1 字节) 时间差(有符号，微秒) 调用处 id 日志器名 id
+ *                  线程名 id 线程 id 协程 id elapse 消息
+ */
+enum class BinaryLogRecord {
+    HEADER = 0,
+    SITE = 1,
+    NAME = 2,
+    EVENT = 3
+};
+
+//****************************************************************************
+// 二进制输出地
+//****************************************************************************
+
+/*!
+ * @brief 二进制日志输出地
+ * @details 不使用格式器，每条日志只编码级别、时间差、调用处 id、线程与协程 id
+ *          以及消息内容，用于量最大的日志器。用 sylar_logdecode 解码
+ */
+class BinaryLogAppender : public LogAppender {
+private:
+    std::string __file_name;
+    int __fd = -1;
+    // 调用处(文件名指针, 行号) -> id，文件名是日志宏处的静态字符串
+    std::map<std::pair<const char*, uint32_t>, uint32_t> __sites;
+    // 日志器名与线程名 -> id
+    std::map<std::string, uint32_t, std::less<> > __names;
+    uint64_t __lastTime = 0;    // 上一条日志的时间(微秒)
+    std::string __buffer;       // 编码缓冲，攒到 log.file.buffer_size 或遇到
+                                // 不低于 log.file.flush_level 的日志时写出
+private:
+    /*!
+     * @brief 写入段头并清空字典，调用方持有 __mutex
+     */
+    void writeHeader();
+
+    /*!
+     * @brief 取名称的 id，首次出现时先写入字典
+     */
+    uint32_t getNameId(const char* name);
+
+    /*!
+     * @brief 写入 __buffer 中的全部内容，调用方持有 __mutex
+     */
+    void flushBuffer();
+public:
+    BinaryLogAppender(const std::string& file_name);
+    ~BinaryLogAppender();
+
+    bool isRaw() const override { return true; }
+
+    /*!
+     * @brief 编码一条日志追加到缓冲
+     */
+    void log(const LogEvent& event) override;
+
+    /*!
+     * @brief 写入原始字节
+     */
+    void write(const char* data, size_t size) override;
+
+    /*!
+     * @brief 刷出缓冲，异步日志在每批末尾调用
+     */
+    void flush() override;
+
+    /*!
+     * @brief 重新打开日志文件，开始新的一段
+     */
+    bool reopen();
+};
+
+//****************************************************************************
+// 解码
+//****************************************************************************
+
+/*!
+ * @brief 二进制日志解码
+ */
+class BinaryLogReader {
+private:
+    ByteArray __data;
+    std::vector<std::pair<std::string, uint32_t> > __sites;    // id -> (文件名, 行号)
+    std::vector<std::string> __names;                           // id -> 名称
+    uint64_t __lastTime = 0;
+    std::string __message;
+    std::string __error;
+public:
+    /*!
+     * @brief 读入整个文件
+     */
+    bool open(const std::string& path);
+
+    /*!
+     * @brief 解码下一条日志
+     * @param[out] event 其中的字符串指向本对象，下次调用 next 前有效
+     * @return false 表示已读完或遇到错误(getError 非空)
+     */
+    bool next(LogEvent& event);
+
+    /*!
+     * @brief 获取解码错误，文件末尾不完整的记录(写入时进程退出)也视为错误
+     */
+    const std::string& getError() const { return __error; }
+};
+
+}; /* sylar */
+
+#endif /* SYLAR_BINARYLOG_H */
@@ -1,7 +1,7 @@
 //*****************************************************************************
 //
 //
-//   飨л/л
+//   二进制数组（序列化/反序列化）
 //  
 //
 //*****************************************************************************
@@ -21,58 +21,58 @@ namespace sylar
 {
 
 //****************************************************************************
-// ǰ
+// 前置声明
 //****************************************************************************
 
 class ByteArray;
 using ByteArray_ptr = std::shared_ptr<ByteArray>;
 
 //****************************************************************************
-// ,ṩ͵л,л
+// 二进制数组,提供基础类型的序列化,反序列化功能
 //****************************************************************************
 
 class ByteArray {
 public:
 	/*!
-	 * @brief ByteArrayĴ洢ڵ
+	 * @brief ByteArray的存储节点
 	 */
 	struct Node {
-		Node* __next;     // һڴַ
-		char* __ptr;      // ڴַָ
-		size_t __size;    // ڴС
+		Node* __next;     // 下一个内存块地址
+		char* __ptr;      // 内存块地址指针
+		size_t __size;    // 内存块大小
 
 		/*!
-		 * @brief ָСڴ
-		 * @param s ڴֽ
+		 * @brief 构造指定大小的内存块
+		 * @param s 内存块字节数
 		 */
 		Node(size_t s);
 
 		/*!
-		 * @brief ޲ι캯
+		 * @brief 无参构造函数
 		 */
 		Node();
 
 		/*!
-		 * @brief ,ͷڴ
+		 * @brief 析构函数,释放内存
 		 */
 		~Node();
 	};
 private:
-	size_t __baseSize;  // ڴĴС
-	size_t __position;  // ǰλ
-	size_t __capacity;  // ǰ
-	size_t __size;      // ǰݵĴС  
-	int8_t __endian;    // ֽ,Ĭϴ
-	Node* __root;       // һڴָ
-	Node* __cur;        // ǰڴָ
+	size_t __baseSize;  // 内存块的大小
+	size_t __position;  // 当前操作位置
+	size_t __capacity;  // 当前的总容量
+	size_t __size;      // 当前数据的大小  
+	int8_t __endian;    // 字节序,默认大端
+	Node* __root;       // 第一个内存块指针
+	Node* __cur;        // 当前操作的内存块指针
 private:
 	/*!
-	 * @brief ByteArray,ʹsize(ԭԿ,)
+	 * @brief 扩容ByteArray,使其可以容纳size个数据(如果原本可以可以容纳,则不扩容)
 	 */
 	void addCapacity(size_t size);
 
 	/*!
-	 * @brief ȡǰĿд
+	 * @brief 获取当前的可写入容量
 	 */
 	size_t getCapacity() const;
 public:
@@ -0,0 +1,72 @@
+//*****************************************************************************
+//
+//
+//   时钟服务（单调时钟 / 线程缓存时钟 / 日志墙上时钟）
+//  
+//
+//*****************************************************************************
+
+#ifndef SYLAR_CLOCK_H
+#define SYLAR_CLOCK_H
+
+#include <stdint.h>
+#include <time.h>
+
+namespace sylar
+{
+
+//****************************************************************************
+// 时钟服务
+//****************************************************************************
+
+/*!
+ * @brief 基于 CLOCK_MONOTONIC 的时钟服务
+ * @details 单调时钟不受 NTP 调整和手动改时影响，定时器统一使用该时钟。
+ *          每个线程维护一份缓存的 "当前时间"，由 IOManager::idle 在每次
+ *          epoll_wait 返回后刷新一次，扫描到期定时器时直接读取缓存
+ */
+class Clock {
+public:
+    /*!
+     * @brief 单调时钟的当前时间(微秒)
+     */
+    static uint64_t NowUS();
+
+    /*!
+     * @brief 单调时钟的当前时间(毫秒)
+     */
+    static uint64_t NowMS();
+
+    /*!
+     * @brief 刷新当前线程缓存的单调时间
+     * @return 刷新后的时间(微秒)
+     */
+    static uint64_t Update();
+
+    /*!
+     * @brief 当前线程缓存的单调时间(微秒)，从未刷新过时读取一次真实时间
+     * @details 缓存值只会比真实时间早，用它判断定时器到期只会推迟、不会提前
+     */
+    static uint64_t CachedUS();
+
+    /*!
+     * @brief 当前线程缓存的单调时间(毫秒)
+     */
+    static uint64_t CachedMS();
+
+    /*!
+     * @brief 用于日志时间戳的墙上时钟(秒)
+     * @details 读取 CLOCK_REALTIME_COARSE，由内核在每个 tick 更新，经 vDSO 读取不陷入内核
+     */
+    static time_t WallSecond();
+
+    /*!
+     * @brief 用于日志时间戳的墙上时钟(微秒)
+     * @details 读取 CLOCK_REALTIME，同样经 vDSO 读取，精度足以输出毫秒与微秒
+     */
+    static uint64_t WallUS();
+};
+
+}; /* sylar */
+
+#endif /* SYLAR_CLOCK_H */
@@ -1,7 +1,7 @@
 //*****************************************************************************
 //
 //
-//   ͷļʵϵͳ
+//   此头文件实现配置系统功能
 //  
 //
 //*****************************************************************************
@@ -14,16 +14,20 @@
 #include <list>
 #include <memory>
 #include <functional>
+#include <atomic>
+#include <type_traits>
 #include <yaml-cpp/yaml.h>
 
 #include "Log.h"
 #include "LexicalCast.h"
+#include "ByteArray.h"
 #include "Thread.h"
+#include "Rcu.h"
 
 namespace sylar {
 
 //****************************************************************************
-// ǰ
+// 前置声明
 //****************************************************************************
 
 class ConfigVarBase;
@@ -37,12 +41,134 @@ using ConfigVar_ptr = std::shared_ptr<ConfigVar<T, FromStr, ToStr>>;
 
 using ConfigVarMap = std::map<std::string, ConfigVarBase_ptr>;
 
+template<class T, class FromStr = LexicalCast<std::string, T>, class ToStr = LexicalCast<T, std::string>>
+class ConfigVarCache;
+
 //****************************************************************************
-// 
+// 配置值的二进制编码
 //****************************************************************************
 
 /*!
- * @brief ñĻ
+ * @brief 配置值的二进制编码，配置快照加载时直接解码，不再经过 YAML
+ * @details 没有特化的类型 supported 为 false，快照中仍保存其文本。
+ *          自定义类型可特化本模板，提供 Write/Read
+ */
+template<class T, class Enable = void>
+class ConfigBinary {
+public:
+	static constexpr bool supported = false;
+};
+
+template<>
+class ConfigBinary<bool> {
+public:
+	static constexpr bool supported = true;
+	static void Write(ByteArray& ba, bool v) { ba.writeFuint8(v ? 1 : 0); }
+	static bool Read(ByteArray& ba) { return ba.readFuint8() != 0; }
+};
+
+template<class T>
+class ConfigBinary<T, typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value>::type> {
+public:
+	static constexpr bool supported = true;
+	static void Write(ByteArray& ba, T v) {
+		if (std::is_signed<T>::value) {
+			ba.writeInt64(v);
+		} else {
+			ba.writeUint64(v);
+		}
+	}
+	static T Read(ByteArray& ba) {
+		return std::is_signed<T>::value ? (T)ba.readInt64() : (T)ba.readUint64();
+	}
+};
+
+template<class T>
+class ConfigBinary<T, typename std::enable_if<std::is_floating_point<T>::value>::type> {
+public:
+	static constexpr bool supported = true;
+	static void Write(ByteArray& ba, T v) { ba.writeDouble(v); }
+	static T Read(ByteArray& ba) { return (T)ba.readDouble(); }
+};
+
+template<>
+class ConfigBinary<std::string> {
+public:
+	static constexpr bool supported = true;
+	static void Write(ByteArray& ba, const std::string& v) { ba.writeStringVint(v); }
+	static std::string Read(ByteArray& ba) { return ba.readStringVint(); }
+};
+
+/*!
+ * @brief 容器：元素个数后依次是各元素，元素类型可编码时才可编码
+ */
+template<class C, class E>
+class ConfigBinarySequence {
+public:
+	static constexpr bool supported = ConfigBinary<E>::supported;
+	static void Write(ByteArray& ba, const C& v) {
+		ba.writeUint64(v.size());
+		for (auto& i : v) {
+			ConfigBinary<E>::Write(ba, i);
+		}
+	}
+	static C Read(ByteArray& ba) {
+		C v;
+		for (uint64_t n = ba.readUint64(); n; --n) {
+			v.insert(v.end(), ConfigBinary<E>::Read(ba));
+		}
+		return v;
+	}
+};
+
+template<class T>
+class ConfigBinary<std::vector<T> > : public ConfigBinarySequence<std::vector<T>, T> {};
+
+template<class T>
+class ConfigBinary<std::list<T> > : public ConfigBinarySequence<std::list<T>, T> {};
+
+template<class T>
+class ConfigBinary<std::set<T> > : public ConfigBinarySequence<std::set<T>, T> {};
+
+template<class T>
+class ConfigBinary<std::unordered_set<T> > : public ConfigBinarySequence<std::unordered_set<T>, T> {};
+
+/*!
+ * @brief 以字符串为 key 的映射：元素个数后依次是 key 与值
+ */
+template<class C, class E>
+class ConfigBinaryMap {
+public:
+	static constexpr bool supported = ConfigBinary<E>::supported;
+	static void Write(ByteArray& ba, const C& v) {
+		ba.writeUint64(v.size());
+		for (auto& i : v) {
+			ba.writeStringVint(i.first);
+			ConfigBinary<E>::Write(ba, i.second);
+		}
+	}
+	static C Read(ByteArray& ba) {
+		C v;
+		for (uint64_t n = ba.readUint64(); n; --n) {
+			std::string key = ba.readStringVint();
+			v.emplace(std::move(key), ConfigBinary<E>::Read(ba));
+		}
+		return v;
+	}
+};
+
+template<class T>
+class ConfigBinary<std::map<std::string, T> > : public ConfigBinaryMap<std::map<std::string, T>, T> {};
+
+template<class T>
+class ConfigBinary<std::unordered_map<std::string, T> > : public ConfigBinaryMap<std::unordered_map<std::string, T>, T> {};
+
+//****************************************************************************
+// 配置器
+//****************************************************************************
+
+/*!
+ * @brief 配置变量的基类
  */
 class ConfigVarBase {
 protected:
@@ -57,19 +183,35 @@ public:
 	const std::string& getDescription() const;
 
 	/*!
-	 * @brief Ϣ
+	 * @brief 输出配置信息
 	 */
 	virtual std::string toString() = 0;
 
 	/*!
-	 * @brief ļϢתΪ ConfigVarBase Ϣ
+	 * @brief 将配置文件中信息转化为 ConfigVarBase 对象信息
 	 */
 	virtual bool fromString(const std::string& val) = 0;
 
 	/*!
-	 * @brief òֵ
+	 * @brief 将配置文件中的文本转换成值后按类型写入二进制编码，不改变当前值
+	 * @return 类型没有二进制编码(ConfigBinary)或转换失败返回 false
+	 */
+	virtual bool toBinary(const std::string& text, ByteArray& ba) = 0;
+
+	/*!
+	 * @brief 从 toBinary 写入的编码设置值
+	 */
+	virtual bool fromBinary(ByteArray& ba) = 0;
+
+	/*!
+	 * @brief 返回配置参数值的类型名称
 	 */
 	virtual std::string getTypeName() const = 0;
+
+	/*!
+	 * @brief 返回值的版本号，值每改变一次加一
+	 */
+	virtual uint64_t getVersion() const = 0;
 };
 
 template<class T, class FromStr, class ToStr>
@@ -78,67 +220,120 @@ public:
 	using on_change_cb = typename std::function<void(const T& old_value, const T& new_value)>;
 	using RWMutexType =  RWMutex;
 private:
-	T __val;
+	// 当前值的快照，读者在 Rcu::ReadLock 内读取，不加锁
+	RcuPtr<T> __val;
+	// 每次发布新值后加一，供 ConfigVarCache 判断缓存是否过期
+	std::atomic<uint64_t> __version = { 0 };
 	std::map<uint64_t, on_change_cb> __cbs;
+	// 保护 __cbs；setValue 持有写锁完成比较、回调与发布，彼此互斥
 	RWMutexType __mutex;
 public:
 	
 	ConfigVar(const std::string& name, const T& value, const std::string& description = "");
 
 	/*!
-	 * @brief ֵתYAML std::string
-	 * @exception תʧ׳쳣 
+	 * @brief 将参数值转换成YAML std::string
+	 * @exception 当转换失败抛出异常 
 	 */
 	std::string toString() override;
 
 	/*!
-	 * @brief YAML std::string תɲֵ
-	 * @exception תʧ׳쳣
+	 * @brief 从YAML std::string 转成参数的值
+	 * @exception 当转换失败抛出异常
 	 */
 	bool fromString(const std::string& val) override;
 
 	/*!
-	 * @brief  ConfigVar<T>   T  name
+	 * @brief 将文本用 FromStr 转换后按 ConfigBinary<T> 编码
+	 */
+	bool toBinary(const std::string& text, ByteArray& ba) override;
+
+	/*!
+	 * @brief 按 ConfigBinary<T> 解码后 setValue
+	 */
+	bool fromBinary(ByteArray& ba) override;
+
+	/*!
+	 * @brief 返回 ConfigVar<T> 中 类型 T 的 name
 	 */
 	std::string getTypeName() const override;
 
 	/*!
-	 * @brief ֵʱ򣬼ֵǷ仯ӦĲ
+	 * @brief 设置值的时候，监听值是否发生，如果发生变化，做相应的操作
 	 */
 	void setValue(const T& val);
 
 	/*!
-	 * @brief ֵ
+	 * @brief 返回当前值的副本
+	 * @details 不加锁；之前返回的引用在锁释放后可能失效，现在按值返回。
+	 *          值较大且读取频繁时用 read 或 ConfigVarCache 避免复制
 	 */
-	const T& getValue();
+	T getValue() const;
 
 	/*!
-	 * @brief Ӽ
+	 * @brief 在读临界区内以 fun(const T&) 访问当前值，不复制
+	 * @details fun 中不能让出协程，也不能保存值的引用
+	 */
+	template<class F>
+	auto read(F fun) const -> decltype(fun(std::declval<const T&>()));
+
+	/*!
+	 * @brief 返回值的版本号，每次 setValue 改变值后加一
+	 */
+	uint64_t getVersion() const override { return __version.load(std::memory_order_acquire); }
+
+	/*!
+	 * @brief 增加监听
 	 */
 	uint64_t addListener(on_change_cb cb);
 
 	/*!
-	 * @brief ɾ
+	 * @brief 删除监听
 	 */
 	void delListener(uint64_t key);
 
 	/*!
-	 * @brief ü
+	 * @brief 获得监听器
 	 */
 	on_change_cb getListener(uint64_t key);
 
 	/*!
-	 * @brief ռ
+	 * @brief 清空监听器
 	 */
 	void clearListener();
 };
 
-class Config {
+/*!
+ * @brief 配置值的线程局部缓存
+ * @details 以 static thread_local 声明，get 只读一次版本号，版本变化时才重新复制值。
+ *          返回的引用在本线程下次调用 get 之前有效
+ */
+template<class T, class FromStr, class ToStr>
+class ConfigVarCache {
+private:
+	std::shared_ptr<ConfigVar<T, FromStr, ToStr>> __var;
+	uint64_t __version = ~0ull;
+	T __value;
 public:
-	using RWMutexType = RWMutex;
+	ConfigVarCache(std::shared_ptr<ConfigVar<T, FromStr, ToStr>> var) : __var(var) {}
+
+	const T& get() {
+		// 先读版本再读值：读到的值只会比版本新，下次调用时会再刷新一次
+		uint64_t version = __var->getVersion();
+		if (version != __version) {
+			__value = __var->getValue();
+			__version = version;
+		}
+		return __value;
+	}
+};
+
+class Config {
 private:
-	static ConfigVarMap& GetDatas();
-	static RWMutexType& GetMutex();
+	/*!
+	 * @brief 所有配置项，写时复制，查找时不加锁
+	 */
+	static RcuPtr<ConfigVarMap>& GetDatas();
 public:
 	template<class T>
 	static ConfigVar_ptr<T> Lookup(const std::string& name, const T& value, const std::string& description = "");
@@ -148,11 +343,50 @@ public:
 
 	static ConfigVarBase_ptr LookupBase(const std::string& name);
 
-	static void LoadFromYaml(const YAML::Node& root);
+	/*!
+	 * @brief 从 YAML 加载配置
+	 * @details 记录每个配置项上次加载的文本，文本未变且值未被 setValue 改过的
+	 *          配置项不再转换，也不会触发监听器
+	 * @return 实际更新的配置项数
+	 */
+	static size_t LoadFromYaml(const YAML::Node& root);
+
+	/*!
+	 * @brief 加载一个 YAML 文件
+	 * @return 实际更新的配置项数，解析失败返回 0
+	 */
+	static size_t LoadFromFile(const std::string& path);
+
+	/*!
+	 * @brief 加载目录下所有 .yml/.yaml 文件
+	 * @param force 为 false 时跳过修改时间未变的文件
+	 * @return 实际更新的配置项数
+	 */
+	static size_t LoadFromConfDir(const std::string& path, bool force = false);
+
+	/*!
+	 * @brief 将配置目录编译为二进制快照
+	 * @details 快照记录每个文件的路径、大小与修改时间，以及已注册配置项按
+	 *          ConfigBinary 编码的值，启动时无需再解析 YAML。未注册的标量保存文本
+	 * @return 有文件解析失败或写入失败返回 false
+	 */
+	static bool SaveSnapshot(const std::string& path, const std::string& snapshot);
+
+	/*!
+	 * @brief 从快照加载配置目录
+	 * @return 实际更新的配置项数，快照不存在、校验失败或已过期返回 -1
+	 */
+	static int64_t LoadFromSnapshot(const std::string& path, const std::string& snapshot);
+
+	/*!
+	 * @brief 优先从快照加载，快照不可用时解析 YAML 并重新生成快照
+	 * @return 实际更新的配置项数
+	 */
+	static size_t LoadWithSnapshot(const std::string& path, const std::string& snapshot);
 };
 
 //****************************************************************************
-// ΪģԼģ庯ʵ
+// 以下为模板类以及模板函数的实现
 //****************************************************************************
 
 
@@ -167,12 +401,11 @@ ConfigVar<T, FromStr, ToStr>::ConfigVar(const std::string& name, const T& value,
 template<class T, class FromStr, class ToStr>
 std::string ConfigVar<T, FromStr, ToStr>::toString() {
 	try {
-		RWMutexType::ReadLock lock(__mutex);
-		return ToStr()(__val);
+		return read([](const T& val) { return ToStr()(val); });
 	} catch (std::exception& e) {
 		SYLAR_LOG_ERROR(SYLAR_LOG_ROOT())
 			<< "ConfigVar::tostd::string exception " << e.what()
-			<< " convert: " << typeid(__val).name() << " to std::string"
+			<< " convert: " << typeid(T).name() << " to std::string"
 			<< " name = " << __name;
 	}
 	return "";
@@ -192,6 +425,37 @@ bool ConfigVar<T, FromStr, ToStr>::fromString(const std::string& val) {
 	return false;
 }
 
+template<class T, class FromStr, class ToStr>
+bool ConfigVar<T, FromStr, ToStr>::toBinary(const std::string& text, ByteArray& ba) {
+	if constexpr (ConfigBinary<T>::supported) {
+		try {
+			ConfigBinary<T>::Write(ba, FromStr()(text));
+			return true;
+		} catch (std::exception& e) {
+			SYLAR_LOG_ERROR(SYLAR_LOG_ROOT())
+				<< "ConfigVar::toBinary exception " << e.what()
+				<< " convert: std::string to " << typeid(T).name()
+				<< " name = " << __name << " - " << text;
+		}
+	}
+	return false;
+}
+
+template<class T, class FromStr, class ToStr>
+bool ConfigVar<T, FromStr, ToStr>::fromBinary(ByteArray& ba) {
+	if constexpr (ConfigBinary<T>::supported) {
+		try {
+			setValue(ConfigBinary<T>::Read(ba));
+			return true;
+		} catch (std::exception& e) {
+			SYLAR_LOG_ERROR(SYLAR_LOG_ROOT())
+				<< "ConfigVar::fromBinary exception " << e.what()
+				<< " name = " << __name;
+		}
+	}
+	return false;
+}
+
 template<class T, class FromStr, class ToStr>
 std::string ConfigVar<T, FromStr, ToStr>::getTypeName() const {
 	return typeid(T).name();
@@ -199,24 +463,35 @@ std::string ConfigVar<T, FromStr, ToStr>::getTypeName() const {
 
 template<class T, class FromStr, class ToStr>
 void ConfigVar<T, FromStr, ToStr>::setValue(const T& val) {
-	{
-		RWMutexType::ReadLock lock(__mutex);
-		// ȽҪԶ
-		if (val == __val) return;
-		for (auto& i : __cbs) {
-			// ִлصڹ۲ģʽ
-			i.second(__val, val);
-		}
-	}
+	// 比较、回调与发布在同一把写锁内完成，并发的 setValue 不会交错。
+	// 回调中可以 getValue(读到旧值)，但不能再增删本配置项的监听或 setValue
 	RWMutexType::WriteLock lock(__mutex);
-	// ֵ
-	__val = val;
+	// 比较运算符需要在自定义类中重载
+	T old = getValue();
+	if (val == old) return;
+	for (auto& i : __cbs) {
+		// 依次执行回调函数，类似于观察者模式
+		i.second(old, val);
+	}
+	// 发布新快照，旧快照等读者离开后释放
+	__val.update([&val](T& v) {
+		v = val;
+		return true;
+	});
+	__version.fetch_add(1, std::memory_order_release);
 }
 
 template<class T, class FromStr, class ToStr>
-const T& ConfigVar<T, FromStr, ToStr>::getValue() {
-	RWMutexType::ReadLock lock(__mutex);
-	return __val;
+T ConfigVar<T, FromStr, ToStr>::getValue() const {
+	Rcu::ReadLock lock;
+	return *__val.get();
+}
+
+template<class T, class FromStr, class ToStr>
+template<class F>
+auto ConfigVar<T, FromStr, ToStr>::read(F fun) const -> decltype(fun(std::declval<const T&>())) {
+	Rcu::ReadLock lock;
+	return fun(*__val.get());
 }
 
 template<class T, class FromStr, class ToStr>
@@ -254,36 +529,43 @@ void ConfigVar<T, FromStr, ToStr>::clearListener() {
 
 template<class T>
 ConfigVar_ptr<T> Config::Lookup(const std::string& name, const T& value, const std::string& description) {
-	RWMutexType::WriteLock lock(GetMutex());
-	auto it = GetDatas().find(name);
-	if (it != GetDatas().end()) {
-		auto tmp = std::dynamic_pointer_cast<ConfigVar<T>>(it->second);
-		if (tmp) {
-			SYLAR_LOG_INFO(SYLAR_LOG_ROOT()) << "Lookup name = " << name << " exists ";
-			return tmp;
-		} else {
-			SYLAR_LOG_ERROR(SYLAR_LOG_ROOT()) << "Lookup name = " << name << " exists but type not "
-				<< typeid(T).name() << " real_type = " << it->second->getTypeName()
-				<< " " << it->second->toString();
-			return nullptr;
+	ConfigVarBase_ptr exists = LookupBase(name);
+	if (!exists) {
+		if (name.find_first_not_of("abcdefghikjlmnopqrstuvwxyz._0123456789") != std::string::npos) {
+			SYLAR_LOG_ERROR(SYLAR_LOG_ROOT()) << "Lookup name invalid " << name;
+			throw std::invalid_argument(name);
+		}
+		ConfigVar_ptr<T> v = std::make_shared<ConfigVar<T>>(name, value, description);
+		// 并发注册同名配置时以先发布的为准
+		GetDatas().update([&name, &v, &exists](ConfigVarMap& datas) {
+			auto& slot = datas[name];
+			if (slot) {
+				exists = slot;
+				return false;
+			}
+			slot = v;
+			return true;
+		});
+		if (!exists) {
+			return v;
 		}
 	}
 
-	if (name.find_first_not_of("abcdefghikjlmnopqrstuvwxyz._0123456789") != std::string::npos) {
-		SYLAR_LOG_ERROR(SYLAR_LOG_ROOT()) << "Lookup name invalid " << name;
-		throw std::invalid_argument(name);
+	auto tmp = std::dynamic_pointer_cast<ConfigVar<T>>(exists);
+	if (tmp) {
+		SYLAR_LOG_INFO(SYLAR_LOG_ROOT()) << "Lookup name = " << name << " exists ";
+		return tmp;
+	} else {
+		SYLAR_LOG_ERROR(SYLAR_LOG_ROOT()) << "Lookup name = " << name << " exists but type not "
+			<< typeid(T).name() << " real_type = " << exists->getTypeName()
+			<< " " << exists->toString();
+		return nullptr;
 	}
-	ConfigVar_ptr<T> v = std::make_shared<ConfigVar<T>>(name, value, description);
-	GetDatas()[name] = v;
-	return v;
 }
 
 template<class T>
 ConfigVar_ptr<T> Config::Lookup(const std::string& name) {
-	RWMutexType::ReadLock lock(GetMutex());
-	auto it = GetDatas().find(name);
-	if (it == GetDatas().end()) return nullptr;
-	else return std::dynamic_pointer_cast<ConfigVar<T>>(it->second);
+	return std::dynamic_pointer_cast<ConfigVar<T>>(LookupBase(name));
 }
 
 
@@ -0,0 +1,108 @@
+//*****************************************************************************
+//
+//
+//   此头文件实现配置目录监视：inotify 发现文件变化后只重新加载变化的文件
+//
+//
+//*****************************************************************************
+
+#ifndef SYLAR_CONFIGWATCHER_H
+#define SYLAR_CONFIGWATCHER_H
+
+#include <memory>
+#include <map>
+#include <set>
+#include <string>
+#include <atomic>
+#include <boost/noncopyable.hpp>
+#include "Mutex.h"
+
+namespace sylar
+{
+
+//****************************************************************************
+// 前置声明
+//****************************************************************************
+
+class IOManager;
+
+class Timer;
+using Timer_ptr = std::shared_ptr<Timer>;
+
+class ConfigWatcher;
+using ConfigWatcher_ptr = std::shared_ptr<ConfigWatcher>;
+
+//****************************************************************************
+// 配置目录监视
+//****************************************************************************
+
+/*!
+ * @brief 监视配置目录，自动重新加载变化的 .yml/.yaml 文件
+ * @details inotify 句柄注册在 IOManager 上，与 Config::LoadFromConfDir 一样包含
+ *          子目录：每个子目录各有一个监视，新建或移入的子目录随即加入。
+ *          文件写完(IN_CLOSE_WRITE)或被改名
+ *          移入(IN_MOVED_TO，编辑器常用的保存方式)时记下文件名；最后一次变化
+ *          debounce_ms 毫秒后只解析这些文件，由 Config::LoadFromYaml 对比每个
+ *          配置项上次加载的文本，只有变化的配置项才会转换并通知监听器
+ */
+class ConfigWatcher : public std::enable_shared_from_this<ConfigWatcher>, public boost::noncopyable {
+public:
+    using MutexType = Mutex;
+private:
+    IOManager* __iom;
+    std::string __path;
+    uint64_t __debounceMS;
+    int __fd = -1;                      // inotify 句柄
+    std::map<int, std::string> __dirs;  // 监视描述符 -> 目录，只在 start 与 onReadable 中访问
+    MutexType __mutex;
+    std::set<std::string> __pending;    // 等待加载的文件(完整路径)
+    Timer_ptr __timer;                  // 去抖定时器
+    bool __stopping = false;
+    std::atomic<uint64_t> __reloads = { 0 };    // 加载文件的次数
+private:
+    /*!
+     * @brief 监视目录及其所有子目录
+     * @param files 非空时收集其中已有的配置文件
+     * @return 目录本身监视失败返回 false
+     */
+    bool addWatch(const std::string& dir, std::set<std::string>* files);
+
+    /*!
+     * @brief 读出所有 inotify 事件并重新注册读事件
+     */
+    void onReadable();
+
+    /*!
+     * @brief 去抖时间到，加载变化的文件
+     */
+    void onTimer();
+public:
+    /*!
+     * @param path 配置目录
+     * @param debounce_ms 最后一次变化后等待的毫秒数
+     * @param iom 注册 inotify 句柄的 IOManager，默认当前线程的
+     */
+    ConfigWatcher(const std::string& path, uint64_t debounce_ms = 200, IOManager* iom = nullptr);
+
+    ~ConfigWatcher();
+
+    /*!
+     * @brief 开始监视
+     * @return inotify 初始化或注册失败返回 false
+     */
+    bool start();
+
+    /*!
+     * @brief 停止监视，尚未加载的变化被丢弃
+     */
+    void stop();
+
+    /*!
+     * @brief 获取加载文件的次数
+     */
+    uint64_t getReloads() const { return __reloads; }
+};
+
+}; /* sylar */
+
+#endif /* SYLAR_CONFIGWATCHER_H */
@@ -1,7 +1,7 @@
 //*****************************************************************************
 //
 //
-//   ͷļʵֽ/Сˣ
+//   此头文件实现字节序操作函数（大端/小端）
 //  
 //
 //*****************************************************************************
@@ -9,8 +9,8 @@
 #ifndef SYLAR_ENDIAN_H
 #define SYLAR_ENDIAN_H
 
-#define SYLAR_LITTLE_ENDIAN 1 // С
-#define SYLAR_BIG_ENDIAN 2 // 
+#define SYLAR_LITTLE_ENDIAN 1 // 小端
+#define SYLAR_BIG_ENDIAN 2 // 大端
 
 #include <byteswap.h>
 #include <stdint.h>
@@ -19,7 +19,7 @@ namespace sylar
 {
 
 /*!
- * @brief 8ֽ͵ֽת
+ * @brief 8字节类型的字节序转化
  */
 template<class T>
 typename std::enable_if<sizeof(T) == sizeof(uint64_t), T>::type
@@ -28,7 +28,7 @@ byteswap(T value) {
 }
 
 /*!
- * @brief 4ֽ͵ֽת
+ * @brief 4字节类型的字节序转化
  */
 template<class T>
 typename std::enable_if<sizeof(T) == sizeof(uint32_t), T>::type
@@ -37,7 +37,7 @@ byteswap(T value) {
 }
 
 /*!
- * @brief 2ֽ͵ֽת
+ * @brief 2字节类型的字节序转化
  */
 template<class T>
 typename std::enable_if<sizeof(T) == sizeof(uint16_t), T>::type
@@ -54,7 +54,7 @@ byteswap(T value) {
 #if SYLAR_BYTE_ORDER == SYLAR_BIG_ENDIAN
 
 /*!
- * @brief ֻС˻ִbyteswap, ڴ˻ʲô
+ * @brief 只在小端机器上执行byteswap, 在大端机器上什么都不做
  */
 template<class T>
 T byteswapOnLittleEndian(T t) {
@@ -62,7 +62,7 @@ T byteswapOnLittleEndian(T t) {
 }
 
 /*!
- * @brief ֻڴ˻ִbyteswap, С˻ʲô
+ * @brief 只在大端机器上执行byteswap, 在小端机器上什么都不做
  */
 template<class T>
 T byteswapOnBigEndian(T t) {
@@ -72,7 +72,7 @@ T byteswapOnBigEndian(T t) {
 #else
 
 /*!
- * @brief ֻС˻ִbyteswap, ڴ˻ʲô
+ * @brief 只在小端机器上执行byteswap, 在大端机器上什么都不做
  */
 template<class T>
 T byteswapOnLittleEndian(T t) {
@@ -80,7 +80,7 @@ T byteswapOnLittleEndian(T t) {
 }
 
 /*!
- * @brief ֻڴ˻ִbyteswap, С˻ʲô
+ * @brief 只在大端机器上执行byteswap, 在小端机器上什么都不做
  */
 template<class T>
 T byteswapOnBigEndian(T t) {
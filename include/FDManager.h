@@ -1,7 +1,7 @@
 //*****************************************************************************
 //
 //
-//   ͷļʵЭģ
+//   此头文件实现协程模块
 //  
 //
 //*****************************************************************************
@@ -11,16 +11,23 @@
 
 #include <memory>
 #include <vector>
+#include <string>
+#include <atomic>
+#include <ostream>
 #include "Single.h"
 #include "Mutex.h"
+#include "Timer.h"
+#include "Clock.h"
 
 namespace sylar
 {
 
 //****************************************************************************
-// ǰ
+// 前置声明
 //****************************************************************************
 
+class IOManager;
+
 class FDCtx;
 using FDCtx_ptr = std::shared_ptr <FDCtx>;
 
@@ -28,119 +35,280 @@ class FDManager;
 using FDManager_single = Single<FDManager>;
 
 //****************************************************************************
-// ļ
+// 文件句柄 IO 统计
+//****************************************************************************
+
+/*!
+ * @brief 单个文件句柄的 IO 统计快照，由 hook 的 do_io 累计
+ */
+struct FDStats {
+    /*!
+     * @brief 统计项，可作为排序依据
+     */
+    enum Metric {
+        BYTES_READ = 0,     // 读取字节数
+        BYTES_WRITTEN,      // 写入字节数
+        SYSCALLS,           // 系统调用次数
+        EAGAINS,            // 返回 EAGAIN 的次数
+        SUSPEND_US,         // 在 YieldToHold 中挂起的时间(微秒)
+        TIMEOUTS,           // 超时次数
+        METRIC_COUNT
+    };
+
+    int fd = -1;
+    uint64_t values[METRIC_COUNT] = { 0 };
+
+    /*!
+     * @brief 获取统计项的值
+     */
+    uint64_t get(Metric metric) const { return values[metric]; }
+
+    /*!
+     * @brief 统计项名称
+     */
+    static const char* ToString(Metric metric);
+
+    /*!
+     * @brief 由名称解析统计项(如 "bytes_read")
+     * @return 名称是否合法
+     */
+    static bool FromString(const std::string& str, Metric& metric);
+};
+
+//****************************************************************************
+// 文件句柄上下文类
 //****************************************************************************
 
 /*!
- * @brief ļࡣļͣǷsocketǷǷرգ/дʱʱ
+ * @brief 文件句柄上下文类。管理文件句柄类型（是否socket），是否阻塞，是否关闭，读/写超时时间
  */
 class FDCtx : public std::enable_shared_from_this<FDCtx> {
+private:
+    /*!
+     * @brief 连接级截止时间的定时器节点，整个连接生命周期内复用
+     * @details 读、写各一个：两个方向的等待者可能在不同的 IOManager 上，
+     *          共用一个节点时后挂载的一方会把另一方的定时器摘掉
+     */
+    struct DeadlineNode : public TimerNode {
+        FDCtx* ctx;
+        int dir;    // 读(0)/写(1)
+        DeadlineNode(FDCtx* c, int d) : TimerNode(&FDCtx::OnDeadline), ctx(c), dir(d) {}
+    };
 private: 
-    bool __isInit : 1;          // Ƿʼ
-    bool __isSocket : 1;        // Ƿsocket
-    bool __sysNonblock : 1;     // Ƿhook
-    bool __userNonblock : 1;    // Ƿû÷
-    bool __isClosed : 1;        // Ƿر
-    int __fd;                   // ļ 
-    uint64_t __recvTimeout;     // ʱʱ
-    uint64_t __sendTimeout;     // дʱʱ
+    bool __isInit : 1;          // 是否初始化
+    bool __isSocket : 1;        // 是否socket
+    bool __sysNonblock : 1;     // 是否hook非阻塞
+    bool __userNonblock : 1;    // 是否用户主动设置非阻塞
+    bool __isClosed : 1;        // 是否关闭
+    int __fd;                   // 文件句柄 
+    uint64_t __recvTimeout;     // 读超时时间毫秒
+    uint64_t __sendTimeout;     // 写超时时间毫秒
+    std::atomic<uint64_t> __stats[FDStats::METRIC_COUNT];   // IO 统计
+
+    SpinLock __deadlineMutex;               // 保护以下截止时间与等待状态
+    uint64_t __deadline[2];                 // 读/写的绝对截止时间(Clock 微秒)，~0ull 表示不限
+    std::atomic<uint64_t> __idleTimeout;    // 空闲超时(微秒)，0 表示不限
+    std::atomic<uint64_t> __lastActive;     // 最近一次读写成功的时间(Clock 微秒)
+    IOManager* __waitIom[2];                // 等待读/写的协程所在的 IOManager，nullptr 表示没有等待
+    bool __timedOut[2];                     // 等待是否因截止时间到达而结束
+    DeadlineNode __deadlineNode[2];         // 读/写的截止时间定时器，最后声明，析构时最先取消
 private:
     /*!
-     * @brief ʼ
+     * @brief 初始化
      */
     bool init();
+
+    /*!
+     * @brief 计算读(0)/写(1)方向生效的截止时间，需持有 __deadlineMutex
+     */
+    uint64_t effectiveDeadline(int dir) const;
+
+    /*!
+     * @brief 截止时间可能提前时，保证有等待者的方向按时唤醒
+     */
+    void rearmWaiters();
+
+    /*!
+     * @brief 截止时间定时器的回调，在 TimerManager 的锁内执行
+     * @details 到期时取消该方向等待者的事件并标记超时，截止时间被推迟的则顺延定时器。
+     *          __deadlineMutex 内只读写等待状态，cancelEvent 在释放后调用
+     */
+    static void OnDeadline(TimerNode* node);
 public:
     /*!
-     * @brief 캯
-     * @param fd ļ
+     * @brief 构造函数
+     * @param fd 文件句柄
      */
     FDCtx(int fd);
 
     /*!
-     * @brief 
+     * @brief 析构函数
      */
     ~FDCtx();
 
     /*!
-     * @brief Ƿʼ
+     * @brief 是否初始化完成
      */
     bool isInit() const;
 
     /*!
-     * @brief Ƿ socket
+     * @brief 是否 socket
      */
     bool isSocket() const;
 
     /*!
-     * @brief Ƿѹر
+     * @brief 是否已关闭
      */
     bool isClose() const;
 
     /*!
-     * @brief û
+     * @brief 设置用户非阻塞
      */
     void setUserNonblock(bool v);
 
     /*!
-     * @brief ȡû
+     * @brief 获取用户非阻塞
      */
     bool getUserNonblock() const;
 
     /*!
-     * @brief ϵͳ
+     * @brief 设置系统非阻塞
      */
     void setSysNonblock(bool v);
 
     /*!
-     * @brief ȡϵͳ
+     * @brief 获取系统非阻塞
      * @return 
      */
     bool getSysNonblock() const;
 
     /*!
-     * @brief óʱʱ
-     * @param type SO_RCVTIMEO(ʱ), SO_SNDTIMEO(дʱ)
-     * @param v ʱ䣨룩
+     * @brief 设置超时时间
+     * @param type 类型SO_RCVTIMEO(读超时), SO_SNDTIMEO(写超时)
+     * @param v 时间（毫秒）
      */
     void setTimeout(int type, uint64_t v);
 
     /*!
-     * @brief ȡʱʱ
-     * @param type SO_RCVTIMEO(ʱ), SO_SNDTIMEO(дʱ)
-     * @return ʱʱ䣨룩
+     * @brief 获取超时时间
+     * @param type 类型SO_RCVTIMEO(读超时), SO_SNDTIMEO(写超时)
+     * @return 超时时间（毫秒）
      */
     uint64_t getTimeout(int type);
+
+    /*!
+     * @brief 设置连接级截止时间，到达后该方向的阻塞 IO 返回 ETIMEDOUT
+     * @details 与 setTimeout 的每次调用超时不同，截止时间是绝对的，由一个常驻的定时器
+     *          覆盖整个连接，设置后优先于 setTimeout
+     * @param type 类型SO_RCVTIMEO(读), SO_SNDTIMEO(写)
+     * @param deadline_us 绝对时间(Clock 单调时钟，微秒)，~0ull 表示取消
+     */
+    void setDeadline(int type, uint64_t deadline_us);
+
+    /*!
+     * @brief 获取连接级截止时间
+     * @param type 类型SO_RCVTIMEO(读), SO_SNDTIMEO(写)
+     */
+    uint64_t getDeadline(int type);
+
+    /*!
+     * @brief 取消截止时间定时器，清除截止时间、空闲超时与等待状态
+     * @details fd 关闭后 FDCtx 可能仍被持有，避免截止时间留给复用该 fd 的连接
+     */
+    void resetDeadlines();
+
+    /*!
+     * @brief 设置空闲超时，超过 ms 毫秒没有成功读写时阻塞 IO 返回 ETIMEDOUT
+     * @param ms 毫秒，0 表示取消
+     */
+    void setIdleTimeout(uint64_t ms);
+
+    /*!
+     * @brief 获取空闲超时(毫秒)
+     */
+    uint64_t getIdleTimeout() const;
+
+    /*!
+     * @brief 获取读/写方向生效的截止时间(取截止时间与空闲超时中较早者)
+     * @return ~0ull 表示没有连接级截止时间
+     */
+    uint64_t getEffectiveDeadline(int type);
+
+    /*!
+     * @brief 记录一次成功的读写，推迟空闲超时
+     */
+    void touch() {
+        if (__idleTimeout.load(std::memory_order_relaxed)) {
+            __lastActive.store(Clock::NowUS(), std::memory_order_relaxed);
+        }
+    }
+
+    /*!
+     * @brief 协程已在 iom 上注册事件、即将挂起时调用，按截止时间挂载定时器
+     * @param type 类型SO_RCVTIMEO(读), SO_SNDTIMEO(写)
+     */
+    void beginWait(int type, IOManager* iom);
+
+    /*!
+     * @brief 协程被唤醒后调用
+     * @return 是否因截止时间到达而被唤醒
+     */
+    bool endWait(int type);
+
+    /*!
+     * @brief 累加统计项，读写可能在不同线程，使用 relaxed 原子操作
+     */
+    void addStat(FDStats::Metric metric, uint64_t v) {
+        __stats[metric].fetch_add(v, std::memory_order_relaxed);
+    }
+
+    /*!
+     * @brief 获取统计快照
+     */
+    FDStats getStats() const;
 };
 
 //****************************************************************************
-// ļ
+// 文件句柄管理类
 //****************************************************************************
 
 class FDManager {
 public:
     using RWMutexType = RWMutex;
 private:
-    RWMutexType __mutex;            // д
-    std::vector<FDCtx_ptr> __datas; // ļ
+    RWMutexType __mutex;            // 读写锁
+    std::vector<FDCtx_ptr> __datas; // 文件句柄集合
 public:
     /*!
-     * @brief ޲ι캯
+     * @brief 无参构造函数
      */
     FDManager();
 
     /*!
-     * @brief ȡ/ļ FDCtx
-     * @param fd ļ
-     * @param auto_create ǷԶ
-     * @return ضӦļ FDCtx_ptr
+     * @brief 获取/创建文件句柄类 FDCtx
+     * @param fd 文件句柄
+     * @param auto_create 是否自动创建
+     * @return 返回对应文件句柄类 FDCtx_ptr
      */
     FDCtx_ptr get(int fd, bool auto_create = false);
 
     /*!
-     * @brief ɾļ
-     * @param fd ļ
+     * @brief 删除文件句柄类
+     * @param fd 文件句柄
      */
     void del(int fd);
+
+    /*!
+     * @brief 按统计项从大到小取前 n 个文件句柄
+     * @param metric 排序依据
+     * @param n 数量
+     */
+    std::vector<FDStats> top(FDStats::Metric metric, size_t n);
+
+    /*!
+     * @brief 输出按统计项排序的前 n 个文件句柄
+     */
+    std::ostream& dumpTop(std::ostream& os, FDStats::Metric metric, size_t n);
 };
 
 }; /* sylar */
@@ -1,7 +1,7 @@
 //*****************************************************************************
 //
 //
-//   ͷļʵЭģ
+//   此头文件实现协程模块
 //  
 //
 //*****************************************************************************
@@ -17,7 +17,7 @@ namespace sylar
 {
 
 //****************************************************************************
-// ǰ
+// 前置声明
 //****************************************************************************
 
 class Fiber;
@@ -26,135 +26,135 @@ using Fiber_ptr = std::shared_ptr<Fiber>;
 class Scheduler;
 
 //****************************************************************************
-// Э
+// 协程类
 //****************************************************************************
 
 /*!
- * @brief Э״̬
+ * @brief 协程状态
  */
 enum FiberState {
-	// ʼ״̬
+	// 初始化状态
 	INIT,  
-	// ͣ״̬
+	// 暂停状态
 	HOLD,  
-	// ִ״̬
+	// 执行中状态
 	EXEC,  
-	// ״̬
+	// 结束状态
 	TERM,  
-	// ִ״̬
+	// 可执行状态
 	READY, 
-	// 쳣״̬
+	// 异常状态
 	EXCEPT 
 };
 
 /*!
- * @brief Э
+ * @brief 协程类
  */
 class Fiber : public std::enable_shared_from_this<Fiber> {
 	friend class Scheduler;
 private:
-	// Эid
+	// 协程id
 	uint64_t __id = 0;
-	// ЭջС
+	// 协程运行栈大小
 	uint32_t __stack_size = 0;
-	// Э״̬
+	// 协程状态
 	FiberState __state = FiberState::INIT;
-	// Э
+	// 协程上下文
 	ucontext_t __ucontext;
-	// Эջָ
+	// 协程运行栈指针
 	void* __stack = nullptr;
-	// Эк
+	// 协程运行函数
 	std::function<void()> __cb;
 private:
 	/*!
-	 * @brief ޲ι캯 ÿ̵߳һЭ̵Ĺ
+	 * @brief 无参构造函数 每个线程第一个协程的构造
 	 */
 	Fiber();
 public:
 	/*!
-	 * @brief صǰЭ
+	 * @brief 返回当前协程
 	 */
 	static Fiber_ptr GetThis();
 
 	/*!
-	 * @brief õǰ̵߳Э
+	 * @brief 设置当前线程的运行协程
 	 */
 	static void SetThis(Fiber* f);
 
 	/*!
-	 * @brief ȡǰЭ̵ id
+	 * @brief 获取当前协程的 id
 	 */
 	static uint64_t GetFiberId();
 
 	/*!
-	 * @brief ǰЭл̨ΪREADY״̬
+	 * @brief 将当前协程切换到后台，并设置为READY状态
 	 */
 	static void YieldToReady();
 
 	/*!
-	 * @brief ǰЭл̨ΪHOLD״̬
+	 * @brief 将当前协程切换到后台，并设置为HOLD状态
 	 */
 	static void YieldToHold();
 
 	/*!
-	 * @brief 1ǰЭ̵
+	 * @brief 返回1当前协程的总数量
 	 */
 	static uint64_t TotalFibers();
 
 	/*!
-	 * @brief Эִкִɺ󷵻߳Э
+	 * @brief 协程执行函数，执行完成后返回线程主协程
 	 */
 	static void MainFunc();
 
 	/*!
-	 * @brief Эִкִɷص̵߳Э
+	 * @brief 协程执行函数，执行完成返回到线程调度协程
 	 */
 	static void CallerMainFunc();
 
 	/*!
-	 * @brief 캯
-	 * @param cb ЭִеĻص
-	 * @param stacksize ЭջС
+	 * @brief 构造函数
+	 * @param cb 协程执行的回调函数
+	 * @param stacksize 协程栈大小
 	 */
 	Fiber(std::function<void()> cb, std::size_t stacksize = 0, bool use_caller = false);
 
 	/*!
-	 * @brief 
+	 * @brief 析构函数
 	 */
 	~Fiber();
 
 	/*!
-	 * @brief Э id
+	 * @brief 返回协程 id
 	 */
 	uint64_t getId() const;
 
 	/*!
-	 * @brief Э״̬
+	 * @brief 返回协程状态
 	 */
 	FiberState getState() const;
 
 	/*!
-	 * @brief ЭִеĻص,״̬
+	 * @brief 重置协程执行的回调函数,并重置状态
 	 */
 	void reset(std::function<void()> cb);
 
 	/*!
-	 * @brief ǰЭл״̬
+	 * @brief 将当前协程切换到运行状态
 	 */
 	void swapIn();
 
 	/*!
-	 * @brief ǰЭл̨
+	 * @brief 将当前协程切换到后台
 	 */
 	void swapOut();
 
 	/*!
-	 * @brief ǰ߳лִ״ִ̬Э
+	 * @brief 将当前线程切换到执行状态，并执行主协程
 	 */
 	void call();
 
 	/*!
-	 * @brief ǰ߳лִ̨еǰЭ
+	 * @brief 将当前线程切换到后台，并执行当前协程
 	 */
 	void back();
 };
@@ -0,0 +1,148 @@
+//*****************************************************************************
+//
+//
+//   此头文件实现普通文件 IO 的后台线程池
+//
+//
+//*****************************************************************************
+
+#ifndef SYLAR_FILEIO_H
+#define SYLAR_FILEIO_H
+
+#include <memory>
+#include <vector>
+#include <deque>
+#include <atomic>
+#include <ostream>
+#include <functional>
+#include <unordered_map>
+#include <sys/types.h>
+#include <boost/noncopyable.hpp>
+#include "Mutex.h"
+#include "Single.h"
+
+namespace sylar
+{
+
+//****************************************************************************
+// 前置声明
+//****************************************************************************
+
+class Fiber;
+using Fiber_ptr = std::shared_ptr<Fiber>;
+
+class Scheduler;
+
+class Thread;
+using Thread_ptr = std::shared_ptr<Thread>;
+
+class FileIOPool;
+using FileIOPool_single = Single<FileIOPool>;
+
+//****************************************************************************
+// 普通文件 IO 线程池
+//****************************************************************************
+
+/*!
+ * @brief 普通文件 IO 线程池
+ * @details 普通文件没有 EAGAIN，epoll 也无法等待，hook 后的 read/write/pread/pwrite/fsync
+ *          在开启 fileio.offload 后把系统调用交给后台线程执行，发起的协程让出，
+ *          完成后再调度回原调度器。同一设备(st_dev)上同时执行的请求数受
+ *          fileio.device_concurrency 限制，避免一块慢盘占满所有线程
+ */
+class FileIOPool : public boost::noncopyable {
+public:
+    using MutexType = Mutex;
+
+    /*!
+     * @brief 在作用域内禁止当前线程把文件 IO 交给线程池
+     * @details 持有线程锁时不能让出协程(例如日志输出)，用它包住临界区
+     */
+    class InlineGuard : public boost::noncopyable {
+    public:
+        InlineGuard();
+        ~InlineGuard();
+    };
+private:
+    /*!
+     * @brief 一次文件 IO 请求，放在发起协程的栈上
+     */
+    struct Job {
+        const std::function<ssize_t()>* fun = nullptr;
+        dev_t dev = 0;
+        ssize_t result = -1;
+        int err = 0;
+        uint64_t queuedUS = 0;
+        Scheduler* scheduler = nullptr;
+        Fiber_ptr fiber;
+    };
+
+    MutexType __mutex;
+    Semaphore __semaphore;                              // 可能有可执行请求时通知工作线程
+    std::deque<Job*> __jobs;                            // 等待执行的请求
+    std::unordered_map<dev_t, uint32_t> __running;      // 各设备正在执行的请求数
+    std::vector<Thread_ptr> __threads;
+    bool __stopping = false;
+
+    std::atomic<uint64_t> __submitted = { 0 };          // 交给线程池的请求数
+    std::atomic<uint64_t> __inlined = { 0 };            // 不满足条件直接执行的请求数
+    std::atomic<uint64_t> __throttled = { 0 };          // 因设备并发已满而排队的次数
+    std::atomic<uint64_t> __waitUS = { 0 };             // 请求在队列中等待的总时间
+private:
+    /*!
+     * @brief 按配置创建工作线程，第一次提交请求时调用
+     */
+    void start();
+
+    /*!
+     * @brief 工作线程主循环
+     */
+    void run();
+
+    /*!
+     * @brief 取出一个所在设备未达到并发上限的请求，没有则返回 nullptr
+     */
+    Job* take();
+public:
+    FileIOPool();
+
+    ~FileIOPool();
+
+    /*!
+     * @brief 是否开启文件 IO 卸载(配置 fileio.offload)
+     */
+    static bool IsEnabled();
+
+    /*!
+     * @brief 当前线程是否允许卸载(开关打开、处于调度器协程中且不在 InlineGuard 内)
+     */
+    static bool CanOffload();
+
+    /*!
+     * @brief 执行一次文件 IO
+     * @details fd 是普通文件且当前协程可以让出时交给线程池执行并让出协程，
+     *          否则直接在当前线程执行。errno 与直接调用一致
+     * @param fd 文件描述符，用于判断文件类型与所在设备
+     * @param fun 实际的系统调用
+     */
+    ssize_t execute(int fd, const std::function<ssize_t()>& fun);
+
+    /*!
+     * @brief 获取交给线程池执行的请求数
+     */
+    uint64_t getSubmitted() const { return __submitted; }
+
+    /*!
+     * @brief 获取直接在当前线程执行的请求数
+     */
+    uint64_t getInlined() const { return __inlined; }
+
+    /*!
+     * @brief 输出统计
+     */
+    std::ostream& dump(std::ostream& os);
+};
+
+}; /* sylar */
+
+#endif /* SYLAR_FILEIO_H */
@@ -1,7 +1,7 @@
 //*****************************************************************************
 //
 //
-//   Hook װ
+//   Hook 函数封装
 //  
 //
 //*****************************************************************************
@@ -12,17 +12,22 @@
 #include <time.h>
 #include <unistd.h>
 #include <stdint.h>
+#include <sys/types.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/select.h>
+#include <sys/epoll.h>
 
 namespace sylar
 {
 
 /*!
- * @brief ǰ߳Ƿ Hook
+ * @brief 当前线程是否 Hook
  */
 bool is_hook_enable();
 
 /*!
- * @brief õǰ̵߳ Hook ״̬
+ * @brief 设置当前线程的 Hook 状态
  */
 void set_hook_enable(bool flag);
 
@@ -66,6 +71,9 @@ extern read_fun read_f;
 using readv_fun = ssize_t(*)(int fd, const struct iovec* iov, int iovcnt);
 extern readv_fun readv_f;
 
+using pread_fun = ssize_t(*)(int fd, void* buf, size_t count, off_t offset);
+extern pread_fun pread_f;
+
 using recv_fun = ssize_t(*)(int sockfd, void* buf, size_t len, int flags);
 extern recv_fun recv_f;
 
@@ -85,6 +93,9 @@ extern write_fun write_f;
 using writev_fun = ssize_t(*)(int fd, const struct iovec* iov, int iovcnt);
 extern writev_fun writev_f;
 
+using pwrite_fun = ssize_t(*)(int fd, const void* buf, size_t count, off_t offset);
+extern pwrite_fun pwrite_f;
+
 using send_fun = ssize_t(*)(int s, const void* msg, size_t len, int flags);
 extern send_fun send_f;
 
@@ -94,9 +105,34 @@ extern sendto_fun sendto_f;
 using sendmsg_fun = ssize_t(*)(int s, const struct msghdr* msg, int flags);
 extern sendmsg_fun sendmsg_f;
 
+using sendfile_fun = ssize_t(*)(int out_fd, int in_fd, off_t* offset, size_t count);
+extern sendfile_fun sendfile_f;
+
+using splice_fun = ssize_t(*)(int fd_in, loff_t* off_in, int fd_out, loff_t* off_out, size_t len, unsigned int flags);
+extern splice_fun splice_f;
+
 using close_fun = int (*)(int fd);
 extern close_fun close_f;
 
+using fsync_fun = int (*)(int fd);
+extern fsync_fun fsync_f;
+
+//****************************************************************************
+// poll
+//****************************************************************************
+
+using poll_fun = int (*)(struct pollfd* fds, nfds_t nfds, int timeout);
+extern poll_fun poll_f;
+
+using ppoll_fun = int (*)(struct pollfd* fds, nfds_t nfds, const struct timespec* tmo_p, const sigset_t* sigmask);
+extern ppoll_fun ppoll_f;
+
+using select_fun = int (*)(int nfds, fd_set* readfds, fd_set* writefds, fd_set* exceptfds, struct timeval* timeout);
+extern select_fun select_f;
+
+using epoll_wait_fun = int (*)(int epfd, struct epoll_event* events, int maxevents, int timeout);
+extern epoll_wait_fun epoll_wait_f;
+
 //****************************************************************************
 // other
 //****************************************************************************
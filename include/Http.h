@@ -1,7 +1,7 @@
 //*****************************************************************************
 //
 //
-//   HTTPṹװ
+//   HTTP定义结构体封装
 //  
 //
 //*****************************************************************************
@@ -21,7 +21,7 @@ namespace sylar::http
 {
 
 //****************************************************************************
-// ǰ
+// 前置声明
 //****************************************************************************
 
 enum class HttpMethod;
@@ -35,7 +35,7 @@ class HttpResponse;
 using HttpResponse_ptr = std::shared_ptr<HttpResponse>;
 
 //****************************************************************************
-// HTTPö
+// HTTP方法枚举
 //****************************************************************************
 
 #define HTTP_METHOD_MAP(XX)         \
@@ -90,7 +90,7 @@ enum class HttpMethod {
 };
 
 //****************************************************************************
-// HTTP״̬ö
+// HTTP状态枚举
 //****************************************************************************
 
 #define HTTP_STATUS_MAP(XX)                                                 \
@@ -161,90 +161,90 @@ enum class HttpStatus {
 };
 
 //****************************************************************************
-// HTTP״̬غ
+// HTTP方法与状态相关函数
 //****************************************************************************
 
 /*!
- * @brief ַתHTTPö
- * @param m HTTP
- * @return HTTPö
+ * @brief 将字符串方法名转成HTTP方法枚举
+ * @param m HTTP方法
+ * @return HTTP方法枚举
  */
 HttpMethod StringToHttpMethod(const std::string& m);
 
 /*!
- * @brief ַָתHTTPö
- * @param m ַö
- * @return HTTPö
+ * @brief 将字符串指针转换成HTTP方法枚举
+ * @param m 字符串方法枚举
+ * @return HTTP方法枚举
  */
 HttpMethod CharsToHttpMethod(const char* m);
 
 /*!
- * @brief HTTPöתַ
- * @param m HTTPö
- * @return ַ
+ * @brief 将HTTP方法枚举转换成字符串
+ * @param m HTTP方法枚举
+ * @return 字符串
  */
 const char* HttpMethodToString(const HttpMethod& m);
 
 /*!
- * @brief HTTP״̬öתַ
- * @param s HTTP״̬ö
- * @return ַ
+ * @brief 将HTTP状态枚举转换成字符串
+ * @param s HTTP状态枚举
+ * @return 字符串
  */
 const char* HttpStatusToString(const HttpStatus& s);
 
 /*!
- * @brief ȡMapеkeyֵ,תɶӦ,Ƿɹ
- * @param m Mapݽṹ
- * @param key ؼ
- * @param val תֵ
- * @param def Ĭֵ
+ * @brief 获取Map中的key值,并转成对应类型,返回是否成功
+ * @param m Map数据结构
+ * @param key 关键字
+ * @param val 保存转换后的值
+ * @param def 默认值
  * @return 
- *      @retval true תɹ, val ΪӦֵ
- *      @retval false ڻתʧ val = def
+ *      @retval true 转换成功, val 为对应的值
+ *      @retval false 不存在或者转换失败 val = def
  */
 template<class MapType, class T>
 bool checkGetAs(const MapType& m, const std::string& key, T& val, const T& def = T());
 
 /*!
- * @brief ȡMapеkeyֵ,תɶӦ
- * @param m Mapݽṹ
- * @param key ؼ
- * @param def Ĭֵ
- * @return תɹضӦֵ,򷵻Ĭֵ
+ * @brief 获取Map中的key值,并转成对应类型
+ * @param m Map数据结构
+ * @param key 关键字
+ * @param def 默认值
+ * @return 如果存在且转换成功返回对应的值,否则返回默认值
  */
 template<class MapType, class T>
 T getAs(const MapType& m, const std::string& key, const T& def = T());
 
 /*!
- * @brief ԴСдȽϷº
+ * @brief 忽略大小写比较仿函数
  */
 struct CaseInsensitiveLess {
     /**
-     * @brief ԴСдȽַ
+     * @brief 忽略大小写比较字符串
      */
     bool operator()(const std::string& lhs, const std::string& rhs) const;
 };
 
 //****************************************************************************
-// HTTPṹ
+// HTTP请求结构
 //****************************************************************************
 
 class HttpRequest {
 public:
     using MapType = std::map<std::string, std::string, CaseInsensitiveLess>;
 private:
-    HttpMethod __method;        // HTTP
-    uint8_t __version;          // HTTP汾
-    bool __close;               // ǷԶر
-    bool __websocket;           // ǷΪwebsocket
+    HttpMethod __method;        // HTTP方法
+    uint8_t __version;          // HTTP版本
+    bool __close;               // 是否自动关闭
+    bool __websocket;           // 是否为websocket
     uint8_t __parserParamFlag;
-    std::string __path;         // ·
-    std::string __query;        // 
-    std::string __fragment;     // fragment
-    std::string __body;         // Ϣ
-    MapType __headers;          // ͷMAP
-    MapType __params;           // MAP
-    MapType __cookies;          // Cookie MAP
+    std::string __path;         // 请求路径
+    std::string __query;        // 请求参数
+    std::string __fragment;     // 请求fragment
+    std::string __body;         // 请求消息体
+    MapType __headers;          // 请求头部MAP
+    MapType __params;           // 请求参数MAP
+    MapType __cookies;          // 请求Cookie MAP
 public:
     HttpRequest(uint8_t version = 0x11, bool close = true);
 
@@ -346,20 +346,20 @@ public:
 };
 
 //****************************************************************************
-// HTTPӦṹ
+// HTTP响应结构
 //****************************************************************************
 
 class HttpResponse {
 public:
     using MapType = std::map<std::string, std::string, CaseInsensitiveLess>;
 private:
-    HttpStatus __status;                // Ӧ״̬
-    uint8_t __version;                  // 汾
-    bool __close;                       // ǷԶر
-    bool __websocket;                   // ǷΪwebsocket 
-    std::string __body;                 // ӦϢ
-    std::string __reason;               // Ӧԭ
-    MapType __headers;                  // ӦͷMAP
+    HttpStatus __status;                // 响应状态
+    uint8_t __version;                  // 版本
+    bool __close;                       // 是否自动关闭
+    bool __websocket;                   // 是否为websocket 
+    std::string __body;                 // 响应消息体
+    std::string __reason;               // 响应原因
+    MapType __headers;                  // 响应头部MAP
     std::vector<std::string> __cookies;
 public:
     HttpResponse(uint8_t version = 0x11, bool close = true);
@@ -415,7 +415,7 @@ public:
 };
 
 //****************************************************************************
-// ʽ
+// 流式输出
 //****************************************************************************
 
 std::ostream& operator<<(std::ostream& os, const HttpRequest& req);
@@ -423,7 +423,7 @@ std::ostream& operator<<(std::ostream& os, const HttpRequest& req);
 std::ostream& operator<<(std::ostream& os, const HttpResponse& rsp);
 
 //****************************************************************************
-// ģʵ
+// 模板类或函数实现
 //****************************************************************************
 
 template<class MapType, class T>
@@ -1,7 +1,7 @@
 //*****************************************************************************
 //
 //
-//   ͷļʵ HTTP ͻ
+//   此头文件实现 HTTP 客户端类
 //  
 //
 //*****************************************************************************
@@ -23,7 +23,7 @@ namespace sylar::http
 {
 
 //****************************************************************************
-// ǰ
+// 前置声明
 //****************************************************************************
 
 struct HttpResult;
@@ -36,26 +36,26 @@ class HttpConnectionPool;
 using HttpConnectionPool_ptr = std::shared_ptr<HttpConnectionPool>;
 
 //****************************************************************************
-// HTTP Ӧ
+// HTTP 响应结果
 //****************************************************************************
 
 struct HttpResult {
 	enum class Error {
-		OK = 0,                         // 
-		INVALID_URL = 1,                // ǷURL
-		INVALID_HOST = 2,               // ޷HOST
-		CONNECT_FAIL = 3,               // ʧ
-		SEND_CLOSE_BY_PEER = 4,         // ӱԶ˹ر
-		SEND_SOCKET_ERROR = 5,          // Socket
-		TIMEOUT = 6,                    // ʱ
-		CREATE_SOCKET_ERROR = 7,        // Socketʧ
-		POOL_GET_CONNECTION = 8,        // ӳȡʧ
-		POOL_INVALID_CONNECTION = 9,    // Ч
+		OK = 0,                         // 正常
+		INVALID_URL = 1,                // 非法URL
+		INVALID_HOST = 2,               // 无法解析HOST
+		CONNECT_FAIL = 3,               // 连接失败
+		SEND_CLOSE_BY_PEER = 4,         // 连接被对端关闭
+		SEND_SOCKET_ERROR = 5,          // 发送请求产生Socket错误
+		TIMEOUT = 6,                    // 超时
+		CREATE_SOCKET_ERROR = 7,        // 创建Socket失败
+		POOL_GET_CONNECTION = 8,        // 从连接池中取连接失败
+		POOL_INVALID_CONNECTION = 9,    // 无效的连接
 	};
 
-	int result;                         // 
-	HttpResponse_ptr response;         // HTTPӦṹ
-	std::string error;                  // 
+	int result;                         // 错误码
+	HttpResponse_ptr response;         // HTTP响应结构体
+	std::string error;                  // 错误描述
 
 	HttpResult(int _result, HttpResponse_ptr _response, const std::string& _error);
 
@@ -63,7 +63,7 @@ struct HttpResult {
 };
 
 //****************************************************************************
-// HTTP ͻ
+// HTTP 客户端类
 //****************************************************************************
 
 class HttpConnection : public SocketStream {
@@ -96,24 +96,24 @@ public:
 };
 
 //****************************************************************************
-// HTTP ͻ˳
+// HTTP 客户端池
 //****************************************************************************
 
 class HttpConnectionPool {
 public:
 	using MutexType = Mutex;
 private:
-	std::string m_host; // 
+	std::string m_host; // 主机
 	std::string m_vhost; 
-	uint32_t m_port; // ˿ں
-	uint32_t m_maxSize; // 
-	uint32_t m_maxAliveTime; // ʱ
-	uint32_t m_maxRequest; // ʱ
+	uint32_t m_port; // 端口号
+	uint32_t m_maxSize; // 连接最大数
+	uint32_t m_maxAliveTime; // 连接时长
+	uint32_t m_maxRequest; // 请求时长
 	bool m_isHttps;
 
-	MutexType m_mutex; // 
-	std::list<HttpConnection*> m_conns; // HttpConnection ָ
-	std::atomic<int32_t> m_total = { 0 }; // ӵ
+	MutexType m_mutex; // 锁
+	std::list<HttpConnection*> m_conns; // HttpConnection 指针链表
+	std::atomic<int32_t> m_total = { 0 }; // 连接的数量
 private:
 	static void ReleasePtr(HttpConnection* ptr, HttpConnectionPool* pool);
 public:
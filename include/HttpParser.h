@@ -1,7 +1,7 @@
 //*****************************************************************************
 //
 //
-//   HTTPЭװ
+//   HTTP协议解析封装
 //  
 //
 //*****************************************************************************
@@ -17,7 +17,7 @@ namespace sylar::http
 {
 
 //****************************************************************************
-// ǰ
+// 前置声明
 //****************************************************************************
 
 class HttpRequestParser;
@@ -27,59 +27,59 @@ class HttpResponseParser;
 using HttpResponseParser_ptr = std::shared_ptr<HttpResponseParser>;
 
 //****************************************************************************
-// HTTP
+// HTTP请求解析类
 //****************************************************************************
 
 class HttpRequestParser {
 private:
     http_parser __parser;       // http_parser
-    HttpRequest_ptr __data;     // HttpRequestṹ
-    /// 
+    HttpRequest_ptr __data;     // HttpRequest结构
+    /// 错误码
     /// 1000: invalid method
     /// 1001: invalid version
     /// 1002: invalid field
     int m_error;
 public:
     /*!
-     * @brief HttpRequestЭĻС
+     * @brief 返回HttpRequest协议解析的缓存大小
      */
     static uint64_t GetHttpRequestBufferSize();
 
     /*!
-     * @brief HttpRequestЭϢС
+     * @brief 返回HttpRequest协议的最大消息体大小
      */
     static uint64_t GetHttpRequestMaxBodySize();
 
     /*!
-     * @brief 캯
+     * @brief 构造函数
      */
     HttpRequestParser();
 
     /*!
-     * @brief Э
-     * @param data Эıڴ
-     * @param len Эıڴ泤
-     * @return ʵʽĳ,ҽѽƳ
+     * @brief 解析协议
+     * @param data 协议文本内存
+     * @param len 协议文本内存长度
+     * @return 返回实际解析的长度,并且将已解析的数据移除
      */
     size_t execute(char* data, size_t len);
 
     /*!
-     * @brief Ƿ
+     * @brief 是否解析完成
      */
     int isFinished();
 
     /*!
-     * @brief Ƿд
+     * @brief 是否有错误
      */
     int hasError();
 
     /*!
-     * @brief HttpRequestṹ
+     * @brief 返回HttpRequest结构体
      */
     HttpRequest_ptr getData() const;
 
     /*!
-     * @brief ô
+     * @brief 设置错误
      * @param v = 1000: invalid method
      * @param v = 1001: invalid version
      * @param v = 1002: invalid field
@@ -87,70 +87,70 @@ public:
     void setError(int v);
 
     /*!
-     * @brief ȡϢ峤
+     * @brief 获取消息体长度
      */
     uint64_t getContentLength();
 
     /*!
-     * @brief ȡhttp_parserṹ
+     * @brief 获取http_parser结构体
      */
     const http_parser& getParser() const;
 };
 
 //****************************************************************************
-// HttpӦṹ
+// Http响应解析结构体
 //****************************************************************************
 
 class HttpResponseParser {
 private:
     httpclient_parser __parser;     // httpclient_parser
     HttpResponse_ptr __data;        // HttpResponse
-    /// 
+    /// 错误码
     /// 1001: invalid version
     /// 1002: invalid field
     int m_error;
 public:
     /*!
-     * @brief HTTPӦС
+     * @brief 返回HTTP响应解析缓存大小
      */
     static uint64_t GetHttpResponseBufferSize();
 
     /*!
-     * @brief HTTPӦϢС
+     * @brief 返回HTTP响应最大消息体大小
      */
     static uint64_t GetHttpResponseMaxBodySize();
 
     /*!
-     * @brief 캯
+     * @brief 构造函数
      */
     HttpResponseParser();
 
     /*!
-     * @brief HTTPӦЭ
-     * @param data Эڴ
-     * @param len ЭڴС
-     * @param chunck Ƿڽchunck
-     * @return ʵʽĳ,Ƴѽ
+     * @brief 解析HTTP响应协议
+     * @param data 协议数据内存
+     * @param len 协议数据内存大小
+     * @param chunck 是否在解析chunck
+     * @return 返回实际解析的长度,并且移除已解析的数据
      */
     size_t execute(char* data, size_t len, bool chunck);
 
     /*!
-     * @brief Ƿ
+     * @brief 是否解析完成
      */
     int isFinished();
 
     /*!
-     * @brief Ƿд
+     * @brief 是否有错误
      */
     int hasError();
 
     /*!
-     * @brief HttpResponse
+     * @brief 返回HttpResponse
      */
     HttpResponse_ptr getData() const;
 
     /*!
-     * @brief ô
+     * @brief 设置错误码
      * @param v = 1000: invalid method
      * @param v = 1001: invalid version
      * @param v = 1002: invalid field
@@ -158,12 +158,12 @@ public:
     void setError(int v);
 
     /*!
-     * @brief ȡϢ峤
+     * @brief 获取消息体长度
      */
     uint64_t getContentLength();
 
     /*!
-     * @brief httpclient_parser
+     * @brief 返回httpclient_parser
      */
     const httpclient_parser& getParser() const;
 };
@@ -1,7 +1,7 @@
 //*****************************************************************************
 //
 //
-//   HTTPװ
+//   HTTP服务器封装
 //  
 //
 //*****************************************************************************
@@ -20,20 +20,20 @@ namespace sylar::http
 {
 
 //****************************************************************************
-// ǰ
+// 前置声明
 //****************************************************************************
 
 class HttpServer;
 using HttpServer_ptr = std::shared_ptr<HttpServer>;
 
 //****************************************************************************
-// HTTP
+// HTTP服务器类
 //****************************************************************************
 
 class HttpServer : public sylar::TcpServer {
 private: 
-    bool m_isKeepalive;                 // Ƿֳ֧
-    ServletDispatch_ptr m_dispatch;    // Servletַ
+    bool m_isKeepalive;                 // 是否支持长连接
+    ServletDispatch_ptr m_dispatch;    // Servlet分发器
 protected:
     virtual void handleClient(Socket_ptr client) override;
 public:
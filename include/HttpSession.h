@@ -1,8 +1,8 @@
 //*****************************************************************************
 //
 //
-//   ͷļװ HttpSession
-//   HttpSessionģӦ
+//   此头文件封装 HttpSession
+//   HttpSession接收请求报文，发送响应报文
 //  
 //
 //*****************************************************************************
@@ -19,37 +19,37 @@ namespace sylar::http
 {
 
 //****************************************************************************
-// ǰ
+// 前置声明
 //****************************************************************************
 
 class HttpSession;
 using HttpSession_ptr = std::shared_ptr<HttpSession>;
 
 //****************************************************************************
-// HttpSession::װ
+// HttpSession::封装
 //****************************************************************************
 
 class HttpSession : public sylar::SocketStream {
 public:
     /*!
-     * @brief 캯
-     * @param sock Socket
-     * @param owner Ƿй
+     * @brief 构造函数
+     * @param sock Socket类型
+     * @param owner 是否托管
      */
     HttpSession(sylar::Socket_ptr sock, bool owner = true);
 
     /*!
-     * @brief HTTP
+     * @brief 接收HTTP请求
      */
     HttpRequest_ptr recvRequest();
 
     /*!
-     * @brief HTTPӦ
-     * @param rsp HTTPӦ
+     * @brief 发送HTTP响应
+     * @param rsp HTTP响应
      * @return 
-     *      @retval > 0 ͳɹ
-     *      @retval = 0 Էر
-     *      @retval < 0 Socket쳣
+     *      @retval > 0 发送成功
+     *      @retval = 0 对方关闭
+     *      @retval < 0 Socket异常
      */
     int sendResponse(HttpResponse_ptr rsp);
 };
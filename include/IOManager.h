@@ -1,7 +1,7 @@
 //*****************************************************************************
 //
 //
-//   ͷļʵ IO 
+//   此头文件实现 IO 管理
 //  
 //
 //*****************************************************************************
@@ -13,149 +13,312 @@
 #include "Scheduler.h"
 #include "Timer.h"
 #include "Mutex.h"
+#include "Metrics.h"
 #include <memory>
 #include <functional>
 #include <atomic>
 #include <vector>
+#include <sys/epoll.h>
 
 namespace sylar
 {
 
 //****************************************************************************
-// ǰ
+// 前置声明
 //****************************************************************************
 
 class IOManager;
 using IOManager_ptr = std::shared_ptr<IOManager>;
 
 //****************************************************************************
-//  Epoll  IO Э̵
+// 基于 Epoll 的 IO 协程调度器
 //****************************************************************************
 
 class IOManager : public Scheduler, public TimerManager {
 public:
 	using RWMutexType = RWMutex;
 	/*!
-	 * @brief IO ¼
+	 * @brief IO 事件
 	 */
 	enum Event {
-		NONE    = 0x0,    // ¼
-		READ    = 0x1,    // ¼EPOLLIN
-		WRITE   = 0x2     // д¼EPOLLOUT
+		NONE    = 0x0,    // 无事件
+		READ    = 0x1,    // 读事件（EPOLLIN）
+		PRI     = 0x2,    // 带外/高优先级数据（EPOLLPRI），供 poll/select 的 hook 使用
+		WRITE   = 0x4     // 写事件（EPOLLOUT）
+	};
+
+	/*!
+	 * @brief 事件循环统计
+	 * @details 每个执行 idle 的线程一份，只由该线程写入；
+	 *          不在 idle 线程上发生的操作记入 IOManager 的公共统计
+	 */
+	struct LoopStats : public boost::noncopyable {
+		int thread = -1;                                // 所属线程 id，-1 为公共统计
+		std::atomic<uint64_t> wakeups = { 0 };          // epoll_wait 返回次数
+		std::atomic<uint64_t> events = { 0 };           // 分发的 fd 事件数
+		std::atomic<uint64_t> tickleSent = { 0 };       // 发出的 tickle 次数
+		std::atomic<uint64_t> tickleCoalesced = { 0 };  // 因已有唤醒未消费而合并掉的 tickle 次数
+		std::atomic<uint64_t> leaderPromotions = { 0 }; // 卸任 leader 时唤醒其他线程接替的次数
+		std::atomic<uint64_t> spinHits = { 0 };         // 自旋期间拿到任务或 IO 的次数
+		std::atomic<uint64_t> spinMisses = { 0 };       // 自旋落空转入阻塞的次数
+		std::atomic<uint64_t> tickleWakeups = { 0 };    // 被 tickle 唤醒的次数
+		std::atomic<uint64_t> timerWakeups = { 0 };     // 被 timerfd 唤醒的次数
+		std::atomic<uint64_t> emptyTimeouts = { 0 };    // MAX_TIMEOUT 到期且无事可做的次数
+		std::atomic<uint64_t> addEvents = { 0 };        // addEvent 次数
+		std::atomic<uint64_t> delEvents = { 0 };        // delEvent 次数
+		std::atomic<uint64_t> cancelEvents = { 0 };     // cancelEvent 次数
+		std::atomic<uint64_t> epollCtlErrors = { 0 };   // epoll_ctl 失败次数
+		Histogram eventsPerWakeup;                      // 每次唤醒返回的事件数
+		Histogram dispatchUS;                           // 每次唤醒的分发耗时(微秒)
+		Histogram iterationUS;                          // 唤醒到下一次 epoll_wait 的耗时(微秒)
+		Histogram spinUS;                               // 每次自旋的耗时(微秒)
+
+		/*!
+		 * @brief 计数器加一
+		 * @details 线程私有的统计只有所属线程写入，用普通的读后写代替带锁的
+		 *          fetch_add，其他线程读取时仍是完整的 64 位值；公共统计由多个线程写入
+		 */
+		void inc(std::atomic<uint64_t> LoopStats::* counter) {
+			std::atomic<uint64_t>& c = this->*counter;
+			if (thread >= 0) {
+				c.store(c.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+			}
+			else {
+				c.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+
+		/*!
+		 * @brief 将另一份统计累加到本统计
+		 */
+		void merge(const LoopStats& other);
+
+		/*!
+		 * @brief 输出统计
+		 */
+		std::ostream& dump(std::ostream& os) const;
 	};
 private:
-	// Socket ¼
+	// Socket 事件上下文类
 	struct FdContext {
 		using MutexType = Mutex;
 		/*!
-		 * @brief ¼
+		 * @brief 事件上下文类
 		 */
 		struct EventContext {
-			Scheduler* __scheduler = nullptr;   // ¼ִе Scheduler
-			Fiber_ptr __fiber;                  // ¼Э
-			std::function<void()> __cb;         // ¼Ļص
+			Scheduler* __scheduler = nullptr;   // 事件执行的 Scheduler
+			Fiber_ptr __fiber;                  // 事件协程
+			std::function<void()> __cb;         // 事件的回调函数
+			const void* __owner = nullptr;      // 注册者的标识，供 delEventIf 判断
 		};
 
-		EventContext __read;    // ¼
-		EventContext __write;   // д¼
-		int __fd = 0;           // ¼ľ
-		Event __events = NONE;  // Ѿע¼
-		MutexType __mutex;      // ¼Mutex
+		EventContext __read;    // 读事件
+		EventContext __write;   // 写事件
+		EventContext __pri;     // 带外数据事件
+		int __fd = 0;           // 事件关联的句柄
+		Event __events = NONE;  // 已经注册的事件
+		MutexType __mutex;      // 事件的Mutex
 
         /*!
-         * @brief ȡ¼
-         * @param event ¼
-         * @return ضӦ¼
+         * @brief 获取事件上下文类
+         * @param event 事件类型
+         * @return 返回对应事件的上下文
          */
         EventContext& getContext(Event event);
 
         /*!
-         * @brief ¼
-         * @param ctx õ
+         * @brief 重置事件上下文
+         * @param ctx 待重置的上下文类
          */
         void resetContext(EventContext& ctx);
 
         /*!
-         * @brief ¼
-         * @param event ¼
+         * @brief 触发事件
+         * @param event 事件类型
          */
         void triggerEvent(Event event);
 	};
+
+	/*!
+	 * @brief 执行 idle 的工作线程
+	 * @details 同一时刻只有一个线程(leader)阻塞在共享的 epoll 上等待 IO 和定时器，
+	 *          其余线程(follower)阻塞在只包含自己 eventfd 的 epoll 上，以便定向唤醒
+	 */
+	struct Worker {
+		std::atomic<int> __threadId = { -1 };           // 占用该槽位的线程 id，-1 为尚未占用
+		int __epfd = -1;                                // 只包含 __eventFd 的 epoll
+		int __eventFd = -1;                             // 唤醒用 eventfd
+		std::atomic<bool> __parked = { false };         // 是否即将或正在阻塞于 epoll_wait
+		std::atomic<bool> __pending = { false };        // 是否有尚未被消费的唤醒
+		uint64_t __gapEwmaUS = 0;                       // 最近空闲间隔的滑动平均(微秒)，只由本线程读写
+	};
 private:
-    int __epfd = 0;                                     // epoll ļ  
-    int __tickleFds[2];                                 // pipe ļ
-    std::atomic<size_t> __pendingEventCount = { 0 };    // ǰȴִе¼ 
-    RWMutexType __mutex;                                // IOManagerMutex
-    std::vector<FdContext*> __fdContexts;               // socket¼ĵ
+    int __epfd = 0;                                     // epoll 文件句柄  
+    int __leaderFd = -1;                                // 唤醒 leader 的 eventfd(在共享 epoll 中)
+    std::vector<Worker*> __workers;                     // 工作线程槽位，构造后大小不变
+    std::atomic<Worker*> __leader = { nullptr };        // 当前阻塞在共享 epoll 上的线程
+    std::atomic<size_t> __workerCount = { 0 };          // 已被线程占用的槽位数
+    std::atomic<size_t> __pendingWakeups = { 0 };       // 尚未被消费的唤醒数量
+    std::atomic<size_t> __spinners = { 0 };             // 正在自旋的线程数量
+    int __timerFd = -1;                                 // timerfd 文件句柄(微秒精度定时唤醒)
+    uint64_t __timerFdDeadline = ~0ull;                 // timerfd 当前设置的到期时间(微秒)
+    SpinLock __timerFdMutex;                            // timerfd 的锁
+    std::atomic<size_t> __pendingEventCount = { 0 };    // 当前等待执行的事件数量 
+    RWMutexType __mutex;                                // IOManager的Mutex
+    std::vector<FdContext*> __fdContexts;               // socket事件上下文的容器
+    Mutex __statsMutex;                                 // 统计容器的锁
+    std::vector<LoopStats*> __loopStats;                // 各 idle 线程的事件循环统计
+    LoopStats __sharedStats;                            // 非 idle 线程上的操作统计
 
 protected:
     void tickle() override;
+    void tickle(int thread) override;
     bool stopping() override;
     void idle() override;
     void onTimerInsertedAtFront() override;
     
     /*!
-     * @brief жǷֹͣ
-     * @param timeout ҪĶʱ¼
-     * @return Ƿֹͣ
+     * @brief 判断是否可以停止
+     * @param timeout 最近要触发的定时器的到期时间(Clock 单调时钟，微秒)
+     * @return 返回是否可以停止
      */
     bool stopping(uint64_t& timeout);
 
     /*!
-     * @brief socketĵС
-     * @param size С
+     * @brief 设置 timerfd 的到期时间，已设置更早且未被消费的时间时不做修改
+     * @param deadline_us 到期的绝对时间(Clock 单调时钟，微秒)
+     */
+    void armTimerFd(uint64_t deadline_us);
+
+    /*!
+     * @brief 重置socket句柄上下文的容器大小
+     * @param size 容量大小
      */
     void contextResize(size_t size);
 
+    /*!
+     * @brief 返回当前线程在本 IOManager 上的统计
+     */
+    LoopStats& localStats();
+
+    /*!
+     * @brief 唤醒指定的工作线程，已有未消费的唤醒时合并
+     * @return 是否真正写入了 eventfd
+     */
+    bool wakeWorker(Worker* worker);
+
+    /*!
+     * @brief 处理 epoll 返回的唤醒事件
+     * @param self 当前线程的槽位
+     * @param fd 就绪的句柄
+     * @return fd 不是唤醒用的 eventfd 时返回 false
+     */
+    bool handleWakeup(Worker* self, int fd);
+
+    /*!
+     * @brief 根据最近的空闲间隔计算本次自旋的时长
+     * @return 自旋时长(微秒)，0 表示直接阻塞
+     */
+    uint64_t spinBudget(Worker* self);
+
+    /*!
+     * @brief 阻塞前自旋，轮询任务队列和 epoll_wait(..., 0)
+     * @param rt 输出参数，自旋期间 epoll_wait 返回的事件数
+     * @return 自旋期间拿到任务或 IO 返回 true
+     */
+    bool spinWait(Worker* self, epoll_event* events, int max_events, uint64_t budget_us, int& rt);
+
+    /*!
+     * @brief leader 去执行任务前，唤醒一个阻塞的 follower 接替等待 IO
+     */
+    void promoteLeader();
+
+    /*!
+     * @brief addEvent/tryAddEvent 的实现
+     * @param strict 事件已注册时是否断言，否则返回 1
+     */
+    int doAddEvent(int fd, Event event, std::function<void()>& cb, bool strict, const void* owner);
+
+    /*!
+     * @brief delEvent/delEventIf 的实现
+     * @param check_owner 是否只删除 owner 注册的事件
+     */
+    bool doDelEvent(int fd, Event event, const void* owner, bool check_owner);
+
 public:
     /*!
-     * @brief صǰIOManager
+     * @brief 返回当前的IOManager
      */
     static IOManager* GetThis();
 
     /*!
-     * @brief 캯
-     * @param threads ߳
-     * @param use_caller Ƿ񽫵̰߳ȥ
-     * @param name 
+     * @brief 构造函数
+     * @param threads 线程数量
+     * @param use_caller 是否将调用线程包含进去
+     * @param name 调度器的名称
      */
     IOManager(size_t threads = 1, bool use_caller = true, const std::string& name = "");
 
     /*!
-     * @brief 
+     * @brief 析构函数
      */
     ~IOManager();
 
     /*!
-     * @brief ¼
-     * @param fd socket
-     * @param event ¼
-     * @param cb ¼ص
-     * @return ӳɹ0,ʧܷ-1
+     * @brief 添加事件
+     * @param fd socket句柄
+     * @param event 事件类型
+     * @param cb 事件回调函数
+     * @return 添加成功返回0,失败返回-1
      */
     int addEvent(int fd, Event event, std::function<void()> cb = nullptr);
 
     /*!
-     * @brief ɾ¼
-     * @param fd socket
-     * @param event ¼
-     * @return ᴥ¼
+     * @brief 添加事件，事件已被其他协程注册时不断言
+     * @param owner 注册者的标识，之后可用 delEventIf 只删除自己的注册
+     * @return 添加成功返回0,事件已存在返回1,失败返回-1
+     */
+    int tryAddEvent(int fd, Event event, std::function<void()> cb = nullptr, const void* owner = nullptr);
+
+    /*!
+     * @brief 删除事件
+     * @param fd socket句柄
+     * @param event 事件类型
+     * @return 不会触发事件
      */
     bool delEvent(int fd, Event event);
 
     /*!
-     * @brief ȡ¼
-     * @param fd socket
-     * @param event ¼
-     * @return ¼򴥷¼
+     * @brief 删除 owner 注册的事件
+     * @details 事件已触发后同一 fd 可能被其他协程重新注册，此时不删除
+     * @return 删除了 owner 的注册返回 true
+     */
+    bool delEventIf(int fd, Event event, const void* owner);
+
+    /*!
+     * @brief 取消事件
+     * @param fd socket句柄
+     * @param event 事件类型
+     * @return 如果事件存在则触发事件
      */
     bool cancelEvent(int fd, Event event);
 
     /*!
-     * @brief ȡ¼
-     * @param fd socket
+     * @brief 取消所有事件
+     * @param fd socket句柄
      */
     bool cancelAll(int fd);
+
+    /*!
+     * @brief 汇总所有线程的事件循环统计
+     * @param total 输出参数，累加到其中
+     */
+    void getLoopStats(LoopStats& total);
+
+    /*!
+     * @brief 输出调度器信息及事件循环统计
+     */
+    std::ostream& dump(std::ostream& os) override;
 };
 
 }; /* sylar */
@@ -1,7 +1,7 @@
 //*****************************************************************************
 //
 //
-//   ͷļʵ YAML  std ת
+//   此头文件实现 YAML 类型与 std 类型转换功能
 //  
 //
 //*****************************************************************************
@@ -24,7 +24,7 @@
 namespace sylar {
 
 /*!
- * @brief  F תΪ T 
+ * @brief 将 F 类型转换为 T 类型
  */
 template<class F, class T>
 class LexicalCast {
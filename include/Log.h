@@ -1,7 +1,7 @@
 //*****************************************************************************
 //
 //
-//   ͷļʵ־ϵͳ
+//   此头文件实现日志系统功能
 //  
 //
 //*****************************************************************************
@@ -13,17 +13,23 @@
 #include <vector>
 #include <list>
 #include <map>
+#include <unordered_map>
 #include <memory>
 #include <sstream>
 #include <fstream>
+#include <sys/uio.h>
+#include <atomic>
+#include <boost/noncopyable.hpp>
 
 #include "Util.h"
 #include "Mutex.h"
+#include "Rcu.h"
+#include "Clock.h"
 
 namespace sylar{
 
 //****************************************************************************
-// ǰ
+// 前置声明
 //****************************************************************************
 
 class LogEvent;
@@ -47,199 +53,384 @@ using FileLogAppender_ptr = typename std::shared_ptr<FileLogAppender>;
 class Logger;
 using Logger_ptr = typename std::shared_ptr<Logger>;
 
+class LogBatch;
+
+class LogStream;
+
 class LogEventWrap;
 
 class LoggerManager;
 
 //****************************************************************************
-// ־
+// 日志级别
 //****************************************************************************
 
 enum LogLevel {
-	UNKNOW = 0,		// δ֪־
-	DEBUG = 1,		// Լ־
-	INFO = 2,		// ͨ־
-	WARN = 3,		// 漶־
-	ERROR = 4,		// 󼶱־
-	FATAL = 5		// Ѽ־
+	UNKNOW = 0,		// 未知级别日志
+	DEBUG = 1,		// 调试级别日志
+	INFO = 2,		// 普通级别日志
+	WARN = 3,		// 警告级别日志
+	ERROR = 4,		// 错误级别日志
+	FATAL = 5		// 灾难级别日志
 };
 
 /*!
- * @brief ־תı
+ * @brief 将日志级别转成文本输出
  */
 std::string LevelToString(LogLevel level);
 
 /*!
- * @brief ıת־
+ * @brief 将文本转换成日志级别
  */
 LogLevel LevelFromString(const std::string& str);
 
 
 //****************************************************************************
-// ־Ϣ
+// 日志信息
 //****************************************************************************
 
+/*!
+ * @brief 日志调用处的静态信息，由日志宏在调用处生成静态对象，事件只保存其指针
+ */
+struct LogLocation {
+	const char* file;	// 文件名
+	uint32_t line;		// 行号
+};
+
+/*!
+ * @brief 一条日志
+ * @details 只保存指针与整数，不持有任何堆内存：日志器名称指向日志器自身的成员，
+ *          文件名与线程名是静态字符串，消息内容指向调用方的缓冲。
+ *          需要跨线程保存时(异步日志)由保存方复制消息内容
+ */
 class LogEvent {
-private: // Ա
-	//־
-	std::string __log_name;
-	//־
-	LogLevel __level;
-	//ļ
-	std::string __file_name;
-	//к
-	uint32_t __line;
-	//ʼڵĺ
-	uint32_t __elapse;
-	//߳id
-	uint32_t __thread_id;
-	//Эid
-	uint32_t __fiber_id;
-	//ʱ
-	uint64_t __time;
-	//߳
-	std::string __thread_name;
-	//ַ
-	std::stringstream __sstream;
-public: // 캯
+private: // 成员变量
+	//日志器名称
+	const std::string* __log_name = nullptr;
+	//日志级别
+	LogLevel __level = LogLevel::UNKNOW;
+	//文件名
+	const char* __file_name = "";
+	//行号
+	uint32_t __line = 0;
+	//程序启动开始到现在的毫秒数
+	uint32_t __elapse = 0;
+	//线程id
+	uint32_t __thread_id = 0;
+	//协程id
+	uint32_t __fiber_id = 0;
+	//时间戳(秒)
+	uint64_t __time = 0;
+	//时间戳的亚秒部分(微秒)
+	uint32_t __usec = 0;
+	//线程名
+	const char* __thread_name = "";
+	//消息内容
+	const char* __message = "";
+	size_t __message_size = 0;
+public: // 构造函数
+	LogEvent() {}
+
+	/*!
+	 * @param log_name 日志器名称，须在事件使用期间有效
+	 * @param file_name 文件名，须为静态字符串
+	 * @param thread_name 线程名，须为静态字符串
+	 */
 	LogEvent(const std::string& log_name, LogLevel level,
-			 const std::string& file_name, uint32_t line,
+			 const char* file_name, uint32_t line,
 			 uint32_t elapse, uint32_t thread_id,
-			 const std::string& thread_name,
-			 uint32_t fiber_id, uint64_t time);
-public: // ӿ
+			 const char* thread_name,
+			 uint32_t fiber_id, uint64_t time, uint32_t usec = 0);
+public: // 接口
 	/*!
-	 * @brief ־
+	 * @brief 返回日志器名称
 	 */
 	const std::string& getLogName() const;
 
 	/*!
-	 * @brief ļ
+	 * @brief 返回文件名
 	 */
-	const std::string& getFile() const;
+	const char* getFile() const;
 
 	/*!
-	 * @brief к
+	 * @brief 返回行号
 	 */
 	uint32_t getLine() const;
 
 	/*!
-	 * @brief سʼڵĺ
+	 * @brief 返回程序启动开始到现在的毫秒数
 	 */
 	uint32_t getElapse() const;
 
 	/*!
-	 * @brief ߳id
+	 * @brief 返回线程id
 	 */
 	uint32_t getThreadId() const;
 
 	/*!
-	 * @brief Эid
+	 * @brief 返回协程id
 	 */
 	uint32_t getFiberId() const;
 
 	/*!
-	 * @brief ߳
+	 * @brief 返回线程名称
 	 */
-	const std::string& getThreadName() const;
+	const char* getThreadName() const;
 
 	/*!
-	 * @brief ʱ
+	 * @brief 返回时间戳(秒)
 	 */
 	uint64_t getTime() const;
 
 	/*!
-	 * @brief ־
+	 * @brief 返回时间戳的亚秒部分(微秒)
+	 */
+	uint32_t getUsec() const;
+
+	/*!
+	 * @brief 返回日志级别
 	 */
 	LogLevel getLevel() const;
 
 	/*!
-	 * @brief ַ
+	 * @brief 返回消息内容
 	 */
-	std::string getContext() const;
+	const char* getMessage() const;
 
 	/*!
-	 * @brief ַ
+	 * @brief 返回消息长度
 	 */
-	std::stringstream& getSS();
+	size_t getMessageSize() const;
 
+	/*!
+	 * @brief 设置消息内容，只保存指针
+	 */
+	void setMessage(const char* data, size_t size);
+
+	/*!
+	 * @brief 返回消息内容的副本
+	 */
+	std::string getContext() const;
 };
 
 //****************************************************************************
-// ־ʽ
+// 日志格式化
 //****************************************************************************
 
 static const std::string __dafault_formatter = "%d{%Y-%m-%d %H:%M:%S}%T%t%T%N%T%F%T[%p]%T[%c]%T%f:%l%T%m%n";
 
-// ӿ
+// 抽象接口
 class FormatterItem {
 public:
 	virtual ~FormatterItem() {}
-	virtual void format(std::ostream& os, LogEvent_ptr event) = 0;
+	/*!
+	 * @brief 把本项追加到 buf 末尾
+	 */
+	virtual void format(std::string& buf, const LogEvent& event) = 0;
 };
 
 class LogFormatter {
-private: // Ա
+private: // 成员变量
 	std::string __pattern;
 	std::vector<FormatterItem_ptr> __items;
 private:
 	void init();
-public: // 캯
+public: // 构造函数
 	LogFormatter(const std::string& pattern = __dafault_formatter);
 public:
-	std::string format(LogEvent_ptr event);
+	/*!
+	 * @brief 格式化日志并追加到调用方提供的缓冲末尾
+	 */
+	void format(std::string& buf, const LogEvent& event);
+
+	/*!
+	 * @brief 格式化日志，返回新字符串
+	 */
+	std::string format(const LogEvent& event);
 };
  
 //****************************************************************************
-// ־
+// 日志输出
 //****************************************************************************
 
 class LogAppender {
+public:
+	using MutexType = FutexMutex;
 protected:
 	LogFormatter_ptr __formatter;
-	SpinLock __mutex;
+	MutexType __mutex;
 public:
 	virtual ~LogAppender() {}
-	virtual void log(LogEvent_ptr event) = 0;
+
+	/*!
+	 * @brief 用本输出地的格式器格式化后写入
+	 */
+	virtual void log(const LogEvent& event);
+
+	/*!
+	 * @brief 是否直接编码日志事件(如二进制输出)
+	 * @details 为 true 时日志器不为其格式化文本，而是直接调用 log
+	 */
+	virtual bool isRaw() const { return false; }
+
+	/*!
+	 * @brief 写入已格式化的日志
+	 */
+	virtual void write(const char* data, size_t size) = 0;
+
+	/*!
+	 * @brief 写入同步输出的一条已格式化日志，默认直接 write
+	 * @details 带缓冲的输出地可按日志级别决定是否立即刷出
+	 */
+	virtual void writeLine(const char* data, size_t size, LogLevel level) { write(data, size); }
+
+	/*!
+	 * @brief 批量写入已格式化的日志，由异步日志线程调用，默认逐段 write
+	 * @details 每段是一条日志；acceptsCoalesced 为 true 时相邻的多条可能合成一段
+	 */
+	virtual void writeBatch(const struct iovec* iov, int count);
+
+	/*!
+	 * @brief writeBatch 是否接受多条日志合成的一段
+	 * @details 用 writev 整批写出的输出地返回 true，减少 iovec 数量
+	 */
+	virtual bool acceptsCoalesced() const { return false; }
+
+	/*!
+	 * @brief 刷出缓冲中尚未写出的日志
+	 */
+	virtual void flush() {}
+
 	void setFormatter(LogFormatter_ptr val);
 	LogFormatter_ptr getFormatter();
 };
 
+/*!
+ * @brief 同步写文件的输出地的缓冲大小(log.file.buffer_size)，0 表示不缓冲
+ */
+size_t FileLogBufferSize();
+
+/*!
+ * @brief 不低于该级别(log.file.flush_level)的日志立即刷出文件缓冲
+ */
+LogLevel FileLogFlushLevel();
+
+/*!
+ * @brief 登记带缓冲的输出地，异步日志刷写线程每隔 log.file.flush_interval 调用其 flush
+ */
+void RegisterBufferedAppender(LogAppender* appender);
+
+/*!
+ * @brief 取消登记，输出地析构前调用
+ */
+void UnregisterBufferedAppender(LogAppender* appender);
+
+/*!
+ * @brief 刷出所有已登记输出地的缓冲
+ */
+void FlushBufferedAppenders();
+
 class StdOutLogAppender : public LogAppender {
 public:
-	void log(LogEvent_ptr event) override;
+	void write(const char* data, size_t size) override;
+	void writeBatch(const struct iovec* iov, int count) override;
+	bool acceptsCoalesced() const override { return true; }
 };
 
 class FileLogAppender : public LogAppender {
 private:
-	// ļ·
+	// 文件路径
 	std::string __file_name;
-	// ļ
-	std::ofstream __file_stream;
+	// 以追加方式打开的文件描述符，批量写入时直接 writev
+	int __fd = -1;
+	// 同步输出的用户态缓冲，超过 log.file.buffer_size 或遇到
+	// 不低于 log.file.flush_level 的日志时写出
+	std::string __buffer;
+private:
+	/*!
+	 * @brief 写出缓冲，调用方持有锁
+	 */
+	void flushBuffer();
 public:
 	FileLogAppender(const std::string& filename);
-	void log(LogEvent_ptr event) override;
+	~FileLogAppender();
+	void write(const char* data, size_t size) override;
+	void writeLine(const char* data, size_t size, LogLevel level) override;
+	void writeBatch(const struct iovec* iov, int count) override;
+	bool acceptsCoalesced() const override { return true; }
+	void flush() override;
 	/*!
-	 * @brief ´־ļ 
+	 * @brief 重新打开日志文件 
 	 */
 	bool reopen();
 };
 
 //****************************************************************************
-// ־
+// 批量输出
+//****************************************************************************
+
+/*!
+ * @brief 异步日志线程的一批输出
+ * @details 每个格式器一块连续缓冲，同一条日志对共用格式器的输出地只格式化一次；
+ *          各输出地记录自己的日志在缓冲中的位置，相邻的合并为一段，最后用 writev 写出
+ */
+class LogBatch {
+private:
+	struct Buffer {
+		LogFormatter_ptr formatter;
+		std::string data;
+		const LogEvent* last = nullptr;		// 最近一次格式化的日志
+		size_t lastOffset = 0;
+		size_t lastSize = 0;
+	};
+
+	struct Slice {
+		size_t buffer;
+		size_t offset;
+		size_t size;
+	};
+
+	// 写出后保留各项及其容量供下一批复用，只有前 __bufferCount/__appenderCount 项在用
+	std::vector<Buffer> __buffers;
+	std::vector<std::pair<LogAppender_ptr, std::vector<Slice>>> __appenders;
+	size_t __bufferCount = 0;
+	size_t __appenderCount = 0;
+	// 本批中直接编码日志的输出地，批末统一 flush
+	std::vector<LogAppender_ptr> __raws;
+public:
+	/*!
+	 * @brief 追加一条日志到某个输出地
+	 */
+	void append(const LogAppender_ptr& appender, const LogFormatter_ptr& formatter, const LogEvent& event);
+
+	/*!
+	 * @brief 交给直接编码日志的输出地(isRaw)，批末再刷出它的缓冲
+	 */
+	void appendRaw(const LogAppender_ptr& appender, const LogEvent& event);
+
+	/*!
+	 * @brief 写出所有内容并清空，保留缓冲的容量
+	 */
+	void flush();
+};
+
+//****************************************************************************
+// 日志器
 //****************************************************************************
 
 class Logger {
+public:
+	using AppenderList = std::list<LogAppender_ptr>;
 private:
 	std::string __name;
-	LogLevel __level; // ־ܹ־
-	SpinLock __mutex;
-	std::list<LogAppender_ptr> __appenders;
+	LogLevel __level; // 本日志器能够输出的最大日志级别
+	RcuPtr<AppenderList> __appenders; // 每条日志都要遍历，写时复制
 public:
 	Logger(const std::string& name = "root");
 
-	// һ־ķ(Ҫ鿴־)
-	void log(LogEvent_ptr event);
+	// 一个输出日志的方法(传入想要查看的最大日志级别)
+	// 共用同一格式器的输出地只格式化一次
+	void log(const LogEvent& event);
 
 	const std::string& getName() const;
 	LogLevel getLevel() const;
@@ -247,17 +438,23 @@ public:
 
 	void addAppender(LogAppender_ptr appender);
 	void delAppender(LogAppender_ptr appender);
+
+	/*!
+	 * @brief 按本日志器的级别与输出地格式化日志，追加到 batch 中
+	 */
+	void appendTo(const LogEvent& event, LogBatch& batch);
 };
 
 //****************************************************************************
-//  عߺ
+// 管理类 及其相关工具宏
 //****************************************************************************
 
 class LoggerManager {
+public:
+	using LoggerMap = std::map<std::string, Logger_ptr>;
 private:
-	std::map<std::string, Logger_ptr> __loggers;
+	RcuPtr<LoggerMap> __loggers; // 写时复制，查找时不加锁
 	Logger_ptr __root;
-	SpinLock __mutex;
 public:
 	LoggerManager();
 	Logger_ptr getLogger(const std::string& name);
@@ -269,32 +466,112 @@ Logger_ptr SYLAR_LOG_ROOT();
 Logger_ptr SYLAR_LOG_NAME(const std::string& name);
 
 //****************************************************************************
-// RAII  LogEvent 
+// RAII 管理 LogEvent 的输出
 //****************************************************************************
 
+/*!
+ * @brief 日志宏生成的临时对象，析构时输出
+ * @details 消息写入线程局部、可复用的 LogStream，稳定后整条路径不分配内存。
+ *          logger 须在本对象析构前有效(日志宏中为同一表达式内的临时对象)
+ */
 class LogEventWrap {
 private:
-	Logger_ptr __logger;
-	LogEvent_ptr __event_ptr;
+	const Logger_ptr& __logger;
+	LogEvent __event;
+	LogStream* __stream;
 public:
-	LogEventWrap(Logger_ptr logger, LogEvent_ptr e);
+	LogEventWrap(const Logger_ptr& logger, LogLevel level, const LogLocation& location);
 	~LogEventWrap();
 
-	LogEvent_ptr getEvent() const;
-	std::stringstream& getSS();
+	const LogEvent& getEvent() const;
+	std::ostream& getSS();
+};
+
+//****************************************************************************
+// 调用处的采样与限流
+//****************************************************************************
+
+/*!
+ * @brief 一个调用处的采样与限流状态
+ * @details 由 SYLAR_LOG_SAMPLE / SYLAR_LOG_RATE 在调用处生成静态对象，
+ *          判断只用几次 relaxed 原子操作，被抑制的日志不会构造 LogEvent。
+ *          被抑制的条数每 log.limit.summary_interval 秒由刷写线程汇总输出到 root 日志器一次
+ */
+class LogLimiter : public boost::noncopyable {
+private:
+	const LogLocation& __location;
+	uint32_t __first;						// 先输出的条数
+	uint32_t __every;						// 之后每 every 条输出一条，0 表示不再输出
+	uint32_t __perSecond;					// 每秒最多输出的条数，0 表示不限
+	std::atomic<uint64_t> __count = { 0 };			// 采样计数
+	std::atomic<int64_t> __window = { 0 };			// 限流计数所在的秒
+	std::atomic<uint32_t> __windowCount = { 0 };	// 本秒内的计数
+	std::atomic<uint64_t> __suppressed = { 0 };		// 尚未汇总的抑制条数
+	std::atomic<bool> __registered = { false };
+	LogLimiter* __next = nullptr;			// 汇总链表，只增不删
+private:
+	/*!
+	 * @brief 记录一次抑制
+	 */
+	void suppress();
+public:
+	LogLimiter(const LogLocation& location, uint32_t first, uint32_t every, uint32_t per_second);
+
+	/*!
+	 * @brief 本次日志是否输出
+	 */
+	bool allow();
+
+	const LogLocation& getLocation() const { return __location; }
+
+	/*!
+	 * @brief 把各调用处尚未汇总的抑制条数输出到 root 日志器并清零
+	 * @return 本次汇总的总条数
+	 */
+	static uint64_t Summary();
+
+	/*!
+	 * @brief 有尚未汇总的抑制且到了汇总时间时输出汇总
+	 * @details 由异步日志刷写线程定期调用，调用处之后不再执行也能按时汇总
+	 */
+	static void Poll();
 };
 
 //****************************************************************************
-// ʹʽʽ־level־д뵽logger
+// 使用流式方式将日志级别level的日志写入到logger
 //****************************************************************************
 
+// 调用处的文件与行号是编译期常量，放进静态对象只传指针
+#define SYLAR_LOG_LOCATION() \
+	([]() -> const sylar::LogLocation& { \
+		static const sylar::LogLocation s_location = { __FILE__, __LINE__ }; \
+		return s_location; \
+	}())
+
 #define SYLAR_LOG_LEVEL(logger, level) \
 	if (logger->getLevel() <= level) \
- 		LogEventWrap(logger, LogEvent_ptr(new LogEvent( \
-				logger->getName(), level, __FILE__, __LINE__, 0, \
-                GetThreadId(), "log_thread", 1, time(0)))) \
-      	.getSS() \
-  		
+		LogEventWrap(logger, level, SYLAR_LOG_LOCATION()).getSS()
+
+// 参数须为常量，限流状态在调用处首次执行时创建
+#define SYLAR_LOG_LIMITER(first, every, per_second) \
+	([]() -> sylar::LogLimiter& { \
+		static sylar::LogLimiter s_limiter(SYLAR_LOG_LOCATION(), first, every, per_second); \
+		return s_limiter; \
+	}())
+
+#define SYLAR_LOG_LIMITED(logger, level, first, every, per_second) \
+	if (logger->getLevel() <= level) \
+		if (sylar::LogLimiter& _sylar_limiter = SYLAR_LOG_LIMITER(first, every, per_second); \
+			_sylar_limiter.allow()) \
+			LogEventWrap(logger, level, _sylar_limiter.getLocation()).getSS()
+
+// 先输出前 first 条，之后每 every 条输出一条
+#define SYLAR_LOG_SAMPLE(logger, level, first, every) \
+	SYLAR_LOG_LIMITED(logger, level, first, every, 0)
+
+// 每秒最多输出 per_second 条
+#define SYLAR_LOG_RATE(logger, level, per_second) \
+	SYLAR_LOG_LIMITED(logger, level, 0, 1, per_second)
 
 #define SYLAR_LOG_DEBUG(logger) SYLAR_LOG_LEVEL(logger, LogLevel::DEBUG)
 
@@ -1,7 +1,7 @@
 //*****************************************************************************
 //
 //
-//   ͷļװ˳ú
+//   此头文件封装了常用宏
 //  
 //
 //*****************************************************************************
@@ -18,16 +18,16 @@ namespace sylar
 {
 
 #if defined __GNUC__ || defined __llvm__
-/// LIKCLY ķװ, ߱Ż,ʳ
+/// LIKCLY 宏的封装, 告诉编译器优化,条件大概率成立
 #   define SYLAR_LIKELY(x)       __builtin_expect(!!(x), 1)
-/// LIKCLY ķװ, ߱Ż,ʲ
+/// LIKCLY 宏的封装, 告诉编译器优化,条件大概率不成立
 #   define SYLAR_UNLIKELY(x)     __builtin_expect(!!(x), 0)
 #else
 #   define SYLAR_LIKELY(x)      (x)
 #   define SYLAR_UNLIKELY(x)      (x)
 #endif
 
-/// Ժװ
+/// 断言宏封装
 #define SYLAR_ASSERT(x) \
     if(SYLAR_UNLIKELY(!(x))) { \
         SYLAR_LOG_ERROR(SYLAR_LOG_ROOT()) << "ASSERTION: " #x \
@@ -36,7 +36,7 @@ namespace sylar
         assert(x); \
     }
 
-/// Ժװ
+/// 断言宏封装
 #define SYLAR_ASSERT2(x, w) \
     if(SYLAR_UNLIKELY(!(x))) { \
         SYLAR_LOG_ERROR(SYLAR_LOG_ROOT()) << "ASSERTION: " #x \
@@ -0,0 +1,88 @@
+//*****************************************************************************
+//
+//
+//   运行时统计工具（直方图）
+//  
+//
+//*****************************************************************************
+
+#ifndef SYLAR_METRICS_H
+#define SYLAR_METRICS_H
+
+#include <atomic>
+#include <ostream>
+#include <stdint.h>
+#include <boost/noncopyable.hpp>
+
+namespace sylar
+{
+
+//****************************************************************************
+// 直方图
+//****************************************************************************
+
+/*!
+ * @brief 以 2 的幂为桶边界的直方图
+ * @details 第 0 个桶记录 0，第 i 个桶记录 [2^(i-1), 2^i)。
+ *          同一时刻只允许一个线程调用 record(读后写，不加锁)，其他线程可以随时读取，
+ *          适合每个线程一份、在热路径上使用
+ */
+class Histogram : public boost::noncopyable {
+public:
+    static const size_t BUCKETS = 65;
+private:
+    std::atomic<uint64_t> __buckets[BUCKETS];   // 各个桶的计数
+    std::atomic<uint64_t> __count = { 0 };      // 记录次数
+    std::atomic<uint64_t> __sum = { 0 };        // 记录值之和
+    std::atomic<uint64_t> __max = { 0 };        // 记录的最大值
+public:
+    /*!
+     * @brief 构造函数
+     */
+    Histogram();
+
+    /*!
+     * @brief 记录一个值
+     */
+    void record(uint64_t v);
+
+    /*!
+     * @brief 将另一个直方图累加到本直方图
+     */
+    void merge(const Histogram& other);
+
+    /*!
+     * @brief 清空
+     */
+    void reset();
+
+    /*!
+     * @brief 记录次数
+     */
+    uint64_t getCount() const;
+
+    /*!
+     * @brief 记录值之和
+     */
+    uint64_t getSum() const;
+
+    /*!
+     * @brief 记录的最大值
+     */
+    uint64_t getMax() const;
+
+    /*!
+     * @brief 返回百分位数所在桶的上界
+     * @param p 百分位(0 ~ 1)
+     */
+    uint64_t percentile(double p) const;
+
+    /*!
+     * @brief 输出 count/avg/p50/p99/max
+     */
+    std::ostream& dump(std::ostream& os) const;
+};
+
+}; /* sylar */
+
+#endif /* SYLAR_METRICS_H */
@@ -1,7 +1,7 @@
 //*****************************************************************************
 //
 //
-//   ͷļװ
+//   此头文件封装锁
 //  
 //
 //*****************************************************************************
@@ -11,6 +11,10 @@
 #define SYLAR_MUTEX_H
 
 #include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <ostream>
 #include <stdint.h>
 #include <stdexcept>
 #include <pthread.h>
@@ -20,7 +24,7 @@
 namespace sylar {
 
 //****************************************************************************
-// ǰ
+// 前置声明
 //****************************************************************************
 
 template<class T>
@@ -47,41 +51,120 @@ class RWMutex;
 class NullRWMutex;
 
 //****************************************************************************
-// ֲģ
+// 锁竞争统计
+//****************************************************************************
+
+/*!
+ * @brief 一组锁(同名或同一创建位置)的竞争统计
+ */
+struct LockStats {
+    std::string name;                               // 名称或创建位置 file:line
+    std::atomic<uint64_t> acquisitions = { 0 };     // 加锁次数
+    std::atomic<uint64_t> contended = { 0 };        // 首次尝试失败、需要等待的次数
+    std::atomic<uint64_t> waitNS = { 0 };           // 等待总时间(纳秒)
+    std::atomic<uint64_t> maxHoldNS = { 0 };        // 最长持有时间(纳秒)，读锁不统计
+};
+
+/*!
+ * @brief 锁的创建位置与统计状态，嵌入每个锁中
+ */
+struct LockSite {
+    const char* file;                               // 创建位置的文件
+    int line;                                       // 创建位置的行号
+    const char* name;                               // 显式名称(静态字符串)，为空时按创建位置汇总
+    std::atomic<LockStats*> stats = { nullptr };    // 首次统计时解析
+    uint64_t acquiredNS = 0;                        // 独占持有的开始时间，受锁自身保护
+
+    LockSite(const char* n, const char* f, int l) : file(f), line(l), name(n) {}
+};
+
+/*!
+ * @brief 锁竞争分析器
+ * @details 运行时开启(LockProfiler::SetEnabled 或配置 lock.profile)，关闭时每次加解锁
+ *          只多一次 relaxed 读。开启后 Mutex.h 中的所有锁记录加锁次数、竞争次数、
+ *          等待时间与最长持有时间，按构造时给定的名称或创建位置汇总
+ */
+class LockProfiler {
+private:
+    static std::atomic<bool> s_enabled;
+public:
+    /*!
+     * @brief 是否开启
+     */
+    static bool IsEnabled() { return s_enabled.load(std::memory_order_relaxed); }
+
+    /*!
+     * @brief 开启或关闭统计
+     */
+    static void SetEnabled(bool v);
+
+    /*!
+     * @brief 清空已有的统计
+     */
+    static void Reset();
+
+    /*!
+     * @brief 获取锁所属的统计项
+     */
+    static LockStats* GetStats(LockSite& site);
+
+    /*!
+     * @brief 按等待总时间从大到小返回统计快照
+     */
+    static std::vector<std::shared_ptr<LockStats>> GetReport();
+
+    /*!
+     * @brief 输出等待时间最长的前 n 项
+     */
+    static std::ostream& Dump(std::ostream& os, size_t n = 20);
+};
+
+/*!
+ * @brief 可被 LockProfiler 统计的锁的基类
+ */
+class ProfiledLock {
+protected:
+    LockSite __site;
+public:
+    ProfiledLock(const char* name, const char* file, int line) : __site(name, file, line) {}
+};
+
+//****************************************************************************
+// 局部锁的模板声明
 //****************************************************************************
 
 template<class T>
 class ScopedLockImpl {
 private:
-    // 
+    // 锁
     T& __mutex;
-    // Ƿ
+    // 是否已上锁
     bool __locked;
 public:
     /*!
-     * @brief 캯
-     * @param mutex 
+     * @brief 构造函数
+     * @param mutex 锁
      */
     ScopedLockImpl(T& mutex);
 
     /*!
-     * @brief ,Զͷ
+     * @brief 析构函数,自动释放锁
      */
     ~ScopedLockImpl();
 
     /*!
-     * @brief 
+     * @brief 加锁
      */
     void lock();
 
     /*!
-     * @brief 
+     * @brief 解锁
      */
     void unlock();
 };
 
 //****************************************************************************
-// ֲģ
+// 局部读锁的模板声明
 //****************************************************************************
 
 template<class T>
@@ -89,33 +172,33 @@ class ReadScopedLockImpl {
 private:
     // mutex
     T& __mutex;
-    // Ƿ
+    // 是否已上锁
     bool __locked;
 public:
     /*!
-     * @brief 캯
-     * @param mutex 
+     * @brief 构造函数
+     * @param mutex 读锁
      */
     ReadScopedLockImpl(T& mutex);
 
     /*!
-     * @brief 
+     * @brief 析构函数
      */
     ~ReadScopedLockImpl();
 
     /*!
-     * @brief 
+     * @brief 加锁
      */
     void lock();
 
     /*!
-     * @brief 
+     * @brief 解锁
      */
     void unlock();
 };
 
 //****************************************************************************
-// ֲдģ
+// 局部写锁的模板声明
 //****************************************************************************
 
 template<class T>
@@ -123,33 +206,33 @@ class WriteScopedLockImpl {
 private:
     // Mutex
     T& __mutex;
-    // Ƿ
+    // 是否已上锁
     bool __locked;
 public:
     /*!
-     * @brief 캯
-     * @param mutex д
+     * @brief 构造函数
+     * @param mutex 写锁
      */
     WriteScopedLockImpl(T& mutex);
 
     /*!
-     * @brief 
+     * @brief 析构函数
      */
     ~WriteScopedLockImpl();
 
     /*!
-     * @brief 
+     * @brief 加锁
      */
     void lock();
 
     /*!
-     * @brief 
+     * @brief 解锁
      */
     void unlock();
 };
 
 //****************************************************************************
-// ź
+// 信号量类型
 //****************************************************************************
 
 class Semaphore : public boost::noncopyable{
@@ -157,95 +240,105 @@ private:
     sem_t __semaphore;
 public:
     /*!
-     * @brief 캯
-     * @param count źֵĴС
+     * @brief 构造函数
+     * @param count 信号量值的大小
      */
     Semaphore(uint32_t count = 0);
 
     /*!
-     * @brief 
+     * @brief 析构函数
      */
     ~Semaphore();
 
     /*!
-     * @brief ȡź
+     * @brief 获取信号量
      */
     void wait();
 
     /*!
-     * @brief  ͷź
+     * @brief 获取信号量，最多等待 timeout_ms 毫秒
+     * @return 超时返回 false
+     */
+    bool wait(uint64_t timeout_ms);
+
+    /*!
+     * @brief  释放信号量
      */
     void notify();
 };
 
 //****************************************************************************
-// 
+// 自旋锁
 //****************************************************************************
 
-class SpinLock : public boost::noncopyable {
+class SpinLock : public boost::noncopyable, public ProfiledLock {
 private:
     pthread_spinlock_t __mutex;
 public:    
     using Lock =  ScopedLockImpl<SpinLock>;
 
     /*!
-     * @brief 캯
+     * @brief 构造函数
+     * @param name 统计时使用的名称，须为静态字符串，为空时按创建位置汇总
+     * @param file,line 创建位置，默认取调用处，用于竞争统计
      */
-    SpinLock();
+    explicit SpinLock(const char* name = nullptr, const char* file = __builtin_FILE(), int line = __builtin_LINE());
 
     /*!
-     * @brief 
+     * @brief 析构函数
      */
     ~SpinLock();
 
     /*!
-     * @brief 
+     * @brief 加锁
      */
     void lock();
 
     /*!
-     * @brief 
+     * @brief 解锁
      */
     void unlock();
 };
 
 //****************************************************************************
-// ԭ
+// 原子锁
 //****************************************************************************
 
-class CASLock : public boost::noncopyable {
+class CASLock : public boost::noncopyable, public ProfiledLock {
 private:
-    /// ԭ״̬
+    /// 原子状态
     volatile std::atomic_flag __mutex;
 public:
     using Lock = ScopedLockImpl<CASLock>;
 
     /*!
-     * @brief 캯
+     * @brief 构造函数
+     * @param name 统计时使用的名称，须为静态字符串，为空时按创建位置汇总
+     * @param file,line 创建位置，默认取调用处，用于竞争统计
      */
-    CASLock();
+    explicit CASLock(const char* name = nullptr, const char* file = __builtin_FILE(), int line = __builtin_LINE());
 
     /*!
-     * @brief 
+     * @brief 析构函数
      */
     ~CASLock();
 
     /*!
-     * @brief 
+     * @brief 上锁
      */
     void lock();
 
     /*!
-     * @brief 
+     * @brief 解锁
      */
     void unlock();
 };
 
 //****************************************************************************
-// 
+// 互斥锁
 //****************************************************************************
 
-class Mutex : public boost::noncopyable {
+class Mutex : public boost::noncopyable, public ProfiledLock {
 private:
     // mutex
     pthread_mutex_t __mutex;
@@ -253,29 +346,81 @@ public:
     using Lock = ScopedLockImpl<Mutex>;
 
     /*!
-     * @brief 캯
+     * @brief 构造函数
+     * @param name 统计时使用的名称，须为静态字符串，为空时按创建位置汇总
+     * @param file,line 创建位置，默认取调用处，用于竞争统计
      */
-    Mutex();
+    explicit Mutex(const char* name = nullptr, const char* file = __builtin_FILE(), int line = __builtin_LINE());
 
     /*!
-     * @brief 
+     * @brief 析构函数
      */
     ~Mutex();
 
     /*!
-     * @brief 
+     * @brief 加锁
      */
     void lock();
 
     /*!
-     * @brief 
+     * @brief 解锁
      */
     void unlock();
 
 };
 
 //****************************************************************************
-// ڵԣ
+// 自适应互斥锁
+//****************************************************************************
+
+/*!
+ * @brief 基于 futex 的自适应互斥锁
+ * @details 先带退避地自旋一段时间，仍拿不到锁再在 futex 上睡眠。自旋上限按最近
+ *          几次加锁实际自旋的次数自适应调整：临界区短时多自旋，长时尽快睡眠。
+ *          无竞争时加解锁各只有一次原子操作
+ */
+class FutexMutex : public boost::noncopyable, public ProfiledLock {
+private:
+    std::atomic<int> __state = { 0 };       // 0 未加锁, 1 加锁无等待者, 2 加锁且可能有等待者
+    std::atomic<int> __spins = { 0 };       // 近期平均自旋次数
+private:
+    /*!
+     * @brief 首次尝试失败后的自旋与睡眠
+     */
+    void lockSlow();
+public:
+    using Lock = ScopedLockImpl<FutexMutex>;
+
+    /*!
+     * @brief 构造函数
+     * @param name 统计时使用的名称，须为静态字符串，为空时按创建位置汇总
+     * @param file,line 创建位置，默认取调用处，用于竞争统计
+     */
+    explicit FutexMutex(const char* name = nullptr, const char* file = __builtin_FILE(), int line = __builtin_LINE());
+
+    /*!
+     * @brief 析构函数
+     */
+    ~FutexMutex();
+
+    /*!
+     * @brief 加锁
+     */
+    void lock();
+
+    /*!
+     * @brief 尝试加锁
+     */
+    bool tryLock();
+
+    /*!
+     * @brief 解锁
+     */
+    void unlock();
+};
+
+//****************************************************************************
+// 空锁（用于调试）
 //****************************************************************************
 
 class NullMutex : public boost::noncopyable {
@@ -283,67 +428,143 @@ public:
     using Lock = ScopedLockImpl<NullMutex>;
 
     /*!
-     * @brief 캯
+     * @brief 构造函数
      */
     NullMutex();
 
     /*!
-     * @brief 
+     * @brief 析构函数
      */
     ~NullMutex();
 
     /*!
-     * @brief 
+     * @brief 加锁
      */
     void lock();
 
     /*!
-     * @brief 
+     * @brief 解锁
      */
     void unlock();
 };
 
 //****************************************************************************
-// д
+// 读写互斥量
 //****************************************************************************
 
-class RWMutex : public boost::noncopyable {
+class RWMutex : public boost::noncopyable, public ProfiledLock {
 private:
-    // д
+    // 读写锁
     pthread_rwlock_t __lock;
 public:
     using ReadLock = ReadScopedLockImpl<RWMutex>;
     using WriteLock = WriteScopedLockImpl<RWMutex>;;
 
     /*!
-     * @brief 캯
+     * @brief 构造函数
+     * @param name 统计时使用的名称，须为静态字符串，为空时按创建位置汇总
+     * @param file,line 创建位置，默认取调用处，用于竞争统计
      */
-    RWMutex();
+    explicit RWMutex(const char* name = nullptr, const char* file = __builtin_FILE(), int line = __builtin_LINE());
 
     /*!
-     * @brief 
+     * @brief 析构函数
      */
     ~RWMutex();
 
     /*!
-     * @brief Ӷ
+     * @brief 加读锁
      */
     void rdlock();
 
     /*!
-     * @brief д
+     * @brief 加写锁
      */
     void wrlock();
 
     /**
-     * @brief 
+     * @brief 解锁
      */
     void unlock();
 
 };
 
 //****************************************************************************
-// նд(ڵ)
+// 自适应读写锁
+//****************************************************************************
+
+/*!
+ * @brief 基于 futex、写优先的读写锁
+ * @details 读者计数分散在多个独占缓存行的槽中，每个线程固定使用一个槽，读锁之间
+ *          不争抢同一缓存行。写者置位后新来的读者让路并睡眠，写者等已进入的读者
+ *          退出后获得锁。适合读多写少的场景，写锁需要遍历所有槽
+ */
+class FutexRWMutex : public boost::noncopyable, public ProfiledLock {
+public:
+    static const size_t SLOTS = 16;
+private:
+    struct alignas(64) Slot {
+        std::atomic<int64_t> readers = { 0 };
+    };
+
+    Slot __slots[SLOTS];                    // 各槽的读者数
+    alignas(64) std::atomic<int> __writer = { 0 };  // 0 无写者, 1 写者等待读者退出, 2 写者持有锁
+    std::atomic<int> __drain = { 0 };       // 读者退出时递增，写者在其上等待
+    FutexMutex __writerMutex;               // 写者之间互斥
+private:
+    /*!
+     * @brief 所有槽的读者数之和
+     */
+    int64_t readers() const;
+
+    /*!
+     * @brief 自旋后在 futex 上等待写者释放
+     */
+    void waitWriter();
+
+    /*!
+     * @brief 加写锁，返回是否发生了等待
+     */
+    bool wrlockImpl();
+public:
+    using ReadLock = ReadScopedLockImpl<FutexRWMutex>;
+    using WriteLock = WriteScopedLockImpl<FutexRWMutex>;
+
+    /*!
+     * @brief 构造函数
+     * @param name 统计时使用的名称，须为静态字符串，为空时按创建位置汇总
+     * @param file,line 创建位置，默认取调用处，用于竞争统计
+     */
+    explicit FutexRWMutex(const char* name = nullptr, const char* file = __builtin_FILE(), int line = __builtin_LINE());
+
+    /*!
+     * @brief 析构函数
+     */
+    ~FutexRWMutex();
+
+    /*!
+     * @brief 加读锁
+     */
+    void rdlock();
+
+    /*!
+     * @brief 尝试加读锁，有写者等待或持有时失败
+     */
+    bool tryRdlock();
+
+    /*!
+     * @brief 加写锁
+     */
+    void wrlock();
+
+    /*!
+     * @brief 解锁(读锁或写锁)
+     */
+    void unlock();
+};
+
+//****************************************************************************
+// 空读写锁(用于调试)
 //****************************************************************************
 
 class NullRWMutex : public boost::noncopyable {
@@ -352,38 +573,38 @@ public:
     using WriteLock = WriteScopedLockImpl<NullRWMutex>;;
 
     /*!
-     * @brief 캯
+     * @brief 构造函数
      */
     NullRWMutex();
 
     /*!
-     * @brief 
+     * @brief 析构函数
      */
     ~NullRWMutex();
 
     /*!
-     * @brief Ӷ
+     * @brief 加读锁
      */
     void rdlock();
 
     /*!
-     * @brief д
+     * @brief 加写锁
      */
     void wrlock();
 
     /*!
-     * @brief 
+     * @brief 解锁
      */
     void unlock();
 };
 
 //****************************************************************************
-// Эź
+// 协程信号量
 //****************************************************************************
 
 
 //****************************************************************************
-// ScopedLockImpl<T> ʵ
+// ScopedLockImpl<T> 的实现
 //****************************************************************************
 
 template<class T>
@@ -414,7 +635,7 @@ void ScopedLockImpl<T>::unlock() {
 }
 
 //****************************************************************************
-// ReadScopedLockImpl<T> ʵ
+// ReadScopedLockImpl<T> 的实现
 //****************************************************************************
 
 template<class T>
@@ -446,7 +667,7 @@ void ReadScopedLockImpl<T>::unlock() {
 
 
 //****************************************************************************
-// WriteScopedLockImpl<T> ʵ
+// WriteScopedLockImpl<T> 的实现
 //****************************************************************************
 
 template<class T>
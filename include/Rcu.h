@@ -0,0 +1,125 @@
+//*****************************************************************************
+//
+//
+//   此头文件实现基于 epoch 的 RCU，用于读多写少的注册表
+//
+//
+//*****************************************************************************
+
+#ifndef SYLAR_RCU_H
+#define SYLAR_RCU_H
+
+#include <memory>
+#include <atomic>
+#include <functional>
+#include <stdint.h>
+#include <boost/noncopyable.hpp>
+#include "Mutex.h"
+
+namespace sylar
+{
+
+//****************************************************************************
+// 基于 epoch 的内存回收
+//****************************************************************************
+
+/*!
+ * @brief 基于 epoch 的延迟回收
+ * @details 读者进入临界区时把当前全局 epoch 记到本线程的记录里，离开时清零，
+ *          只有普通的 store 与一次 fence，没有锁和原子读改写。写者发布新快照后
+ *          把旧快照交给 Retire，全局 epoch 前进；等所有仍在临界区内的读者的
+ *          epoch 都晚于旧快照时再释放。回收在 Retire 与 Quiescent 中进行，
+ *          调度器每次回到调度协程时调用 Quiescent。
+ *          读临界区内不能让出协程
+ */
+class Rcu {
+public:
+    /*!
+     * @brief 读临界区，可嵌套
+     */
+    class ReadLock : public boost::noncopyable {
+    private:
+        void* __record;
+    public:
+        ReadLock();
+        ~ReadLock();
+    };
+
+    /*!
+     * @brief 延迟执行 fun，直到当前所有读临界区都已结束
+     */
+    static void Retire(std::function<void()> fun);
+
+    /*!
+     * @brief 静默点：当前线程不在读临界区时回收已过宽限期的对象
+     * @details 没有待回收对象时只有一次 relaxed 读
+     */
+    static void Quiescent();
+
+    /*!
+     * @brief 获取待回收的对象数
+     */
+    static uint64_t GetPending();
+};
+
+//****************************************************************************
+// 写时复制的快照指针
+//****************************************************************************
+
+/*!
+ * @brief 写时复制的快照
+ * @details 读者在 Rcu::ReadLock 内通过 get() 读取当前快照；写者之间互斥，
+ *          复制当前快照、修改后原子替换，旧快照交给 Rcu 延迟释放
+ */
+template<class T>
+class RcuPtr : public boost::noncopyable {
+public:
+    using MutexType = Mutex;
+private:
+    std::atomic<T*> __ptr;
+    MutexType __mutex;      // 写者之间互斥
+public:
+    RcuPtr() : __ptr(new T()) {}
+
+    explicit RcuPtr(const T& value) : __ptr(new T(value)) {}
+
+    /*!
+     * @brief 析构时不应再有读者
+     */
+    ~RcuPtr() { delete __ptr.load(std::memory_order_relaxed); }
+
+    /*!
+     * @brief 获取当前快照，调用方须持有 Rcu::ReadLock
+     */
+    const T* get() const { return __ptr.load(std::memory_order_acquire); }
+
+    /*!
+     * @brief 修改快照
+     * @param fun bool(T&)，在当前快照的副本上修改，返回 false 时放弃本次修改
+     * @return 是否发布了新快照
+     */
+    template<class F>
+    bool update(F fun);
+};
+
+template<class T>
+template<class F>
+bool RcuPtr<T>::update(F fun) {
+    T* old = nullptr;
+    {
+        MutexType::Lock lock(__mutex);
+        old = __ptr.load(std::memory_order_relaxed);
+        std::unique_ptr<T> copy(new T(*old));
+        if (!fun(*copy)) {
+            return false;
+        }
+        __ptr.store(copy.release(), std::memory_order_seq_cst);
+    }
+    // 旧快照的析构可能再次修改本对象，放到锁外
+    Rcu::Retire([old]() { delete old; });
+    return true;
+}
+
+}; /* sylar */
+
+#endif /* SYLAR_RCU_H */
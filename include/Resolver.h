@@ -0,0 +1,165 @@
+//*****************************************************************************
+//
+//
+//   此头文件实现协程化的 DNS 解析器
+//
+//
+//*****************************************************************************
+
+#ifndef SYLAR_RESOLVER_H
+#define SYLAR_RESOLVER_H
+
+#include <memory>
+#include <vector>
+#include <string>
+#include <atomic>
+#include <ostream>
+#include <unordered_map>
+#include <sys/types.h>
+#include <boost/noncopyable.hpp>
+#include "Address.h"
+#include "Mutex.h"
+#include "Single.h"
+
+namespace sylar
+{
+
+//****************************************************************************
+// 前置声明
+//****************************************************************************
+
+class Fiber;
+using Fiber_ptr = std::shared_ptr<Fiber>;
+
+class Scheduler;
+
+class Resolver;
+using Resolver_single = Single<Resolver>;
+
+//****************************************************************************
+// DNS 解析器
+//****************************************************************************
+
+/*!
+ * @brief 基于 UDP 的 DNS 解析器
+ * @details 先查 /etc/hosts，再通过 hook 后的 UDP socket 向 resolv.conf(或配置
+ *          dns.nameservers)中的服务器查询 A/AAAA 记录，在协程中等待应答时只让出
+ *          协程，不阻塞工作线程。应答按 TTL 缓存，NXDOMAIN/NODATA 按 SOA 最小
+ *          TTL 做负缓存；同一名字的并发查询合并为一次网络请求
+ */
+class Resolver : public boost::noncopyable {
+public:
+    using MutexType = Mutex;
+    using RWMutexType = RWMutex;
+    static const size_t SHARDS = 16;
+
+    /*!
+     * @brief 单次查询的结果
+     */
+    enum class Status {
+        OK = 0,         // 拿到地址
+        NEGATIVE = 1,   // 名字不存在或没有该类型的记录
+        FAIL = 2        // 超时或服务器错误，不缓存
+    };
+private:
+    /*!
+     * @brief 缓存项，addrs 为空表示负缓存
+     */
+    struct CacheEntry {
+        std::vector<IPAddress_ptr> addrs;
+        uint64_t expireMS = 0;
+    };
+
+    /*!
+     * @brief 进行中的查询，后来的协程挂在 waiters 上等待结果
+     */
+    struct Pending {
+        std::vector<std::pair<Scheduler*, Fiber_ptr>> waiters;
+        std::vector<IPAddress_ptr> addrs;
+        bool ok = false;
+    };
+
+    /*!
+     * @brief 缓存分片，降低多线程查询时的锁竞争
+     */
+    struct Shard {
+        MutexType mutex;
+        std::unordered_map<std::string, CacheEntry> cache;
+        std::unordered_map<std::string, std::shared_ptr<Pending>> pending;
+    };
+
+    Shard __shards[SHARDS];
+
+    RWMutexType __confMutex;                                                // 保护以下配置文件内容
+    std::unordered_map<std::string, std::vector<IPAddress_ptr>> __hosts;    // hosts 文件内容
+    std::vector<IPAddress_ptr> __servers;                                   // resolv.conf 中的服务器
+    std::vector<std::string> __search;                                      // 搜索域
+    int __ndots = 1;                                                        // 少于 ndots 个点时优先拼接搜索域
+    int __timeoutMS = 5000;                                                 // 单次查询超时
+    int __attempts = 2;                                                     // 轮询所有服务器的次数
+    time_t __hostsMtime = 0;                                                // hosts 文件的修改时间
+    time_t __resolvMtime = 0;                                               // resolv.conf 的修改时间
+    std::string __hostsPath;                                                // 已加载的 hosts 路径
+    std::string __resolvPath;                                               // 已加载的 resolv.conf 路径
+    std::atomic<uint64_t> __lastCheckMS = { 0 };                            // 上次检查文件变化的时间
+    std::atomic<bool> __loaded = { false };                                 // 是否已加载过配置文件
+
+    std::atomic<uint64_t> __hits = { 0 };                                   // 命中缓存次数
+    std::atomic<uint64_t> __misses = { 0 };                                 // 未命中缓存次数
+    std::atomic<uint64_t> __coalesced = { 0 };                              // 合并到进行中查询的次数
+    std::atomic<uint64_t> __queries = { 0 };                                // 发出的 DNS 请求数
+private:
+    /*!
+     * @brief 配置文件有变化时重新加载，每秒最多检查一次
+     */
+    void reloadIfChanged();
+
+    /*!
+     * @brief 查询单个地址族，负责缓存与合并并发查询
+     */
+    bool lookupFamily(std::vector<IPAddress_ptr>& result, const std::string& name, int family);
+
+    /*!
+     * @brief 按搜索域依次查询，返回地址与缓存时间(秒)
+     */
+    Status query(const std::string& name, int family, std::vector<IPAddress_ptr>& addrs, uint32_t& ttl);
+
+    /*!
+     * @brief 向服务器列表查询一个完整域名
+     */
+    Status queryName(const std::vector<IPAddress_ptr>& servers, const std::string& qname, uint16_t qtype,
+                     int timeout_ms, int attempts, std::vector<IPAddress_ptr>& addrs, uint32_t& ttl);
+public:
+    /*!
+     * @brief 解析器是否启用(配置 dns.enable)
+     */
+    static bool IsEnabled();
+
+    /*!
+     * @brief 是否数字形式的 IPv4/IPv6 地址
+     */
+    static bool IsNumericHost(const std::string& host);
+
+    /*!
+     * @brief 解析域名
+     * @param result 追加解析到的地址，端口为 0，调用方可自由修改
+     * @param name 域名
+     * @param family AF_INET、AF_INET6 或 AF_UNSPEC
+     * @return 是否解析到地址
+     */
+    bool lookup(std::vector<IPAddress_ptr>& result, const std::string& name, int family = AF_INET);
+
+    /*!
+     * @brief 清空缓存
+     */
+    void clear();
+
+    /*!
+     * @brief 输出缓存统计
+     */
+    std::ostream& dump(std::ostream& os);
+};
+
+}; /* sylar */
+
+#endif /* SYLAR_RESOLVER_H */
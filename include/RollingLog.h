@@ -0,0 +1,147 @@
+//*****************************************************************************
+//
+//
+//   此头文件实现按大小与时间滚动的日志文件，写入 mmap 预分配的文件区域
+//
+//
+//*****************************************************************************
+
+#ifndef SYLAR_ROLLINGLOG_H
+#define SYLAR_ROLLINGLOG_H
+
+#include <memory>
+#include <vector>
+#include <string>
+#include <atomic>
+#include "Log.h"
+#include "Mutex.h"
+
+namespace sylar
+{
+
+//****************************************************************************
+// 前置声明
+//****************************************************************************
+
+class Thread;
+using Thread_ptr = std::shared_ptr<Thread>;
+
+class RollingFileLogAppender;
+using RollingFileLogAppender_ptr = std::shared_ptr<RollingFileLogAppender>;
+
+//****************************************************************************
+// 滚动日志文件
+//****************************************************************************
+
+/*!
+ * @brief 按大小与时间滚动的日志文件输出地
+ * @details 当前段总是名为 file_name，文件预先分配 max_size 字节并映射到内存，
+ *          写日志只是在锁内 memcpy，不经过系统调用。写满或到达滚动时间后，
+ *          当前段改名为 file_name.<打开时间>.<序号>，换上后台线程提前准备好的下一段。
+ *          截断到实际长度、解除映射以及可选的 gzip 压缩都在后台线程上完成，
+ *          不阻塞写日志的线程。
+ *          进程崩溃时当前段末尾会留有未写入的 0 字节
+ */
+class RollingFileLogAppender : public LogAppender {
+private:
+    /*!
+     * @brief 一个映射到内存的日志段
+     */
+    struct Segment {
+        std::string path;
+        int fd = -1;
+        char* data = nullptr;
+        size_t capacity = 0;
+        size_t size = 0;        // 已写入的字节数
+        time_t opened = 0;      // 打开时间，用于命名和按时间滚动
+    };
+    using Segment_ptr = std::shared_ptr<Segment>;
+
+    std::string __file_name;
+    size_t __maxSize;
+    uint32_t __interval;                    // 按时间滚动的间隔(秒)，0 表示只按大小滚动
+    bool __compress;                        // 滚动出的段是否 gzip 压缩
+
+    Segment_ptr __active;                   // 当前段，由 __mutex 保护
+    Segment_ptr __spare;                    // 后台线程准备好的下一段
+    std::vector<Segment_ptr> __retired;     // 等待后台线程收尾的段
+    uint32_t __seq = 0;                     // 滚动序号
+
+    Semaphore __semaphore;                  // 唤醒后台线程
+    std::atomic<bool> __stopping = { false };
+    Thread_ptr __worker;
+
+    std::atomic<uint64_t> __rotations = { 0 };
+    std::atomic<uint64_t> __dropped = { 0 };    // 无法分配新段而丢弃的字节数
+private:
+    /*!
+     * @brief 创建并映射一个预分配的段
+     */
+    Segment_ptr createSegment(const std::string& path);
+
+    /*!
+     * @brief 截断到实际长度并解除映射，按需压缩
+     */
+    void finishSegment(Segment_ptr segment);
+
+    /*!
+     * @brief 丢弃未使用的段
+     */
+    void dropSegment(Segment_ptr segment);
+
+    /*!
+     * @brief 换上新段，调用方持有 __mutex
+     */
+    void rotateLocked(time_t now);
+
+    /*!
+     * @brief 写入一段数据，调用方持有 __mutex
+     */
+    void append(const char* data, size_t size, time_t now);
+
+    /*!
+     * @brief 后台线程主循环
+     */
+    void run();
+public:
+    /*!
+     * @param file_name 当前段的文件名
+     * @param max_size 每段的最大字节数
+     * @param interval 按时间滚动的间隔(秒)，0 表示只按大小滚动
+     * @param compress 滚动出的段是否 gzip 压缩为 .gz
+     */
+    RollingFileLogAppender(const std::string& file_name, size_t max_size = 64 * 1024 * 1024,
+                           uint32_t interval = 0, bool compress = false);
+
+    /*!
+     * @brief 停止后台线程，当前段截断到实际长度后保留为 file_name
+     */
+    ~RollingFileLogAppender();
+
+    void write(const char* data, size_t size) override;
+    void writeBatch(const struct iovec* iov, int count) override;
+
+    /*!
+     * @brief 立即滚动到新的一段
+     */
+    void rotate();
+
+    /*!
+     * @brief 获取滚动次数
+     */
+    uint64_t getRotations() const { return __rotations; }
+
+    /*!
+     * @brief 获取丢弃的字节数
+     */
+    uint64_t getDropped() const { return __dropped; }
+
+    /*!
+     * @brief 将 src 压缩为 gzip 格式的 dst
+     */
+    static bool CompressFile(const std::string& src, const std::string& dst);
+};
+
+}; /* sylar */
+
+#endif /* SYLAR_ROLLINGLOG_H */
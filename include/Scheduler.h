@@ -1,7 +1,7 @@
 //*****************************************************************************
 //
 //
-//   ͷļװЭ̵
+//   此头文件封装协程调度器
 //  
 //
 //*****************************************************************************
@@ -24,7 +24,7 @@ namespace sylar
 {
 
 //****************************************************************************
-// ǰ
+// 前置声明
 //****************************************************************************
 
 class Scheduler;
@@ -33,62 +33,62 @@ using Scheduler_ptr = std::shared_ptr<Scheduler>;
 class FiberAndThread;
 
 //****************************************************************************
-// Э̵
+// 协程调度器
 //****************************************************************************
 
 /*!
- * @brief Э /  / ߳
+ * @brief 协程 / 函数 / 线程组
  */
 class FiberAndThread {
 public:
-	// Э
+	// 协程
 	Fiber_ptr __fiber;
-	// Эִк
+	// 协程执行函数
 	std::function<void()> __cb;
-	// ߳ id
+	// 线程 id
 	int __thread_id;
 public:
 	/*!
-	 * @brief ޲ι캯
+	 * @brief 无参构造函数
 	 */
 	FiberAndThread();
 
 	/*!
-	 * @brief 캯
-	 * @param f Э
-	 * @param thr ߳ id
+	 * @brief 构造函数
+	 * @param f 协程
+	 * @param thr 线程 id
 	 */
 	FiberAndThread(Fiber_ptr f, int thr);
 
 	/*!
-	 * @brief 캯
-	 * @param f Эָ
-	 * @param thr ߳id
+	 * @brief 构造函数
+	 * @param f 协程指针
+	 * @param thr 线程id
 	 */
 	FiberAndThread(Fiber_ptr* f, int thr);
 
 	/*!
-	 * @brief 캯
-	 * @param f Эִк
-	 * @param thr ߳id
+	 * @brief 构造函数
+	 * @param f 协程执行函数
+	 * @param thr 线程id
 	 */
 	FiberAndThread(std::function<void()> f, int thr);
 
 	/*!
-	 * @brief 캯
-	 * @param f Эִкָ
-	 * @param thr ߳id
+	 * @brief 构造函数
+	 * @param f 协程执行函数指针
+	 * @param thr 线程id
 	 */
 	FiberAndThread(std::function<void()>* f, int thr);
 
 	/*!
-	 * @brief 
+	 * @brief 重置数据
 	 */
 	void reset();
 };
 
 /*!
- * @brief Э̵
+ * @brief 协程调度器
  */
 class Scheduler {
 public:
@@ -96,127 +96,158 @@ public:
 private:
 	// Mutex
 	MutexType __mutex;
-	// ̳߳
+	// 线程池
 	std::vector<Thread_ptr> __threads;
-	// ִеЭ̶
+	// 待执行的协程队列
 	std::list<FiberAndThread> __fibers;
-	// use_caller Ϊ true ʱЧ Э
+	// use_caller 为 true 时有效， 调度协程
 	Fiber_ptr __root_fiber;
-	// Э̵
+	// 协程调度器名称
 	std::string __name;
 protected:
-	// Эµ߳ id 
+	// 协程下的线程 id 数组
 	std::vector<int> __thread_ids;
-	// ߳
+	// 线程数量
 	size_t __thread_count = 0;
-	// ߳
+	// 工作线程数量
 	std::atomic<size_t> __active_thread_count = { 0 };
-	// ߳
+	// 空闲线程数量
 	std::atomic<size_t> __idle_thread_count = { 0 };
-	// Ƿֹͣ
+	// 待执行队列长度(无锁读取的提示值)
+	std::atomic<size_t> __queued_count = { 0 };
+	// 挂起等待外部线程唤醒的协程数量
+	std::atomic<size_t> __external_count = { 0 };
+	// 是否正在停止
 	bool __is_stopping = true;
-	// ǷԶֹͣ
+	// 是否自动停止
 	bool __is_auto_stop = false;
-	// ߳ id ( use_caller )
+	// 主线程 id ( use_caller )
 	int __root_thread = 0;
 private:
 	/*!
-	 * @brief Э̵()
+	 * @brief 协程调度启动(无锁)
 	 */
 	template<class FiberOrCb>
 	bool scheduleNoLock(FiberOrCb fc, int thread);
 protected:
 	/*!
-	 * @brief ֪ͨЭ̵
+	 * @brief 通知协程调度器有任务了
 	 */
 	virtual void tickle();
 
 	/*!
-	 * @brief õǰЭ̵
+	 * @brief 通知指定线程有任务了
+	 * @param thread 线程 id, -1 标识任意线程
+	 */
+	virtual void tickle(int thread);
+
+	/*!
+	 * @brief 设置当前的协程调度器
 	 */
 	void setThis();
 
 	/*!
-	 * @brief Ƿп߳
+	 * @brief 是否有空闲线程
 	 */
 	bool hasIdleThreads() const;
 
 	/*!
-	 * @brief Э̵Ⱥ
+	 * @brief 队列中是否有可由指定线程执行的任务
+	 * @param thread 线程 id
+	 */
+	bool hasPendingFibers(int thread);
+
+	/*!
+	 * @brief 队列是否非空(不加锁，只作提示)
+	 */
+	bool hasQueuedFibers() const;
+
+	/*!
+	 * @brief 协程调度函数
 	 */
 	void run();
 
 	/*!
-	 * @brief Ƿֹͣ
+	 * @brief 返回是否可以停止
 	 */
 	virtual bool stopping();
 
 	/*!
-	 * @brief ЭɵʱִidleЭ
+	 * @brief 协程无任务可调度时执行idle协程
 	 */
 	virtual void idle();
 public:
 	/*!
-	 * @brief صǰЭ̵
+	 * @brief 返回当前协程调度器
 	 */
 	static Scheduler* GetThis();
 
 	/*!
-	 * @brief صǰЭ̵ĵЭ
+	 * @brief 返回当前协程调度器的调度协程
 	 */
 	static Fiber* GetMainFiber();
 
 	/*!
-	 * @brief 캯
-	 * @param threads ߳
-	 * @param use_caller Ƿʹõǰ߳
-	 * @param name Э̵
+	 * @brief 构造函数
+	 * @param threads 线程数量
+	 * @param use_caller 是否使用当前调用线程
+	 * @param name 协程调度器名称
 	 */
 	Scheduler(std::size_t threads = 1, bool use_caller = true, const std::string& name = "");
 
 	/*!
-	 * @brief 
+	 * @brief 析构函数
 	 */
 	virtual ~Scheduler();
 
 	/*!
-	 * @brief Э̵
+	 * @brief 返回协程调度器名称
 	 */
 	const std::string getName() const;
 
 	/*!
-	 * @brief Э̵
+	 * @brief 启动协程调度器
 	 */
 	void start();
 
 	/*!
-	 * @brief ֹͣЭ̵
+	 * @brief 停止协程调度器
 	 */
 	void stop();
 
 	/*!
-	 * @brief Э
+	 * @brief 调度协程
 	 * @tparam FiberOrCb 
-	 * @param fc Э̻
-	 * @param thread Эִе߳ id, -1 ʶ߳
+	 * @param fc 协程或函数
+	 * @param thread 协程执行的线程 id, -1 标识任意线程
 	 */
 	template<class FiberOrCb>
 	void schedule(FiberOrCb fc, int thread = -1);
 
 	/*!
-	 * @brief Э
-	 * @param begin ЭĿʼ
-	 * @param end ЭĽ
+	 * @brief 批量调度协程
+	 * @param begin 协程数组的开始
+	 * @param end 协程数组的结束
 	 */
 	template<class InputIterator>
 	void schedule(InputIterator begin, InputIterator end);
 
+	/*!
+	 * @brief 登记一个挂起后由外部线程调度回来的协程，登记期间调度器不会停止
+	 */
+	void addExternalWaiter();
+
+	/*!
+	 * @brief 外部线程已把协程重新调度后撤销登记
+	 */
+	void delExternalWaiter();
+
 	void switchTo(int thread = -1);
-	std::ostream& dump(std::ostream& os);
+	virtual std::ostream& dump(std::ostream& os);
 };
 
 //****************************************************************************
-// Э̵
+// 协程调度器的派生类
 //****************************************************************************
 
 class SchedulerSwitcher : public boost::noncopyable {
@@ -229,14 +260,17 @@ public:
 
 
 //****************************************************************************
-// Scheduler ģ庯ʵ
+// Scheduler 模板函数的实现
 //****************************************************************************
 
 template<class FiberOrCb>
 bool Scheduler::scheduleNoLock(FiberOrCb fc, int thread) {
 	bool need_tickle = __fibers.empty();
 	FiberAndThread  ft(fc, thread);
-	if (ft.__fiber || ft.__cb) __fibers.emplace_back(ft);
+	if (ft.__fiber || ft.__cb) {
+		__fibers.emplace_back(ft);
+		++__queued_count;
+	}
 	return need_tickle;
 }
 
@@ -247,7 +281,7 @@ void Scheduler::schedule(FiberOrCb fc, int thread) {
 		MutexType::Lock lock(__mutex);
 		need_tickle = scheduleNoLock(fc, thread);
 	}
-	if (need_tickle) tickle();
+	if (need_tickle) tickle(thread);
 }
 
 template<class InputIterator>
@@ -1,7 +1,7 @@
 //*****************************************************************************
 //
 //
-//   ͷļװ Servlet
+//   此头文件封装 Servlet
 //  
 //
 //*****************************************************************************
@@ -18,6 +18,7 @@
 #include "Http.h"
 #include "HttpSession.h"
 #include "Mutex.h"
+#include "Rcu.h"
 #include "Thread.h"
 #include "Util.h"
 
@@ -25,7 +26,7 @@ namespace sylar::http
 {
 
 //****************************************************************************
-// ǰ
+// 前置声明
 //****************************************************************************
 class Servlet;
 using Servlet_ptr = std::shared_ptr<Servlet>;
@@ -40,55 +41,55 @@ class ServletDispatch;
 using ServletDispatch_ptr = std::shared_ptr<ServletDispatch>;
 
 //****************************************************************************
-// Servletװ
+// Servlet封装
 //****************************************************************************
 
 class Servlet {
 protected:
-    std::string m_name; // 
+    std::string m_name; // 名称
 public:
     /*!
-     * @brief 캯
-     * @param name 
+     * @brief 构造函数
+     * @param name 名称
      */
     Servlet(const std::string& name);
 
     /*!
-     * @brief 
+     * @brief 析构函数
      */
     virtual ~Servlet();
 
     /*!
-     * @brief 
-     * @param request HTTP
-     * @param response HTTPӦ
-     * @param session HTTP
-     * @return Ƿɹ
+     * @brief 处理请求
+     * @param request HTTP请求
+     * @param response HTTP响应
+     * @param session HTTP连接
+     * @return 是否处理成功
      */
     virtual int32_t handle(HttpRequest_ptr request, 
                            HttpResponse_ptr response, 
                            HttpSession_ptr session) = 0;
 
     /*!
-     * @brief Servlet
+     * @brief 返回Servlet名称
      */
     const std::string& getName() const;
 };
 
 //****************************************************************************
-// ʽServlet
+// 函数式Servlet
 //****************************************************************************
 
 class FunctionServlet : public Servlet {
 public:
-    // صͶ
+    // 函数回调类型定义
     using callback = std::function<int32_t(HttpRequest_ptr request, HttpResponse_ptr response, HttpSession_ptr session)>;
 private:
-    callback m_cb;  // ص
+    callback m_cb;  // 回调函数
 public:
     /*!
-     * @brief 캯
-     * @param cb ص
+     * @brief 构造函数
+     * @param cb 回调函数
      */
     FunctionServlet(callback cb);
 
@@ -98,7 +99,7 @@ public:
 };
 
 //****************************************************************************
-// ĬϷ404
+// 默认返回404
 //****************************************************************************
 
 class NotFoundServlet : public Servlet {
@@ -113,17 +114,18 @@ public:
 };
 
 //****************************************************************************
-// Servlet ַ/
+// Servlet 分发器/管理器
 //****************************************************************************
 
 class ServletDispatch : public Servlet {
 public:
-    using RWMutexType = RWMutex;
+    using ServletMap = std::unordered_map<std::string, Servlet_ptr>;
+    using GlobList = std::vector<std::pair<std::string, Servlet_ptr>>;
 private:
-    RWMutexType m_mutex;                                                // д
-    std::unordered_map<std::string, Servlet_ptr> m_datas;               // ׼ƥservlet MAP [ uri(/sylar/xxx) -> servlet ]
-    std::vector<std::pair<std::string, Servlet_ptr>> m_globs;           // ģƥservlet  [ uri(/sylar/*) -> servlet ]
-    Servlet_ptr m_default;                                              // Ĭservlet·ûƥ䵽ʱʹ
+    // 每个请求都要查找，很少修改：写时复制，读取时只需进入 RCU 读临界区
+    RcuPtr<ServletMap> m_datas;                                         // 精准匹配servlet MAP [ uri(/sylar/xxx) -> servlet ]
+    RcuPtr<GlobList> m_globs;                                           // 模糊匹配servlet 数组 [ uri(/sylar/*) -> servlet ]
+    Servlet_ptr m_default;                                              // 默认servlet，所有路径都没匹配到时使用
 public:
     ServletDispatch();
     virtual int32_t handle(HttpRequest_ptr request, HttpResponse_ptr response, HttpSession_ptr session) override;
@@ -164,7 +166,7 @@ public:
 };
 
 //****************************************************************************
-// ģʵ
+// 模板类或函数实现
 //****************************************************************************
 
 //template<class T>
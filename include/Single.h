@@ -1,7 +1,7 @@
 //*****************************************************************************
 //
 //
-//   ͷļʵֵģʽؽӿķװ
+//   此头文件实现单例模式相关接口与类的封装
 //  
 //
 //*****************************************************************************
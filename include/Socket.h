@@ -1,7 +1,7 @@
 //*****************************************************************************
 //
 //
-//   ͷļʵ socket װ
+//   此头文件实现 socket 封装
 //  
 //
 //*****************************************************************************
@@ -22,7 +22,7 @@ namespace sylar
 {
 
 //****************************************************************************
-// ǰ
+// 前置声明
 //****************************************************************************
 
 class Socket;
@@ -33,14 +33,14 @@ class SSLSocket;
 using SSLSocket_ptr = std::shared_ptr<SSLSocket>;
 
 //****************************************************************************
-// Socketװ
+// Socket封装类
 //****************************************************************************
 
 class Socket : public std::enable_shared_from_this<Socket>, boost::noncopyable {
 public:
 	enum Type {
-		TCP = SOCK_STREAM,	// TCP 
-		UDP = SOCK_DGRAM	// UDP 
+		TCP = SOCK_STREAM,	// TCP 类型
+		UDP = SOCK_DGRAM	// UDP 类型
 	};
 	enum Family {	
 		IPv4 = AF_INET,		// IPv4 socket
@@ -48,262 +48,281 @@ public:
 		UNIX = AF_UNIX,		// Unix socket
 	};
 protected:  
-    int __sock;						// socket 
-    int __family;					// Э
-    int __type;						// 
-    int __protocol;					// Э
-    bool __isConnected;				// Ƿ
-    Address_ptr __localAddress;		// صַ
-    Address_ptr __remoteAddress;	// Զ˵ַ
+    int __sock;						// socket句柄 
+    int __family;					// 协议簇
+    int __type;						// 类型
+    int __protocol;					// 协议
+    bool __isConnected;				// 是否连接
+    Address_ptr __localAddress;		// 本地地址
+    Address_ptr __remoteAddress;	// 远端地址
 protected:
     /*!
-     * @brief ʼ socket
+     * @brief 初始化 socket
      */
     void initSock();
 
     /*!
-     * @brief  socket
+     * @brief 创建 socket
      */
     void newSock();
 
     /*!
-     * @brief ʼ sock
+     * @brief 初始化 sock
      */
     virtual bool init(int sock);
 public:
     /*!
-     * @brief TCP Socket(ַ) 
-     * @param address ַ
+     * @brief 创建TCP Socket(满足地址类型) 
+     * @param address 地址
      */
     static Socket_ptr CreateTCP(Address_ptr address);
 
     /*!
-     * @brief UDP Socket(ַ)
-     * @param address ַ
+     * @brief 创建UDP Socket(满足地址类型)
+     * @param address 地址
      */
     static Socket_ptr CreateUDP(Address_ptr address);
 
     /*!
-     * @brief IPv4TCP Socket
+     * @brief 创建IPv4的TCP Socket
      */
     static Socket_ptr CreateTCPSocket();
 
     /*!
-     * @brief IPv4UDP Socket
+     * @brief 创建IPv4的UDP Socket
      */
     static Socket_ptr CreateUDPSocket();
 
     /*!
-     * @brief IPv6TCP Socket
+     * @brief 创建IPv6的TCP Socket
      */
     static Socket_ptr CreateTCPSocket6();
 
     /*!
-     * @brief IPv6UDP Socket
+     * @brief 创建IPv6的UDP Socket
      */
     static Socket_ptr CreateUDPSocket6();
 
     /*!
-     * @brief UnixTCP Socket
+     * @brief 创建Unix的TCP Socket
      */
     static Socket_ptr CreateUnixTCPSocket();
 
     /*!
-     * @brief UnixUDP Socket
+     * @brief 创建Unix的UDP Socket
      */
     static Socket_ptr CreateUnixUDPSocket();
 
     /*!
-     * @brief Socket캯
-     * @param family Э
-     * @param type 
-     * @param protocol Э
+     * @brief Socket构造函数
+     * @param family 协议簇
+     * @param type 类型
+     * @param protocol 协议
      */
     Socket(int family, int type, int protocol = 0);
 
     /*!
-     * @brief 
+     * @brief 析构函数
      */
     virtual ~Socket();
 
     /*!
-     * @brief ȡͳʱʱ()
+     * @brief 获取发送超时时间(毫秒)
      */
     int64_t getSendTimeout();
 
     /*!
-     * @brief ÷ͳʱʱ()
+     * @brief 设置发送超时时间(毫秒)
      */
     void setSendTimeout(int64_t v);
 
     /*!
-     * @brief ȡܳʱʱ()
+     * @brief 获取接受超时时间(毫秒)
      */
     int64_t getRecvTimeout();
 
     /*!
-     * @brief ýܳʱʱ()
+     * @brief 设置接受超时时间(毫秒)
      */
     void setRecvTimeout(int64_t v);
 
     /*!
-     * @brief ȡsockopt
+     * @brief 设置读截止时间，ms 毫秒后阻塞的读返回 ETIMEDOUT
+     * @details 截止时间覆盖之后所有的读操作，由 fd 上常驻的定时器实现，优先于 setRecvTimeout
+     * @param ms 从现在起的毫秒数，0 表示取消
+     */
+    bool setReadDeadline(uint64_t ms);
+
+    /*!
+     * @brief 设置写截止时间，ms 毫秒后阻塞的写返回 ETIMEDOUT
+     * @param ms 从现在起的毫秒数，0 表示取消
+     */
+    bool setWriteDeadline(uint64_t ms);
+
+    /*!
+     * @brief 设置空闲超时，超过 ms 毫秒没有成功读写时阻塞的 IO 返回 ETIMEDOUT
+     * @param ms 毫秒，0 表示取消
+     */
+    bool setIdleTimeout(uint64_t ms);
+
+    /*!
+     * @brief 获取sockopt
      */
     bool getOption(int level, int option, void* result, socklen_t* len);
 
     /*!
-     * @brief ȡsockoptģ
+     * @brief 获取sockopt模板
      */
     template<class T>
     bool getOption(int level, int option, T& result);
 
     /*!
-     * @brief sockopt
+     * @brief 设置sockopt
      */
     bool setOption(int level, int option, const void* result, socklen_t len);
 
     /*!
-     * @brief sockoptģ
+     * @brief 设置sockopt模板
      */
     template<class T>
     bool setOption(int level, int option, const T& value);
 
     /*!
-     * @brief connect
-     * @return ɹӵsocket,ʧܷnullptr
+     * @brief 接收connect链接
+     * @return 成功返回新连接的socket,失败返回nullptr
      */
     virtual Socket_ptr accept();
 
     /*!
-     * @brief 󶨵ַ
-     * @param addr ַ
-     * @return Ƿ󶨳ɹ
+     * @brief 绑定地址
+     * @param addr 地址
+     * @return 是否绑定成功
      */
     virtual bool bind(const Address_ptr addr);
 
     /*!
-     * @brief ӵַ
-     * @param addr Ŀַ
-     * @param timeout_ms ʱʱ()
+     * @brief 连接地址
+     * @param addr 目标地址
+     * @param timeout_ms 超时时间(毫秒)
      */
     virtual bool connect(const Address_ptr addr, uint64_t timeout_ms = -1);
 
     /*!
-     * @brief ӵַ
-     * @param timeout_ms ʱʱ()
+     * @brief 重新连接地址
+     * @param timeout_ms 超时时间(毫秒)
      * @return 
      */
     virtual bool reconnect(uint64_t timeout_ms = -1);
 
     /*!
-     * @brief socket
-     * @param backlog δӶе󳤶
-     * @return ؼǷɹ
+     * @brief 监听socket
+     * @param backlog 未完成连接队列的最大长度
+     * @return 返回监听是否成功
      */
     virtual bool listen(int backlog = SOMAXCONN);
 
     /*!
-     * @brief رsocket
+     * @brief 关闭socket
      */
     virtual bool close();
 
     /*!
-     * @brief 
-     * @param buffer ݵڴ
-     * @param length ݵĳ
-     * @param flags ־
+     * @brief 发送数据
+     * @param buffer 待发送数据的内存
+     * @param length 待发送数据的长度
+     * @param flags 标志字
      * @return 
-     *      @retval > 0 ͳɹӦС
-     *      @retval = 0 socketر
-     *      @retval < 0 socket
+     *      @retval > 0 发送成功对应大小的数据
+     *      @retval = 0 socket被关闭
+     *      @retval < 0 socket出错
      */
     virtual int send(const void* buffer, size_t length, int flags = 0);
 
     /*!
-     * @brief 
-     * @param buffers ݵڴ(iovec)
-     * @param length ݵĳ(iovec)
-     * @param flags ־
+     * @brief 发送数据
+     * @param buffers 待发送数据的内存(iovec数组)
+     * @param length 待发送数据的长度(iovec长度)
+     * @param flags 标志字
      * @return 
-     *      @retval > 0 ͳɹӦС
-     *      @retval = 0 socketر
-     *      @retval < 0 socket
+     *      @retval > 0 发送成功对应大小的数据
+     *      @retval = 0 socket被关闭
+     *      @retval < 0 socket出错
      */
     virtual int send(const iovec* buffers, size_t length, int flags = 0);
 
     /*!
-     * @brief 
-     * @param buffer ݵڴ
-     * @param length ݵĳ
-     * @param to ͵Ŀַ
-     * @param flags ־
+     * @brief 发送数据
+     * @param buffer 待发送数据的内存
+     * @param length 待发送数据的长度
+     * @param to 发送的目标地址
+     * @param flags 标志字
      * @return 
-     *      @retval > 0 ͳɹӦС
-     *      @retval = 0 socketر
-     *      @retval < 0 socket
+     *      @retval > 0 发送成功对应大小的数据
+     *      @retval = 0 socket被关闭
+     *      @retval < 0 socket出错
      */
     virtual int sendTo(const void* buffer, size_t length, const Address_ptr to, int flags = 0);
 
     /*!
-     * @brief 
-     * @param buffers ݵڴ(iovec)
-     * @param length ݵĳ(iovec)
-     * @param to ͵Ŀַ
-     * @param flags ־
+     * @brief 发送数据
+     * @param buffers 待发送数据的内存(iovec数组)
+     * @param length 待发送数据的长度(iovec长度)
+     * @param to 发送的目标地址
+     * @param flags 标志字
      * @return 
-     *      @retval > 0 ͳɹӦС
-     *      @retval = 0 socketر
-     *      @retval < 0 socket
+     *      @retval > 0 发送成功对应大小的数据
+     *      @retval = 0 socket被关闭
+     *      @retval < 0 socket出错
      */
     virtual int sendTo(const iovec* buffers, size_t length, const Address_ptr to, int flags = 0);
     
     /*!
-     * @brief 
-     * @param buffer ݵڴ
-     * @param length ݵڴС
-     * @param flags ־
+     * @brief 接受数据
+     * @param buffer 接收数据的内存
+     * @param length 接收数据的内存大小
+     * @param flags 标志字
      * @return 
-     *      @retval > 0 ͳɹӦС
-     *      @retval = 0 socketر
-     *      @retval < 0 socket
+     *      @retval > 0 发送成功对应大小的数据
+     *      @retval = 0 socket被关闭
+     *      @retval < 0 socket出错
      */
     virtual int recv(void* buffer, size_t length, int flags = 0);
 
     /*!
-     * @brief 
-     * @param buffers ݵڴ(iovec)
-     * @param length ݵڴС(iovec鳤)
-     * @param flags ־
+     * @brief 接受数据
+     * @param buffers 接收数据的内存(iovec数组)
+     * @param length 接收数据的内存大小(iovec数组长度)
+     * @param flags 标志字
      * @return 
-     *      @retval > 0 ͳɹӦС
-     *      @retval = 0 socketر
-     *      @retval < 0 socket
+     *      @retval > 0 发送成功对应大小的数据
+     *      @retval = 0 socket被关闭
+     *      @retval < 0 socket出错
      */
     virtual int recv(iovec* buffers, size_t length, int flags = 0);
 
     /*!
-     * @brief 
-     * @param buffer ݵڴ
-     * @param length ݵڴС
-     * @param from Ͷ˵ַ
-     * @param flags ־
+     * @brief 接受数据
+     * @param buffer 接收数据的内存
+     * @param length 接收数据的内存大小
+     * @param from 发送端地址
+     * @param flags 标志字
      * @return 
-     *      @retval > 0 ͳɹӦС
-     *      @retval = 0 socketر
-     *      @retval < 0 socket
+     *      @retval > 0 发送成功对应大小的数据
+     *      @retval = 0 socket被关闭
+     *      @retval < 0 socket出错
      */
     virtual int recvFrom(void* buffer, size_t length, Address_ptr from, int flags = 0);
 
     /*!
-     * @brief 
-     * @param buffers ݵڴ(iovec)
-     * @param length ݵڴС(iovec鳤)
-     * @param from Ͷ˵ַ
-     * @param flags ־
+     * @brief 接受数据
+     * @param buffers 接收数据的内存(iovec数组)
+     * @param length 接收数据的内存大小(iovec数组长度)
+     * @param from 发送端地址
+     * @param flags 标志字
      * @return 
-     *      @retval > 0 ͳɹӦС
-     *      @retval = 0 socketر
-     *      @retval < 0 socket
+     *      @retval > 0 发送成功对应大小的数据
+     *      @retval = 0 socket被关闭
+     *      @retval < 0 socket出错
      */
     virtual int recvFrom(iovec* buffers, size_t length, Address_ptr from, int flags = 0);
 
@@ -339,13 +358,13 @@ public:
 };
 
 //****************************************************************************
-// ʽ socket
+// 流式处理 socket
 //****************************************************************************
 
 std::ostream& operator<<(std::ostream& os, const Socket& sock);
 
 //****************************************************************************
-// Socket
+// Socket派生类
 //****************************************************************************
 
 class SSLSocket : public Socket {
@@ -379,7 +398,7 @@ public:
 };
 
 //****************************************************************************
-// ģʵ
+// 模板类或函数的实现
 //****************************************************************************
 
 template<class T>
@@ -1,7 +1,7 @@
 //*****************************************************************************
 //
 //
-//   ͷļʵӿ
+//   此头文件实现流接口
 //  
 //
 //*****************************************************************************
@@ -24,7 +24,7 @@ namespace sylar
 {
 
 //****************************************************************************
-// ǰ
+// 前置声明
 //****************************************************************************
 
 class Stream;
@@ -37,118 +37,118 @@ class ZlibStream;
 using ZlibStream_ptr = std::shared_ptr<ZlibStream>;
 
 //****************************************************************************
-// ӿ
+// 流接口
 //****************************************************************************
 
 class Stream {
 public:
     /*!
-     * @brief 
+     * @brief 析构函数
      */
     virtual ~Stream();
 
     /*!
-     * @brief 
-     * @param buffer ݵڴ
-     * @param length ݵڴС
+     * @brief 读数据
+     * @param buffer 接收数据的内存
+     * @param length 接收数据的内存大小
      * @return 
-     *      @retval > 0 ؽյݵʵʴС
-     *      @retval = 0 ر
-     *      @retval < 0 
+     *      @retval > 0 返回接收到的数据的实际大小
+     *      @retval = 0 被关闭
+     *      @retval < 0 出现流错误
      */
     virtual int read(void* buffer, size_t length) = 0;
 
     /*!
-     * @brief 
-     * @param ba ݵByteArray
-     * @param length ݵڴС
+     * @brief 读数据
+     * @param ba 接收数据的ByteArray
+     * @param length 接收数据的内存大小
      * @return 
-     *      @retval > 0 ؽյݵʵʴС
-     *      @retval = 0 ر
-     *      @retval < 0 
+     *      @retval > 0 返回接收到的数据的实际大小
+     *      @retval = 0 被关闭
+     *      @retval < 0 出现流错误
      */
     virtual int read(ByteArray_ptr ba, size_t length) = 0;
 
     /*!
-     * @brief ̶ȵ
-     * @param buffer ݵڴ
-     * @param length ݵڴС
+     * @brief 读固定长度的数据
+     * @param buffer 接收数据的内存
+     * @param length 接收数据的内存大小
      * @return
-     *      @retval > 0 ؽյݵʵʴС
-     *      @retval = 0 ر
-     *      @retval < 0 
+     *      @retval > 0 返回接收到的数据的实际大小
+     *      @retval = 0 被关闭
+     *      @retval < 0 出现流错误
      */
     virtual int readFixSize(void* buffer, size_t length);
 
     /*!
-     * @brief ̶ȵ
-     * @param ba ݵByteArray
-     * @param length ݵڴС
+     * @brief 读固定长度的数据
+     * @param ba 接收数据的ByteArray
+     * @param length 接收数据的内存大小
      * @return
-     *      @retval > 0 ؽյݵʵʴС
-     *      @retval = 0 ر
-     *      @retval < 0 
+     *      @retval > 0 返回接收到的数据的实际大小
+     *      @retval = 0 被关闭
+     *      @retval < 0 出现流错误
      */
     virtual int readFixSize(ByteArray_ptr ba, size_t length);
 
     /*!
-     * @brief д
-     * @param buffer дݵڴ
-     * @param length дݵڴС
+     * @brief 写数据
+     * @param buffer 写数据的内存
+     * @param length 写入数据的内存大小
      * @return
-     *      @retval > 0 ؽյݵʵʴС
-     *      @retval = 0 ر
-     *      @retval < 0 
+     *      @retval > 0 返回接收到的数据的实际大小
+     *      @retval = 0 被关闭
+     *      @retval < 0 出现流错误
      */
     virtual int write(const void* buffer, size_t length) = 0;
 
     /*!
-     * @brief д
-     * @param ba дݵByteArray
-     * @param length дݵڴС
+     * @brief 写数据
+     * @param ba 写数据的ByteArray
+     * @param length 写入数据的内存大小
      * @return
-     *      @retval > 0 ؽյݵʵʴС
-     *      @retval = 0 ر
-     *      @retval < 0 
+     *      @retval > 0 返回接收到的数据的实际大小
+     *      @retval = 0 被关闭
+     *      @retval < 0 出现流错误
      */
     virtual int write(ByteArray_ptr ba, size_t length) = 0;
 
     /*!
-     * @brief д̶ȵ
-     * @param buffer дݵڴ
-     * @param length дݵڴС
+     * @brief 写固定长度的数据
+     * @param buffer 写数据的内存
+     * @param length 写入数据的内存大小
      * @return
-     *      @retval > 0 ؽյݵʵʴС
-     *      @retval = 0 ر
-     *      @retval < 0 
+     *      @retval > 0 返回接收到的数据的实际大小
+     *      @retval = 0 被关闭
+     *      @retval < 0 出现流错误
      */
     virtual int writeFixSize(const void* buffer, size_t length);
 
     /*!
-     * @brief д̶ȵ
-     * @param ba дݵByteArray
-     * @param length дݵڴС
+     * @brief 写固定长度的数据
+     * @param ba 写数据的ByteArray
+     * @param length 写入数据的内存大小
      * @return
-     *      @retval > 0 ؽյݵʵʴС
-     *      @retval = 0 ر
-     *      @retval < 0 
+     *      @retval > 0 返回接收到的数据的实际大小
+     *      @retval = 0 被关闭
+     *      @retval < 0 出现流错误
      */
     virtual int writeFixSize(ByteArray_ptr ba, size_t length);
 
     /*!
-     * @brief ر
+     * @brief 关闭流
      */
     virtual void close() = 0;
 };
 
 //****************************************************************************
-// Socket ӿ
+// Socket 流接口
 //****************************************************************************
 
 class SocketStream : public Stream {
 protected:
-    Socket_ptr __socket;    // Socket
-    bool __owner;           // Ƿ
+    Socket_ptr __socket;    // Socket类
+    bool __owner;           // 是否主控
 public:
     SocketStream(Socket_ptr sock, bool owner = true);
 
@@ -162,6 +162,26 @@ public:
 
     virtual int write(ByteArray_ptr ba, size_t length) override;
 
+    /*!
+     * @brief 用 sendfile 将文件内容直接发送到 socket，数据不经过用户态缓冲区
+     * @param fd 文件句柄
+     * @param offset 文件中的起始位置
+     * @param length 发送的长度，(uint64_t)-1 表示发送到文件末尾
+     * @return
+     *      @retval >= 0 实际发送的长度(文件提前结束或发送部分数据后出错时小于 length)
+     *      @retval < 0 一个字节都未发送就出现流错误
+     */
+    int64_t sendFile(int fd, uint64_t offset = 0, uint64_t length = (uint64_t)-1);
+
+    /*!
+     * @brief 打开文件并用 sendfile 发送
+     * @param path 文件路径
+     * @param offset 文件中的起始位置
+     * @param length 发送的长度，(uint64_t)-1 表示发送到文件末尾
+     * @return 同 sendFile(int, uint64_t, uint64_t)，文件打开失败返回 -1
+     */
+    int64_t sendFile(const std::string& path, uint64_t offset = 0, uint64_t length = (uint64_t)-1);
+
     virtual void close() override;
 
     Socket_ptr getSocket() const;
@@ -175,7 +195,7 @@ public:
 };
 
 //****************************************************************************
-// Zlib ӿ
+// Zlib 流接口
 //****************************************************************************
 
 class ZlibStream : public Stream {
@@ -1,7 +1,7 @@
 //*****************************************************************************
 //
 //
-//   ͷļʵ TCP ķװ
+//   此头文件实现 TCP 服务器的封装
 //  
 //
 //*****************************************************************************
@@ -27,7 +27,7 @@ namespace sylar
 {
 
 //****************************************************************************
-// ǰ
+// 前置声明
 //****************************************************************************
 
 struct TcpServerConf;
@@ -37,7 +37,7 @@ class TcpServer;
 using TcpServer_ptr = std::shared_ptr<TcpServer>;
 
 //****************************************************************************
-// TCP ýṹ
+// TCP 配置结构
 //****************************************************************************
 
 struct TcpServerConf {
@@ -46,7 +46,7 @@ struct TcpServerConf {
 	int timeout = 1000 * 2 * 60;
 	int ssl = 0;
 	std::string id;
-	std::string type = "http";                  // ͣhttp, ws, rock
+	std::string type = "http";                  // 服务器类型，http, ws, rock
 	std::string name;
 	std::string cert_file;
 	std::string key_file;
@@ -61,7 +61,7 @@ struct TcpServerConf {
 };
 
 //****************************************************************************
-// Զת
+// 自定义类型转换
 //****************************************************************************
 
 template<>
@@ -118,57 +118,57 @@ public:
 };
 
 //****************************************************************************
-// TCPװ
+// TCP服务器封装
 //****************************************************************************
 
 class TcpServer : public std::enable_shared_from_this<TcpServer>, boost::noncopyable {
 protected:
-	std::vector<Socket_ptr> __socks;        // Socket
-	IOManager* __worker;                    // ӵSocketĵ
+	std::vector<Socket_ptr> __socks;        // 监听Socket数组
+	IOManager* __worker;                    // 新连接的Socket工作的调度器
 	IOManager* __ioWorker;
-	IOManager* __acceptWorker;              // Socketӵĵ
-	uint64_t __recvTimeout;                 // ճʱʱ()
-	std::string __name;                     // 
-	std::string __type = "tcp";             // 
-	bool __isStop;                          // Ƿֹͣ
+	IOManager* __acceptWorker;              // 服务器Socket接收连接的调度器
+	uint64_t __recvTimeout;                 // 接收超时时间(毫秒)
+	std::string __name;                     // 服务器名称
+	std::string __type = "tcp";             // 服务器类型
+	bool __isStop;                          // 服务是否停止
 	bool __ssl = false;
 	TcpServerConf_ptr __conf;
 protected:
 	/*!
-	 * @brief ӵSocket
+	 * @brief 处理新连接的Socket类
 	 */
 	virtual void handleClient(Socket_ptr client);
 
 	/*!
-	 * @brief ʼ
+	 * @brief 开始接受连接
 	 */
 	virtual void startAccept(Socket_ptr sock);
 public:
 	/*!
-	 * @brief 캯
-	 * @param worker socketͻ˹Э̵
-	 * @param accept_worker socketִнsocketӵЭ̵
+	 * @brief 构造函数
+	 * @param worker socket客户端工作的协程调度器
+	 * @param accept_worker 服务器socket执行接收socket连接的协程调度器
 	 */
 	TcpServer(IOManager* worker = IOManager::GetThis(),
 			  IOManager* io_worker = IOManager::GetThis(),
 			  IOManager* accept_worker = IOManager::GetThis());
 
 	/*!
-	 * @brief 
+	 * @brief 析构函数
 	 */
 	virtual ~TcpServer();
 
 	/*!
-	 * @brief 󶨵ַ
-	 * @return Ƿ󶨳ɹ
+	 * @brief 绑定地址
+	 * @return 返回是否绑定成功
 	 */
 	virtual bool bind(Address_ptr addr);
 
 	/*!
-	 * @brief 󶨵ַ
-	 * @param addrs Ҫ󶨵ĵַ
-	 * @param fails ʧܵĵַ
-	 * @return Ƿ󶨳ɹ
+	 * @brief 绑定地址数组
+	 * @param addrs 需要绑定的地址数组
+	 * @param fails 绑定失败的地址
+	 * @return 是否绑定成功
 	 */
 	virtual bool bind(const std::vector<Address_ptr>& addrs,
 			  std::vector<Address_ptr>& fails);
@@ -176,38 +176,38 @@ public:
 	bool loadCertificates(const std::string& cert_file, const std::string& key_file);
 
 	/*!
-	 * @brief 
-	 * @return Ҫbindɹִ
+	 * @brief 启动服务
+	 * @return 需要bind成功后执行
 	 */
 	virtual bool start();
 
 	/*!
-	 * @brief ֹͣ
+	 * @brief 停止服务
 	 */
 	virtual void stop();
 
 	/*!
-	 * @brief ضȡʱʱ()
+	 * @brief 返回读取超时时间(毫秒)
 	 */
 	uint64_t getRecvTimeout() const;
 
 	/*!
-	 * @brief ط
+	 * @brief 返回服务器名称
 	 */
 	std::string getName() const;
 
 	/*!
-	 * @brief öȡʱʱ()
+	 * @brief 设置读取超时时间(毫秒)
 	 */
 	void setRecvTimeout(uint64_t v);
 
 	/*!
-	 * @brief ÷
+	 * @brief 设置服务器名称
 	 */
 	virtual void setName(const std::string& v);
 
 	/*!
-	 * @brief Ƿֹͣ
+	 * @brief 是否停止
 	 */
 	bool isStop() const;
 
@@ -1,7 +1,7 @@
 //*****************************************************************************
 //
 //
-//   ͷļ pthread װԶ thread
+//   此头文件根据 pthread 封装自定义 thread
 //  
 //
 //*****************************************************************************
@@ -20,14 +20,14 @@
 namespace sylar{
 
 //****************************************************************************
-// ǰ
+// 前置声明
 //****************************************************************************
 
 class Thread;
 using Thread_ptr = std::shared_ptr<Thread>;
 
 //****************************************************************************
-// ̷߳װ
+// 线程封装
 //****************************************************************************
 
 class Thread : public boost::noncopyable {
@@ -36,49 +36,49 @@ private:
     pthread_t __m_thread = 0;
     std::function<void()> __cb;
     std::string __name;
-    //ڱ̴֤߳ɹִ֮жӦ
+    //用于保证线程创建成功之后再执行对应方法
     Semaphore __semaphore;
 public:
     /*!
-     * @brief 캯
+     * @brief 构造函数
      * 
-     * @param cb ִ߳к
-     * @param name ߳
+     * @param cb 线程执行函数
+     * @param name 线程名称
      */
     Thread(std::function<void()> cb, const std::string& name);
 
     /*!
-     * @brief 
+     * @brief 析构函数
      */
     ~Thread();
 
     /*!
-     * @brief ȡǰָ߳
+     * @brief 获取当前的线程指针
      */
     static Thread* GetThis();
 
     /*!
-     * @brief ȡǰ߳
+     * @brief 获取当前的线程名称
      */
     static const std::string& GetName();
 
     /*!
-     * @brief õǰ߳
+     * @brief 设置当前的线程名称
      */
     static void SetName(const std::string& name);
 
     /*!
-     * @brief ȡ߳ ID
+     * @brief 获取线程 ID
      */
     pid_t getId() const;
 
     /*!
-     * @brief ȡ߳
+     * @brief 获取线程名称
      */
     const std::string& getName() const;
 
     /*!
-     * @brief ֱִ߳
+     * @brief 阻塞线程直至执行完成
      */
     void join();
 private:
@@ -1,7 +1,7 @@
 //*****************************************************************************
 //
 //
-//   ʱ
+//   定时器
 //  
 //
 //*****************************************************************************
@@ -13,157 +13,318 @@
 #include <memory>
 #include <vector>
 #include <set>
+#include <atomic>
 #include <functional>
+#include <boost/noncopyable.hpp>
 
 namespace sylar
 {
 
 //****************************************************************************
-// ǰ
+// 前置声明
 //****************************************************************************
 
 class Timer;
 using Timer_ptr = std::shared_ptr<Timer>;
 
+class TimerNode;
+
 class TimerManager;
 
 struct TimerComparator;
 
+struct TimerStats;
+
 //****************************************************************************
-// ʱȽ
+// 定时器比较器
 //****************************************************************************
 
 struct TimerComparator {
     /*!
-     * @brief ִʱȽ϶ʱָĴС
+     * @brief 按执行时间比较定时器智能指针的大小
      */
     bool operator()(const Timer_ptr& lhs, const Timer_ptr& rhs) const;
 };
 
 
 //****************************************************************************
-// ʱ
+// 定时器
 //****************************************************************************
 
 class Timer : public std::enable_shared_from_this<Timer> {
 	friend class TimerManager;
     friend struct TimerComparator;
 private:  
-    bool __recurring = false;           // Ƿѭʱ
-    uint64_t __ms = 0;                  // ִ
-    uint64_t __next = 0;                // ȷִʱ
-    std::function<void()> __cb;         // ص
-    TimerManager* __manager = nullptr;  // ʱ
+    bool __recurring = false;           // 是否循环定时器
+    uint64_t __us = 0;                  // 执行周期(微秒)
+    uint64_t __next = 0;                // 精确的执行时间(微秒)
+    uint64_t __slack = 0;               // 允许延后执行的时间(微秒)
+    std::function<void()> __cb;         // 回调函数
+    TimerManager* __manager = nullptr;  // 定时器管理器
 private:
     /*!
-     * @brief 캯
-     * @param ms ʱִмʱ
-     * @param cb ص
-     * @param recurring Ƿѭ
-     * @param manager ʱ
+     * @brief 构造函数
+     * @param us 定时器执行间隔时间(微秒)
+     * @param cb 回调函数
+     * @param recurring 是否循环
+     * @param manager 定时器管理器
+     * @param slack 允许延后执行的时间(微秒)
      */
-    Timer(uint64_t ms, std::function<void()> cb,
-          bool recurring, TimerManager* manager);
+    Timer(uint64_t us, std::function<void()> cb,
+          bool recurring, TimerManager* manager, uint64_t slack = 0);
 
     /*!
-     * @brief  캯
-     * @param next ִеʱ()
+     * @brief  构造函数
+     * @param next 执行的时间戳(微秒)
      */
     Timer(uint64_t next);
 public:
     /*!
-     * @brief ȡʱ
+     * @brief 取消定时器
      */
     bool cancel();
 
     /*!
-     * @brief ˢöʱִʱ
+     * @brief 刷新设置定时器的执行时间
      */
     bool refresh();
 
     /*!
-     * @brief öʱʱ
-     * @param ms ʱִмʱ()
-     * @param from_now Ƿӵǰʱ俪ʼ
+     * @brief 重置定时器时间
+     * @param ms 定时器执行间隔时间(毫秒)
+     * @param from_now 是否从当前时间开始计算
      */
     bool reset(uint64_t ms, bool from_now);
 };
 
 //****************************************************************************
-// ʱ
+// 侵入式定时器节点
+//****************************************************************************
+
+/*!
+ * @brief 可嵌入调用方栈帧的定时器节点，挂载与取消均不分配堆内存
+ * @details 回调在 TimerManager 的锁内执行，回调中不能再操作定时器；
+ *          cancel() 返回后回调要么已经执行完毕，要么不会再执行
+ */
+class TimerNode : public boost::noncopyable {
+    friend class TimerManager;
+public:
+    using Callback = void (*)(TimerNode* node);
+private:
+    uint64_t __next = 0;                    // 精确的执行时间(微秒)
+    uint64_t __slack = 0;                   // 允许延后执行的时间(微秒)
+    size_t __index = (size_t)-1;            // 在最小堆中的下标，-1 表示未挂载
+    Callback __cb = nullptr;                // 回调函数
+    std::atomic<TimerManager*> __manager = { nullptr };    // 挂载的管理器，未挂载(或回调已执行完)时为空
+    uint64_t __deferTo = 0;                 // 回调中要求重新挂载的时间，0 表示不重新挂载
+public:
+    /*!
+     * @brief 构造函数
+     * @param cb 超时回调函数
+     */
+    TimerNode(Callback cb = nullptr);
+
+    /*!
+     * @brief 析构函数，未触发的节点自动取消
+     */
+    ~TimerNode();
+
+    /*!
+     * @brief 是否已挂载到定时器管理器中
+     */
+    bool isArmed() const;
+
+    /*!
+     * @brief 取消定时器
+     * @return 节点处于挂载状态时返回 true
+     */
+    bool cancel();
+
+    /*!
+     * @brief 只能在回调中调用：回调返回后按新的绝对时间(Clock 微秒)重新挂载
+     * @details 用于惰性延后的截止时间，截止时间推迟时不必取消重挂，到期后再顺延
+     */
+    void deferTo(uint64_t next_us);
+};
+
+//****************************************************************************
+// 定时器统计
+//****************************************************************************
+
+/*!
+ * @brief 定时器合并相关的统计信息
+ */
+struct TimerStats {
+    uint64_t bucketed = 0;          // 因 slack 对齐到桶边界的定时器数量
+    uint64_t savedWakeups = 0;      // 因新定时器落在当前等待的 slack 内而省去的唤醒次数
+};
+
+//****************************************************************************
+// 时间器管理器
 //****************************************************************************
 
 class TimerManager {
     friend class Timer;
+    friend class TimerNode;
 public:
     using RWMutexType = RWMutex;
 private:
     RWMutexType __mutex;                                // Mutex
-    std::set<Timer_ptr, TimerComparator> __timers;      // ʱ
-    bool __tickled = false;                             // Ƿ񴥷onTimerInsertedAtFront
-    uint64_t __previouseTime = 0;                       // ϴִʱ
+    std::set<Timer_ptr, TimerComparator> __timers;      // 定时器集合
+    bool __tickled = false;                             // 是否触发onTimerInsertedAtFront
+    std::atomic<uint64_t> __waitDeadline = { ~0ull };   // 事件循环当前等待的到期时间(微秒)
+    std::atomic<uint64_t> __bucketed = { 0 };           // 对齐到桶边界的定时器数量
+    std::atomic<uint64_t> __savedWakeups = { 0 };       // 省去的唤醒次数
+    std::vector<TimerNode*> __nodes;                    // 侵入式定时器节点最小堆
 private:
     /*!
-     * @brief ʱǷ񱻵
+     * @brief 节点最小堆上浮
+     */
+    void nodeSiftUp(size_t idx);
+
+    /*!
+     * @brief 节点最小堆下沉
+     */
+    void nodeSiftDown(size_t idx);
+
+    /*!
+     * @brief 从节点最小堆中移除下标为 idx 的节点
      */
-    bool detectClockRollover(uint64_t now_ms);
+    void nodeRemove(size_t idx);
+
+    /*!
+     * @brief 按 slack 将到期时间向上对齐到桶边界，相近的定时器落入同一个桶一起触发
+     * @param next 精确的到期时间(微秒)
+     * @param slack 允许延后执行的时间(微秒)
+     */
+    uint64_t applySlack(uint64_t next, uint64_t slack);
+
+    /*!
+     * @brief 新定时器成为最早的定时器时，判断是否需要通知事件循环(需持有写锁)
+     * @details 事件循环本来就会在 next + slack 之前醒来时不再通知
+     */
+    bool checkFrontNotify(uint64_t next, uint64_t slack);
 protected:
     /*!
-     * @brief µĶʱ뵽ʱײ,ִиú
+     * @brief 当有新的定时器插入到定时器的首部,执行该函数
      */
     virtual void onTimerInsertedAtFront() = 0;
 
     /*!
-     * @brief ʱӵ
+     * @brief 将定时器添加到管理器中
      */
     void addTimer(Timer_ptr val, RWMutexType::WriteLock& lock);
 public:
     /*!
-     * @brief 캯
+     * @brief 构造函数
      */
     TimerManager();
 
     /*!
-     * @brief 
+     * @brief 析构函数，仍挂载的节点被摘下，之后节点析构不会再访问管理器
      */
     virtual ~TimerManager();
 
     /*!
-     * @brief Ӷʱ
-     * @param ms ʱִмʱ
-     * @param cb ʱص
-     * @param recurring Ƿѭʱ
+     * @brief 添加定时器
+     * @param ms 定时器执行间隔时间
+     * @param cb 定时器回调函数
+     * @param recurring 是否循环定时器
      */
     Timer_ptr 
     addTimer(uint64_t ms, std::function<void()> cb, 
              bool recurring = false);
 
     /*!
-     * @brief ʱ
-     * @param ms ʱִмʱ
-     * @param cb ʱص
-     * @param weak_cond 
-     * @param recurring Ƿѭ
+     * @brief 添加定时器(微秒精度)
+     * @param us 定时器执行间隔时间(微秒)
+     * @param cb 定时器回调函数
+     * @param recurring 是否循环定时器
+     * @param slack_us 允许延后执行的时间(微秒)，到期时间相近的定时器会合并触发
+     */
+    Timer_ptr 
+    addTimerUS(uint64_t us, std::function<void()> cb, 
+               bool recurring = false, uint64_t slack_us = 0);
+
+    /*!
+     * @brief 添加条件定时器
+     * @param ms 定时器执行间隔时间
+     * @param cb 定时器回调函数
+     * @param weak_cond 条件
+     * @param recurring 是否循环
      */
     Timer_ptr 
     addConditionTimer(uint64_t ms, std::function<void()> cb, 
                       std::weak_ptr<void> weak_cond, bool recurring = false);
 
     /*!
-     * @brief һʱִеʱ()
+     * @brief 添加条件定时器(微秒精度)
+     * @param us 定时器执行间隔时间(微秒)
+     * @param cb 定时器回调函数
+     * @param weak_cond 条件
+     * @param recurring 是否循环
+     */
+    Timer_ptr 
+    addConditionTimerUS(uint64_t us, std::function<void()> cb, 
+                        std::weak_ptr<void> weak_cond, bool recurring = false);
+
+    /*!
+     * @brief 挂载侵入式定时器节点
+     * @param node 定时器节点(由调用方持有，挂载期间必须保持有效)
+     * @param ms 定时器执行间隔时间
+     */
+    void addTimerNode(TimerNode* node, uint64_t ms);
+
+    /*!
+     * @brief 挂载侵入式定时器节点(微秒精度)
+     * @param node 定时器节点
+     * @param us 定时器执行间隔时间(微秒)
+     * @param slack_us 允许延后执行的时间(微秒)
+     */
+    void addTimerNodeUS(TimerNode* node, uint64_t us, uint64_t slack_us = 0);
+
+    /*!
+     * @brief 保证节点不晚于 deadline_us(Clock 单调时钟，微秒)触发
+     * @details 节点未挂载或挂载得更晚时重新挂载，否则不做任何事
+     * @return 是否重新挂载
+     */
+    bool armTimerNodeBefore(TimerNode* node, uint64_t deadline_us);
+
+    /*!
+     * @brief 执行所有已到期的侵入式定时器节点(按 Clock::CachedUS 判断到期)
+     */
+    void triggerExpiredNodes();
+
+    /*!
+     * @brief 到最近一个定时器执行的时间间隔(毫秒，向上取整)
      */
     uint64_t getNextTimer();
 
     /*!
-     * @brief ȡҪִеĶʱĻصб
-     * @param cbs ص
+     * @brief 到最近一个定时器执行的时间间隔(微秒)
+     */
+    uint64_t getNextTimerUS();
+
+    /*!
+     * @brief 最近一个定时器执行的绝对时间(Clock 单调时钟，微秒)，没有定时器时返回 ~0ull
+     */
+    uint64_t getNextDeadlineUS();
+
+    /*!
+     * @brief 获取需要执行的定时器的回调函数列表(按 Clock::CachedUS 判断到期)
+     * @param cbs 回调函数数组
      */
     void listExpiredCb(std::vector<std::function<void()> >& cbs);
 
     /*!
-     * @brief Ƿжʱ
+     * @brief 是否有定时器
      */
     bool hasTimer();
+
+    /*!
+     * @brief 返回定时器合并的统计信息
+     */
+    TimerStats getStats() const;
 };
 
 }; /* sylar */
@@ -1,9 +1,9 @@
 //*****************************************************************************
 //
 //
-//   ͷļװ URI
+//   此头文件封装 URI
 // 
-//   URI ʽΪ:
+//   URI 格式为:
 // 
 //   foo://user@sylar.com:8042/over/there?name=ferret#nose
 //      \_/ \______________/ \_________/ \_________/ \__/
@@ -24,25 +24,25 @@ namespace sylar
 {
 
 //****************************************************************************
-// ǰ
+// 前置声明
 //****************************************************************************
 
 class Uri;
 using Uri_ptr = std::shared_ptr<Uri>;
 
 //****************************************************************************
-// URI 
+// URI 类
 //****************************************************************************
 
 class Uri {
 private:
     std::string m_scheme;           // schema
-    std::string m_userinfo;         // ûϢ
+    std::string m_userinfo;         // 用户信息
     std::string m_host;             // host
-    std::string m_path;             // ·
-    std::string m_query;            // ѯ
+    std::string m_path;             // 路径
+    std::string m_query;            // 查询参数
     std::string m_fragment;         // fragment
-    int32_t m_port;                 // ˿
+    int32_t m_port;                 // 端口
 private:
     bool isDefaultPort() const;
 public:
@@ -1,7 +1,7 @@
 //*****************************************************************************
 //
 //
-//   ͷļװùߺ
+//   此头文件封装常用工具函数
 //  
 //
 //*****************************************************************************
@@ -21,40 +21,42 @@
 namespace sylar{
 
 /*!
- * @brief صǰ߳ ID
+ * @brief 返回当前线程 ID
  */
 pid_t GetThreadId();
 
 /*!
- * @brief ȡǰЭ ID
+ * @brief 获取当前协程 ID
  */
 uint32_t GetFiberId();
 
 /*!
- * @brief ȡǰĵջ
- * @param bt ջϢ
- * @param size ෵ز
- * @param skip ջĲ
- * @result ջϢ
+ * @brief 获取当前的调用栈
+ * @param bt 保存调用栈信息
+ * @param size 最多返回层数
+ * @param skip 跳过栈顶的层数
+ * @result 保存调用栈信息
  */
 void Backtrace(std::vector<std::string>& bt, int size = 64, int skip = 1);
 std::vector<std::string> Backtrace(std::size_t size = 64, std::size_t skip = 1);
 
 /*!
- * @brief ȡǰջϢַ
- * @param size ջ
- * @param skip ջĲ
- * @param prefix ÿջϢǰ
+ * @brief 获取当前栈信息的字符串
+ * @param size 栈的最大层数
+ * @param skip 跳过栈顶的层数
+ * @param prefix 每条栈信息前输出的内容
  */
 std::string BacktraceToString(int size = 64, int skip = 2, const std::string& prefix = "");
 
 /*!
- * @brief ȡǰʱ䣨룩
+ * @brief 获取当前时间（毫秒）
+ * @details 墙上时钟，会随 NTP 跳变，计算时间间隔请使用 Clock::NowMS
  */
 uint64_t GetCurrentMS();
 
 /*!
- * @brief ȡǰʱ䣨΢
+ * @brief 获取当前时间（微妙）
+ * @details 墙上时钟，会随 NTP 跳变，计算时间间隔请使用 Clock::NowUS
  */
 uint64_t GetCurrentUS();
 
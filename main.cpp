@@ -1,21 +1,24 @@
 //#include "test_yaml.h"
 //#include "test_boost.h"
-//#include "test_log.h"
+#include "test_log.h"
 //#include "test_Single.h"
-//#include "test_config.h"
+#include "test_config.h"
 //#include "test_Thread.h"
 //#include "test_util.h"
 //#include "test_Scheduler.h"
-//#include "test_IOManager.h"
-//#include "test_hook.h"
-//#include "test_Address.h"
-//#include "test_Socket.h"
+#include "test_IOManager.h"
+#include "test_hook.h"
+#include "test_Address.h"
+#include "test_Socket.h"
 //#include "test_ByteArray.h"
 //#include "test_TcpServer.h"
 //#include "test_http.h"
 //#include "test_HttpParser.h"
 //#include "test_HttpServer.h"
-#include "test_HttpConnection.h"
+//#include "test_HttpConnection.h"
+//#include "test_Timer.h"
+#include "test_Mutex.h"
+#include "test_Rcu.h"
 
 using namespace Test;
 
@@ -37,7 +40,29 @@ int main(){
     //test_http();
     //test_httpparser();
     //test_httpserver();
-    test_httpconnection();
+    //test_httpconnection();
+    //test_timer();
+    //test_iomanager_stats();
+    //test_iomanager_wakeup();
+    //test_iomanager_spin();
+    //test_socket_sendfile();
+    //test_resolver();
+    //test_hook_fileio();
+    //test_hook_stats();
+    //test_hook_poll();
+    //test_socket_deadline();
+    //test_mutex();
+    //test_lock_profile();
+    //test_rcu();
+    //test_log_async();
+    //test_log_bench();
+    //test_log_datetime();
+    //test_log_binary();
+    //test_log_rolling();
+    //test_log_limit();
+    //test_config_snapshot();
+    //test_config_watch();
+    test_config_binary();
 
     return 0;
 }
@@ -1,6 +1,7 @@
 #include "Address.h"
 #include "Endian.h"
 #include "Log.h"
+#include "Resolver.h"
 #include <sstream>
 
 namespace sylar
@@ -25,7 +26,7 @@ static uint32_t CountBytes(T value) {
 }
 
 //****************************************************************************
-// ʽAddress
+// 流式输出Address
 //****************************************************************************
 
 std::ostream& operator<<(std::ostream& os, const Address& addr) {
@@ -69,7 +70,7 @@ bool Address::Lookup(std::vector<Address_ptr>& result, const std::string& host,
     std::string node;
     const char* service = NULL;
 
-    // ipv6address serivce
+    //检查 ipv6address serivce
     if (!host.empty() && host[0] == '[') {
         const char* endipv6 = (const char*)memchr(host.c_str() + 1, ']', host.size() - 1);
         if (endipv6) {
@@ -81,7 +82,7 @@ bool Address::Lookup(std::vector<Address_ptr>& result, const std::string& host,
         }
     }
 
-    // node serivce
+    //检查 node serivce
     if (node.empty()) {
         service = (const char*)memchr(host.c_str(), ':', host.size());
         if (service) {
@@ -95,6 +96,41 @@ bool Address::Lookup(std::vector<Address_ptr>& result, const std::string& host,
     if (node.empty()) {
         node = host;
     }
+
+    // 域名交给协程化的解析器，数字地址和其他协议族仍走 getaddrinfo
+    if (Resolver::IsEnabled() && !node.empty() && !Resolver::IsNumericHost(node)
+        && (family == AF_INET || family == AF_INET6 || family == AF_UNSPEC)) {
+        uint16_t port = 0;
+        if (service && *service) {
+            char* end = nullptr;
+            long v = strtol(service, &end, 10);
+            if (*end == '\0' && v >= 0 && v <= 65535) {
+                port = (uint16_t)v;
+            }
+            else {
+                servent ent, * res = nullptr;
+                char buf[1024];
+                if (getservbyname_r(service, type == SOCK_DGRAM ? "udp" : "tcp", &ent, buf, sizeof(buf), &res) || !res) {
+                    SYLAR_LOG_DEBUG(SYLAR_LOG_ROOT()) << "Address::Lookup unknown service " << service;
+                    return false;
+                }
+                port = ntohs((uint16_t)res->s_port);
+            }
+        }
+        std::vector<IPAddress_ptr> addrs;
+        if (!Resolver_single::GetInstance()->lookup(addrs, node, family)) {
+            SYLAR_LOG_DEBUG(SYLAR_LOG_ROOT())
+                << "Address::Lookup resolve( " << host << ", "
+                << family << ") failed";
+            return false;
+        }
+        for (auto& it : addrs) {
+            it->setPort(port);
+            result.push_back(it);
+        }
+        return !result.empty();
+    }
+
     int error = getaddrinfo(node.c_str(), service, &hints, &results);
     if (error) {
         SYLAR_LOG_DEBUG(SYLAR_LOG_ROOT()) 
@@ -0,0 +1,356 @@
+#include "AsyncLog.h"
+#include "Config.h"
+#include "Thread.h"
+#include "FileIO.h"
+#include "Clock.h"
+#include <sched.h>
+#include <algorithm>
+
+namespace sylar {
+
+//****************************************************************************
+// 配置
+//****************************************************************************
+
+static ConfigVar_ptr<bool> g_log_async_enable =
+    Config::Lookup("log.async.enable", false, "write logs on a background thread");
+
+static ConfigVar_ptr<uint32_t> g_log_async_ring_size =
+    Config::Lookup("log.async.ring_size", (uint32_t)4096, "per-thread async log queue capacity");
+
+static ConfigVar_ptr<std::string> g_log_async_full_policy =
+    Config::Lookup("log.async.full_policy", std::string("block"), "when the queue is full: block, drop or sample");
+
+static ConfigVar_ptr<uint32_t> g_log_async_sample =
+    Config::Lookup("log.async.sample", (uint32_t)10, "keep one of every n logs when sampling");
+
+static ConfigVar_ptr<uint32_t> g_log_file_flush_interval =
+    Config::Lookup("log.file.flush_interval", (uint32_t)1000, "milliseconds between periodic flushes of buffered log appenders, 0 disables");
+
+static std::atomic<bool> s_async_enable = { false };
+static std::atomic<uint32_t> s_ring_size = { 4096 };
+static std::atomic<int> s_full_policy = { (int)LogFullPolicy::BLOCK };
+static std::atomic<uint32_t> s_sample = { 10 };
+static std::atomic<uint32_t> s_flush_interval = { 1000 };
+// 刷写线程是否已创建
+static std::atomic<bool> s_started = { false };
+// 进程退出阶段刷写线程已停止，之后的日志同步输出
+static std::atomic<bool> s_shutdown = { false };
+
+static LogFullPolicy FullPolicyFromString(const std::string& str) {
+    if (str == "drop") return LogFullPolicy::DROP;
+    if (str == "sample") return LogFullPolicy::SAMPLE;
+    return LogFullPolicy::BLOCK;
+}
+
+struct _AsyncLogIniter {
+    _AsyncLogIniter() {
+        s_async_enable = g_log_async_enable->getValue();
+        s_ring_size = g_log_async_ring_size->getValue();
+        s_full_policy = (int)FullPolicyFromString(g_log_async_full_policy->getValue());
+        s_sample = g_log_async_sample->getValue();
+        s_flush_interval = g_log_file_flush_interval->getValue();
+
+        g_log_async_enable->addListener([](const bool& old_value, const bool& new_value) {
+            s_async_enable = new_value;
+        });
+        g_log_async_ring_size->addListener([](const uint32_t& old_value, const uint32_t& new_value) {
+            s_ring_size = new_value;
+        });
+        g_log_async_full_policy->addListener([](const std::string& old_value, const std::string& new_value) {
+            s_full_policy = (int)FullPolicyFromString(new_value);
+        });
+        g_log_async_sample->addListener([](const uint32_t& old_value, const uint32_t& new_value) {
+            s_sample = new_value;
+        });
+        g_log_file_flush_interval->addListener([](const uint32_t& old_value, const uint32_t& new_value) {
+            s_flush_interval = new_value;
+            // 让等待中的刷写线程按新的间隔重新计时
+            if (s_started && !s_shutdown) {
+                AsyncLogger_single::GetInstance()->wakeup();
+            }
+        });
+    }
+};
+
+static _AsyncLogIniter s_async_log_initer;
+
+//****************************************************************************
+// AsyncLogRing
+//****************************************************************************
+
+/*!
+ * @brief 单生产者(所属线程)单消费者(持有 __drainMutex 的线程)的环形队列
+ */
+class AsyncLogRing {
+public:
+    struct Item {
+        Logger_ptr logger;
+        LogEvent event;
+        std::string message;    // 事件正文，指向调用方缓冲的内容复制到这里
+    };
+
+    std::vector<Item> items;
+    uint64_t mask;
+    alignas(64) std::atomic<uint64_t> head = { 0 };     // 消费位置
+    alignas(64) std::atomic<uint64_t> tail = { 0 };     // 生产位置
+    uint64_t sampleSeq = 0;                             // 采样计数，只由生产者访问
+    std::atomic<bool> closed = { false };               // 所属线程已退出，不会再入队
+
+    AsyncLogRing(size_t capacity) : items(capacity), mask(capacity - 1) {}
+
+    uint64_t size() const {
+        return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+    }
+};
+
+static thread_local AsyncLogRing* t_ring = nullptr;
+static thread_local bool t_exited = false;
+static thread_local bool t_flusher = false;
+
+/*!
+ * @brief 线程退出时关闭本线程的队列，剩余日志由刷写线程写出后释放
+ */
+struct AsyncLogRingHolder {
+    AsyncLogRing_ptr ring;
+
+    ~AsyncLogRingHolder() {
+        if (ring) {
+            ring->closed.store(true, std::memory_order_release);
+        }
+        t_ring = nullptr;
+        t_exited = true;
+    }
+};
+
+static thread_local AsyncLogRingHolder t_ring_holder;
+
+//****************************************************************************
+// AsyncLogger
+//****************************************************************************
+
+AsyncLogger::AsyncLogger() {
+    s_started = true;
+    __flusher = std::make_shared<Thread>(std::bind(&AsyncLogger::run, this), "async_log");
+}
+
+AsyncLogger::~AsyncLogger() {
+    s_shutdown = true;
+    __stopping = true;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    wakeup();
+    __flusher->join();
+    drain();
+    FlushBufferedAppenders();
+}
+
+bool AsyncLogger::IsEnabled() {
+    return s_async_enable.load(std::memory_order_relaxed) && !s_shutdown.load(std::memory_order_relaxed);
+}
+
+void AsyncLogger::EnsureStarted() {
+    // 退出阶段单例可能已析构，不能再创建
+    if (s_started.load(std::memory_order_relaxed) || s_shutdown.load(std::memory_order_relaxed)) {
+        return;
+    }
+    AsyncLogger_single::GetInstance();
+}
+
+AsyncLogRing* AsyncLogger::getRing() {
+    if (t_ring) {
+        return t_ring;
+    }
+    // 刷写线程自己的日志若进入队列，队列满时会等待自己
+    if (t_exited || t_flusher) {
+        return nullptr;
+    }
+    size_t capacity = 2;
+    while (capacity < s_ring_size) {
+        capacity <<= 1;
+    }
+    auto ring = std::make_shared<AsyncLogRing>(capacity);
+    {
+        MutexType::Lock lock(__mutex);
+        __rings.push_back(ring);
+    }
+    t_ring_holder.ring = ring;
+    t_ring = ring.get();
+    return t_ring;
+}
+
+void AsyncLogger::wakeup() {
+    if (__sleeping.exchange(false)) {
+        __semaphore.notify();
+    }
+}
+
+bool AsyncLogger::push(const Logger_ptr& logger, const LogEvent& event) {
+    AsyncLogRing* ring = getRing();
+    if (!ring) {
+        return false;
+    }
+    uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+    uint64_t capacity = ring->mask + 1;
+    LogFullPolicy policy = (LogFullPolicy)s_full_policy.load(std::memory_order_relaxed);
+
+    if (policy == LogFullPolicy::SAMPLE && tail - ring->head.load(std::memory_order_acquire) >= capacity / 2) {
+        uint32_t sample = s_sample.load(std::memory_order_relaxed);
+        if (sample > 1 && ring->sampleSeq++ % sample != 0) {
+            __sampled.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    bool blocked = false;
+    while (tail - ring->head.load(std::memory_order_acquire) >= capacity) {
+        if (policy != LogFullPolicy::BLOCK) {
+            __dropped.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+        if (__stopping) {
+            return false;
+        }
+        if (!blocked) {
+            blocked = true;
+            __blocked.fetch_add(1, std::memory_order_relaxed);
+        }
+        wakeup();
+        sched_yield();
+    }
+
+    auto& item = ring->items[tail & ring->mask];
+    item.logger = logger;
+    item.event = event;
+    item.message.assign(event.getMessage(), event.getMessageSize());
+    item.event.setMessage(item.message.data(), item.message.size());
+    ring->tail.store(tail + 1, std::memory_order_release);
+
+    // 与刷写线程进入等待前的检查配对：要么它看到新日志，要么这里看到它在等待
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (__sleeping.load(std::memory_order_relaxed)) {
+        wakeup();
+    }
+    return true;
+}
+
+size_t AsyncLogger::drain() {
+    // FATAL 时可能在协程中调用，持有 __drainMutex 与输出地的锁时不能让出协程
+    FileIOPool::InlineGuard guard;
+    MutexType::Lock drain_lock(__drainMutex);
+    std::vector<AsyncLogRing_ptr> rings;
+    {
+        MutexType::Lock lock(__mutex);
+        rings = __rings;
+    }
+
+    // 直接在槽位上格式化，格式化完成后才归还槽位
+    std::vector<AsyncLogRing::Item*> items;
+    std::vector<std::pair<AsyncLogRing*, uint64_t> > tails;
+    for (auto& ring : rings) {
+        uint64_t head = ring->head.load(std::memory_order_relaxed);
+        uint64_t tail = ring->tail.load(std::memory_order_acquire);
+        for (; head != tail; ++head) {
+            items.push_back(&ring->items[head & ring->mask]);
+        }
+        tails.emplace_back(ring.get(), tail);
+    }
+
+    if (!items.empty()) {
+        // 不同线程的日志大致按时间先后输出
+        std::stable_sort(items.begin(), items.end(), [](const AsyncLogRing::Item* a, const AsyncLogRing::Item* b) {
+            if (a->event.getTime() != b->event.getTime()) {
+                return a->event.getTime() < b->event.getTime();
+            }
+            return a->event.getUsec() < b->event.getUsec();
+        });
+        for (auto i : items) {
+            i->logger->appendTo(i->event, __batch);
+            i->logger.reset();
+        }
+    }
+    for (auto& i : tails) {
+        i.first->head.store(i.second, std::memory_order_release);
+    }
+
+    // 线程已退出且已取空的队列不会再有日志
+    {
+        MutexType::Lock lock(__mutex);
+        __rings.erase(std::remove_if(__rings.begin(), __rings.end(), [](const AsyncLogRing_ptr& ring) {
+            return ring->closed.load(std::memory_order_acquire) && ring->size() == 0;
+        }), __rings.end());
+    }
+
+    if (items.empty()) {
+        return 0;
+    }
+    __batch.flush();
+    __batches.fetch_add(1, std::memory_order_relaxed);
+    __written.fetch_add(items.size(), std::memory_order_relaxed);
+    return items.size();
+}
+
+void AsyncLogger::run() {
+    t_flusher = true;
+    uint64_t last_tick = Clock::NowMS();
+    while (true) {
+        uint32_t interval = s_flush_interval.load(std::memory_order_relaxed);
+        // 关闭定时刷出时仍每秒检查一次被抑制日志的汇总
+        uint32_t period = interval ? interval : 1000;
+        uint64_t now = Clock::NowMS();
+        if (now - last_tick >= period) {
+            if (interval) {
+                FlushBufferedAppenders();
+            }
+            LogLimiter::Poll();
+            last_tick = now;
+        }
+        if (drain()) {
+            continue;
+        }
+        if (__stopping) {
+            break;
+        }
+
+        __sleeping.store(true);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        bool pending = __stopping;
+        {
+            MutexType::Lock lock(__mutex);
+            for (auto& ring : __rings) {
+                if (ring->size()) {
+                    pending = true;
+                    break;
+                }
+            }
+        }
+        // 已被生产者唤醒时需要消费掉那次 notify
+        if (pending && __sleeping.exchange(false)) {
+            continue;
+        }
+        now = Clock::NowMS();
+        uint64_t timeout = now - last_tick >= period ? 1 : last_tick + period - now;
+        // 超时的同时被生产者唤醒，同样需要消费掉那次 notify
+        if (!__semaphore.wait(timeout) && !__sleeping.exchange(false)) {
+            __semaphore.wait();
+        }
+    }
+}
+
+std::ostream& AsyncLogger::dump(std::ostream& os) {
+    size_t rings = 0;
+    {
+        MutexType::Lock lock(__mutex);
+        rings = __rings.size();
+    }
+    os << "[AsyncLogger enabled=" << IsEnabled()
+       << " rings=" << rings
+       << " dropped=" << __dropped
+       << " sampled=" << __sampled
+       << " blocked=" << __blocked
+       << " batches=" << __batches
+       << " written=" << __written
+       << "]" << std::endl;
+    return os;
+}
+
+}; /* sylar */
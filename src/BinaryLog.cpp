@@ -0,0 +1,240 @@
+#include "BinaryLog.h"
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdexcept>
+
+namespace sylar {
+
+static const char BINARY_LOG_MAGIC[] = "SYLB";
+static const uint8_t BINARY_LOG_VERSION = 1;
+
+//****************************************************************************
+// 编码
+//****************************************************************************
+
+/*!
+ * @brief 追加变长整数，与 ByteArray::writeUint64 的编码相同
+ */
+static inline void AppendVarint(std::string& buf, uint64_t value) {
+    while (value >= 0x80) {
+        buf.push_back((char)((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    buf.push_back((char)value);
+}
+
+/*!
+ * @brief 追加有符号变长整数，与 ByteArray::writeInt64 的 zigzag 编码相同
+ */
+static inline void AppendVarintSigned(std::string& buf, int64_t value) {
+    AppendVarint(buf, value < 0 ? ((uint64_t)(-value)) * 2 - 1 : (uint64_t)value * 2);
+}
+
+static inline void AppendString(std::string& buf, const char* data, size_t size) {
+    AppendVarint(buf, size);
+    buf.append(data, size);
+}
+
+//****************************************************************************
+// BinaryLogAppender
+//****************************************************************************
+
+BinaryLogAppender::BinaryLogAppender(const std::string& file_name)
+    : __file_name(file_name) {
+    reopen();
+    RegisterBufferedAppender(this);
+}
+
+BinaryLogAppender::~BinaryLogAppender() {
+    UnregisterBufferedAppender(this);
+    flushBuffer();
+    if (__fd >= 0) close(__fd);
+}
+
+bool BinaryLogAppender::reopen() {
+    MutexType::Lock lock(__mutex);
+    flushBuffer();
+    if (__fd >= 0) close(__fd);
+    __fd = open(__file_name.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+    if (__fd < 0) {
+        return false;
+    }
+    // 追加到已有文件时，之前的字典属于上一段，这里开始新的一段
+    writeHeader();
+    flushBuffer();
+    return true;
+}
+
+void BinaryLogAppender::writeHeader() {
+    __sites.clear();
+    __names.clear();
+    __lastTime = 0;
+    __buffer.push_back((char)BinaryLogRecord::HEADER);
+    __buffer.append(BINARY_LOG_MAGIC, 4);
+    __buffer.push_back((char)BINARY_LOG_VERSION);
+}
+
+uint32_t BinaryLogAppender::getNameId(const char* name) {
+    auto it = __names.find(name);
+    if (it != __names.end()) {
+        return it->second;
+    }
+    uint32_t id = __names.size();
+    __names.emplace(name, id);
+    __buffer.push_back((char)BinaryLogRecord::NAME);
+    AppendVarint(__buffer, id);
+    AppendString(__buffer, name, strlen(name));
+    return id;
+}
+
+void BinaryLogAppender::flushBuffer() {
+    const char* data = __buffer.data();
+    size_t size = __buffer.size();
+    while (size > 0 && __fd >= 0) {
+        ssize_t n = ::write(__fd, data, size);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        data += n;
+        size -= n;
+    }
+    __buffer.clear();
+}
+
+void BinaryLogAppender::log(const LogEvent& event) {
+    MutexType::Lock lock(__mutex);
+    uint32_t site = 0;
+    auto key = std::make_pair(event.getFile(), event.getLine());
+    auto it = __sites.find(key);
+    if (it != __sites.end()) {
+        site = it->second;
+    } else {
+        site = __sites.size();
+        __sites.emplace(key, site);
+        __buffer.push_back((char)BinaryLogRecord::SITE);
+        AppendVarint(__buffer, site);
+        AppendVarint(__buffer, event.getLine());
+        AppendString(__buffer, event.getFile(), strlen(event.getFile()));
+    }
+    uint32_t log_name = getNameId(event.getLogName().c_str());
+    uint32_t thread_name = getNameId(event.getThreadName());
+
+    uint64_t time = event.getTime() * 1000000ull + event.getUsec();
+    __buffer.push_back((char)BinaryLogRecord::EVENT);
+    __buffer.push_back((char)event.getLevel());
+    AppendVarintSigned(__buffer, (int64_t)(time - __lastTime));
+    __lastTime = time;
+    AppendVarint(__buffer, site);
+    AppendVarint(__buffer, log_name);
+    AppendVarint(__buffer, thread_name);
+    AppendVarint(__buffer, event.getThreadId());
+    AppendVarint(__buffer, event.getFiberId());
+    AppendVarint(__buffer, event.getElapse());
+    AppendString(__buffer, event.getMessage(), event.getMessageSize());
+    if (__buffer.size() >= FileLogBufferSize() || event.getLevel() >= FileLogFlushLevel()) {
+        flushBuffer();
+    }
+}
+
+void BinaryLogAppender::write(const char* data, size_t size) {
+    MutexType::Lock lock(__mutex);
+    __buffer.append(data, size);
+    flushBuffer();
+}
+
+void BinaryLogAppender::flush() {
+    MutexType::Lock lock(__mutex);
+    flushBuffer();
+}
+
+//****************************************************************************
+// BinaryLogReader
+//****************************************************************************
+
+bool BinaryLogReader::open(const std::string& path) {
+    __data.clear();
+    __sites.clear();
+    __names.clear();
+    __lastTime = 0;
+    __error.clear();
+    if (!__data.readFromFile(path)) {
+        __error = "open " + path + " failed: " + strerror(errno);
+        return false;
+    }
+    __data.setPosition(0);
+    return true;
+}
+
+bool BinaryLogReader::next(LogEvent& event) {
+    try {
+        while (__data.getReadSize() > 0) {
+            BinaryLogRecord type = (BinaryLogRecord)__data.readFuint8();
+            switch (type) {
+            case BinaryLogRecord::HEADER: {
+                char magic[4];
+                __data.read(magic, sizeof(magic));
+                uint8_t version = __data.readFuint8();
+                if (memcmp(magic, BINARY_LOG_MAGIC, sizeof(magic)) || version != BINARY_LOG_VERSION) {
+                    __error = "bad header at " + std::to_string(__data.getPosition());
+                    return false;
+                }
+                __sites.clear();
+                __names.clear();
+                __lastTime = 0;
+                break;
+            }
+            case BinaryLogRecord::SITE: {
+                uint32_t id = __data.readUint32();
+                uint32_t line = __data.readUint32();
+                std::string file = __data.readStringVint();
+                if (id >= __sites.size()) {
+                    __sites.resize(id + 1);
+                }
+                __sites[id] = std::make_pair(file, line);
+                break;
+            }
+            case BinaryLogRecord::NAME: {
+                uint32_t id = __data.readUint32();
+                std::string name = __data.readStringVint();
+                if (id >= __names.size()) {
+                    __names.resize(id + 1);
+                }
+                __names[id] = name;
+                break;
+            }
+            case BinaryLogRecord::EVENT: {
+                LogLevel level = (LogLevel)__data.readFuint8();
+                __lastTime += __data.readInt64();
+                uint32_t site = __data.readUint32();
+                uint32_t log_name = __data.readUint32();
+                uint32_t thread_name = __data.readUint32();
+                uint32_t thread_id = __data.readUint32();
+                uint32_t fiber_id = __data.readUint32();
+                uint32_t elapse = __data.readUint32();
+                __message = __data.readStringVint();
+                if (site >= __sites.size() || log_name >= __names.size() || thread_name >= __names.size()) {
+                    __error = "undefined id at " + std::to_string(__data.getPosition());
+                    return false;
+                }
+                event = LogEvent(__names[log_name], level, __sites[site].first.c_str(), __sites[site].second,
+                                 elapse, thread_id, __names[thread_name].c_str(), fiber_id,
+                                 __lastTime / 1000000, __lastTime % 1000000);
+                event.setMessage(__message.data(), __message.size());
+                return true;
+            }
+            default:
+                __error = "unknown record " + std::to_string((int)type)
+                    + " at " + std::to_string(__data.getPosition() - 1);
+                return false;
+            }
+        }
+    } catch (std::out_of_range& e) {
+        __error = "truncated record at end of file";
+    }
+    return false;
+}
+
+}; /* sylar */
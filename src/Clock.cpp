@@ -0,0 +1,48 @@
+#include "Clock.h"
+
+namespace sylar
+{
+
+//****************************************************************************
+// Clock
+//****************************************************************************
+
+static thread_local uint64_t t_cached_us = 0;
+
+uint64_t Clock::NowUS() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000ull + ts.tv_nsec / 1000;
+}
+
+uint64_t Clock::NowMS() {
+	return NowUS() / 1000;
+}
+
+uint64_t Clock::Update() {
+	t_cached_us = NowUS();
+	return t_cached_us;
+}
+
+uint64_t Clock::CachedUS() {
+	if (t_cached_us == 0) return Update();
+	return t_cached_us;
+}
+
+uint64_t Clock::CachedMS() {
+	return CachedUS() / 1000;
+}
+
+time_t Clock::WallSecond() {
+	struct timespec ts;
+	clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+	return ts.tv_sec;
+}
+
+uint64_t Clock::WallUS() {
+	struct timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	return ts.tv_sec * 1000000ull + ts.tv_nsec / 1000;
+}
+
+}; /* sylar */
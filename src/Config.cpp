@@ -1,4 +1,11 @@
 #include "Config.h"
+#include "Util.h"
+#include "ByteArray.h"
+#include <string.h>
+#include <unistd.h>
+#include <zlib.h>
+#include <sys/stat.h>
+#include <algorithm>
 
 namespace sylar {
 
@@ -41,52 +48,497 @@ ListAllMember(const std::string& prefix, const YAML::Node& node,
 	}
 }
 
-ConfigVarMap& Config::GetDatas() {
-	static ConfigVarMap __datas;
+RcuPtr<ConfigVarMap>& Config::GetDatas() {
+	static RcuPtr<ConfigVarMap> __datas;
 	return __datas;
 }
 
-Config::RWMutexType& Config::GetMutex() {
-	static RWMutexType __mutex;
-	return __mutex;
-}
-
 ConfigVarBase_ptr Config::LookupBase(const std::string& name) {
-	RWMutexType::ReadLock lock(GetMutex());
-	auto it = GetDatas().find(name);
-	if (it == GetDatas().end()) return nullptr;
+	Rcu::ReadLock lock;
+	const ConfigVarMap* datas = GetDatas().get();
+	auto it = datas->find(name);
+	if (it == datas->end()) return nullptr;
 	else return it->second;
 }
 
-void Config::LoadFromYaml(const YAML::Node& root) {
+/*!
+ * @brief 每个配置项上次从配置文件加载的文本与加载后值的版本号
+ * @details 文本相同且值此后未被 setValue 改过时跳过该配置项
+ */
+static std::map<std::string, std::pair<std::string, uint64_t>>& GetLoadedTexts() {
+	static std::map<std::string, std::pair<std::string, uint64_t>> s_texts;
+	return s_texts;
+}
+
+static Mutex& GetLoadMutex() {
+	static Mutex s_mutex;
+	return s_mutex;
+}
+
+/*!
+ * @brief 配置目录下每个文件上次加载时的修改时间(纳秒)
+ */
+static std::map<std::string, uint64_t>& GetFileMtimes() {
+	static std::map<std::string, uint64_t> s_mtimes;
+	return s_mtimes;
+}
+
+static Mutex& GetMtimeMutex() {
+	static Mutex s_mutex;
+	return s_mutex;
+}
+
+using ConfigText = std::pair<std::string, std::string>;
+
+/*!
+ * @brief 结点的文本：标量直接取文本，由偏特化的 LexicalCast 转换；
+ *        其他类型(Sequence、Map)输出为 YAML，偏特化中 fromString 有对应的处理方法
+ */
+static std::string NodeText(const YAML::Node& node) {
+	if (node.IsScalar()) {
+		return node.Scalar();
+	}
+	std::stringstream ss;
+	ss << node;
+	return ss.str();
+}
+
+/*!
+ * @brief 展开 YAML 树，得到每个已注册配置项的 key 与文本
+ */
+static void ListAllText(const YAML::Node& root, std::vector<ConfigText>& output) {
 	std::list<std::pair<std::string, const YAML::Node>> all_nodes;
 	ListAllMember("", root, all_nodes);
-
 	for (auto& i : all_nodes) {
-	// ȡkeyǷkey֮ǰ޸Ϊļмصֵ
 		std::string key = i.first;
 		if (key.empty()) continue;
-		// keyתΪСд
+		// 将key转为小写
 		std::transform(key.begin(), key.end(), key.begin(), ::tolower);
+		// 不存在的key直接跳过
+		if (!Config::LookupBase(key)) continue;
+		output.push_back(std::make_pair(key, NodeText(i.second)));
+	}
+}
+
+/*!
+ * @brief 按顺序更新配置项，跳过文本与上次加载相同的
+ * @return 实际更新的配置项数
+ */
+static size_t ApplyText(const std::vector<ConfigText>& texts) {
+	// 加载之间互斥，保证 GetLoadedTexts 与实际值一致
+	Mutex::Lock lock(GetLoadMutex());
+	auto& loaded = GetLoadedTexts();
+	size_t changed = 0;
+	for (auto& i : texts) {
+		ConfigVarBase_ptr var = Config::LookupBase(i.first);
+		if (!var) continue;
+		// 与上次加载的文本相同、且值没有在别处被修改时不再转换
+		auto it = loaded.find(i.first);
+		if (it != loaded.end() && it->second.first == i.second
+				&& it->second.second == var->getVersion()) {
+			continue;
+		}
+		if (var->fromString(i.second)) {
+			loaded[i.first] = std::make_pair(i.second, var->getVersion());
+			++changed;
+		}
+	}
+	return changed;
+}
+
+size_t Config::LoadFromYaml(const YAML::Node& root) {
+	std::vector<ConfigText> texts;
+	ListAllText(root, texts);
+	return ApplyText(texts);
+}
+
+size_t Config::LoadFromFile(const std::string& path) {
+	YAML::Node root;
+	try {
+		root = YAML::LoadFile(path);
+	} catch (std::exception& e) {
+		SYLAR_LOG_ERROR(SYLAR_LOG_ROOT()) << "Config::LoadFromFile " << path << " failed: " << e.what();
+		return 0;
+	}
+	size_t changed = LoadFromYaml(root);
+	SYLAR_LOG_INFO(SYLAR_LOG_ROOT()) << "Config::LoadFromFile " << path << " changed " << changed;
+	return changed;
+}
 
-		// ѯǷkey
-		ConfigVarBase_ptr var = LookupBase(key);
-
-		// keyŴļмظ£ֱ
-		if (var) {
-			if (i.second.IsScalar()) {
-				// YAML::ڽֵתΪScalar
-				// Ȼַмأͨʵƫػʵ͵ת__valи
-				var->fromString(i.second.Scalar());
-			} else {
-				//  Sequence,ƫػfromstd::stringжӦĴ
-				std::stringstream ss;
-				ss << i.second;
-				var->fromString(ss.str());
+/*!
+ * @brief 配置文件的指纹，任一项变化都说明快照已过期
+ */
+struct ConfigFileStat {
+	std::string path;
+	uint64_t size = 0;
+	uint64_t mtime = 0;		// 纳秒
+
+	bool operator==(const ConfigFileStat& rhs) const {
+		return path == rhs.path && size == rhs.size && mtime == rhs.mtime;
+	}
+};
+
+/*!
+ * @brief 列出目录下所有 .yml/.yaml 文件，按路径排序
+ */
+static void ListConfigFile(const std::string& path, std::vector<ConfigFileStat>& output) {
+	std::vector<std::string> files;
+	FSUtil::ListAllFile(files, path, ".yml");
+	FSUtil::ListAllFile(files, path, ".yaml");
+	std::sort(files.begin(), files.end());
+	for (auto& i : files) {
+		struct stat st;
+		if (stat(i.c_str(), &st)) {
+			continue;
+		}
+		ConfigFileStat file;
+		file.path = i;
+		file.size = st.st_size;
+		file.mtime = st.st_mtim.tv_sec * 1000000000ull + st.st_mtim.tv_nsec;
+		output.push_back(file);
+	}
+}
+
+/*!
+ * @brief 记下已加载文件的修改时间，之后 LoadFromConfDir 跳过它们
+ */
+static void MarkLoaded(const std::vector<ConfigFileStat>& files) {
+	Mutex::Lock lock(GetMtimeMutex());
+	auto& mtimes = GetFileMtimes();
+	for (auto& i : files) {
+		mtimes[i.path] = i.mtime;
+	}
+}
+
+size_t Config::LoadFromConfDir(const std::string& path, bool force) {
+	std::vector<ConfigFileStat> files;
+	ListConfigFile(path, files);
+
+	size_t changed = 0;
+	for (auto& i : files) {
+		{
+			Mutex::Lock lock(GetMtimeMutex());
+			auto& mtimes = GetFileMtimes();
+			auto it = mtimes.find(i.path);
+			if (!force && it != mtimes.end() && it->second == i.mtime) {
+				continue;
 			}
+			mtimes[i.path] = i.mtime;
+		}
+		changed += LoadFromFile(i.path);
+	}
+	return changed;
+}
+
+//****************************************************************************
+// 配置快照
+//****************************************************************************
+
+/*!
+ * 快照文件格式(ByteArray 编码)：
+ *   "SYCF" | 版本 Fuint8 | 正文长度 Fuint64 | 正文 crc32 Fuint32 | 正文
+ * 正文：
+ *   文件数 Uint32，每个文件 路径 StringVint、大小 Uint64、修改时间 Uint64
+ *   项数 Uint32，每项 key StringVint、类别 Fuint8，按加载顺序排列：
+ *     TEXT       文本 StringVint
+ *     BINARY     类型名 StringVint、ConfigBinary 编码 StringVint
+ *     UNRESOLVED 无
+ */
+static const char CONFIG_SNAPSHOT_MAGIC[4] = { 'S', 'Y', 'C', 'F' };
+static const uint8_t CONFIG_SNAPSHOT_VERSION = 2;
+
+/*!
+ * @brief 快照中的一项
+ */
+struct ConfigEntry {
+	enum Kind {
+		TEXT = 0,			// 生成快照时未注册的标量，或类型没有二进制编码，加载时 fromString
+		BINARY = 1,			// 按类型编码的值，加载时 fromBinary，不经过 YAML
+		UNRESOLVED = 2		// 生成快照时未注册的非标量结点，只记录 key
+	};
+
+	std::string key;
+	uint8_t kind = TEXT;
+	std::string type;		// BINARY 时为值的类型名
+	std::string data;		// TEXT 为文本，BINARY 为编码
+};
+
+/*!
+ * @brief 展开 YAML 树，得到快照的各项
+ * @details 已注册的配置项转换成值后按类型编码；未注册的标量保存文本，之后注册的
+ *          配置项仍能从快照取值；未注册的非标量(中间结点或容器)只记录 key，
+ *          加载时它已被注册则快照过期
+ */
+static void ListAllEntry(const YAML::Node& root, std::vector<ConfigEntry>& output) {
+	std::list<std::pair<std::string, const YAML::Node>> all_nodes;
+	ListAllMember("", root, all_nodes);
+	ByteArray ba(256);
+	for (auto& i : all_nodes) {
+		if (i.first.empty()) continue;
+		ConfigEntry entry;
+		entry.key = i.first;
+		std::transform(entry.key.begin(), entry.key.end(), entry.key.begin(), ::tolower);
+		ConfigVarBase_ptr var = Config::LookupBase(entry.key);
+		if (!var && !i.second.IsScalar()) {
+			entry.kind = ConfigEntry::UNRESOLVED;
+			output.push_back(std::move(entry));
+			continue;
+		}
+		entry.data = NodeText(i.second);
+		ba.clear();
+		if (var && var->toBinary(entry.data, ba)) {
+			ba.setPosition(0);
+			entry.kind = ConfigEntry::BINARY;
+			entry.type = var->getTypeName();
+			entry.data = ba.toString();
 		}
+		output.push_back(std::move(entry));
 	}
 }
 
+/*!
+ * @brief 解析全部配置文件，任一文件解析失败返回 false
+ */
+static bool CompileConfigFile(const std::vector<ConfigFileStat>& files, std::vector<ConfigEntry>& entries) {
+	for (auto& i : files) {
+		try {
+			ListAllEntry(YAML::LoadFile(i.path), entries);
+		} catch (std::exception& e) {
+			SYLAR_LOG_ERROR(SYLAR_LOG_ROOT()) << "Config compile " << i.path << " failed: " << e.what();
+			return false;
+		}
+	}
+	// 多个文件设置同一配置项时只保留最后一次，避免加载时中间值触发监听器
+	std::map<std::string, size_t> last;
+	for (size_t i = 0; i < entries.size(); ++i) {
+		last[entries[i].key] = i;
+	}
+	size_t n = 0;
+	for (size_t i = 0; i < entries.size(); ++i) {
+		if (last[entries[i].key] == i) {
+			entries[n++] = std::move(entries[i]);
+		}
+	}
+	entries.resize(n);
+	return true;
+}
+
+/*!
+ * @brief 快照生成后注册表的变化是否使其失效
+ * @details 编码时的类型与现在注册的不同，或当时未注册的非标量现在已注册
+ */
+static bool CheckEntries(const std::vector<ConfigEntry>& entries, std::string& error) {
+	for (auto& i : entries) {
+		if (i.kind == ConfigEntry::TEXT) continue;
+		ConfigVarBase_ptr var = Config::LookupBase(i.key);
+		if (!var) continue;
+		if (i.kind == ConfigEntry::UNRESOLVED || var->getTypeName() != i.type) {
+			error = "stale " + i.key;
+			return false;
+		}
+	}
+	return true;
+}
+
+/*!
+ * @brief 按顺序应用快照的各项，跳过与上次加载相同的
+ * @return 值实际改变的配置项数
+ */
+static size_t ApplyEntries(const std::vector<ConfigEntry>& entries) {
+	Mutex::Lock lock(GetLoadMutex());
+	auto& loaded = GetLoadedTexts();
+	ByteArray ba(256);
+	size_t changed = 0;
+	for (auto& i : entries) {
+		if (i.kind == ConfigEntry::UNRESOLVED) continue;
+		ConfigVarBase_ptr var = Config::LookupBase(i.key);
+		if (!var) continue;
+		// 编码前加 '\0'，与配置文件中加载的文本区分
+		std::string data = i.kind == ConfigEntry::BINARY ? std::string(1, '\0') + i.data : i.data;
+		uint64_t version = var->getVersion();
+		auto it = loaded.find(i.key);
+		if (it != loaded.end() && it->second.first == data && it->second.second == version) {
+			continue;
+		}
+		bool ok = false;
+		if (i.kind == ConfigEntry::BINARY) {
+			ba.clear();
+			ba.write(i.data.data(), i.data.size());
+			ba.setPosition(0);
+			ok = var->fromBinary(ba);
+		} else {
+			ok = var->fromString(i.data);
+		}
+		if (ok) {
+			// 与 YAML 加载的值相同时只更新记录，不计数
+			if (var->getVersion() != version) {
+				++changed;
+			}
+			loaded[i.key] = std::make_pair(std::move(data), var->getVersion());
+		}
+	}
+	return changed;
+}
+
+/*!
+ * @brief 写快照，先写临时文件再改名，读者不会看到写了一半的快照
+ */
+static bool WriteSnapshot(const std::string& snapshot, const std::vector<ConfigFileStat>& files,
+						  const std::vector<ConfigEntry>& entries) {
+	ByteArray body;
+	body.writeUint32(files.size());
+	for (auto& i : files) {
+		body.writeStringVint(i.path);
+		body.writeUint64(i.size);
+		body.writeUint64(i.mtime);
+	}
+	body.writeUint32(entries.size());
+	for (auto& i : entries) {
+		body.writeStringVint(i.key);
+		body.writeFuint8(i.kind);
+		if (i.kind == ConfigEntry::BINARY) {
+			body.writeStringVint(i.type);
+		}
+		if (i.kind != ConfigEntry::UNRESOLVED) {
+			body.writeStringVint(i.data);
+		}
+	}
+	body.setPosition(0);
+	std::string data = body.toString();
+
+	ByteArray ba;
+	ba.write(CONFIG_SNAPSHOT_MAGIC, sizeof(CONFIG_SNAPSHOT_MAGIC));
+	ba.writeFuint8(CONFIG_SNAPSHOT_VERSION);
+	ba.writeFuint64(data.size());
+	ba.writeFuint32(crc32(0, (const Bytef*)data.data(), data.size()));
+	ba.write(data.data(), data.size());
+	ba.setPosition(0);
+
+	std::string tmp = snapshot + ".tmp";
+	if (!ba.writeToFile(tmp) || rename(tmp.c_str(), snapshot.c_str())) {
+		unlink(tmp.c_str());
+		return false;
+	}
+	return true;
+}
+
+/*!
+ * @brief 读快照，文件损坏或与 files 记录的指纹不一致时返回 false
+ */
+static bool ReadSnapshot(const std::string& snapshot, const std::vector<ConfigFileStat>& files,
+						 std::vector<ConfigEntry>& entries, std::string& error) {
+	if (access(snapshot.c_str(), R_OK)) {
+		error = "not found";
+		return false;
+	}
+	ByteArray ba;
+	if (!ba.readFromFile(snapshot)) {
+		error = "read failed";
+		return false;
+	}
+	ba.setPosition(0);
+	try {
+		char magic[4];
+		ba.read(magic, sizeof(magic));
+		uint8_t version = ba.readFuint8();
+		if (memcmp(magic, CONFIG_SNAPSHOT_MAGIC, sizeof(magic)) || version != CONFIG_SNAPSHOT_VERSION) {
+			error = "bad header";
+			return false;
+		}
+		uint64_t size = ba.readFuint64();
+		uint32_t crc = ba.readFuint32();
+		if (size != ba.getReadSize()) {
+			error = "bad size";
+			return false;
+		}
+		std::string data = ba.toString();
+		if (crc != crc32(0, (const Bytef*)data.data(), data.size())) {
+			error = "checksum mismatch";
+			return false;
+		}
+
+		uint32_t count = ba.readUint32();
+		if (count != files.size()) {
+			error = "stale";
+			return false;
+		}
+		for (uint32_t i = 0; i < count; ++i) {
+			ConfigFileStat file;
+			file.path = ba.readStringVint();
+			file.size = ba.readUint64();
+			file.mtime = ba.readUint64();
+			if (!(file == files[i])) {
+				error = "stale";
+				return false;
+			}
+		}
+		count = ba.readUint32();
+		entries.resize(count);
+		for (auto& i : entries) {
+			i.key = ba.readStringVint();
+			i.kind = ba.readFuint8();
+			if (i.kind > ConfigEntry::UNRESOLVED) {
+				error = "bad entry " + i.key;
+				return false;
+			}
+			if (i.kind == ConfigEntry::BINARY) {
+				i.type = ba.readStringVint();
+			}
+			if (i.kind != ConfigEntry::UNRESOLVED) {
+				i.data = ba.readStringVint();
+			}
+		}
+	} catch (std::exception& e) {
+		error = e.what();
+		return false;
+	}
+	return CheckEntries(entries, error);
+}
+
+bool Config::SaveSnapshot(const std::string& path, const std::string& snapshot) {
+	std::vector<ConfigFileStat> files;
+	std::vector<ConfigEntry> entries;
+	ListConfigFile(path, files);
+	if (!CompileConfigFile(files, entries)) {
+		return false;
+	}
+	return WriteSnapshot(snapshot, files, entries);
+}
+
+int64_t Config::LoadFromSnapshot(const std::string& path, const std::string& snapshot) {
+	std::vector<ConfigFileStat> files;
+	std::vector<ConfigEntry> entries;
+	ListConfigFile(path, files);
+	std::string error;
+	if (!ReadSnapshot(snapshot, files, entries, error)) {
+		SYLAR_LOG_INFO(SYLAR_LOG_ROOT()) << "Config::LoadFromSnapshot " << snapshot << " unusable: " << error;
+		return -1;
+	}
+	size_t changed = ApplyEntries(entries);
+	MarkLoaded(files);
+	SYLAR_LOG_INFO(SYLAR_LOG_ROOT()) << "Config::LoadFromSnapshot " << snapshot << " changed " << changed;
+	return changed;
+}
+
+size_t Config::LoadWithSnapshot(const std::string& path, const std::string& snapshot) {
+	int64_t changed = LoadFromSnapshot(path, snapshot);
+	if (changed >= 0) {
+		return changed;
+	}
+	// 快照不可用，解析 YAML 并顺便重新生成快照
+	std::vector<ConfigFileStat> files;
+	std::vector<ConfigEntry> entries;
+	ListConfigFile(path, files);
+	if (!CompileConfigFile(files, entries)) {
+		// 有文件解析失败时逐个加载其余文件，不生成快照
+		return LoadFromConfDir(path, true);
+	}
+	changed = ApplyEntries(entries);
+	MarkLoaded(files);
+	if (!WriteSnapshot(snapshot, files, entries)) {
+		SYLAR_LOG_ERROR(SYLAR_LOG_ROOT()) << "Config write snapshot " << snapshot << " failed";
+	}
+	return changed;
+}
 
-}; /* sylar */
\ No newline at end of file
+}; /* sylar */
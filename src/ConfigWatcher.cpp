@@ -0,0 +1,193 @@
+#include "ConfigWatcher.h"
+#include "IOManager.h"
+#include "Config.h"
+#include "Log.h"
+#include <errno.h>
+#include <string.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+
+namespace sylar {
+
+/*!
+ * @brief 只关心 YAML 文件，编辑器的临时文件(.swp 等)忽略
+ */
+static bool IsConfigFile(const std::string& name) {
+    auto ends_with = [&name](const char* suffix) {
+        size_t n = strlen(suffix);
+        return name.size() > n && name.compare(name.size() - n, n, suffix) == 0;
+    };
+    return ends_with(".yml") || ends_with(".yaml");
+}
+
+//****************************************************************************
+// ConfigWatcher
+//****************************************************************************
+
+ConfigWatcher::ConfigWatcher(const std::string& path, uint64_t debounce_ms, IOManager* iom)
+    : __iom(iom ? iom : IOManager::GetThis())
+    , __path(path)
+    , __debounceMS(debounce_ms) {
+}
+
+ConfigWatcher::~ConfigWatcher() {
+    if (__fd >= 0) {
+        close(__fd);
+    }
+}
+
+bool ConfigWatcher::start() {
+    if (!__iom) {
+        SYLAR_LOG_ERROR(SYLAR_LOG_ROOT()) << "ConfigWatcher::start " << __path << " without IOManager";
+        return false;
+    }
+    __fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (__fd < 0) {
+        SYLAR_LOG_ERROR(SYLAR_LOG_ROOT()) << "inotify_init1 failed errno=" << errno << " " << strerror(errno);
+        return false;
+    }
+    if (!addWatch(__path, nullptr)) {
+        close(__fd);
+        __fd = -1;
+        return false;
+    }
+    auto self = shared_from_this();
+    if (__iom->addEvent(__fd, IOManager::READ, [self]() { self->onReadable(); })) {
+        close(__fd);
+        __fd = -1;
+        return false;
+    }
+    SYLAR_LOG_INFO(SYLAR_LOG_ROOT()) << "ConfigWatcher watching " << __path;
+    return true;
+}
+
+void ConfigWatcher::stop() {
+    Timer_ptr timer;
+    {
+        MutexType::Lock lock(__mutex);
+        if (__stopping) {
+            return;
+        }
+        __stopping = true;
+        timer.swap(__timer);
+        __pending.clear();
+    }
+    if (timer) {
+        timer->cancel();
+    }
+    if (__fd >= 0) {
+        __iom->delEvent(__fd, IOManager::READ);
+    }
+}
+
+bool ConfigWatcher::addWatch(const std::string& dir, std::set<std::string>* files) {
+    int wd = inotify_add_watch(__fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_MOVE_SELF | IN_ONLYDIR);
+    if (wd < 0) {
+        SYLAR_LOG_ERROR(SYLAR_LOG_ROOT()) << "inotify_add_watch " << dir << " failed errno="
+            << errno << " " << strerror(errno);
+        return false;
+    }
+    __dirs[wd] = dir;
+
+    // 先加监视再列目录，列目录之后的变化由事件报告
+    DIR* dp = opendir(dir.c_str());
+    if (!dp) {
+        return true;
+    }
+    struct dirent* entry = nullptr;
+    while ((entry = readdir(dp)) != nullptr) {
+        if (entry->d_type == DT_DIR) {
+            if (!strcmp(entry->d_name, ".") || !strcmp(entry->d_name, "..")) {
+                continue;
+            }
+            addWatch(dir + "/" + entry->d_name, files);
+        } else if (files && entry->d_type == DT_REG && IsConfigFile(entry->d_name)) {
+            files->insert(dir + "/" + entry->d_name);
+        }
+    }
+    closedir(dp);
+    return true;
+}
+
+void ConfigWatcher::onReadable() {
+    // 事件结构后紧跟文件名，按 inotify_event 对齐
+    alignas(inotify_event) char buff[4096];
+    std::set<std::string> names;
+    while (true) {
+        ssize_t n = read(__fd, buff, sizeof(buff));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        for (char* p = buff; p < buff + n;) {
+            inotify_event* event = (inotify_event*)p;
+            p += sizeof(inotify_event) + event->len;
+            auto it = __dirs.find(event->wd);
+            if (it == __dirs.end()) {
+                continue;
+            }
+            if (event->mask & IN_IGNORED) {
+                // 目录被删除，监视已被内核移除
+                __dirs.erase(it);
+                continue;
+            }
+            if ((event->mask & IN_MOVE_SELF) && it->second != __path
+                    && access(it->second.c_str(), F_OK) != 0) {
+                // 子目录被移出，记录的路径已失效。在目录内改名时先收到父目录的
+                // IN_MOVED_TO，同一个监视已改记新路径
+                inotify_rm_watch(__fd, event->wd);
+                __dirs.erase(it);
+                continue;
+            }
+            if (!event->len) {
+                continue;
+            }
+            std::string path = it->second + "/" + event->name;
+            if (event->mask & IN_ISDIR) {
+                // 新建或移入的子目录，其中已有的文件一并加载
+                if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+                    addWatch(path, &names);
+                }
+            } else if ((event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) && IsConfigFile(event->name)) {
+                names.insert(path);
+            }
+        }
+    }
+
+    MutexType::Lock lock(__mutex);
+    if (__stopping) {
+        return;
+    }
+    if (!names.empty()) {
+        __pending.insert(names.begin(), names.end());
+        // 连续修改时推迟到最后一次变化之后再加载
+        if (!__timer || !__timer->reset(__debounceMS, true)) {
+            auto self = shared_from_this();
+            __timer = __iom->addTimer(__debounceMS, [self]() { self->onTimer(); });
+        }
+    }
+    // 读事件触发一次后即被移除，读空后重新注册
+    auto self = shared_from_this();
+    __iom->addEvent(__fd, IOManager::READ, [self]() { self->onReadable(); });
+}
+
+void ConfigWatcher::onTimer() {
+    std::set<std::string> files;
+    {
+        MutexType::Lock lock(__mutex);
+        if (__stopping) {
+            return;
+        }
+        files.swap(__pending);
+        __timer = nullptr;
+    }
+    for (auto& i : files) {
+        Config::LoadFromFile(i);
+        ++__reloads;
+    }
+}
+
+}; /* sylar */
@@ -1,13 +1,44 @@
 #include "FDManager.h"
 #include "Hook.h"
+#include "IOManager.h"
 #include <sys/stat.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/socket.h>
+#include <string.h>
+#include <algorithm>
 
 namespace sylar
 {
 
+//****************************************************************************
+// FDStats
+//****************************************************************************
+
+static const char* s_metric_names[FDStats::METRIC_COUNT] = {
+	"bytes_read",
+	"bytes_written",
+	"syscalls",
+	"eagains",
+	"suspend_us",
+	"timeouts"
+};
+
+const char* FDStats::ToString(FDStats::Metric metric) {
+	if (metric < 0 || metric >= METRIC_COUNT) return "unknown";
+	return s_metric_names[metric];
+}
+
+bool FDStats::FromString(const std::string& str, FDStats::Metric& metric) {
+	for (int i = 0; i < METRIC_COUNT; ++i) {
+		if (strcasecmp(str.c_str(), s_metric_names[i]) == 0) {
+			metric = (Metric)i;
+			return true;
+		}
+	}
+	return false;
+}
+
 //****************************************************************************
 // FDCtx
 //****************************************************************************
@@ -17,6 +48,7 @@ bool FDCtx::init() {
 
 	__recvTimeout = -1;
 	__sendTimeout = -1;
+	resetDeadlines();
 
 	struct stat fd_stat;
 	if (fstat(__fd, &fd_stat) == -1) {
@@ -52,7 +84,13 @@ FDCtx::FDCtx(int fd)
 	__isClosed(false),
 	__fd(fd),
 	__recvTimeout(-1),
-	__sendTimeout(-1) {
+	__sendTimeout(-1),
+	__idleTimeout(0),
+	__lastActive(0),
+	__deadlineNode{ { this, 0 }, { this, 1 } } {
+	for (auto& i : __stats) {
+		i = 0;
+	}
 	init();
 }
 
@@ -93,7 +131,151 @@ void FDCtx::setTimeout(int type, uint64_t v) {
 
 uint64_t FDCtx::getTimeout(int type) {
 	if (type == SO_RCVTIMEO) return __recvTimeout;
-	else __sendTimeout;
+	else return __sendTimeout;
+}
+
+static int DeadlineDir(int type) {
+	return type == SO_RCVTIMEO ? 0 : 1;
+}
+
+uint64_t FDCtx::effectiveDeadline(int dir) const {
+	uint64_t deadline = __deadline[dir];
+	uint64_t idle = __idleTimeout.load(std::memory_order_relaxed);
+	if (idle) {
+		deadline = std::min(deadline, __lastActive.load(std::memory_order_relaxed) + idle);
+	}
+	return deadline;
+}
+
+void FDCtx::setDeadline(int type, uint64_t deadline_us) {
+	{
+		SpinLock::Lock lock(__deadlineMutex);
+		__deadline[DeadlineDir(type)] = deadline_us;
+	}
+	rearmWaiters();
+}
+
+uint64_t FDCtx::getDeadline(int type) {
+	SpinLock::Lock lock(__deadlineMutex);
+	return __deadline[DeadlineDir(type)];
+}
+
+void FDCtx::setIdleTimeout(uint64_t ms) {
+	{
+		SpinLock::Lock lock(__deadlineMutex);
+		__lastActive = Clock::NowUS();
+		__idleTimeout = ms * 1000;
+	}
+	rearmWaiters();
+}
+
+uint64_t FDCtx::getIdleTimeout() const {
+	return __idleTimeout.load(std::memory_order_relaxed) / 1000;
+}
+
+uint64_t FDCtx::getEffectiveDeadline(int type) {
+	SpinLock::Lock lock(__deadlineMutex);
+	return effectiveDeadline(DeadlineDir(type));
+}
+
+void FDCtx::rearmWaiters() {
+	IOManager* iom[2] = { nullptr, nullptr };
+	uint64_t deadline[2] = { ~0ull, ~0ull };
+	{
+		SpinLock::Lock lock(__deadlineMutex);
+		for (int i = 0; i < 2; ++i) {
+			iom[i] = __waitIom[i];
+			if (iom[i]) deadline[i] = effectiveDeadline(i);
+		}
+	}
+	// 定时器的锁先于 __deadlineMutex 获取，挂载必须在释放 __deadlineMutex 之后
+	for (int i = 0; i < 2; ++i) {
+		if (iom[i] && deadline[i] != ~0ull) {
+			iom[i]->armTimerNodeBefore(&__deadlineNode[i], deadline[i]);
+		}
+	}
+}
+
+void FDCtx::resetDeadlines() {
+	// 取消必须在获取 __deadlineMutex 之前，回调会获取 __deadlineMutex
+	for (auto& i : __deadlineNode) {
+		i.cancel();
+	}
+	SpinLock::Lock lock(__deadlineMutex);
+	__idleTimeout = 0;
+	__lastActive = 0;
+	for (int i = 0; i < 2; ++i) {
+		__deadline[i] = ~0ull;
+		__waitIom[i] = nullptr;
+		__timedOut[i] = false;
+	}
+}
+
+void FDCtx::beginWait(int type, IOManager* iom) {
+	int dir = DeadlineDir(type);
+	uint64_t deadline;
+	{
+		SpinLock::Lock lock(__deadlineMutex);
+		__waitIom[dir] = iom;
+		__timedOut[dir] = false;
+		deadline = effectiveDeadline(dir);
+	}
+	// 定时器已挂载在截止时间之前时什么都不做，连续的 EAGAIN 不会反复挂载/取消
+	if (deadline != ~0ull) {
+		iom->armTimerNodeBefore(&__deadlineNode[dir], deadline);
+	}
+}
+
+bool FDCtx::endWait(int type) {
+	int dir = DeadlineDir(type);
+	SpinLock::Lock lock(__deadlineMutex);
+	bool timed_out = __timedOut[dir];
+	__waitIom[dir] = nullptr;
+	__timedOut[dir] = false;
+	return timed_out;
+}
+
+void FDCtx::OnDeadline(TimerNode* node) {
+	DeadlineNode* deadline_node = static_cast<DeadlineNode*>(node);
+	FDCtx* ctx = deadline_node->ctx;
+	int dir = deadline_node->dir;
+	static const IOManager::Event events[2] = { IOManager::READ, IOManager::WRITE };
+
+	IOManager* iom = nullptr;
+	{
+		SpinLock::Lock lock(ctx->__deadlineMutex);
+		iom = ctx->__waitIom[dir];
+		if (!iom) return;
+		uint64_t deadline = ctx->effectiveDeadline(dir);
+		// 截止时间被推迟(例如空闲超时期间有读写)，顺延而不是重新挂载
+		if (deadline > Clock::NowUS()) {
+			if (deadline != ~0ull) {
+				node->deferTo(deadline);
+			}
+			return;
+		}
+		// 先记下超时：cancelEvent 唤醒的协程可能在另一个线程上立即执行 endWait
+		ctx->__waitIom[dir] = nullptr;
+		ctx->__timedOut[dir] = true;
+	}
+
+	// cancelEvent 要 epoll_ctl 并调度协程，不能在自旋锁内执行
+	if (!iom->cancelEvent(ctx->__fd, events[dir])) {
+		// 事件已经触发，协程会重试 IO，不算超时；协程已开始新的等待时不再改动
+		SpinLock::Lock lock(ctx->__deadlineMutex);
+		if (!ctx->__waitIom[dir]) {
+			ctx->__timedOut[dir] = false;
+		}
+	}
+}
+
+FDStats FDCtx::getStats() const {
+	FDStats stats;
+	stats.fd = __fd;
+	for (int i = 0; i < FDStats::METRIC_COUNT; ++i) {
+		stats.values[i] = __stats[i].load(std::memory_order_relaxed);
+	}
+	return stats;
 }
 
 //****************************************************************************
@@ -125,10 +307,48 @@ FDCtx_ptr FDManager::get(int fd, bool auto_create) {
 }
 
 void FDManager::del(int fd) {
-	RWMutexType::WriteLock lock(__mutex);
-	if ((int)__datas.size() > fd) {
-		__datas[fd].reset();
+	FDCtx_ptr ctx;
+	{
+		RWMutexType::WriteLock lock(__mutex);
+		if ((int)__datas.size() > fd) {
+			ctx.swap(__datas[fd]);
+		}
+	}
+	// 其他地方仍可能持有 ctx，截止时间不能留给之后复用该 fd 的连接
+	if (ctx) {
+		ctx->resetDeadlines();
+	}
+}
+
+std::vector<FDStats> FDManager::top(FDStats::Metric metric, size_t n) {
+	std::vector<FDStats> result;
+	{
+		RWMutexType::ReadLock lock(__mutex);
+		for (auto& i : __datas) {
+			if (i && !i->isClose()) {
+				result.push_back(i->getStats());
+			}
+		}
+	}
+	n = std::min(n, result.size());
+	std::partial_sort(result.begin(), result.begin() + n, result.end(),
+		[metric](const FDStats& a, const FDStats& b) {
+			return a.get(metric) > b.get(metric);
+		});
+	result.resize(n);
+	return result;
+}
+
+std::ostream& FDManager::dumpTop(std::ostream& os, FDStats::Metric metric, size_t n) {
+	std::vector<FDStats> stats = top(metric, n);
+	os << "[FDManager top " << stats.size() << " by " << FDStats::ToString(metric) << "]";
+	for (auto& i : stats) {
+		os << std::endl << "    fd=" << i.fd;
+		for (int j = 0; j < FDStats::METRIC_COUNT; ++j) {
+			os << " " << s_metric_names[j] << "=" << i.values[j];
+		}
 	}
+	return os;
 }
 
 
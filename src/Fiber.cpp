@@ -9,11 +9,11 @@ namespace sylar
 {
 
 //****************************************************************************
-// Э̿ڲ
+// 协程库所需内部变量
 //****************************************************************************
 
-static std::atomic<uint64_t> s_fiber_id{ 0 };       // ǰЭid
-static std::atomic<uint64_t> s_fiber_count{ 0 };    // ǰЭ
+static std::atomic<uint64_t> s_fiber_id{ 0 };       // 当前最新协程id
+static std::atomic<uint64_t> s_fiber_count{ 0 };    // 当前协程数量
 
 static thread_local Fiber* t_fiber = nullptr;
 static thread_local Fiber_ptr t_threadFiber = nullptr;
@@ -21,8 +21,11 @@ static thread_local Fiber_ptr t_threadFiber = nullptr;
 static ConfigVar_ptr<uint32_t> g_fiber_stack_size =
     Config::Lookup<uint32_t>("fiber.stack_size", 128 * 1024, "fiber stack size");
 
+// 每次创建协程都要读栈大小，线程局部缓存只在配置变化后重新读取
+static thread_local ConfigVarCache<uint32_t> t_fiber_stack_size(g_fiber_stack_size);
+
 //****************************************************************************
-// Զջڴ
+// 自定义栈内存分配器
 //****************************************************************************
 
 class MallocStackAllocator {
@@ -145,22 +148,22 @@ void Fiber::CallerMainFunc() {
 
 Fiber::Fiber(){
     __state = FiberState::EXEC;
-    SetThis(this); // õǰ̵߳ЭΪЭ
+    SetThis(this); // 设置当前线程的运行协程为本协程
 
     if (getcontext(&__ucontext)) SYLAR_ASSERT2(false, "getcontext");
 
-    ++s_fiber_count; // Э
+    ++s_fiber_count; // 增加协程数量
     SYLAR_LOG_DEBUG(SYLAR_LOG_ROOT()) << "Fiber::Fiber() main";
 }
 
 Fiber::Fiber(std::function<void()> cb, std::size_t stacksize, bool use_caller) 
     : __id(++s_fiber_id), __cb(cb)
 {
-    ++s_fiber_count; // Э
-    __stack_size = stacksize ? stacksize : g_fiber_stack_size->getValue(); // ȷЭջռС
-    __stack = StackAllocator::Alloc(__stack_size); // Эջռ
+    ++s_fiber_count; // 更新协程数量
+    __stack_size = stacksize ? stacksize : t_fiber_stack_size.get(); // 确定协程栈空间大小
+    __stack = StackAllocator::Alloc(__stack_size); // 分配协程栈空间
     if (getcontext(&__ucontext)) SYLAR_ASSERT2(false, "getcontext");
-    // ЭϢ
+    // 更新协程信息
     __ucontext.uc_link = nullptr;
     __ucontext.uc_stack.ss_sp = __stack;
     __ucontext.uc_stack.ss_size = __stack_size;
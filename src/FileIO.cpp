@@ -0,0 +1,207 @@
+#include "FileIO.h"
+#include "Thread.h"
+#include "Fiber.h"
+#include "Scheduler.h"
+#include "Config.h"
+#include "Clock.h"
+#include "Log.h"
+#include "Macro.h"
+#include <sys/stat.h>
+#include <errno.h>
+
+namespace sylar
+{
+
+static ConfigVar_ptr<bool> g_fileio_offload =
+    Config::Lookup("fileio.offload", false, "run hooked regular file io on background threads");
+
+static ConfigVar_ptr<uint32_t> g_fileio_threads =
+    Config::Lookup("fileio.threads", (uint32_t)4, "file io thread count");
+
+static ConfigVar_ptr<uint32_t> g_fileio_device_concurrency =
+    Config::Lookup("fileio.device_concurrency", (uint32_t)2, "max concurrent file io requests per device");
+
+static std::atomic<bool> s_fileio_offload = { false };
+static std::atomic<uint32_t> s_device_concurrency = { 2 };
+
+static thread_local int t_inline_depth = 0;
+
+struct _FileIOIniter {
+    _FileIOIniter() {
+        s_fileio_offload = g_fileio_offload->getValue();
+        s_device_concurrency = g_fileio_device_concurrency->getValue();
+
+        g_fileio_offload->addListener([](const bool& old_value, const bool& new_value) {
+            s_fileio_offload = new_value;
+        });
+        g_fileio_device_concurrency->addListener([](const uint32_t& old_value, const uint32_t& new_value) {
+            s_device_concurrency = new_value;
+        });
+    }
+};
+
+static _FileIOIniter s_fileio_initer;
+
+//****************************************************************************
+// FileIOPool::InlineGuard
+//****************************************************************************
+
+FileIOPool::InlineGuard::InlineGuard() {
+    ++t_inline_depth;
+}
+
+FileIOPool::InlineGuard::~InlineGuard() {
+    --t_inline_depth;
+}
+
+//****************************************************************************
+// FileIOPool
+//****************************************************************************
+
+FileIOPool::FileIOPool() {}
+
+FileIOPool::~FileIOPool() {
+    {
+        MutexType::Lock lock(__mutex);
+        __stopping = true;
+    }
+    for (size_t i = 0; i < __threads.size(); ++i) {
+        __semaphore.notify();
+    }
+    for (auto& i : __threads) {
+        i->join();
+    }
+}
+
+bool FileIOPool::IsEnabled() {
+    return s_fileio_offload.load(std::memory_order_relaxed);
+}
+
+bool FileIOPool::CanOffload() {
+    if (!IsEnabled() || t_inline_depth > 0 || !Scheduler::GetThis()) {
+        return false;
+    }
+    // 调度协程自身不能让出
+    return Fiber::GetThis().get() != Scheduler::GetMainFiber();
+}
+
+void FileIOPool::start() {
+    uint32_t count = g_fileio_threads->getValue();
+    if (count == 0) {
+        count = 1;
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+        __threads.emplace_back(std::make_shared<Thread>(
+            std::bind(&FileIOPool::run, this), "fileio_" + std::to_string(i)));
+    }
+}
+
+FileIOPool::Job* FileIOPool::take() {
+    uint32_t limit = s_device_concurrency.load(std::memory_order_relaxed);
+    for (auto it = __jobs.begin(); it != __jobs.end(); ++it) {
+        uint32_t& running = __running[(*it)->dev];
+        if (limit && running >= limit) {
+            continue;
+        }
+        ++running;
+        Job* job = *it;
+        __jobs.erase(it);
+        return job;
+    }
+    return nullptr;
+}
+
+void FileIOPool::run() {
+    while (true) {
+        __semaphore.wait();
+        Job* job = nullptr;
+        {
+            MutexType::Lock lock(__mutex);
+            if (__stopping && __jobs.empty()) {
+                return;
+            }
+            job = take();
+        }
+        // 队列中的请求所在设备都已满，等正在执行的请求完成后再被唤醒
+        if (!job) {
+            continue;
+        }
+
+        __waitUS += Clock::NowUS() - job->queuedUS;
+        job->result = (*job->fun)();
+        job->err = errno;
+
+        dev_t dev = job->dev;
+        Scheduler* scheduler = job->scheduler;
+        Fiber_ptr fiber = std::move(job->fiber);
+        bool more = false;
+        {
+            MutexType::Lock lock(__mutex);
+            auto it = __running.find(dev);
+            if (--it->second == 0) {
+                __running.erase(it);
+            }
+            more = !__jobs.empty();
+        }
+        // 该设备空出一个名额，让其他线程重新检查被限流的请求
+        if (more) {
+            __semaphore.notify();
+        }
+        // 协程恢复后 job 随其栈帧失效，之后不能再访问
+        scheduler->schedule(fiber);
+        scheduler->delExternalWaiter();
+    }
+}
+
+ssize_t FileIOPool::execute(int fd, const std::function<ssize_t()>& fun) {
+    struct stat st;
+    if (!CanOffload() || fstat(fd, &st) != 0 || !(S_ISREG(st.st_mode) || S_ISBLK(st.st_mode))) {
+        ++__inlined;
+        return fun();
+    }
+
+    Job job;
+    job.fun = &fun;
+    job.dev = S_ISBLK(st.st_mode) ? st.st_rdev : st.st_dev;
+    job.queuedUS = Clock::NowUS();
+    job.scheduler = Scheduler::GetThis();
+    job.fiber = Fiber::GetThis();
+    {
+        MutexType::Lock lock(__mutex);
+        if (__stopping) {
+            lock.unlock();
+            ++__inlined;
+            return fun();
+        }
+        if (__threads.empty()) {
+            start();
+        }
+        uint32_t limit = s_device_concurrency.load(std::memory_order_relaxed);
+        auto it = __running.find(job.dev);
+        if (limit && it != __running.end() && it->second >= limit) {
+            ++__throttled;
+        }
+        job.scheduler->addExternalWaiter();
+        __jobs.push_back(&job);
+    }
+    ++__submitted;
+    __semaphore.notify();
+    Fiber::YieldToHold();
+
+    errno = job.err;
+    return job.result;
+}
+
+std::ostream& FileIOPool::dump(std::ostream& os) {
+    MutexType::Lock lock(__mutex);
+    os << "[FileIOPool threads=" << __threads.size()
+       << " queued=" << __jobs.size()
+       << " submitted=" << __submitted
+       << " inlined=" << __inlined
+       << " throttled=" << __throttled
+       << " wait_us=" << __waitUS
+       << "]";
+    return os;
+}
+
+}; /* sylar */
@@ -5,11 +5,18 @@
 #include "Fiber.h"
 #include "IOManager.h"
 #include "FDManager.h"
+#include "FileIO.h"
+#include "Clock.h"
 #include <dlfcn.h>
 #include <fcntl.h>
 #include <sys/socket.h>
 #include <sys/ioctl.h>
+#include <sys/sendfile.h>
 #include <stdarg.h>
+#include <type_traits>
+#include <algorithm>
+#include <atomic>
+#include <vector>
 
 namespace sylar
 {
@@ -23,15 +30,24 @@ namespace sylar
     XX(accept) \
     XX(read) \
     XX(readv) \
+    XX(pread) \
     XX(recv) \
     XX(recvfrom) \
     XX(recvmsg) \
     XX(write) \
     XX(writev) \
+    XX(pwrite) \
     XX(send) \
     XX(sendto) \
     XX(sendmsg) \
+    XX(sendfile) \
+    XX(splice) \
     XX(close) \
+    XX(fsync) \
+    XX(poll) \
+    XX(ppoll) \
+    XX(select) \
+    XX(epoll_wait) \
     XX(fcntl) \
     XX(ioctl) \
     XX(getsockopt) \
@@ -40,6 +56,9 @@ namespace sylar
 static ConfigVar_ptr<int> g_tcp_connect_timeout =
 	Config::Lookup("tcp.connect.timeout", 5000, "tcp connect timeout");
 
+static ConfigVar_ptr<int> g_tcp_timeout_slack =
+	Config::Lookup("tcp.timeout.slack", 0, "tcp io timeout slack ms");
+
 static thread_local bool t_hook_enable = false;
 
 void hook_init() {
@@ -53,10 +72,12 @@ void hook_init() {
 }
 
 static uint64_t s_connect_timeout = -1;
+static uint64_t s_timeout_slack_us = 0;
 struct _HookIniter {
     _HookIniter() {
         hook_init();
         s_connect_timeout = g_tcp_connect_timeout->getValue();
+        s_timeout_slack_us = g_tcp_timeout_slack->getValue() * 1000ull;
 
         g_tcp_connect_timeout->addListener([](const int& old_value, const int& new_value) {
             SYLAR_LOG_INFO(SYLAR_LOG_ROOT()) 
@@ -64,6 +85,13 @@ struct _HookIniter {
                 << old_value << " to " << new_value;
             s_connect_timeout = new_value;
         });
+
+        g_tcp_timeout_slack->addListener([](const int& old_value, const int& new_value) {
+            SYLAR_LOG_INFO(SYLAR_LOG_ROOT()) 
+                << "tcp timeout slack changed from "
+                << old_value << " to " << new_value;
+            s_timeout_slack_us = new_value * 1000ull;
+        });
     }
 };
 
@@ -79,11 +107,42 @@ void set_hook_enable(bool flag) {
 
 }; /* sylar */
 
-struct timer_info {
+using namespace sylar;
+
+/*!
+ * @brief hook IO 的超时信息，直接嵌入 do_io / connect_with_timeout 的栈帧
+ */
+struct timer_info : public TimerNode {
     int cancelled = 0;
+    int fd = -1;
+    uint32_t event = IOManager::NONE;
+    IOManager* iom = nullptr;
+
+    timer_info(int fd_, uint32_t event_)
+        : TimerNode(&timer_info::OnTimeout), fd(fd_), event(event_) {}
+
+    static void OnTimeout(TimerNode* node) {
+        timer_info* t = static_cast<timer_info*>(node);
+        if (t->cancelled) {
+            return;
+        }
+        t->cancelled = ETIMEDOUT;
+        t->iom->cancelEvent(t->fd, (IOManager::Event)(t->event));
+    }
 };
 
-using namespace sylar;
+/*!
+ * @brief 非 socket 的 IO，开启 fileio.offload 时普通文件交给 FileIOPool 执行
+ */
+template<typename OriginFun, typename... Args>
+static ssize_t do_file_io(int fd, OriginFun fun, Args&&... args) {
+    if (!FileIOPool::CanOffload()) {
+        return fun(fd, std::forward<Args>(args)...);
+    }
+    return FileIOPool_single::GetInstance()->execute(fd, [&]() -> ssize_t {
+        return fun(fd, std::forward<Args>(args)...);
+    });
+}
 
 template<typename OriginFun, typename... Args>
 static ssize_t do_io(int fd, OriginFun fun, const char* hook_fun_name,
@@ -94,7 +153,7 @@ static ssize_t do_io(int fd, OriginFun fun, const char* hook_fun_name,
 
     FDCtx_ptr ctx = FDManager_single::GetInstance()->get(fd);
     if (!ctx) {
-        return fun(fd, std::forward<Args>(args)...);
+        return do_file_io(fd, fun, std::forward<Args>(args)...);
     }
 
     if (ctx->isClose()) {
@@ -102,59 +161,212 @@ static ssize_t do_io(int fd, OriginFun fun, const char* hook_fun_name,
         return -1;
     }
 
-    if (!ctx->isSocket() || ctx->getUserNonblock()) {
+    if (!ctx->isSocket()) {
+        return do_file_io(fd, fun, std::forward<Args>(args)...);
+    }
+
+    if (ctx->getUserNonblock()) {
         return fun(fd, std::forward<Args>(args)...);
     }
 
     uint64_t to = ctx->getTimeout(timeout_so);
-    std::shared_ptr<timer_info> tinfo(new timer_info);
+    timer_info tinfo(fd, event);
 
 retry:
     ssize_t n = fun(fd, std::forward<Args>(args)...);
+    ctx->addStat(FDStats::SYSCALLS, 1);
     while (n == -1 && errno == EINTR) {
         n = fun(fd, std::forward<Args>(args)...);
+        ctx->addStat(FDStats::SYSCALLS, 1);
     }
     if (n == -1 && errno == EAGAIN) {
+        ctx->addStat(FDStats::EAGAINS, 1);
         IOManager* iom = IOManager::GetThis();
-        Timer_ptr timer;
-        std::weak_ptr<timer_info> winfo(tinfo);
+
+        // 连接级截止时间优先于每次调用的超时，由 FDCtx 上常驻的定时器负责
+        uint64_t deadline = ctx->getEffectiveDeadline(timeout_so);
+        if (deadline != ~0ull) {
+            if (Clock::NowUS() >= deadline) {
+                ctx->addStat(FDStats::TIMEOUTS, 1);
+                errno = ETIMEDOUT;
+                return -1;
+            }
+            int rt = iom->addEvent(fd, (IOManager::Event)(event));
+            if (SYLAR_UNLIKELY(rt)) {
+                SYLAR_LOG_ERROR(SYLAR_LOG_ROOT()) << hook_fun_name << " addEvent("
+                    << fd << ", " << event << ")";
+                return -1;
+            }
+            ctx->beginWait(timeout_so, iom);
+            uint64_t begin = Clock::NowUS();
+            Fiber::YieldToHold();
+            ctx->addStat(FDStats::SUSPEND_US, Clock::NowUS() - begin);
+            if (ctx->endWait(timeout_so)) {
+                ctx->addStat(FDStats::TIMEOUTS, 1);
+                errno = ETIMEDOUT;
+                return -1;
+            }
+            goto retry;
+        }
+
+        tinfo.iom = iom;
 
         if (to != (uint64_t)-1) {
-            timer = iom->addConditionTimer(to, [winfo, fd, iom, event]() {
-                auto t = winfo.lock();
-                if (!t || t->cancelled) {
-                    return;
-                }
-                t->cancelled = ETIMEDOUT;
-                iom->cancelEvent(fd, (IOManager::Event)(event));
-            }, winfo);
+            iom->addTimerNodeUS(&tinfo, to * 1000, s_timeout_slack_us);
         }
 
         int rt = iom->addEvent(fd, (IOManager::Event)(event));
         if (SYLAR_UNLIKELY(rt)) {
             SYLAR_LOG_ERROR(SYLAR_LOG_ROOT()) << hook_fun_name << " addEvent("
                 << fd << ", " << event << ")";
-            if (timer) {
-                timer->cancel();
-            }
+            tinfo.cancel();
             return -1;
         }
         else {
+            uint64_t begin = Clock::NowUS();
             Fiber::YieldToHold();
-            if (timer) {
-                timer->cancel();
-            }
-            if (tinfo->cancelled) {
-                errno = tinfo->cancelled;
+            ctx->addStat(FDStats::SUSPEND_US, Clock::NowUS() - begin);
+            tinfo.cancel();
+            if (tinfo.cancelled) {
+                if (tinfo.cancelled == ETIMEDOUT) {
+                    ctx->addStat(FDStats::TIMEOUTS, 1);
+                }
+                errno = tinfo.cancelled;
                 return -1;
             }
             goto retry;
         }
     }
 
+    // accept 返回的是新的 fd，不计入字节数
+    if (n > 0 && !std::is_same<OriginFun, accept_fun>::value) {
+        ctx->addStat(event == IOManager::READ ? FDStats::BYTES_READ : FDStats::BYTES_WRITTEN, n);
+    }
+    if (n >= 0) {
+        ctx->touch();
+    }
     return n;
 }
 
+/*!
+ * @brief poll 类 hook 在一次等待中注册的回调共享的状态，首个就绪的事件或定时器唤醒协程
+ */
+struct poll_waiter {
+    std::atomic<bool> done = { false };
+    IOManager* iom = nullptr;
+    Fiber_ptr fiber;
+
+    void wake() {
+        if (!done.exchange(true)) {
+            iom->schedule(fiber);
+        }
+    }
+};
+
+/*!
+ * @brief poll/ppoll/select/epoll_wait 的协程实现
+ * @details 先用超时 0 检查一次，未就绪时把关注的 fd 注册到当前 IOManager 并让出协程，
+ *          被唤醒后再用超时 0 的 poll 计算 revents。fd 的事件已被其他协程占用或无法
+ *          加入 epoll 时退回阻塞的 poll
+ */
+static int do_poll(struct pollfd* fds, nfds_t nfds, int timeout_ms) {
+    int rt = poll_f(fds, nfds, 0);
+    if (rt != 0 || timeout_ms == 0) {
+        return rt;
+    }
+
+    IOManager* iom = IOManager::GetThis();
+    if (!iom || Fiber::GetThis().get() == Scheduler::GetMainFiber()) {
+        return poll_f(fds, nfds, timeout_ms);
+    }
+
+    // 合并同一 fd 的关注事件，错误与挂断总会随 READ/WRITE 一起上报
+    std::vector<std::pair<int, uint32_t>> interests;
+    interests.reserve(nfds);
+    for (nfds_t i = 0; i < nfds; ++i) {
+        if (fds[i].fd < 0) {
+            continue;
+        }
+        uint32_t event = IOManager::NONE;
+        if (fds[i].events & (POLLIN | POLLRDHUP)) {
+            event |= IOManager::READ;
+        }
+        if (fds[i].events & POLLOUT) {
+            event |= IOManager::WRITE;
+        }
+        // 带外数据不会让 fd 可读，必须单独关注 EPOLLPRI
+        if (fds[i].events & POLLPRI) {
+            event |= IOManager::PRI;
+        }
+        interests.emplace_back(fds[i].fd, event ? event : (uint32_t)IOManager::READ);
+    }
+    std::sort(interests.begin(), interests.end());
+    size_t n = 0;
+    for (size_t i = 0; i < interests.size(); ++i) {
+        if (n && interests[n - 1].first == interests[i].first) {
+            interests[n - 1].second |= interests[i].second;
+        }
+        else {
+            interests[n++] = interests[i];
+        }
+    }
+    interests.resize(n);
+
+    uint64_t deadline = timeout_ms < 0 ? ~0ull : Clock::NowMS() + timeout_ms;
+    while (true) {
+        auto waiter = std::make_shared<poll_waiter>();
+        waiter->iom = iom;
+        waiter->fiber = Fiber::GetThis();
+        std::function<void()> cb = std::bind(&poll_waiter::wake, waiter);
+
+        // IOManager 的事件按 READ、WRITE、PRI 分别注册
+        std::vector<std::pair<int, IOManager::Event>> added;
+        bool fallback = false;
+        for (size_t i = 0; i < interests.size() && !fallback; ++i) {
+            for (uint32_t event : { (uint32_t)IOManager::READ, (uint32_t)IOManager::WRITE,
+                                    (uint32_t)IOManager::PRI }) {
+                if (!(interests[i].second & event)) {
+                    continue;
+                }
+                if (iom->tryAddEvent(interests[i].first, (IOManager::Event)event, cb, waiter.get())) {
+                    fallback = true;
+                    break;
+                }
+                added.emplace_back(interests[i].first, (IOManager::Event)event);
+            }
+        }
+
+        Timer_ptr timer;
+        if (!fallback && deadline != ~0ull) {
+            uint64_t now = Clock::NowMS();
+            timer = iom->addTimer(deadline > now ? deadline - now : 0, cb);
+        }
+        // 退回阻塞 poll 前，已注册的事件可能已经调度了本协程，先让出一次把它消费掉
+        if (!fallback || waiter->done.exchange(true)) {
+            Fiber::YieldToHold();
+        }
+
+        // 已触发的事件可能已被其他协程重新注册，只删除本次等待自己的注册
+        for (auto& i : added) {
+            iom->delEventIf(i.first, i.second, waiter.get());
+        }
+        if (timer) {
+            timer->cancel();
+        }
+
+        uint64_t now = Clock::NowMS();
+        int remain = deadline == ~0ull ? -1 : (deadline > now ? (int)(deadline - now) : 0);
+        if (fallback) {
+            return poll_f(fds, nfds, remain);
+        }
+        rt = poll_f(fds, nfds, 0);
+        if (rt != 0 || remain == 0) {
+            return rt;
+        }
+        // 就绪的数据已被别人取走，继续等待剩余时间
+    }
+}
+
 extern "C" {
 #define XX(name) name ## _fun name ## _f = nullptr;
     HOOK_FUN(XX);
@@ -167,9 +379,9 @@ extern "C" {
 
         Fiber_ptr fiber = Fiber::GetThis();
         IOManager* iom = IOManager::GetThis();
-        iom->addTimer(seconds * 1000, std::bind((void(Scheduler::*)
-                                                 (Fiber_ptr, int thread)) & IOManager::schedule
-                                                , iom, fiber, -1));
+        iom->addTimerUS(seconds * 1000000ull, std::bind((void(Scheduler::*)
+                                                         (Fiber_ptr, int thread)) & IOManager::schedule
+                                                        , iom, fiber, -1));
         Fiber::YieldToHold();
         return 0;
     }
@@ -180,9 +392,9 @@ extern "C" {
         }
         Fiber_ptr fiber = Fiber::GetThis();
         IOManager* iom = IOManager::GetThis();
-        iom->addTimer(usec / 1000, std::bind((void(Scheduler::*)
-                                              (Fiber_ptr, int thread)) & IOManager::schedule
-                                             , iom, fiber, -1));
+        iom->addTimerUS(usec, std::bind((void(Scheduler::*)
+                                         (Fiber_ptr, int thread)) & IOManager::schedule
+                                        , iom, fiber, -1));
         Fiber::YieldToHold();
         return 0;
     }
@@ -192,12 +404,17 @@ extern "C" {
             return nanosleep_f(req, rem);
         }
 
-        int timeout_ms = req->tv_sec * 1000 + req->tv_nsec / 1000 / 1000;
+        if (!req || req->tv_sec < 0 || req->tv_nsec < 0 || req->tv_nsec >= 1000000000) {
+            errno = EINVAL;
+            return -1;
+        }
+        // 不足 1 微秒的部分向上取整，保证休眠时间不少于请求的时间
+        uint64_t timeout_us = req->tv_sec * 1000000ull + (req->tv_nsec + 999) / 1000;
         Fiber_ptr fiber = Fiber::GetThis();
         IOManager* iom = IOManager::GetThis();
-        iom->addTimer(timeout_ms, std::bind((void(Scheduler::*)
-                                             (Fiber_ptr, int thread)) & IOManager::schedule
-                                            , iom, fiber, -1));
+        iom->addTimerUS(timeout_us, std::bind((void(Scheduler::*)
+                                               (Fiber_ptr, int thread)) & IOManager::schedule
+                                              , iom, fiber, -1));
         Fiber::YieldToHold();
         return 0;
     }
@@ -233,6 +450,7 @@ extern "C" {
         }
 
         int n = connect_f(fd, addr, addrlen);
+        ctx->addStat(FDStats::SYSCALLS, 1);
         if (n == 0) {
             return 0;
         }
@@ -241,36 +459,29 @@ extern "C" {
         }
 
         IOManager* iom = IOManager::GetThis();
-        Timer_ptr timer;
-        std::shared_ptr<timer_info> tinfo(new timer_info);
-        std::weak_ptr<timer_info> winfo(tinfo);
+        timer_info tinfo(fd, IOManager::WRITE);
+        tinfo.iom = iom;
 
         if (timeout_ms != (uint64_t)-1) {
-            timer = iom->addConditionTimer(timeout_ms, [winfo, fd, iom]() {
-                auto t = winfo.lock();
-                if (!t || t->cancelled) {
-                    return;
-                }
-                t->cancelled = ETIMEDOUT;
-                iom->cancelEvent(fd, IOManager::WRITE);
-            }, winfo);
+            iom->addTimerNodeUS(&tinfo, timeout_ms * 1000, s_timeout_slack_us);
         }
 
         int rt = iom->addEvent(fd, IOManager::WRITE);
         if (rt == 0) {
+            uint64_t begin = Clock::NowUS();
             Fiber::YieldToHold();
-            if (timer) {
-                timer->cancel();
-            }
-            if (tinfo->cancelled) {
-                errno = tinfo->cancelled;
+            ctx->addStat(FDStats::SUSPEND_US, Clock::NowUS() - begin);
+            tinfo.cancel();
+            if (tinfo.cancelled) {
+                if (tinfo.cancelled == ETIMEDOUT) {
+                    ctx->addStat(FDStats::TIMEOUTS, 1);
+                }
+                errno = tinfo.cancelled;
                 return -1;
             }
         }
         else {
-            if (timer) {
-                timer->cancel();
-            }
+            tinfo.cancel();
             SYLAR_LOG_ERROR(SYLAR_LOG_ROOT()) << "connect addEvent(" << fd << ", WRITE) error";
         }
 
@@ -308,6 +519,13 @@ extern "C" {
         return do_io(fd, readv_f, "readv", IOManager::READ, SO_RCVTIMEO, iov, iovcnt);
     }
 
+    ssize_t pread(int fd, void* buf, size_t count, off_t offset) {
+        if (!t_hook_enable) {
+            return pread_f(fd, buf, count, offset);
+        }
+        return do_file_io(fd, pread_f, buf, count, offset);
+    }
+
     ssize_t recv(int sockfd, void* buf, size_t len, int flags) {
         return do_io(sockfd, recv_f, "recv", IOManager::READ, SO_RCVTIMEO, buf, len, flags);
     }
@@ -328,6 +546,13 @@ extern "C" {
         return do_io(fd, writev_f, "writev", IOManager::WRITE, SO_SNDTIMEO, iov, iovcnt);
     }
 
+    ssize_t pwrite(int fd, const void* buf, size_t count, off_t offset) {
+        if (!t_hook_enable) {
+            return pwrite_f(fd, buf, count, offset);
+        }
+        return do_file_io(fd, pwrite_f, buf, count, offset);
+    }
+
     ssize_t send(int s, const void* msg, size_t len, int flags) {
         return do_io(s, send_f, "send", IOManager::WRITE, SO_SNDTIMEO, msg, len, flags);
     }
@@ -340,6 +565,30 @@ extern "C" {
         return do_io(s, sendmsg_f, "sendmsg", IOManager::WRITE, SO_SNDTIMEO, msg, flags);
     }
 
+    ssize_t sendfile(int out_fd, int in_fd, off_t* offset, size_t count) {
+        return do_io(out_fd, sendfile_f, "sendfile", IOManager::WRITE, SO_SNDTIMEO, in_fd, offset, count);
+    }
+
+    ssize_t splice(int fd_in, loff_t* off_in, int fd_out, loff_t* off_out, size_t len, unsigned int flags) {
+        if (!t_hook_enable) {
+            return splice_f(fd_in, off_in, fd_out, off_out, len, flags);
+        }
+        // splice 的两端必有一个是管道，按 socket 所在的一端等待事件
+        FDCtx_ptr ctx = FDManager_single::GetInstance()->get(fd_out);
+        if (ctx && ctx->isSocket()) {
+            return do_io(fd_out, [=](int fd) {
+                return splice_f(fd_in, off_in, fd, off_out, len, flags);
+            }, "splice", IOManager::WRITE, SO_SNDTIMEO);
+        }
+        ctx = FDManager_single::GetInstance()->get(fd_in);
+        if (ctx && ctx->isSocket()) {
+            return do_io(fd_in, [=](int fd) {
+                return splice_f(fd, off_in, fd_out, off_out, len, flags);
+            }, "splice", IOManager::READ, SO_RCVTIMEO);
+        }
+        return splice_f(fd_in, off_in, fd_out, off_out, len, flags);
+    }
+
     int close(int fd) {
         if (!t_hook_enable) {
             return close_f(fd);
@@ -356,6 +605,120 @@ extern "C" {
         return close_f(fd);
     }
 
+    int fsync(int fd) {
+        if (!t_hook_enable) {
+            return fsync_f(fd);
+        }
+        return (int)do_file_io(fd, fsync_f);
+    }
+
+    int poll(struct pollfd* fds, nfds_t nfds, int timeout) {
+        if (!t_hook_enable) {
+            return poll_f(fds, nfds, timeout);
+        }
+        return do_poll(fds, nfds, timeout);
+    }
+
+    int ppoll(struct pollfd* fds, nfds_t nfds, const struct timespec* tmo_p, const sigset_t* sigmask) {
+        // 协程无法原子地切换信号掩码，带 sigmask 时直接调用
+        if (!t_hook_enable || sigmask) {
+            return ppoll_f(fds, nfds, tmo_p, sigmask);
+        }
+        int timeout = -1;
+        if (tmo_p) {
+            timeout = tmo_p->tv_sec * 1000 + (tmo_p->tv_nsec + 999999) / 1000000;
+        }
+        return do_poll(fds, nfds, timeout);
+    }
+
+    int select(int nfds, fd_set* readfds, fd_set* writefds, fd_set* exceptfds, struct timeval* timeout) {
+        if (!t_hook_enable) {
+            return select_f(nfds, readfds, writefds, exceptfds, timeout);
+        }
+
+        std::vector<struct pollfd> pfds;
+        for (int fd = 0; fd < nfds; ++fd) {
+            short events = 0;
+            if (readfds && FD_ISSET(fd, readfds)) events |= POLLIN;
+            if (writefds && FD_ISSET(fd, writefds)) events |= POLLOUT;
+            if (exceptfds && FD_ISSET(fd, exceptfds)) events |= POLLPRI;
+            if (events) {
+                pfds.push_back({ fd, events, 0 });
+            }
+        }
+
+        int timeout_ms = -1;
+        uint64_t begin = Clock::NowUS();
+        if (timeout) {
+            timeout_ms = timeout->tv_sec * 1000 + (timeout->tv_usec + 999) / 1000;
+        }
+        int rt = do_poll(pfds.data(), pfds.size(), timeout_ms);
+        if (rt < 0) {
+            return rt;
+        }
+
+        // 与 select 一致，有无效 fd 时返回 EBADF，调用方的集合保持不变
+        for (auto& i : pfds) {
+            if (i.revents & POLLNVAL) {
+                errno = EBADF;
+                return -1;
+            }
+        }
+
+        if (readfds) FD_ZERO(readfds);
+        if (writefds) FD_ZERO(writefds);
+        if (exceptfds) FD_ZERO(exceptfds);
+        int count = 0;
+        for (auto& i : pfds) {
+            if ((i.events & POLLIN) && (i.revents & (POLLIN | POLLHUP | POLLERR))) {
+                FD_SET(i.fd, readfds);
+                ++count;
+            }
+            if ((i.events & POLLOUT) && (i.revents & (POLLOUT | POLLERR))) {
+                FD_SET(i.fd, writefds);
+                ++count;
+            }
+            if ((i.events & POLLPRI) && (i.revents & POLLPRI)) {
+                FD_SET(i.fd, exceptfds);
+                ++count;
+            }
+        }
+
+        // 与 Linux 一致，返回时 timeout 为剩余时间
+        if (timeout) {
+            uint64_t total = timeout->tv_sec * 1000000ull + timeout->tv_usec;
+            uint64_t used = Clock::NowUS() - begin;
+            uint64_t remain = total > used ? total - used : 0;
+            timeout->tv_sec = remain / 1000000;
+            timeout->tv_usec = remain % 1000000;
+        }
+        return count;
+    }
+
+    int epoll_wait(int epfd, struct epoll_event* events, int maxevents, int timeout) {
+        if (!t_hook_enable) {
+            return epoll_wait_f(epfd, events, maxevents, timeout);
+        }
+        // 嵌套的 epoll 句柄在有事件就绪时可读
+        uint64_t deadline = timeout < 0 ? ~0ull : Clock::NowMS() + timeout;
+        while (true) {
+            int rt = epoll_wait_f(epfd, events, maxevents, 0);
+            if (rt != 0) {
+                return rt;
+            }
+            uint64_t now = Clock::NowMS();
+            int remain = deadline == ~0ull ? -1 : (deadline > now ? (int)(deadline - now) : 0);
+            if (remain == 0) {
+                return 0;
+            }
+            struct pollfd pfd = { epfd, POLLIN, 0 };
+            rt = do_poll(&pfd, 1, remain);
+            if (rt <= 0) {
+                return rt;
+            }
+        }
+    }
+
     int fcntl(int fd, int cmd, ... /* arg */) {
         va_list va;
         va_start(va, cmd);
@@ -5,7 +5,7 @@ namespace sylar::http
 {
 
 //****************************************************************************
-// HTTP״̬غ
+// HTTP方法与状态相关函数
 //****************************************************************************
 
 HttpMethod StringToHttpMethod(const std::string& m) {
@@ -491,7 +491,7 @@ void HttpResponse::setCookie(const std::string& key, const std::string& val,
 }
 
 //****************************************************************************
-// ʽ
+// 流式输出
 //****************************************************************************
 
 std::ostream& operator<<(std::ostream& os, const HttpRequest& req) {
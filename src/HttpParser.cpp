@@ -7,7 +7,7 @@ namespace sylar::http
 {
 
 //****************************************************************************
-// 
+// 杂项
 //****************************************************************************
 
 static sylar::ConfigVar_ptr<uint64_t> g_http_request_buffer_size =
@@ -155,9 +155,9 @@ HttpRequestParser::HttpRequestParser()
     __parser.data = this;
 }
 
-//1: ɹ
-//-1: д
-//>0: ѴֽdataЧΪlen - v;
+//1: 成功
+//-1: 有错误
+//>0: 已处理的字节数，且data有效数据为len - v;
 size_t HttpRequestParser::execute(char* data, size_t len) {
     size_t offset = http_parser_execute(&__parser, data, len, 0);
     memmove(data, data + offset, (len - offset));
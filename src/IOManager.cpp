@@ -1,19 +1,51 @@
 #include "IOManager.h"
 #include "Macro.h"
 #include "Log.h"
+#include "Clock.h"
+#include "Config.h"
+#include "Util.h"
+#include "Hook.h"
 #include <stdexcept>
+#include <algorithm>
 #include <sys/epoll.h>
 #include <ostream>
 #include <string.h>
-#include <fcntl.h>
+#include <sys/timerfd.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
 
 namespace sylar
 {
 
 //****************************************************************************
-// 
+// 杂项
 //****************************************************************************
 
+static ConfigVar_ptr<uint32_t> g_iomanager_max_events =
+    Config::Lookup<uint32_t>("iomanager.max_events", 256, "epoll_wait max events per wakeup");
+
+static ConfigVar_ptr<uint32_t> g_iomanager_spin_us =
+    Config::Lookup<uint32_t>("iomanager.spin_us", 0, "max busy-poll us before idle threads park, 0 disables");
+
+static std::atomic<uint64_t> s_spin_max_us = { 0 };
+struct _IOManagerIniter {
+    _IOManagerIniter() {
+        s_spin_max_us = g_iomanager_spin_us->getValue();
+        g_iomanager_spin_us->addListener([](const uint32_t& old_value, const uint32_t& new_value) {
+            SYLAR_LOG_INFO(SYLAR_LOG_ROOT())
+                << "iomanager spin us changed from "
+                << old_value << " to " << new_value;
+            s_spin_max_us = new_value;
+        });
+    }
+};
+
+static _IOManagerIniter s_iomanager_initer;
+
+// 当前线程正在执行 idle 的 IOManager 及其统计
+static thread_local IOManager* t_stats_owner = nullptr;
+static thread_local IOManager::LoopStats* t_loop_stats = nullptr;
+
 enum EpollCtlOp{};
 
 static std::ostream& operator<< (std::ostream& os, const EpollCtlOp& op) {
@@ -68,6 +100,7 @@ IOManager::FdContext::EventContext&
 IOManager::FdContext::getContext(IOManager::Event event) {
 	if (event == IOManager::Event::READ) return __read;
 	else if (event == IOManager::Event::WRITE) return __write;
+	else if (event == IOManager::Event::PRI) return __pri;
 	else {
 		SYLAR_ASSERT2(false, "getContext");
 	}
@@ -79,25 +112,80 @@ IOManager::FdContext::resetContext(IOManager::FdContext::EventContext& ctx) {
 	ctx.__scheduler = nullptr;
 	ctx.__fiber.reset();
 	ctx.__cb = nullptr;
+	ctx.__owner = nullptr;
 }
 
 void 
 IOManager::FdContext::triggerEvent(IOManager::Event event) {
-	// ж¼Ƿ
+	// 判断事件是否存在
 	SYLAR_ASSERT(__events & event);
-	// ¼
+	// 清除事件
 	__events = (IOManager::Event)(__events & ~event);
-	// ȡ event 
+	// 获取 event 上下文
 	IOManager::FdContext::EventContext& ctx = getContext(event);
-	// ¼лصִлصִЭ
+	// 事件有回调函数则执行回调函数，否则执行其协程
 	if (ctx.__cb) {
 		ctx.__scheduler->schedule(&ctx.__cb);
 	}
 	else {
 		ctx.__scheduler->schedule(&ctx.__fiber);
 	}
-	// ¼ִϣ Э̵
+	// 事件执行完毕，清除其 协程调度器
 	ctx.__scheduler = nullptr;
+	ctx.__owner = nullptr;
+}
+
+//****************************************************************************
+// IOManager::LoopStats
+//****************************************************************************
+
+void IOManager::LoopStats::merge(const IOManager::LoopStats& other) {
+#define XX(f) f.fetch_add(other.f.load(std::memory_order_relaxed), std::memory_order_relaxed)
+    XX(wakeups);
+    XX(events);
+    XX(tickleSent);
+    XX(tickleCoalesced);
+    XX(leaderPromotions);
+    XX(spinHits);
+    XX(spinMisses);
+    XX(tickleWakeups);
+    XX(timerWakeups);
+    XX(emptyTimeouts);
+    XX(addEvents);
+    XX(delEvents);
+    XX(cancelEvents);
+    XX(epollCtlErrors);
+#undef XX
+    eventsPerWakeup.merge(other.eventsPerWakeup);
+    dispatchUS.merge(other.dispatchUS);
+    iterationUS.merge(other.iterationUS);
+    spinUS.merge(other.spinUS);
+}
+
+std::ostream& IOManager::LoopStats::dump(std::ostream& os) const {
+    os << "wakeups=" << wakeups
+        << " events=" << events
+        << " tickle_sent=" << tickleSent
+        << " tickle_coalesced=" << tickleCoalesced
+        << " leader_promotions=" << leaderPromotions
+        << " spin_hits=" << spinHits
+        << " spin_misses=" << spinMisses
+        << " tickle_wakeups=" << tickleWakeups
+        << " timer_wakeups=" << timerWakeups
+        << " empty_timeouts=" << emptyTimeouts
+        << " add=" << addEvents
+        << " del=" << delEvents
+        << " cancel=" << cancelEvents
+        << " epoll_ctl_errors=" << epollCtlErrors;
+    os << std::endl << "        events_per_wakeup: ";
+    eventsPerWakeup.dump(os);
+    os << std::endl << "        dispatch_us: ";
+    dispatchUS.dump(os);
+    os << std::endl << "        iteration_us: ";
+    iterationUS.dump(os);
+    os << std::endl << "        spin_us: ";
+    spinUS.dump(os);
+    return os;
 }
 
 //****************************************************************************
@@ -105,12 +193,54 @@ IOManager::FdContext::triggerEvent(IOManager::Event event) {
 //****************************************************************************
 
 void IOManager::tickle() {
-    // ûпֱ̣߳ӽ
+    tickle(-1);
+}
+
+void IOManager::tickle(int thread) {
+    // 没有空闲线程，直接结束函数
     if (!hasIdleThreads()) return;
-    // ڿ̣߳ T д __tickleFds[1] 
-    int rt = write(__tickleFds[1], "T", 1);
-    // жǷдɹ
-    SYLAR_ASSERT(rt == 1);
+    // 与 idle 中"先标记 __parked 再检查队列"配对，保证不会丢失唤醒
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    size_t count = std::min(__workerCount.load(), __workers.size());
+    // 停止时唤醒所有阻塞的线程，让它们检查是否可以退出
+    if (__is_stopping) {
+        for (size_t i = 0; i < count; ++i) {
+            if (__workers[i]->__parked) wakeWorker(__workers[i]);
+        }
+        return;
+    }
+
+    // 任务指定了线程：只唤醒该线程。它没有阻塞时会在阻塞前检查队列，无需唤醒
+    if (thread != -1) {
+        for (size_t i = 0; i < count; ++i) {
+            if (__workers[i]->__threadId == thread) {
+                if (__workers[i]->__parked) wakeWorker(__workers[i]);
+                return;
+            }
+        }
+        return;
+    }
+
+    // 已有唤醒在途，被唤醒的线程会处理队列
+    if (__pendingWakeups > 0) {
+        localStats().inc(&LoopStats::tickleCoalesced);
+        return;
+    }
+    // 有线程正在自旋，它会拿到任务
+    if (__spinners > 0) {
+        localStats().inc(&LoopStats::tickleCoalesced);
+        return;
+    }
+    // 优先唤醒 follower，让 leader 继续等待 IO
+    Worker* leader = __leader;
+    for (size_t i = 0; i < count; ++i) {
+        Worker* worker = __workers[i];
+        if (worker != leader && worker->__parked && wakeWorker(worker)) return;
+    }
+    if (leader && leader->__parked) {
+        wakeWorker(leader);
+    }
 }
 
 bool IOManager::stopping() {
@@ -120,60 +250,160 @@ bool IOManager::stopping() {
 
 void IOManager::idle() {
     SYLAR_LOG_DEBUG(SYLAR_LOG_ROOT()) << "idle";
-    const uint64_t MAX_EVENTS = 256;
+    // 占用一个工作线程槽位
+    size_t slot = __workerCount++;
+    SYLAR_ASSERT(slot < __workers.size());
+    Worker* self = __workers[slot];
+    self->__threadId = GetThreadId();
+
+    const uint32_t MAX_EVENTS = std::max(g_iomanager_max_events->getValue(), 1u);
     epoll_event* events = new epoll_event[MAX_EVENTS]();
     std::shared_ptr<epoll_event> shared_events(events, [](epoll_event* ptr) {
         delete[] ptr;
     });
 
+    // 本线程的统计，只由本线程写入
+    LoopStats* stats = new LoopStats;
+    stats->thread = GetThreadId();
+    {
+        Mutex::Lock lock(__statsMutex);
+        __loopStats.push_back(stats);
+    }
+    t_stats_owner = this;
+    t_loop_stats = stats;
+
+    uint64_t wake_us = 0;
     while (true) {
-        uint64_t next_timeout = 0;
-        if (SYLAR_UNLIKELY(stopping(next_timeout))) {
-            SYLAR_LOG_INFO(SYLAR_LOG_ROOT())
-                << "name = " << getName()
-                << " idle stopping exit";
-            break;
+        if (wake_us) {
+            stats->iterationUS.record(Clock::NowUS() - wake_us);
         }
 
+        // 自旋阶段：按最近的空闲间隔决定自旋多久，期间拿到任务或 IO 就不再阻塞
+        uint64_t idle_begin = Clock::NowUS();
+        uint64_t budget = spinBudget(self);
+        bool spin_hit = false;
         int rt = 0;
-        do {
-            static const int MAX_TIMEOUT = 3000;
-            if (next_timeout != ~0ull) {
-                next_timeout = (int)next_timeout > MAX_TIMEOUT ? MAX_TIMEOUT : next_timeout;
+        if (budget && !__is_stopping) {
+            spin_hit = spinWait(self, events, MAX_EVENTS, budget, rt);
+            if (spin_hit) {
+                stats->inc(&LoopStats::spinHits);
             }
             else {
-                next_timeout = MAX_TIMEOUT;
+                stats->inc(&LoopStats::spinMisses);
             }
-            rt = epoll_wait(__epfd, events, MAX_EVENTS, (int)next_timeout);
-            if (rt >= 0 || errno != EINTR) {
+            stats->spinUS.record(Clock::NowUS() - idle_begin);
+        }
+
+        static const int MAX_TIMEOUT = 3000;
+        int timeout_ms = MAX_TIMEOUT;
+        if (!spin_hit) {
+            // 先标记为阻塞再检查队列，与 tickle 配对，保证不会丢失唤醒
+            self->__parked = true;
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            uint64_t next_deadline = 0;
+            if (SYLAR_UNLIKELY(stopping(next_deadline))) {
+                self->__parked = false;
+                SYLAR_LOG_INFO(SYLAR_LOG_ROOT())
+                    << "name = " << getName()
+                    << " idle stopping exit";
+                // 让仍阻塞的线程也检查是否可以退出
+                tickle();
                 break;
             }
-        } while (true);
+            bool has_work = hasPendingFibers(self->__threadId);
+
+            // 没有 leader 时由本线程等待共享的 epoll，否则只等待自己的 eventfd
+            Worker* expected = nullptr;
+            bool is_leader = __leader.compare_exchange_strong(expected, self);
+
+            // 标记已置位但唤醒可能写到了别处(本线程刚卸任 leader，或在竞选成功前
+            // 唤醒方写了自己的 eventfd)，不阻塞再检查一轮。必须在竞选之后检查
+            if (self->__pending.exchange(false)) {
+                --__pendingWakeups;
+                has_work = true;
+            }
+
+            do {
+                timeout_ms = MAX_TIMEOUT;
+                if (is_leader && next_deadline != ~0ull) {
+                    // 有 timerfd 时由 timerfd 负责精确唤醒，epoll_wait 只作兜底
+                    if (__timerFd >= 0) {
+                        armTimerFd(next_deadline);
+                    }
+                    else {
+                        uint64_t now_us = Clock::NowUS();
+                        uint64_t ms = next_deadline > now_us ? (next_deadline - now_us + 999) / 1000 : 0;
+                        timeout_ms = ms > MAX_TIMEOUT ? MAX_TIMEOUT : (int)ms;
+                    }
+                }
+                if (has_work) {
+                    timeout_ms = 0;
+                }
+                rt = epoll_wait_f(is_leader ? __epfd : self->__epfd, events, MAX_EVENTS, timeout_ms);
+                if (rt >= 0 || errno != EINTR) {
+                    break;
+                }
+            } while (true);
+            self->__parked = false;
+            if (self->__pending.exchange(false)) {
+                --__pendingWakeups;
+            }
+            if (is_leader) {
+                __leader = nullptr;
+            }
+        }
+
+        // 每次唤醒只读取一次时钟，本轮的到期判断都使用该缓存值
+        wake_us = Clock::Update();
+        // 学习空闲间隔，决定下一次自旋的时长
+        self->__gapEwmaUS = (self->__gapEwmaUS * 7 + (wake_us - idle_begin)) / 8;
+        stats->inc(&LoopStats::wakeups);
+        stats->eventsPerWakeup.record(rt > 0 ? rt : 0);
 
         std::vector<std::function<void()>> cbs;
         listExpiredCb(cbs);
+        if (!spin_hit && rt == 0 && timeout_ms == MAX_TIMEOUT && cbs.empty()) {
+            stats->inc(&LoopStats::emptyTimeouts);
+        }
         if (!cbs.empty()) {
             schedule(cbs.begin(), cbs.end());
             cbs.clear();
         }
+        triggerExpiredNodes();
 
         for (int i = 0; i < rt; ++i) {
             epoll_event& event = events[i];
-            if (event.data.fd == __tickleFds[0]) {
-                uint8_t dummy[256];
-                while (read(__tickleFds[0], dummy, sizeof(dummy)) > 0);
+            if (handleWakeup(self, event.data.fd)) {
+                continue;
+            }
+            if (event.data.fd == __timerFd) {
+                stats->inc(&LoopStats::timerWakeups);
+                uint64_t expirations = 0;
+                while (read_f(__timerFd, &expirations, sizeof(expirations)) > 0) {
+                }
+                {
+                    SpinLock::Lock lock(__timerFdMutex);
+                    __timerFdDeadline = ~0ull;
+                }
+                // 复位前其他线程可能因为已过期的 __timerFdDeadline 跳过了设置，按当前最早的定时器重新设置
+                uint64_t next = getNextDeadlineUS();
+                if (next != ~0ull) {
+                    armTimerFd(next);
+                }
                 continue;
             }
 
             IOManager::FdContext* fd_ctx = (IOManager::FdContext*)event.data.ptr;
             IOManager::FdContext::MutexType::Lock lock(fd_ctx->__mutex);
             if (event.events & (EPOLLERR | EPOLLHUP)) {
-                event.events |= (EPOLLIN | EPOLLOUT) & fd_ctx->__events;
+                event.events |= (EPOLLIN | EPOLLOUT | EPOLLPRI) & fd_ctx->__events;
             }
 
             int real_events = NONE;
             if (event.events & EPOLLIN) real_events |= READ;
             if (event.events & EPOLLOUT) real_events |= WRITE;
+            if (event.events & EPOLLPRI) real_events |= PRI;
 
             if ((fd_ctx->__events & real_events) == NONE) continue;
 
@@ -183,6 +413,7 @@ void IOManager::idle() {
 
             int rt2 = epoll_ctl(__epfd, op, fd_ctx->__fd, &event);
             if (rt2) {
+                stats->inc(&LoopStats::epollCtlErrors);
                 SYLAR_LOG_ERROR(SYLAR_LOG_ROOT()) 
                     << "epoll_ctl(" << __epfd << ", "
                     << (EpollCtlOp)op << ", " 
@@ -193,6 +424,7 @@ void IOManager::idle() {
                 continue;
             }
 
+            stats->inc(&LoopStats::events);
             if (real_events & READ) {
                 fd_ctx->triggerEvent(READ);
                 --__pendingEventCount;
@@ -201,7 +433,15 @@ void IOManager::idle() {
                 fd_ctx->triggerEvent(WRITE);
                 --__pendingEventCount;
             }
+            if (real_events & PRI) {
+                fd_ctx->triggerEvent(PRI);
+                --__pendingEventCount;
+            }
         }
+        stats->dispatchUS.record(Clock::NowUS() - wake_us);
+
+        // 本线程去执行任务前，保证仍有线程等待 IO
+        promoteLeader();
 
         Fiber_ptr cur = Fiber::GetThis();
         auto raw_ptr = cur.get();
@@ -209,10 +449,13 @@ void IOManager::idle() {
 
         raw_ptr->swapOut();
     }
+
+    t_stats_owner = nullptr;
+    t_loop_stats = nullptr;
 }
 
 bool IOManager::stopping(uint64_t& timeout) {
-    timeout = getNextTimer();
+    timeout = getNextDeadlineUS();
 
     return 
         timeout == ~0ull &&
@@ -221,7 +464,130 @@ bool IOManager::stopping(uint64_t& timeout) {
 }
 
 void IOManager::onTimerInsertedAtFront() {
-    tickle();
+    if (__timerFd >= 0) {
+        uint64_t next = getNextDeadlineUS();
+        if (next != ~0ull) {
+            armTimerFd(next);
+        }
+        return;
+    }
+    // 只有 leader 按定时器计算等待时间
+    Worker* leader = __leader;
+    if (leader && leader->__parked) {
+        wakeWorker(leader);
+    }
+    else {
+        tickle();
+    }
+}
+
+void IOManager::armTimerFd(uint64_t deadline_us) {
+    SpinLock::Lock lock(__timerFdMutex);
+    // 已设置的时间更早且尚未被消费，等它触发后由处理它的线程重新设置
+    if (deadline_us >= __timerFdDeadline) {
+        return;
+    }
+    __timerFdDeadline = deadline_us;
+
+    itimerspec its;
+    memset(&its, 0, sizeof(its));
+    its.it_value.tv_sec = deadline_us / 1000000;
+    its.it_value.tv_nsec = (deadline_us % 1000000) * 1000;
+    if (its.it_value.tv_sec == 0 && its.it_value.tv_nsec == 0) {
+        its.it_value.tv_nsec = 1;
+    }
+    if (timerfd_settime(__timerFd, TFD_TIMER_ABSTIME, &its, nullptr)) {
+        SYLAR_LOG_ERROR(SYLAR_LOG_ROOT()) << "timerfd_settime(" << __timerFd
+            << ") (" << errno << ") (" << strerror(errno) << ")";
+    }
+}
+
+bool IOManager::wakeWorker(IOManager::Worker* worker) {
+    LoopStats& stats = localStats();
+    if (worker->__pending.exchange(true)) {
+        stats.inc(&LoopStats::tickleCoalesced);
+        return false;
+    }
+    ++__pendingWakeups;
+    // leader 阻塞在共享的 epoll 上，通过 __leaderFd 唤醒
+    int fd = __leader == worker ? __leaderFd : worker->__eventFd;
+    uint64_t one = 1;
+    int rt = write_f(fd, &one, sizeof(one));
+    SYLAR_ASSERT(rt == (int)sizeof(one));
+    stats.inc(&LoopStats::tickleSent);
+    return true;
+}
+
+bool IOManager::handleWakeup(IOManager::Worker* self, int fd) {
+    if (fd != __leaderFd && fd != self->__eventFd) {
+        return false;
+    }
+    uint64_t value = 0;
+    while (read_f(fd, &value, sizeof(value)) > 0) {
+    }
+    localStats().inc(&LoopStats::tickleWakeups);
+    // 自旋的线程也会在共享 epoll 上拿走发给 leader 的唤醒(__leaderFd 是边沿触发的)。
+    // 替 leader 清除标记，否则 __pendingWakeups 一直大于 0，之后的 tickle 都会被合并掉；
+    // 唤醒可能是发给 leader 本身的(停止、指定线程的任务)，重新唤醒一次
+    Worker* leader = __leader;
+    if (fd == __leaderFd && leader && leader != self && leader->__pending.exchange(false)) {
+        --__pendingWakeups;
+        wakeWorker(leader);
+    }
+    return true;
+}
+
+uint64_t IOManager::spinBudget(IOManager::Worker* self) {
+    // 单核时自旋只会占住投递任务的线程
+    static const bool s_multi_cpu = sysconf(_SC_NPROCESSORS_ONLN) > 1;
+    uint64_t max_us = s_spin_max_us.load(std::memory_order_relaxed);
+    if (!max_us || !s_multi_cpu) return 0;
+    // 最近的空闲间隔超过上限时自旋大概率落空，直接阻塞
+    if (self->__gapEwmaUS > max_us) return 0;
+    return std::min(max_us, self->__gapEwmaUS * 2 + 1);
+}
+
+bool IOManager::spinWait(IOManager::Worker* self, epoll_event* events, int max_events,
+                         uint64_t budget_us, int& rt) {
+    ++__spinners;
+    uint64_t end = Clock::NowUS() + budget_us;
+    bool hit = false;
+    rt = 0;
+    do {
+        if (hasQueuedFibers() && hasPendingFibers(self->__threadId)) {
+            hit = true;
+            break;
+        }
+        rt = epoll_wait_f(__epfd, events, max_events, 0);
+        if (rt > 0) {
+            hit = true;
+            break;
+        }
+        rt = 0;
+    } while (Clock::NowUS() < end && !__is_stopping);
+    --__spinners;
+    return hit;
+}
+
+void IOManager::promoteLeader() {
+    if (__leader || __pendingWakeups > 0) {
+        return;
+    }
+    size_t count = std::min(__workerCount.load(), __workers.size());
+    for (size_t i = 0; i < count; ++i) {
+        Worker* worker = __workers[i];
+        if (worker->__parked && wakeWorker(worker)) {
+            localStats().inc(&LoopStats::leaderPromotions);
+            return;
+        }
+    }
+}
+
+IOManager::LoopStats& IOManager::localStats() {
+    if (t_stats_owner == this) {
+        return *t_loop_stats;
+    }
+    return __sharedStats;
 }
 
 void IOManager::contextResize(size_t size) {
@@ -245,19 +611,49 @@ IOManager::IOManager(size_t threads, bool use_caller, const std::string& name)
     __epfd = epoll_create(5000);
     SYLAR_ASSERT(__epfd > 0);
 
-    int rt = pipe(__tickleFds);
-    SYLAR_ASSERT(!rt);
-
+    // 唤醒阻塞在共享 epoll 上的 leader
+    __leaderFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    SYLAR_ASSERT(__leaderFd >= 0);
     epoll_event event;
-    memset(& event, 0, sizeof(epoll_event));
+    memset(&event, 0, sizeof(epoll_event));
     event.events = EPOLLIN | EPOLLET;
-    event.data.fd = __tickleFds[0];
-
-    rt = fcntl(__tickleFds[0], F_SETFL, O_NONBLOCK);
+    event.data.fd = __leaderFd;
+    int rt = epoll_ctl(__epfd, EPOLL_CTL_ADD, __leaderFd, &event);
     SYLAR_ASSERT(!rt);
 
-    rt = epoll_ctl(__epfd, EPOLL_CTL_ADD, __tickleFds[0], &event);
-    SYLAR_ASSERT(!rt);
+    // 每个工作线程(含 use_caller 线程)一个 eventfd 及只包含它的 epoll，
+    // follower 阻塞在自己的 epoll 上，tickle 时可以只唤醒其中一个
+    size_t workers = __thread_count + (__root_thread != -1 ? 1 : 0);
+    for (size_t i = 0; i < workers; ++i) {
+        Worker* worker = new Worker;
+        worker->__epfd = epoll_create1(EPOLL_CLOEXEC);
+        SYLAR_ASSERT(worker->__epfd >= 0);
+        worker->__eventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        SYLAR_ASSERT(worker->__eventFd >= 0);
+
+        memset(&event, 0, sizeof(epoll_event));
+        event.events = EPOLLIN | EPOLLET;
+        event.data.fd = worker->__eventFd;
+        rt = epoll_ctl(worker->__epfd, EPOLL_CTL_ADD, worker->__eventFd, &event);
+        SYLAR_ASSERT(!rt);
+        __workers.push_back(worker);
+    }
+
+    // 与 Clock 使用同一个单调时钟，到期时间可以直接以绝对时间设置
+    __timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (__timerFd >= 0) {
+        memset(&event, 0, sizeof(epoll_event));
+        event.events = EPOLLIN | EPOLLET;
+        event.data.fd = __timerFd;
+        if (epoll_ctl(__epfd, EPOLL_CTL_ADD, __timerFd, &event)) {
+            close(__timerFd);
+            __timerFd = -1;
+        }
+    }
+    if (__timerFd < 0) {
+        SYLAR_LOG_WARN(SYLAR_LOG_ROOT()) << "timerfd unavailable, timers fall back to "
+            << "epoll_wait millisecond timeout";
+    }
 
     contextResize(32);
     start();
@@ -266,19 +662,37 @@ IOManager::IOManager(size_t threads, bool use_caller, const std::string& name)
 IOManager::~IOManager() {
     stop();
     close(__epfd);
-    close(__tickleFds[0]);
-    close(__tickleFds[1]);
+    close(__leaderFd);
+    for (Worker* worker : __workers) {
+        close(worker->__epfd);
+        close(worker->__eventFd);
+        delete worker;
+    }
+    if (__timerFd >= 0) {
+        close(__timerFd);
+    }
 
     for (size_t i = 0; i < __fdContexts.size(); ++i) {
         if (__fdContexts[i]) {
             delete __fdContexts[i];
         }
     }
+    for (LoopStats* stats : __loopStats) {
+        delete stats;
+    }
 }
 
 int IOManager::addEvent(int fd, Event event, std::function<void()> cb) {
-    // ȡ fd  FdContext
-    //  fd ϣֱӻȡϣ __fdContexts ʹ
+    return doAddEvent(fd, event, cb, true, nullptr);
+}
+
+int IOManager::tryAddEvent(int fd, Event event, std::function<void()> cb, const void* owner) {
+    return doAddEvent(fd, event, cb, false, owner);
+}
+
+int IOManager::doAddEvent(int fd, Event event, std::function<void()>& cb, bool strict, const void* owner) {
+    // 获取 fd 索引的 FdContext。
+    // 如果 fd 符合，则直接获取；如果不符合，则开启 __fdContexts 使其符合
     IOManager::FdContext* fd_ctx = nullptr;
     RWMutexType::ReadLock lock(__mutex);
     if ((int)__fdContexts.size() > fd) {
@@ -294,6 +708,9 @@ int IOManager::addEvent(int fd, Event event, std::function<void()> cb) {
 
     IOManager::FdContext::MutexType::Lock lock2(fd_ctx->__mutex);
     if (SYLAR_UNLIKELY(fd_ctx->__events & event)) {
+        if (!strict) {
+            return 1;
+        }
         SYLAR_LOG_ERROR(SYLAR_LOG_ROOT()) 
             << "addEvent assert fd = " << fd
             << " event = " << (EPOLL_EVENTS)event
@@ -306,8 +723,11 @@ int IOManager::addEvent(int fd, Event event, std::function<void()> cb) {
     epevent.events = EPOLLET | fd_ctx->__events | event;
     epevent.data.ptr = fd_ctx;
 
+    LoopStats& stats = localStats();
+    stats.inc(&LoopStats::addEvents);
     int rt = epoll_ctl(__epfd, op, fd, &epevent);
     if (rt) {
+        stats.inc(&LoopStats::epollCtlErrors);
         SYLAR_LOG_ERROR(SYLAR_LOG_ROOT()) << "epoll_ctl(" << __epfd << ", "
             << (EpollCtlOp)op << ", " << fd << ", " << (EPOLL_EVENTS)epevent.events << "):"
             << rt << " (" << errno << ") (" << strerror(errno) << ") fd_ctx->events="
@@ -321,6 +741,7 @@ int IOManager::addEvent(int fd, Event event, std::function<void()> cb) {
     SYLAR_ASSERT(!event_ctx.__scheduler && !event_ctx.__fiber && !event_ctx.__cb);
 
     event_ctx.__scheduler = Scheduler::GetThis();
+    event_ctx.__owner = owner;
     if (cb) {
         event_ctx.__cb.swap(cb);
     }
@@ -333,6 +754,14 @@ int IOManager::addEvent(int fd, Event event, std::function<void()> cb) {
 }
 
 bool IOManager::delEvent(int fd, Event event) {
+    return doDelEvent(fd, event, nullptr, false);
+}
+
+bool IOManager::delEventIf(int fd, Event event, const void* owner) {
+    return doDelEvent(fd, event, owner, true);
+}
+
+bool IOManager::doDelEvent(int fd, Event event, const void* owner, bool check_owner) {
     RWMutexType::ReadLock lock(__mutex);
     if ((int)__fdContexts.size() <= fd) {
         return false;
@@ -344,6 +773,9 @@ bool IOManager::delEvent(int fd, Event event) {
     if (SYLAR_UNLIKELY(!(fd_ctx->__events & event))) {
         return false;
     }
+    if (check_owner && fd_ctx->getContext(event).__owner != owner) {
+        return false;
+    }
 
     Event new_events = (Event)(fd_ctx->__events & ~event);
     int op = new_events ? EPOLL_CTL_MOD : EPOLL_CTL_DEL;
@@ -351,8 +783,11 @@ bool IOManager::delEvent(int fd, Event event) {
     epevent.events = EPOLLET | new_events;
     epevent.data.ptr = fd_ctx;
 
+    LoopStats& stats = localStats();
+    stats.inc(&LoopStats::delEvents);
     int rt = epoll_ctl(__epfd, op, fd, &epevent);
     if (rt) {
+        stats.inc(&LoopStats::epollCtlErrors);
         SYLAR_LOG_ERROR(SYLAR_LOG_ROOT()) 
             << "epoll_ctl(" << __epfd << ", "
             << (EpollCtlOp)op << ", " << fd << ", " 
@@ -387,8 +822,11 @@ bool IOManager::cancelEvent(int fd, Event event) {
     epevent.events = EPOLLET | new_events;
     epevent.data.ptr = fd_ctx;
 
+    LoopStats& stats = localStats();
+    stats.inc(&LoopStats::cancelEvents);
     int rt = epoll_ctl(__epfd, op, fd, &epevent);
     if (rt) {
+        stats.inc(&LoopStats::epollCtlErrors);
         SYLAR_LOG_ERROR(SYLAR_LOG_ROOT()) 
             << "epoll_ctl(" << __epfd << ", "
             << (EpollCtlOp)op << ", " << fd << ", " 
@@ -422,6 +860,7 @@ bool IOManager::cancelAll(int fd) {
 
     int rt = epoll_ctl(__epfd, op, fd, &epevent);
     if (rt) {
+        localStats().inc(&LoopStats::epollCtlErrors);
         SYLAR_LOG_ERROR(SYLAR_LOG_ROOT()) 
             << "epoll_ctl(" << __epfd << ", "
             << (EpollCtlOp)op << ", " << fd << ", " 
@@ -438,9 +877,42 @@ bool IOManager::cancelAll(int fd) {
         fd_ctx->triggerEvent(WRITE);
         --__pendingEventCount;
     }
+    if (fd_ctx->__events & PRI) {
+        fd_ctx->triggerEvent(PRI);
+        --__pendingEventCount;
+    }
 
     SYLAR_ASSERT(fd_ctx->__events == 0);
     return true;
 }
 
-}; /* sylar */
\ No newline at end of file
+void IOManager::getLoopStats(IOManager::LoopStats& total) {
+    total.merge(__sharedStats);
+    Mutex::Lock lock(__statsMutex);
+    for (LoopStats* stats : __loopStats) {
+        total.merge(*stats);
+    }
+}
+
+std::ostream& IOManager::dump(std::ostream& os) {
+    Scheduler::dump(os);
+    LoopStats total;
+    getLoopStats(total);
+    os << std::endl << "    [IOManager loop total] ";
+    total.dump(os);
+    os << std::endl << "    [IOManager workers] pending_wakeups=" << __pendingWakeups;
+    for (Worker* worker : __workers) {
+        os << " " << worker->__threadId
+            << (worker == __leader ? "(leader," : "(")
+            << (worker->__parked ? "parked" : "running")
+            << (worker->__pending ? ",pending)" : ")");
+    }
+    Mutex::Lock lock(__statsMutex);
+    for (LoopStats* stats : __loopStats) {
+        os << std::endl << "    [IOManager loop thread=" << stats->thread << "] ";
+        stats->dump(os);
+    }
+    return os;
+}
+
+}; /* sylar */
@@ -1,9 +1,19 @@
 #include "Log.h"
 #include "Single.h"
+#include "FileIO.h"
+#include "AsyncLog.h"
+#include "Config.h"
 
 #include <iostream>
 #include <unordered_map>
 #include <functional>
+#include <errno.h>
+#include <string.h>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include <pthread.h>
 
 namespace sylar {
 
@@ -46,27 +56,28 @@ LogLevel LevelFromString(const std::string& str) {
 //****************************************************************************
 
 LogEvent::LogEvent(const std::string& log_name, LogLevel level,
-				   const std::string& file_name, uint32_t line,
+				   const char* file_name, uint32_t line,
 				   uint32_t elapse, uint32_t thread_id,
-				   const std::string& thread_name,
-				   uint32_t fiber_id, uint64_t time)
+				   const char* thread_name,
+				   uint32_t fiber_id, uint64_t time, uint32_t usec)
 	:
-	__log_name(log_name),
+	__log_name(&log_name),
 	__level(level),
 	__file_name(file_name),
 	__line(line),
 	__elapse(elapse),
 	__thread_id(thread_id),
-	__thread_name(thread_name),
 	__fiber_id(fiber_id),
 	__time(time),
-	__sstream() {}
+	__usec(usec),
+	__thread_name(thread_name) {}
 
 const std::string& LogEvent::getLogName() const {
-	return this->__log_name;
+	static const std::string s_empty;
+	return this->__log_name ? *this->__log_name : s_empty;
 }
 
-const std::string& LogEvent::getFile() const {
+const char* LogEvent::getFile() const {
 	return this->__file_name;
 }
 
@@ -86,7 +97,7 @@ uint32_t LogEvent::getFiberId() const {
 	return this->__fiber_id;
 }
 
-const std::string& LogEvent::getThreadName() const {
+const char* LogEvent::getThreadName() const {
 	return __thread_name;
 }
 
@@ -94,16 +105,29 @@ uint64_t LogEvent::getTime() const {
 	return this->__time;
 }
 
+uint32_t LogEvent::getUsec() const {
+	return this->__usec;
+}
+
 LogLevel LogEvent::getLevel() const {
 	return this->__level;
 }
 
-std::string LogEvent::getContext() const {
-	return this->__sstream.str();
+const char* LogEvent::getMessage() const {
+	return this->__message;
 }
 
-std::stringstream& LogEvent::getSS() {
-	return this->__sstream;
+size_t LogEvent::getMessageSize() const {
+	return this->__message_size;
+}
+
+void LogEvent::setMessage(const char* data, size_t size) {
+	this->__message = data;
+	this->__message_size = size;
+}
+
+std::string LogEvent::getContext() const {
+	return std::string(this->__message, this->__message_size);
 }
 
 
@@ -111,104 +135,244 @@ std::stringstream& LogEvent::getSS() {
 // FormatterItem
 //****************************************************************************
 
+/*!
+ * @brief 把无符号整数追加到 buf 末尾，不经过 iostream
+ */
+static inline void AppendUInt(std::string& buf, uint64_t v) {
+	char tmp[20];
+	char* p = tmp + sizeof(tmp);
+	do {
+		*--p = '0' + v % 10;
+		v /= 10;
+	} while (v);
+	buf.append(p, tmp + sizeof(tmp) - p);
+}
+
+static inline void AppendCString(std::string& buf, const char* str) {
+	buf.append(str, strlen(str));
+}
+
 class MessageFormatItem : public FormatterItem {
 public:
 	MessageFormatItem(const std::string& str = "") {}
-	void format(std::ostream& os, LogEvent_ptr event) override {
-		os << event->getContext();
+	void format(std::string& buf, const LogEvent& event) override {
+		buf.append(event.getMessage(), event.getMessageSize());
 	}
 };
 
 class LevelFormatItem : public FormatterItem {
 public:
 	LevelFormatItem(const std::string& str = "") {}
-	void format(std::ostream& os, LogEvent_ptr event) override {
-		os << LevelToString(event->getLevel());
+	void format(std::string& buf, const LogEvent& event) override {
+		static const char* s_names[] = { "UNKNOW", "DEBUG", "INFO", "WARN", "ERROR", "FATAL" };
+		unsigned level = event.getLevel();
+		AppendCString(buf, level < sizeof(s_names) / sizeof(s_names[0]) ? s_names[level] : "UNKNOW");
 	}
 };
 
 class ElapseFormatItem : public FormatterItem {
 public:
 	ElapseFormatItem(const std::string& str = "") {}
-	void format(std::ostream& os, LogEvent_ptr event) override {
-		os << event->getElapse();
+	void format(std::string& buf, const LogEvent& event) override {
+		AppendUInt(buf, event.getElapse());
 	}
 };
 
 class NameFormatItem : public FormatterItem {
 public:
 	NameFormatItem(const std::string& str = "") {}
-	void format(std::ostream& os, LogEvent_ptr event) override {
-		os << event->getLogName();
+	void format(std::string& buf, const LogEvent& event) override {
+		buf.append(event.getLogName());
 	}
 };
 
 class ThreadIdFormatItem : public FormatterItem {
 public:
 	ThreadIdFormatItem(const std::string& str = "") {}
-	void format(std::ostream& os, LogEvent_ptr event) override {
-		os << event->getThreadId();
+	void format(std::string& buf, const LogEvent& event) override {
+		AppendUInt(buf, event.getThreadId());
 	}
 };
 
 class ThreadNameFormatItem : public FormatterItem {
 public:
 	ThreadNameFormatItem(const std::string& str = "") {}
-	void format(std::ostream& os, LogEvent_ptr event) override {
-		os << event->getThreadName();
+	void format(std::string& buf, const LogEvent& event) override {
+		AppendCString(buf, event.getThreadName());
 	}
 };
 
 class FiberIdFormatItem : public FormatterItem {
 public:
 	FiberIdFormatItem(const std::string& str = "") {}
-	void format(std::ostream& os, LogEvent_ptr event) override {
-		os << event->getFiberId();
+	void format(std::string& buf, const LogEvent& event) override {
+		AppendUInt(buf, event.getFiberId());
 	}
 };
 
+/*!
+ * @brief 日期时间
+ * @details 除 strftime 的格式外支持 %3N(毫秒)、%6N(微秒)、%N(纳秒)。
+ *          时间戳只有秒级变化时才需要 localtime_r 与 strftime，因此每个线程按秒缓存
+ *          格式化结果，同一秒内只拷贝缓存并改写亚秒的数字
+ */
 class DateTimeFormatItem : public FormatterItem {
+private:
+	/*!
+	 * @brief 一段格式：strftime 格式串，或宽度为 digits 的亚秒数字
+	 */
+	struct Segment {
+		std::string format;
+		int digits;
+	};
+
+	/*!
+	 * @brief 线程局部缓存的一项
+	 */
+	struct Cache {
+		uint64_t id = 0;				// 所属格式项，0 表示空闲
+		time_t second = -1;				// 缓存对应的秒
+		std::string text;				// 亚秒位置先填 0
+		std::vector<std::pair<size_t, int> > patches;	// 亚秒数字在 text 中的位置与宽度
+	};
+
+	static const size_t CACHE_SIZE = 8;
+	static std::atomic<uint64_t> s_id;
+
+	std::string m_format;
+	std::vector<Segment> m_segments;
+	uint64_t m_id;					// 格式项被释放后地址可能复用，缓存用唯一 id 区分
 public:
 	DateTimeFormatItem(const std::string& format = "%Y-%m-%d %H:%M:%S")
-		:m_format(format) {
+		:m_format(format), m_id(++s_id) {
 		if (m_format.empty()) {
 			m_format = "%Y-%m-%d %H:%M:%S";
 		}
+		std::string text;
+		for (size_t i = 0; i < m_format.size(); ++i) {
+			if (m_format[i] != '%' || i + 1 == m_format.size()) {
+				text.push_back(m_format[i]);
+				continue;
+			}
+			int digits = 0;
+			if (m_format[i + 1] == 'N') {
+				digits = 9;
+			} else if (i + 2 < m_format.size() && m_format[i + 2] == 'N'
+					   && (m_format[i + 1] == '3' || m_format[i + 1] == '6')) {
+				digits = m_format[i + 1] - '0';
+			}
+			if (digits == 0) {
+				// 其余转换(包括 %%)原样交给 strftime
+				text.append(m_format, i, 2);
+				++i;
+				continue;
+			}
+			if (!text.empty()) {
+				m_segments.push_back(Segment{ text, 0 });
+				text.clear();
+			}
+			m_segments.push_back(Segment{ "", digits });
+			i += digits == 9 ? 1 : 2;
+		}
+		if (!text.empty()) {
+			m_segments.push_back(Segment{ text, 0 });
+		}
 	}
 
-	void format(std::ostream& os, LogEvent_ptr event) override {
-		time_t time = event->getTime();
-		char tmp[64];
-		struct tm* timinfo;
-		timinfo = localtime(&time);
-		strftime(tmp, sizeof(tmp), m_format.c_str(), timinfo);
-		os << tmp;
+	void format(std::string& buf, const LogEvent& event) override {
+		Cache& cache = getCache(event.getTime());
+		size_t base = buf.size();
+		buf.append(cache.text);
+		uint32_t usec = event.getUsec();
+		for (auto& i : cache.patches) {
+			// 只有微秒精度，纳秒的低三位补 0
+			uint32_t v = i.second == 3 ? usec / 1000 : usec;
+			int n = i.second == 9 ? 6 : i.second;
+			char* p = &buf[base + i.first + n];
+			while (n--) {
+				*--p = '0' + v % 10;
+				v /= 10;
+			}
+		}
 	}
 private:
-	std::string m_format;
+	/*!
+	 * @brief 取本线程中该格式项在 second 秒的缓存，必要时重新格式化
+	 */
+	Cache& getCache(time_t second) {
+		static thread_local Cache t_caches[CACHE_SIZE];
+		static thread_local size_t t_next = 0;
+
+		Cache* cache = nullptr;
+		for (auto& i : t_caches) {
+			if (i.id == m_id) {
+				cache = &i;
+				break;
+			}
+		}
+		if (!cache) {
+			cache = &t_caches[t_next++ % CACHE_SIZE];
+			cache->id = m_id;
+			cache->second = -1;
+		}
+		if (cache->second == second) {
+			return *cache;
+		}
+
+		// localtime_r 不会每次检查 TZ，时区在 s_tz_initer 中初始化
+		struct tm tm;
+		localtime_r(&second, &tm);
+		cache->second = second;
+		cache->text.clear();
+		cache->patches.clear();
+		for (auto& i : m_segments) {
+			if (i.digits) {
+				cache->patches.emplace_back(cache->text.size(), i.digits);
+				cache->text.append(i.digits, '0');
+			} else {
+				char tmp[128];
+				size_t n = strftime(tmp, sizeof(tmp), i.format.c_str(), &tm);
+				cache->text.append(tmp, n);
+			}
+		}
+		return *cache;
+	}
+};
+
+std::atomic<uint64_t> DateTimeFormatItem::s_id = { 0 };
+
+/*!
+ * @brief 进程启动时读取一次时区，供 localtime_r 使用
+ */
+struct _TzIniter {
+	_TzIniter() {
+		tzset();
+	}
 };
 
+static _TzIniter s_tz_initer;
+
 class FilenameFormatItem : public FormatterItem {
 public:
 	FilenameFormatItem(const std::string& str = "") {}
-	void format(std::ostream& os, LogEvent_ptr event) override {
-		os << event->getFile();
+	void format(std::string& buf, const LogEvent& event) override {
+		AppendCString(buf, event.getFile());
 	}
 };
 
 class LineFormatItem : public FormatterItem {
 public:
 	LineFormatItem(const std::string& str = "") {}
-	void format(std::ostream& os, LogEvent_ptr event) override {
-		os << event->getLine();
+	void format(std::string& buf, const LogEvent& event) override {
+		AppendUInt(buf, event.getLine());
 	}
 };
 
 class NewLineFormatItem : public FormatterItem {
 public:
 	NewLineFormatItem(const std::string& str = "") {}
-	void format(std::ostream& os, LogEvent_ptr event) override {
-		os << std::endl;
+	void format(std::string& buf, const LogEvent& event) override {
+		buf.push_back('\n');
 	}
 };
 
@@ -216,8 +380,8 @@ class StringFormatItem : public FormatterItem {
 public:
 	StringFormatItem(const std::string& str)
 		:m_string(str) {}
-	void format(std::ostream& os, LogEvent_ptr event) override {
-		os << m_string;
+	void format(std::string& buf, const LogEvent& event) override {
+		buf.append(m_string);
 	}
 private:
 	std::string m_string;
@@ -226,8 +390,8 @@ private:
 class TabFormatItem : public FormatterItem {
 public:
 	TabFormatItem(const std::string& str = "") {}
-	void format(std::ostream& os, LogEvent_ptr event) override {
-		os << "\t";
+	void format(std::string& buf, const LogEvent& event) override {
+		buf.push_back('\t');
 	}
 private:
 	std::string m_string;
@@ -258,31 +422,31 @@ extern const std::unordered_map<std::string, std::function<FormatterItem_ptr(con
 
 void LogFormatter::init() {
 	std::vector<std::tuple<std::string, std::string, int>> vec;
-	std::string nstr; // ַ
-	// ѭ
+	std::string nstr; // 解析后的字符串
+	// 循环解析
 	for (std::size_t i = 0; i < __pattern.size(); ++i) {
-		//  % ţӸַ
+		// 如果不是 % 号，则添加该字符
 		if (__pattern[i] != '%') {
 			nstr.push_back(__pattern[i]);
 			continue;
 		}
 
 		// m_pattern[i] == % && m_pattern[i + 1] == '%'
-		// ʱڶַַͨ
+		// 此时第二个字符被视作普通字符
 		if ((i + 1) < __pattern.size() && __pattern[i + 1] == '%') {
 			nstr.push_back('%');
 			continue;
 		}
 
-		// m_pattern[i]% && m_pattern[i + 1] != '%'
-		std::size_t n = i + 1;		// '%','%'һַʼ
-		int fmt_status = 0;			// Ƿڵ: Ѿ'{',ǻû'}' ֵΪ1
-		std::size_t fmt_begin = 0;	// ſʼλ
+		// m_pattern[i]是% && m_pattern[i + 1] != '%'
+		std::size_t n = i + 1;		// 跳过'%',从'%'的下一个字符开始解析
+		int fmt_status = 0;			// 是否解析大括号内的内容: 已经遇到'{',但是还没有遇到'}' 值为1
+		std::size_t fmt_begin = 0;	// 大括号开始的位置
 
 		std::string str;
-		std::string fmt;			// '{}'мȡַ
+		std::string fmt;			// 存放'{}'中间截取的字符
 		while (n < __pattern.size()) {
-			// __pattern[n]ĸ && __pattern[n]'{' && __pattern[n]'}'
+			// __pattern[n]不是字母 && __pattern[n]不是'{' && __pattern[n]不是'}'
 			if (!fmt_status && (!isalpha(__pattern[n]) && __pattern[n] != '{' && __pattern[n] != '}')) {
 				str = __pattern.substr(i + 1, n - i - 1);
 				break;
@@ -340,12 +504,16 @@ void LogFormatter::init() {
 	}
 }
 
-std::string LogFormatter::format(LogEvent_ptr event) {
-	std::stringstream sstream;
+void LogFormatter::format(std::string& buf, const LogEvent& event) {
 	for (auto& item : __items) {
-		item->format(sstream, event);
+		item->format(buf, event);
 	}
-	return sstream.str();
+}
+
+std::string LogFormatter::format(const LogEvent& event) {
+	std::string buf;
+	format(buf, event);
+	return buf;
 }
 
 //****************************************************************************
@@ -353,35 +521,288 @@ std::string LogFormatter::format(LogEvent_ptr event) {
 //****************************************************************************
 
 void LogAppender::setFormatter(LogFormatter_ptr val) {
-	SpinLock::Lock lock(__mutex);
+	MutexType::Lock lock(__mutex);
 	this->__formatter = val;
 }
 
 LogFormatter_ptr LogAppender::getFormatter() {
-	SpinLock::Lock lock(__mutex);
+	MutexType::Lock lock(__mutex);
 	return this->__formatter;
 }
 
-void StdOutLogAppender::log(LogEvent_ptr event) {
-	SpinLock::Lock lock(__mutex);
-	std::cout << this->__formatter->format(event);
+void LogAppender::log(const LogEvent& event) {
+	std::string buf;
+	getFormatter()->format(buf, event);
+	write(buf.data(), buf.size());
+}
+
+void LogAppender::writeBatch(const iovec* iov, int count) {
+	for (int i = 0; i < count; ++i) {
+		write((const char*)iov[i].iov_base, iov[i].iov_len);
+	}
+}
+
+/*!
+ * @brief 写完 iov 中的全部内容，处理部分写入
+ */
+static void WriteAll(int fd, iovec* iov, int cnt) {
+	while (cnt > 0) {
+		ssize_t n = writev(fd, iov, cnt);
+		if (n < 0) {
+			if (errno == EINTR) continue;
+			return;
+		}
+		while (cnt > 0 && (size_t)n >= iov->iov_len) {
+			n -= iov->iov_len;
+			++iov;
+			--cnt;
+		}
+		if (cnt > 0) {
+			iov->iov_base = (char*)iov->iov_base + n;
+			iov->iov_len -= n;
+		}
+	}
+}
+
+/*!
+ * @brief 每次 writev 最多 LOG_IOV_BATCH 段
+ */
+static void WriteBatch(int fd, const iovec* iov, int count) {
+	static const int LOG_IOV_BATCH = 256;
+	iovec tmp[LOG_IOV_BATCH];
+	for (int i = 0; i < count; i += LOG_IOV_BATCH) {
+		int cnt = std::min(count - i, LOG_IOV_BATCH);
+		memcpy(tmp, iov + i, cnt * sizeof(iovec));
+		WriteAll(fd, tmp, cnt);
+	}
+}
+
+void StdOutLogAppender::write(const char* data, size_t size) {
+	MutexType::Lock lock(__mutex);
+	std::cout.write(data, size).flush();
+}
+
+void StdOutLogAppender::writeBatch(const iovec* iov, int count) {
+	MutexType::Lock lock(__mutex);
+	// 先清空 cout 中尚未输出的内容，保持与同步输出的先后顺序
+	std::cout.flush();
+	WriteBatch(STDOUT_FILENO, iov, count);
+}
+
+static ConfigVar_ptr<uint32_t> g_log_file_buffer_size =
+	Config::Lookup("log.file.buffer_size", (uint32_t)(64 * 1024), "bytes buffered by synchronous file appenders, 0 disables buffering");
+
+static ConfigVar_ptr<std::string> g_log_file_flush_level =
+	Config::Lookup("log.file.flush_level", std::string("ERROR"), "logs at or above this level flush the file buffer");
+
+static std::atomic<uint32_t> s_file_buffer_size = { 64 * 1024 };
+static std::atomic<int> s_file_flush_level = { (int)LogLevel::ERROR };
+
+struct _FileLogIniter {
+	_FileLogIniter() {
+		s_file_buffer_size = g_log_file_buffer_size->getValue();
+		g_log_file_buffer_size->addListener([](const uint32_t& old_value, const uint32_t& new_value) {
+			s_file_buffer_size = new_value;
+		});
+		s_file_flush_level = (int)LevelFromString(g_log_file_flush_level->getValue());
+		g_log_file_flush_level->addListener([](const std::string& old_value, const std::string& new_value) {
+			s_file_flush_level = (int)LevelFromString(new_value);
+		});
+	}
+};
+
+static _FileLogIniter s_file_log_initer;
+
+size_t FileLogBufferSize() {
+	return s_file_buffer_size.load(std::memory_order_relaxed);
+}
+
+LogLevel FileLogFlushLevel() {
+	return (LogLevel)s_file_flush_level.load(std::memory_order_relaxed);
+}
+
+// 带缓冲的输出地登记表。输出地可能在任意静态对象中创建，这里只用 pthread 原生锁与不析构的 vector
+static pthread_mutex_t s_buffered_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static std::vector<LogAppender*>& GetBufferedAppenders() {
+	static auto* s_appenders = new std::vector<LogAppender*>();
+	return *s_appenders;
+}
+
+void RegisterBufferedAppender(LogAppender* appender) {
+	pthread_mutex_lock(&s_buffered_mutex);
+	GetBufferedAppenders().push_back(appender);
+	pthread_mutex_unlock(&s_buffered_mutex);
+}
+
+void UnregisterBufferedAppender(LogAppender* appender) {
+	pthread_mutex_lock(&s_buffered_mutex);
+	auto& appenders = GetBufferedAppenders();
+	appenders.erase(std::remove(appenders.begin(), appenders.end(), appender), appenders.end());
+	pthread_mutex_unlock(&s_buffered_mutex);
+}
+
+void FlushBufferedAppenders() {
+	// 持有登记表的锁调用 flush，取消登记返回后输出地不会再被访问
+	pthread_mutex_lock(&s_buffered_mutex);
+	for (auto i : GetBufferedAppenders()) {
+		i->flush();
+	}
+	pthread_mutex_unlock(&s_buffered_mutex);
 }
 
 bool FileLogAppender::reopen() {
-	SpinLock::Lock lock(__mutex);
-	if (__file_stream) __file_stream.close();
-	__file_stream.open(__file_name, std::ios::app);
-	return !!__file_stream;
+	MutexType::Lock lock(__mutex);
+	flushBuffer();
+	if (__fd >= 0) close(__fd);
+	__fd = open(__file_name.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+	return __fd >= 0;
 }
 
 FileLogAppender::FileLogAppender(const std::string& file_name) 
 	: __file_name(file_name) {
 	reopen();
+	RegisterBufferedAppender(this);
 }
 
-void FileLogAppender::log(LogEvent_ptr event) {
-	SpinLock::Lock lock(__mutex);
-	__file_stream << __formatter->format(event);
+FileLogAppender::~FileLogAppender() {
+	UnregisterBufferedAppender(this);
+	flushBuffer();
+	if (__fd >= 0) close(__fd);
+}
+
+void FileLogAppender::flushBuffer() {
+	if (__buffer.empty()) return;
+	if (__fd >= 0) {
+		iovec iov = { (void*)__buffer.data(), __buffer.size() };
+		WriteAll(__fd, &iov, 1);
+	}
+	// 只清空内容，保留容量
+	__buffer.clear();
+}
+
+void FileLogAppender::write(const char* data, size_t size) {
+	MutexType::Lock lock(__mutex);
+	flushBuffer();
+	iovec iov = { (void*)data, size };
+	WriteAll(__fd, &iov, 1);
+}
+
+void FileLogAppender::writeLine(const char* data, size_t size, LogLevel level) {
+	MutexType::Lock lock(__mutex);
+	size_t limit = FileLogBufferSize();
+	bool urgent = level >= FileLogFlushLevel();
+	if (__buffer.size() + size < limit) {
+		__buffer.append(data, size);
+		if (urgent) {
+			flushBuffer();
+		}
+		return;
+	}
+	// 放不下时缓冲与本条一次 writev 写出
+	iovec iov[2] = { { (void*)__buffer.data(), __buffer.size() }, { (void*)data, size } };
+	int skip = __buffer.empty() ? 1 : 0;
+	if (__fd >= 0) {
+		WriteAll(__fd, iov + skip, 2 - skip);
+	}
+	__buffer.clear();
+}
+
+void FileLogAppender::writeBatch(const iovec* iov, int count) {
+	MutexType::Lock lock(__mutex);
+	flushBuffer();
+	WriteBatch(__fd, iov, count);
+}
+
+void FileLogAppender::flush() {
+	MutexType::Lock lock(__mutex);
+	flushBuffer();
+}
+
+//****************************************************************************
+// LogBatch
+//****************************************************************************
+
+void LogBatch::append(const LogAppender_ptr& appender, const LogFormatter_ptr& formatter, const LogEvent& event) {
+	size_t index = 0;
+	while (index < __bufferCount && __buffers[index].formatter != formatter) {
+		++index;
+	}
+	if (index == __bufferCount) {
+		if (index == __buffers.size()) {
+			__buffers.emplace_back();
+		}
+		__buffers[index].formatter = formatter;
+		++__bufferCount;
+	}
+	Buffer& buffer = __buffers[index];
+	if (buffer.last != &event) {
+		buffer.lastOffset = buffer.data.size();
+		formatter->format(buffer.data, event);
+		buffer.lastSize = buffer.data.size() - buffer.lastOffset;
+		buffer.last = &event;
+	}
+
+	size_t i = 0;
+	while (i < __appenderCount && __appenders[i].first != appender) {
+		++i;
+	}
+	if (i == __appenderCount) {
+		if (i == __appenders.size()) {
+			__appenders.emplace_back();
+		}
+		__appenders[i].first = appender;
+		++__appenderCount;
+	}
+	auto& slices = __appenders[i].second;
+	// 输出地接受合并时，与上一段在同一缓冲中相邻则合成一段
+	if (appender->acceptsCoalesced() && !slices.empty() && slices.back().buffer == index
+			&& slices.back().offset + slices.back().size == buffer.lastOffset) {
+		slices.back().size += buffer.lastSize;
+	} else {
+		slices.push_back(Slice{ index, buffer.lastOffset, buffer.lastSize });
+	}
+}
+
+void LogBatch::appendRaw(const LogAppender_ptr& appender, const LogEvent& event) {
+	appender->log(event);
+	if (std::find(__raws.begin(), __raws.end(), appender) == __raws.end()) {
+		__raws.push_back(appender);
+	}
+}
+
+void LogBatch::flush() {
+	static const size_t LOG_BATCH_KEEP = 4 * 1024 * 1024;
+	static thread_local std::vector<iovec> iov;
+	for (size_t i = 0; i < __appenderCount; ++i) {
+		auto& item = __appenders[i];
+		iov.clear();
+		for (auto& slice : item.second) {
+			iov.push_back(iovec{ (void*)(__buffers[slice.buffer].data.data() + slice.offset), slice.size });
+		}
+		item.first->writeBatch(iov.data(), iov.size());
+		// 不再持有输出地与格式器，被删除的输出地可以及时析构
+		item.first.reset();
+		item.second.clear();
+	}
+	for (size_t i = 0; i < __bufferCount; ++i) {
+		Buffer& buffer = __buffers[i];
+		buffer.formatter.reset();
+		buffer.last = nullptr;
+		// 偶发的大批量不长期占用内存
+		if (buffer.data.capacity() > LOG_BATCH_KEEP) {
+			std::string().swap(buffer.data);
+		} else {
+			buffer.data.clear();
+		}
+	}
+	__bufferCount = 0;
+	__appenderCount = 0;
+
+	for (auto& i : __raws) {
+		i->flush();
+	}
+	__raws.clear();
 }
 
 //****************************************************************************
@@ -390,12 +811,41 @@ void FileLogAppender::log(LogEvent_ptr event) {
 
 Logger::Logger(const std::string& name) :__name(name), __level(LogLevel::DEBUG) {}
 
-// һ־ķ(Ҫ鿴־)
-void Logger::log(LogEvent_ptr event) {
-	if (event->getLevel() >= __level) {
-		SpinLock::Lock lock(__mutex);
-		for (auto& i : __appenders) {
-			i->log(event);
+// 格式化结果的线程局部缓冲，重入时(输出过程中又打日志)改用临时缓冲
+static thread_local std::string t_log_line;
+static thread_local bool t_log_line_busy = false;
+
+// 一个输出日志的方法(传入想要查看的最大日志级别)
+void Logger::log(const LogEvent& event) {
+	if (event.getLevel() >= __level) {
+		std::string tmp;
+		std::string* line = &tmp;
+		bool reentrant = t_log_line_busy;
+		if (!reentrant) {
+			t_log_line_busy = true;
+			line = &t_log_line;
+		}
+
+		// 在 RCU 读临界区内持有锁写文件，不能把写操作交给 FileIOPool 后让出协程
+		FileIOPool::InlineGuard guard;
+		Rcu::ReadLock lock;
+		LogFormatter* last = nullptr;
+		for (auto& i : *__appenders.get()) {
+			if (i->isRaw()) {
+				i->log(event);
+				continue;
+			}
+			LogFormatter_ptr formatter = i->getFormatter();
+			if (formatter.get() != last) {
+				line->clear();
+				formatter->format(*line, event);
+				last = formatter.get();
+			}
+			i->writeLine(line->data(), line->size(), event.getLevel());
+		}
+
+		if (!reentrant) {
+			t_log_line_busy = false;
 		}
 	}
 }
@@ -413,17 +863,237 @@ void Logger::setLevel(LogLevel val) {
 }
 
 void Logger::addAppender(LogAppender_ptr appender) {
-	SpinLock::Lock lock(__mutex);
-	this->__appenders.push_back(appender);
+	__appenders.update([&appender](AppenderList& appenders) {
+		appenders.push_back(appender);
+		return true;
+	});
 }
 
 void Logger::delAppender(LogAppender_ptr appender) {
-	SpinLock::Lock lock(__mutex);
-	for (auto it = __appenders.begin(); it != __appenders.end(); ++it) {
-		if (*it == appender) {
-			__appenders.erase(it);
-			break;
+	__appenders.update([&appender](AppenderList& appenders) {
+		for (auto it = appenders.begin(); it != appenders.end(); ++it) {
+			if (*it == appender) {
+				appenders.erase(it);
+				return true;
+			}
+		}
+		return false;
+	});
+}
+
+void Logger::appendTo(const LogEvent& event, LogBatch& batch) {
+	if (event.getLevel() < __level) return;
+	Rcu::ReadLock lock;
+	for (auto& i : *__appenders.get()) {
+		if (i->isRaw()) {
+			// 按时间排序后逐条交给输出地，同一输出地内仍保持顺序
+			batch.appendRaw(i, event);
+			continue;
 		}
+		batch.append(i, i->getFormatter(), event);
+	}
+}
+
+//****************************************************************************
+// LogStream
+//****************************************************************************
+
+/*!
+ * @brief 写入线程局部缓冲的输出流，按嵌套深度复用
+ */
+class LogStream : public std::ostream {
+private:
+	class Buf : public std::streambuf {
+	public:
+		std::string data;
+	protected:
+		int_type overflow(int_type c) override {
+			if (c != traits_type::eof()) {
+				data.push_back((char)c);
+			}
+			return c;
+		}
+
+		std::streamsize xsputn(const char* s, std::streamsize n) override {
+			data.append(s, n);
+			return n;
+		}
+	};
+
+	Buf __buf;
+public:
+	bool inUse = false;
+
+	LogStream() : std::ostream(nullptr) {
+		rdbuf(&__buf);
+	}
+
+	/*!
+	 * @brief 清空内容并恢复默认格式(上一条日志可能设置了 hex、精度等)
+	 */
+	void reset() {
+		__buf.data.clear();
+		clear();
+		flags(std::ios_base::skipws | std::ios_base::dec);
+		precision(6);
+		width(0);
+		fill(' ');
+	}
+
+	const std::string& data() const { return __buf.data; }
+};
+
+/*!
+ * @brief 线程局部的 LogStream 池，线程退出后改为每次临时创建
+ */
+struct LogStreamPool {
+	std::vector<LogStream*> streams;
+
+	~LogStreamPool();
+};
+
+static thread_local LogStreamPool* t_stream_pool = nullptr;
+static thread_local bool t_stream_pool_exited = false;
+static thread_local LogStreamPool t_stream_pool_holder;
+
+LogStreamPool::~LogStreamPool() {
+	for (auto i : streams) {
+		delete i;
+	}
+	t_stream_pool = nullptr;
+	t_stream_pool_exited = true;
+}
+
+static LogStream* AcquireLogStream() {
+	if (!t_stream_pool) {
+		if (t_stream_pool_exited) {
+			LogStream* stream = new LogStream();
+			stream->inUse = true;
+			return stream;
+		}
+		t_stream_pool = &t_stream_pool_holder;
+	}
+	for (auto i : t_stream_pool->streams) {
+		if (!i->inUse) {
+			i->inUse = true;
+			i->reset();
+			return i;
+		}
+	}
+	LogStream* stream = new LogStream();
+	stream->inUse = true;
+	t_stream_pool->streams.push_back(stream);
+	return stream;
+}
+
+static void ReleaseLogStream(LogStream* stream) {
+	if (t_stream_pool_exited && !t_stream_pool) {
+		delete stream;
+		return;
+	}
+	stream->inUse = false;
+}
+
+//****************************************************************************
+// LogLimiter
+//****************************************************************************
+
+static ConfigVar_ptr<uint32_t> g_log_limit_summary_interval =
+	Config::Lookup("log.limit.summary_interval", (uint32_t)10, "seconds between suppressed log summaries");
+
+static std::atomic<uint32_t> s_summary_interval = { 10 };
+
+struct _LogLimiterIniter {
+	_LogLimiterIniter() {
+		s_summary_interval = g_log_limit_summary_interval->getValue();
+		g_log_limit_summary_interval->addListener([](const uint32_t& old_value, const uint32_t& new_value) {
+			s_summary_interval = new_value;
+		});
+	}
+};
+
+static _LogLimiterIniter s_log_limiter_initer;
+
+static std::atomic<LogLimiter*> s_limiters = { nullptr };	// 有过抑制的调用处
+static std::atomic<bool> s_limit_pending = { false };		// 是否有尚未汇总的抑制
+static std::atomic<int64_t> s_next_summary = { 0 };			// 下次汇总的时间(秒)
+
+
+LogLimiter::LogLimiter(const LogLocation& location, uint32_t first, uint32_t every, uint32_t per_second)
+	: __location(location)
+	, __first(first)
+	, __every(every)
+	, __perSecond(per_second) {
+}
+
+bool LogLimiter::allow() {
+	bool pass = true;
+	// every 为 1 时只限流，不需要采样计数
+	if (__every != 1) {
+		uint64_t n = __count.fetch_add(1, std::memory_order_relaxed);
+		pass = n < __first || (__every && (n - __first) % __every == 0);
+	}
+	if (pass && __perSecond) {
+		int64_t now = Clock::WallSecond();
+		int64_t window = __window.load(std::memory_order_relaxed);
+		// 换秒时只有一个线程清零，其余线程可能多计入几条，可以接受
+		if (window != now && __window.compare_exchange_strong(window, now, std::memory_order_relaxed)) {
+			__windowCount.store(0, std::memory_order_relaxed);
+		}
+		pass = __windowCount.fetch_add(1, std::memory_order_relaxed) < __perSecond;
+	}
+	if (!pass) {
+		suppress();
+	}
+	return pass;
+}
+
+void LogLimiter::suppress() {
+	uint64_t n = __suppressed.fetch_add(1, std::memory_order_relaxed);
+	if (n == 0 && !__registered.exchange(true)) {
+		LogLimiter* head = s_limiters.load(std::memory_order_relaxed);
+		do {
+			__next = head;
+		} while (!s_limiters.compare_exchange_weak(head, this, std::memory_order_release, std::memory_order_relaxed));
+		// 汇总由刷写线程定时完成
+		AsyncLogger::EnsureStarted();
+	}
+	if (!s_limit_pending.load(std::memory_order_relaxed)) {
+		s_limit_pending.store(true, std::memory_order_relaxed);
+	}
+}
+
+uint64_t LogLimiter::Summary() {
+	s_limit_pending.store(false, std::memory_order_relaxed);
+	// 下一次定时汇总从现在开始计时
+	s_next_summary.store(Clock::WallSecond() + s_summary_interval.load(std::memory_order_relaxed),
+						 std::memory_order_relaxed);
+	std::stringstream ss;
+	uint64_t total = 0;
+	for (LogLimiter* i = s_limiters.load(std::memory_order_acquire); i; i = i->__next) {
+		uint64_t n = i->__suppressed.exchange(0, std::memory_order_relaxed);
+		if (n) {
+			ss << " " << i->__location.file << ":" << i->__location.line << "=" << n;
+			total += n;
+		}
+	}
+	if (total) {
+		SYLAR_LOG_WARN(SYLAR_LOG_ROOT()) << "suppressed " << total << " log lines:" << ss.str();
+	}
+	return total;
+}
+
+void LogLimiter::Poll() {
+	if (!s_limit_pending.load(std::memory_order_relaxed)) {
+		return;
+	}
+	int64_t now = Clock::WallSecond();
+	int64_t next = s_next_summary.load(std::memory_order_relaxed);
+	// 第一次抑制时只开始计时，不立即汇总
+	if (!next) {
+		s_next_summary.store(now + s_summary_interval.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	} else if (now >= next) {
+		Summary();
 	}
 }
 
@@ -431,20 +1101,52 @@ void Logger::delAppender(LogAppender_ptr appender) {
 // LogEventWrap
 //****************************************************************************
 
-LogEventWrap::LogEventWrap(Logger_ptr logger, LogEvent_ptr event_ptr)
-	:__logger(logger), __event_ptr(event_ptr) {
+// 线程 id 每条日志都要用，缓存下来省掉 gettid 系统调用
+static thread_local uint32_t t_log_thread_id = 0;
+
+static LogEvent NewLogEvent(const Logger_ptr& logger, LogLevel level, const LogLocation& location) {
+	if (!t_log_thread_id) {
+		t_log_thread_id = GetThreadId();
+	}
+	uint64_t now = Clock::WallUS();
+	return LogEvent(logger->getName(), level, location.file, location.line, 0,
+					t_log_thread_id, "log_thread", 1, now / 1000000, now % 1000000);
+}
+
+LogEventWrap::LogEventWrap(const Logger_ptr& logger, LogLevel level, const LogLocation& location)
+	: __logger(logger)
+	, __event(NewLogEvent(logger, level, location))
+	, __stream(AcquireLogStream()) {
 }
 
 LogEventWrap::~LogEventWrap() {
-	this->__logger->log(__event_ptr);
+	const std::string& data = __stream->data();
+	__event.setMessage(data.data(), data.size());
+	do {
+		if (AsyncLogger::IsEnabled()) {
+			auto async_logger = AsyncLogger_single::GetInstance();
+			if (__event.getLevel() < LogLevel::FATAL) {
+				if (async_logger->push(__logger, __event)) break;
+			} else {
+				// FATAL 之前的日志先全部写出，本条同步输出
+				async_logger->drain();
+			}
+		}
+		this->__logger->log(__event);
+	} while (false);
+	ReleaseLogStream(__stream);
+	// 文件缓冲由刷写线程定时刷出
+	if (FileLogBufferSize()) {
+		AsyncLogger::EnsureStarted();
+	}
 }
 
-LogEvent_ptr LogEventWrap::getEvent() const {
-	return this->__event_ptr;
+const LogEvent& LogEventWrap::getEvent() const {
+	return this->__event;
 }
 
-std::stringstream& LogEventWrap::getSS() {
-	return this->__event_ptr->getSS();
+std::ostream& LogEventWrap::getSS() {
+	return *this->__stream;
 }
 
 //****************************************************************************
@@ -462,9 +1164,10 @@ LoggerManager::LoggerManager() : __root(std::make_shared<Logger>()) {
 }
 
 Logger_ptr LoggerManager::getLogger(const std::string& name) {
-	SpinLock::Lock lock(__mutex);
-	auto it = __loggers.find(name);
-	if (it == __loggers.end()) return __root;
+	Rcu::ReadLock lock;
+	const LoggerMap* loggers = __loggers.get();
+	auto it = loggers->find(name);
+	if (it == loggers->end()) return __root;
 	else return it->second;
 }
 
@@ -0,0 +1,85 @@
+#include "Metrics.h"
+
+namespace sylar
+{
+
+//****************************************************************************
+// Histogram
+//****************************************************************************
+
+Histogram::Histogram() {
+	reset();
+}
+
+void Histogram::record(uint64_t v) {
+	size_t idx = v ? 64 - __builtin_clzll(v) : 0;
+	// 只有一个线程写入，读后写即可，不需要带锁的读改写
+	__buckets[idx].store(__buckets[idx].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	__count.store(__count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	__sum.store(__sum.load(std::memory_order_relaxed) + v, std::memory_order_relaxed);
+	if (v > __max.load(std::memory_order_relaxed)) {
+		__max.store(v, std::memory_order_relaxed);
+	}
+}
+
+void Histogram::merge(const Histogram& other) {
+	for (size_t i = 0; i < BUCKETS; ++i) {
+		__buckets[i].fetch_add(other.__buckets[i].load(std::memory_order_relaxed),
+							   std::memory_order_relaxed);
+	}
+	__count.fetch_add(other.getCount(), std::memory_order_relaxed);
+	__sum.fetch_add(other.getSum(), std::memory_order_relaxed);
+	uint64_t v = other.getMax();
+	uint64_t max = __max.load(std::memory_order_relaxed);
+	while (v > max && !__max.compare_exchange_weak(max, v, std::memory_order_relaxed));
+}
+
+void Histogram::reset() {
+	for (size_t i = 0; i < BUCKETS; ++i) {
+		__buckets[i].store(0, std::memory_order_relaxed);
+	}
+	__count.store(0, std::memory_order_relaxed);
+	__sum.store(0, std::memory_order_relaxed);
+	__max.store(0, std::memory_order_relaxed);
+}
+
+uint64_t Histogram::getCount() const {
+	return __count.load(std::memory_order_relaxed);
+}
+
+uint64_t Histogram::getSum() const {
+	return __sum.load(std::memory_order_relaxed);
+}
+
+uint64_t Histogram::getMax() const {
+	return __max.load(std::memory_order_relaxed);
+}
+
+uint64_t Histogram::percentile(double p) const {
+	uint64_t total = getCount();
+	if (total == 0) return 0;
+	uint64_t target = (uint64_t)(total * p);
+	if (target >= total) target = total - 1;
+	uint64_t seen = 0;
+	for (size_t i = 0; i < BUCKETS; ++i) {
+		seen += __buckets[i].load(std::memory_order_relaxed);
+		if (seen > target) {
+			if (i == 0) return 0;
+			if (i == 64) return getMax();
+			return (1ull << i) - 1;
+		}
+	}
+	return getMax();
+}
+
+std::ostream& Histogram::dump(std::ostream& os) const {
+	uint64_t count = getCount();
+	os << "count=" << count
+		<< " avg=" << (count ? getSum() / count : 0)
+		<< " p50<=" << percentile(0.5)
+		<< " p99<=" << percentile(0.99)
+		<< " max=" << getMax();
+	return os;
+}
+
+}; /* sylar */
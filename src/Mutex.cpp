@@ -1,7 +1,158 @@
 #include "Mutex.h"
+#include "Config.h"
+#include <limits.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <map>
+#include <algorithm>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
 
 namespace sylar {
 
+//****************************************************************************
+// LockProfiler
+//****************************************************************************
+
+static ConfigVar_ptr<bool> g_lock_profile =
+    Config::Lookup("lock.profile", false, "record lock contention statistics");
+
+std::atomic<bool> LockProfiler::s_enabled = { false };
+
+struct _LockProfileIniter {
+    _LockProfileIniter() {
+        LockProfiler::SetEnabled(g_lock_profile->getValue());
+        g_lock_profile->addListener([](const bool& old_value, const bool& new_value) {
+            LockProfiler::SetEnabled(new_value);
+        });
+    }
+};
+
+static _LockProfileIniter s_lock_profile_initer;
+
+// 统计项注册表。锁本身可能在任意静态对象中使用，这里只用 pthread 原生锁与不析构的 map
+static pthread_mutex_t s_registry_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static std::map<std::string, std::shared_ptr<LockStats>>& GetRegistry() {
+    static auto* s_registry = new std::map<std::string, std::shared_ptr<LockStats>>();
+    return *s_registry;
+}
+
+static inline uint64_t NowNS() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/*!
+ * @brief 记录一次加锁
+ * @param wait_begin 非 0 表示首次尝试失败，从该时刻开始等待
+ * @param exclusive 是否独占持有，独占时从现在开始统计持有时间
+ */
+static void OnAcquired(LockSite& site, uint64_t wait_begin, bool exclusive) {
+    LockStats* stats = LockProfiler::GetStats(site);
+    stats->acquisitions.fetch_add(1, std::memory_order_relaxed);
+    if (wait_begin || exclusive) {
+        uint64_t now = NowNS();
+        if (wait_begin) {
+            stats->contended.fetch_add(1, std::memory_order_relaxed);
+            stats->waitNS.fetch_add(now - wait_begin, std::memory_order_relaxed);
+        }
+        if (exclusive) {
+            site.acquiredNS = now;
+        }
+    }
+}
+
+/*!
+ * @brief 记录一次独占持有的结束，在解锁前调用
+ */
+static void OnReleasing(LockSite& site) {
+    uint64_t hold = NowNS() - site.acquiredNS;
+    site.acquiredNS = 0;
+    LockStats* stats = LockProfiler::GetStats(site);
+    uint64_t v = stats->maxHoldNS.load(std::memory_order_relaxed);
+    while (hold > v && !stats->maxHoldNS.compare_exchange_weak(v, hold, std::memory_order_relaxed));
+}
+
+void LockProfiler::SetEnabled(bool v) {
+    s_enabled.store(v, std::memory_order_relaxed);
+}
+
+void LockProfiler::Reset() {
+    pthread_mutex_lock(&s_registry_mutex);
+    // 锁中缓存了统计项的指针，只清零不删除
+    for (auto& i : GetRegistry()) {
+        i.second->acquisitions = 0;
+        i.second->contended = 0;
+        i.second->waitNS = 0;
+        i.second->maxHoldNS = 0;
+    }
+    pthread_mutex_unlock(&s_registry_mutex);
+}
+
+LockStats* LockProfiler::GetStats(LockSite& site) {
+    LockStats* stats = site.stats.load(std::memory_order_acquire);
+    if (__builtin_expect(stats != nullptr, 1)) {
+        return stats;
+    }
+
+    std::string key = site.name ? site.name : "";
+    if (key.empty()) {
+        const char* base = strrchr(site.file, '/');
+        key = std::string(base ? base + 1 : site.file) + ":" + std::to_string(site.line);
+    }
+    pthread_mutex_lock(&s_registry_mutex);
+    auto& ptr = GetRegistry()[key];
+    if (!ptr) {
+        ptr = std::make_shared<LockStats>();
+        ptr->name = key;
+    }
+    stats = ptr.get();
+    pthread_mutex_unlock(&s_registry_mutex);
+    site.stats.store(stats, std::memory_order_release);
+    return stats;
+}
+
+std::vector<std::shared_ptr<LockStats>> LockProfiler::GetReport() {
+    std::vector<std::shared_ptr<LockStats>> report;
+    pthread_mutex_lock(&s_registry_mutex);
+    for (auto& i : GetRegistry()) {
+        auto item = std::make_shared<LockStats>();
+        item->name = i.second->name;
+        item->acquisitions = i.second->acquisitions.load(std::memory_order_relaxed);
+        item->contended = i.second->contended.load(std::memory_order_relaxed);
+        item->waitNS = i.second->waitNS.load(std::memory_order_relaxed);
+        item->maxHoldNS = i.second->maxHoldNS.load(std::memory_order_relaxed);
+        if (item->acquisitions) {
+            report.push_back(item);
+        }
+    }
+    pthread_mutex_unlock(&s_registry_mutex);
+
+    std::sort(report.begin(), report.end(), [](const std::shared_ptr<LockStats>& a,
+                                               const std::shared_ptr<LockStats>& b) {
+        return a->waitNS > b->waitNS;
+    });
+    return report;
+}
+
+std::ostream& LockProfiler::Dump(std::ostream& os, size_t n) {
+    auto report = GetReport();
+    os << "[LockProfiler enabled=" << IsEnabled() << " locks=" << report.size() << "]" << std::endl;
+    for (size_t i = 0; i < report.size() && i < n; ++i) {
+        auto& item = report[i];
+        os << "    " << item->name
+           << " acquisitions=" << item->acquisitions
+           << " contended=" << item->contended
+           << " wait_us=" << item->waitNS / 1000
+           << " max_hold_us=" << item->maxHoldNS / 1000 << std::endl;
+    }
+    return os;
+}
+
 //****************************************************************************
 // Semaphore
 //****************************************************************************
@@ -22,6 +173,26 @@ void Semaphore::wait() {
     }
 }
 
+bool Semaphore::wait(uint64_t timeout_ms) {
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_sec += timeout_ms / 1000;
+    ts.tv_nsec += (timeout_ms % 1000) * 1000000;
+    if (ts.tv_nsec >= 1000000000) {
+        ++ts.tv_sec;
+        ts.tv_nsec -= 1000000000;
+    }
+    while (sem_timedwait(&__semaphore, &ts)) {
+        if (errno == ETIMEDOUT) {
+            return false;
+        }
+        if (errno != EINTR) {
+            throw std::logic_error("sem_timedwait error");
+        }
+    }
+    return true;
+}
+
 void Semaphore::notify() {
     if (sem_post(&__semaphore)) {
         throw std::logic_error("sem_post error");
@@ -32,7 +203,7 @@ void Semaphore::notify() {
 // SpinLock
 //****************************************************************************
 
-SpinLock::SpinLock() {
+SpinLock::SpinLock(const char* name, const char* file, int line) : ProfiledLock(name, file, line) {
     pthread_spin_init(&__mutex, 0);
 }
 
@@ -41,10 +212,22 @@ SpinLock::~SpinLock() {
 }
 
 void SpinLock::lock() {
+    if (__builtin_expect(LockProfiler::IsEnabled(), 0)) {
+        uint64_t begin = 0;
+        if (pthread_spin_trylock(&__mutex)) {
+            begin = NowNS();
+            pthread_spin_lock(&__mutex);
+        }
+        OnAcquired(__site, begin, true);
+        return;
+    }
     pthread_spin_lock(&__mutex);
 }
 
 void SpinLock::unlock() {
+    if (__site.acquiredNS) {
+        OnReleasing(__site);
+    }
     pthread_spin_unlock(&__mutex);
 }
 
@@ -52,17 +235,29 @@ void SpinLock::unlock() {
 // CASLock
 //****************************************************************************
 
-CASLock::CASLock() {
+CASLock::CASLock(const char* name, const char* file, int line) : ProfiledLock(name, file, line) {
     __mutex.clear();
 }
 
 CASLock::~CASLock() {}
 
 void CASLock::lock() {
+    if (__builtin_expect(LockProfiler::IsEnabled(), 0)) {
+        uint64_t begin = 0;
+        if (std::atomic_flag_test_and_set_explicit(&__mutex, std::memory_order_acquire)) {
+            begin = NowNS();
+            while (std::atomic_flag_test_and_set_explicit(&__mutex, std::memory_order_acquire));
+        }
+        OnAcquired(__site, begin, true);
+        return;
+    }
     while (std::atomic_flag_test_and_set_explicit(&__mutex, std::memory_order_acquire));
 }
 
 void CASLock::unlock() {
+    if (__site.acquiredNS) {
+        OnReleasing(__site);
+    }
     std::atomic_flag_clear_explicit(&__mutex, std::memory_order_release);
 }
 
@@ -70,7 +265,7 @@ void CASLock::unlock() {
 // Mutex
 //****************************************************************************
 
-Mutex::Mutex() {
+Mutex::Mutex(const char* name, const char* file, int line) : ProfiledLock(name, file, line) {
     pthread_mutex_init(&__mutex, nullptr);
 }
 
@@ -79,13 +274,240 @@ Mutex::~Mutex() {
 }
 
 void Mutex::lock() {
+    if (__builtin_expect(LockProfiler::IsEnabled(), 0)) {
+        uint64_t begin = 0;
+        if (pthread_mutex_trylock(&__mutex)) {
+            begin = NowNS();
+            pthread_mutex_lock(&__mutex);
+        }
+        OnAcquired(__site, begin, true);
+        return;
+    }
     pthread_mutex_lock(&__mutex);
 }
 
 void Mutex::unlock() {
+    if (__site.acquiredNS) {
+        OnReleasing(__site);
+    }
     pthread_mutex_unlock(&__mutex);
 }
 
+//****************************************************************************
+// futex
+//****************************************************************************
+
+static inline void CpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield" ::: "memory");
+#endif
+}
+
+static inline void FutexWait(std::atomic<int>* addr, int expected) {
+    syscall(SYS_futex, (int*)addr, FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+}
+
+static inline void FutexWake(std::atomic<int>* addr, int count) {
+    syscall(SYS_futex, (int*)addr, FUTEX_WAKE_PRIVATE, count, nullptr, nullptr, 0);
+}
+
+// 自适应自旋的上限(次)与每次自旋的最大退避(pause 条数)
+static const int MAX_SPINS = 100;
+static const int MAX_BACKOFF = 64;
+
+//****************************************************************************
+// FutexMutex
+//****************************************************************************
+
+FutexMutex::FutexMutex(const char* name, const char* file, int line) : ProfiledLock(name, file, line) {}
+
+FutexMutex::~FutexMutex() {}
+
+bool FutexMutex::tryLock() {
+    int expected = 0;
+    return __state.compare_exchange_strong(expected, 1, std::memory_order_acquire);
+}
+
+void FutexMutex::lock() {
+    if (__builtin_expect(LockProfiler::IsEnabled(), 0)) {
+        uint64_t begin = 0;
+        if (!tryLock()) {
+            begin = NowNS();
+            lockSlow();
+        }
+        OnAcquired(__site, begin, true);
+        return;
+    }
+    if (!tryLock()) {
+        lockSlow();
+    }
+}
+
+void FutexMutex::lockSlow() {
+    // 自旋阶段：上限为近期平均值的两倍，退避时间指数增长
+    int spins = __spins.load(std::memory_order_relaxed);
+    int limit = std::min(MAX_SPINS, spins * 2 + 10);
+    int backoff = 1;
+    for (int i = 0; i < limit; ++i) {
+        for (int j = 0; j < backoff; ++j) {
+            CpuRelax();
+        }
+        if (__state.load(std::memory_order_relaxed) == 0 && tryLock()) {
+            __spins.store(spins + (i - spins) / 8, std::memory_order_relaxed);
+            return;
+        }
+        backoff = std::min(backoff * 2, MAX_BACKOFF);
+    }
+    __spins.store(spins + (limit - spins) / 8, std::memory_order_relaxed);
+
+    // 睡眠阶段：标记有等待者，解锁方据此决定是否需要唤醒
+    while (__state.exchange(2, std::memory_order_acquire) != 0) {
+        FutexWait(&__state, 2);
+    }
+}
+
+void FutexMutex::unlock() {
+    if (__site.acquiredNS) {
+        OnReleasing(__site);
+    }
+    if (__state.exchange(0, std::memory_order_release) == 2) {
+        FutexWake(&__state, 1);
+    }
+}
+
+//****************************************************************************
+// FutexRWMutex
+//****************************************************************************
+
+static std::atomic<size_t> s_rw_slot_seq = { 0 };
+static thread_local size_t t_rw_slot = s_rw_slot_seq++ % FutexRWMutex::SLOTS;
+
+FutexRWMutex::FutexRWMutex(const char* name, const char* file, int line)
+    : ProfiledLock(name, file, line)
+    , __writerMutex("FutexRWMutex.writer", file, line) {
+}
+
+FutexRWMutex::~FutexRWMutex() {}
+
+int64_t FutexRWMutex::readers() const {
+    int64_t sum = 0;
+    for (auto& i : __slots) {
+        sum += i.readers.load(std::memory_order_seq_cst);
+    }
+    return sum;
+}
+
+bool FutexRWMutex::tryRdlock() {
+    Slot& slot = __slots[t_rw_slot];
+    slot.readers.fetch_add(1, std::memory_order_seq_cst);
+    if (__writer.load(std::memory_order_seq_cst) == 0) {
+        return true;
+    }
+    // 写优先：退出并唤醒可能在等待读者清空的写者
+    slot.readers.fetch_sub(1, std::memory_order_seq_cst);
+    __drain.fetch_add(1, std::memory_order_seq_cst);
+    FutexWake(&__drain, 1);
+    return false;
+}
+
+void FutexRWMutex::waitWriter() {
+    int backoff = 1;
+    for (int i = 0; i < MAX_SPINS / 10; ++i) {
+        if (__writer.load(std::memory_order_relaxed) == 0) {
+            return;
+        }
+        for (int j = 0; j < backoff; ++j) {
+            CpuRelax();
+        }
+        backoff = std::min(backoff * 2, MAX_BACKOFF);
+    }
+    int w;
+    while ((w = __writer.load(std::memory_order_acquire)) != 0) {
+        FutexWait(&__writer, w);
+    }
+}
+
+void FutexRWMutex::rdlock() {
+    if (__builtin_expect(LockProfiler::IsEnabled(), 0)) {
+        uint64_t begin = 0;
+        if (!tryRdlock()) {
+            begin = NowNS();
+            do {
+                waitWriter();
+            } while (!tryRdlock());
+        }
+        OnAcquired(__site, begin, false);
+        return;
+    }
+    while (!tryRdlock()) {
+        waitWriter();
+    }
+}
+
+void FutexRWMutex::wrlock() {
+    if (__builtin_expect(LockProfiler::IsEnabled(), 0)) {
+        uint64_t begin = NowNS();
+        OnAcquired(__site, wrlockImpl() ? begin : 0, true);
+        return;
+    }
+    wrlockImpl();
+}
+
+bool FutexRWMutex::wrlockImpl() {
+    bool waited = false;
+    if (!__writerMutex.tryLock()) {
+        __writerMutex.lock();
+        waited = true;
+    }
+    __writer.store(1, std::memory_order_seq_cst);
+    if (readers() == 0) {
+        __writer.store(2, std::memory_order_relaxed);
+        return waited;
+    }
+
+    int backoff = 1;
+    for (int i = 0; i < MAX_SPINS; ++i) {
+        for (int j = 0; j < backoff; ++j) {
+            CpuRelax();
+        }
+        backoff = std::min(backoff * 2, MAX_BACKOFF);
+        if (readers() == 0) {
+            __writer.store(2, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    while (true) {
+        int seq = __drain.load(std::memory_order_seq_cst);
+        if (readers() == 0) {
+            break;
+        }
+        FutexWait(&__drain, seq);
+    }
+    __writer.store(2, std::memory_order_relaxed);
+    return true;
+}
+
+void FutexRWMutex::unlock() {
+    // 写者持有锁时不可能有读者持有读锁，据此区分解的是哪种锁
+    if (__writer.load(std::memory_order_relaxed) == 2) {
+        if (__site.acquiredNS) {
+            OnReleasing(__site);
+        }
+        __writer.store(0, std::memory_order_seq_cst);
+        FutexWake(&__writer, INT_MAX);
+        __writerMutex.unlock();
+        return;
+    }
+
+    __slots[t_rw_slot].readers.fetch_sub(1, std::memory_order_seq_cst);
+    if (__writer.load(std::memory_order_seq_cst) != 0) {
+        __drain.fetch_add(1, std::memory_order_seq_cst);
+        FutexWake(&__drain, 1);
+    }
+}
+
 //****************************************************************************
 // NullMutex
 //****************************************************************************
@@ -102,7 +524,7 @@ void NullMutex::unlock() {}
 // RWMutex
 //****************************************************************************
 
-RWMutex::RWMutex() {
+RWMutex::RWMutex(const char* name, const char* file, int line) : ProfiledLock(name, file, line) {
     pthread_rwlock_init(&__lock, nullptr);
 }
 
@@ -111,14 +533,36 @@ RWMutex::~RWMutex() {
 }
 
 void RWMutex::rdlock() {
+    if (__builtin_expect(LockProfiler::IsEnabled(), 0)) {
+        uint64_t begin = 0;
+        if (pthread_rwlock_tryrdlock(&__lock)) {
+            begin = NowNS();
+            pthread_rwlock_rdlock(&__lock);
+        }
+        OnAcquired(__site, begin, false);
+        return;
+    }
     pthread_rwlock_rdlock(&__lock);
 }
 
 void RWMutex::wrlock() {
+    if (__builtin_expect(LockProfiler::IsEnabled(), 0)) {
+        uint64_t begin = 0;
+        if (pthread_rwlock_trywrlock(&__lock)) {
+            begin = NowNS();
+            pthread_rwlock_wrlock(&__lock);
+        }
+        OnAcquired(__site, begin, true);
+        return;
+    }
     pthread_rwlock_wrlock(&__lock);
 }
 
 void RWMutex::unlock() {
+    // 只有写者会设置 acquiredNS，写者持有时没有读者
+    if (__site.acquiredNS) {
+        OnReleasing(__site);
+    }
     pthread_rwlock_unlock(&__lock);
 }
 
@@ -0,0 +1,162 @@
+#include "Rcu.h"
+#include <pthread.h>
+#include <deque>
+#include <vector>
+
+namespace sylar {
+
+//****************************************************************************
+// Rcu 内部状态
+//****************************************************************************
+
+/*!
+ * @brief 每个线程一条记录，线程退出后可被新线程复用，从不释放
+ */
+struct alignas(64) RcuRecord {
+    std::atomic<uint64_t> epoch = { 0 };    // 进入读临界区时的全局 epoch，0 表示不在临界区
+    std::atomic<bool> used = { false };     // 是否被某个线程占用
+    uint32_t nesting = 0;                   // 读临界区嵌套层数，只由所属线程访问
+    RcuRecord* next = nullptr;
+};
+
+/*!
+ * @brief 待回收对象
+ */
+struct RcuRetired {
+    uint64_t epoch;                         // 交给 Retire 时的全局 epoch
+    std::function<void()> fun;
+};
+
+// 全局 epoch 从 1 开始，0 留给"不在临界区"
+static std::atomic<uint64_t> s_epoch = { 1 };
+static std::atomic<RcuRecord*> s_records = { nullptr };
+static std::atomic<uint64_t> s_pending = { 0 };
+
+// 注册表等静态对象在初始化时就会用到，这里只用 pthread 原生锁与不析构的队列
+static pthread_mutex_t s_retired_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static std::deque<RcuRetired>& GetRetired() {
+    static auto* s_retired = new std::deque<RcuRetired>();
+    return *s_retired;
+}
+
+static thread_local RcuRecord* t_record = nullptr;
+static thread_local bool t_exited = false;
+
+/*!
+ * @brief 线程退出时交还记录
+ */
+struct RcuRecordReleaser {
+    ~RcuRecordReleaser() {
+        if (t_record) {
+            t_record->epoch.store(0, std::memory_order_release);
+            t_record->used.store(false, std::memory_order_release);
+        }
+        t_record = nullptr;
+        t_exited = true;
+    }
+};
+
+static thread_local RcuRecordReleaser t_releaser;
+
+static RcuRecord* AcquireRecord() {
+    // 线程退出阶段(例如静态对象析构)仍可能读注册表，此时占用的记录不再交还
+    if (!t_exited) {
+        (void)&t_releaser;
+    }
+    for (RcuRecord* r = s_records.load(std::memory_order_acquire); r; r = r->next) {
+        bool expected = false;
+        if (!r->used.load(std::memory_order_relaxed)
+            && r->used.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+            t_record = r;
+            return r;
+        }
+    }
+    RcuRecord* r = new RcuRecord();
+    r->used.store(true, std::memory_order_relaxed);
+    r->next = s_records.load(std::memory_order_relaxed);
+    while (!s_records.compare_exchange_weak(r->next, r, std::memory_order_release,
+                                            std::memory_order_relaxed));
+    t_record = r;
+    return r;
+}
+
+/*!
+ * @brief 回收所有早于最老读者的对象，另一个线程正在回收时直接返回
+ */
+static void Reclaim() {
+    if (s_pending.load(std::memory_order_relaxed) == 0) {
+        return;
+    }
+    // 先持锁冻结待回收队列再扫描读者：队列中的对象都在扫描开始前交出，
+    // 扫描之后才交出的对象可能正被扫描时还不在临界区的读者持有
+    if (pthread_mutex_trylock(&s_retired_mutex)) {
+        return;
+    }
+    // 与读者进入临界区时的 fence 配对：要么读者看到新快照，要么这里看到读者的 epoch
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    uint64_t min_epoch = UINT64_MAX;
+    for (RcuRecord* r = s_records.load(std::memory_order_acquire); r; r = r->next) {
+        uint64_t e = r->epoch.load(std::memory_order_relaxed);
+        if (e && e < min_epoch) {
+            min_epoch = e;
+        }
+    }
+
+    std::vector<std::function<void()>> funs;
+    auto& retired = GetRetired();
+    while (!retired.empty() && retired.front().epoch < min_epoch) {
+        funs.push_back(std::move(retired.front().fun));
+        retired.pop_front();
+    }
+    s_pending.fetch_sub(funs.size(), std::memory_order_relaxed);
+    pthread_mutex_unlock(&s_retired_mutex);
+
+    for (auto& i : funs) {
+        i();
+    }
+}
+
+//****************************************************************************
+// Rcu::ReadLock
+//****************************************************************************
+
+Rcu::ReadLock::ReadLock() {
+    RcuRecord* r = t_record ? t_record : AcquireRecord();
+    __record = r;
+    if (r->nesting++ == 0) {
+        r->epoch.store(s_epoch.load(std::memory_order_acquire), std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+}
+
+Rcu::ReadLock::~ReadLock() {
+    RcuRecord* r = (RcuRecord*)__record;
+    if (--r->nesting == 0) {
+        r->epoch.store(0, std::memory_order_release);
+    }
+}
+
+//****************************************************************************
+// Rcu
+//****************************************************************************
+
+void Rcu::Retire(std::function<void()> fun) {
+    pthread_mutex_lock(&s_retired_mutex);
+    // 此后进入临界区的读者 epoch 更大，只能看到新快照
+    uint64_t epoch = s_epoch.fetch_add(1, std::memory_order_seq_cst);
+    GetRetired().push_back(RcuRetired{ epoch, std::move(fun) });
+    s_pending.fetch_add(1, std::memory_order_relaxed);
+    pthread_mutex_unlock(&s_retired_mutex);
+    Reclaim();
+}
+
+void Rcu::Quiescent() {
+    Reclaim();
+}
+
+uint64_t Rcu::GetPending() {
+    return s_pending.load(std::memory_order_relaxed);
+}
+
+}; /* sylar */
@@ -0,0 +1,630 @@
+#include "Resolver.h"
+#include "Socket.h"
+#include "Fiber.h"
+#include "Scheduler.h"
+#include "Config.h"
+#include "Clock.h"
+#include "Log.h"
+#include "Macro.h"
+#include <fstream>
+#include <sstream>
+#include <random>
+#include <algorithm>
+#include <string.h>
+#include <sys/stat.h>
+
+namespace sylar
+{
+
+static ConfigVar_ptr<bool> g_dns_enable =
+    Config::Lookup("dns.enable", true, "resolve host names with the fiber-aware resolver");
+
+static ConfigVar_ptr<std::vector<std::string>> g_dns_nameservers =
+    Config::Lookup("dns.nameservers", std::vector<std::string>(),
+                   "dns servers ip[:port], overrides resolv.conf when not empty");
+
+static ConfigVar_ptr<uint32_t> g_dns_timeout_ms =
+    Config::Lookup("dns.timeout_ms", (uint32_t)0, "dns query timeout ms, 0 uses resolv.conf");
+
+static ConfigVar_ptr<uint32_t> g_dns_negative_ttl =
+    Config::Lookup("dns.negative_ttl", (uint32_t)30, "negative cache seconds when the answer has no SOA");
+
+static ConfigVar_ptr<uint32_t> g_dns_max_ttl =
+    Config::Lookup("dns.max_ttl", (uint32_t)3600, "max seconds a dns answer stays in cache");
+
+static ConfigVar_ptr<std::string> g_dns_hosts_file =
+    Config::Lookup("dns.hosts_file", std::string("/etc/hosts"), "hosts file");
+
+static ConfigVar_ptr<std::string> g_dns_resolv_conf =
+    Config::Lookup("dns.resolv_conf", std::string("/etc/resolv.conf"), "resolver config file");
+
+//****************************************************************************
+// DNS 报文
+//****************************************************************************
+
+static const uint16_t DNS_TYPE_A = 1;
+static const uint16_t DNS_TYPE_SOA = 6;
+static const uint16_t DNS_TYPE_AAAA = 28;
+static const uint16_t DNS_CLASS_IN = 1;
+static const uint8_t DNS_RCODE_NXDOMAIN = 3;
+
+static std::string ToLower(const std::string& str) {
+    std::string result(str);
+    std::transform(result.begin(), result.end(), result.begin(), ::tolower);
+    return result;
+}
+
+static uint16_t ReadU16(const uint8_t* p) {
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static uint32_t ReadU32(const uint8_t* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static void WriteU16(std::string& out, uint16_t v) {
+    out.push_back((char)(v >> 8));
+    out.push_back((char)(v & 0xff));
+}
+
+/*!
+ * @brief 构造只有一个问题的查询报文，名字不合法时返回 false
+ */
+static bool BuildQuery(std::string& out, uint16_t id, const std::string& qname, uint16_t qtype) {
+    out.clear();
+    WriteU16(out, id);
+    WriteU16(out, 0x0100);  // RD
+    WriteU16(out, 1);       // QDCOUNT
+    WriteU16(out, 0);
+    WriteU16(out, 0);
+    WriteU16(out, 0);
+
+    size_t begin = 0;
+    while (begin < qname.size()) {
+        size_t end = qname.find('.', begin);
+        if (end == std::string::npos) {
+            end = qname.size();
+        }
+        size_t len = end - begin;
+        if (len == 0 || len > 63) {
+            return false;
+        }
+        out.push_back((char)len);
+        out.append(qname, begin, len);
+        begin = end + 1;
+    }
+    out.push_back(0);
+    if (out.size() - 12 > 255) {
+        return false;
+    }
+    WriteU16(out, qtype);
+    WriteU16(out, DNS_CLASS_IN);
+    return true;
+}
+
+/*!
+ * @brief 读取(可能被压缩的)域名，pos 移动到名字之后
+ */
+static bool ReadName(const uint8_t* buf, size_t len, size_t& pos, std::string& name) {
+    name.clear();
+    size_t cur = pos;
+    bool jumped = false;
+    int jumps = 0;
+    while (true) {
+        if (cur >= len) {
+            return false;
+        }
+        uint8_t c = buf[cur];
+        if ((c & 0xc0) == 0xc0) {
+            if (cur + 1 >= len || ++jumps > 16) {
+                return false;
+            }
+            if (!jumped) {
+                pos = cur + 2;
+                jumped = true;
+            }
+            cur = ((c & 0x3f) << 8) | buf[cur + 1];
+            continue;
+        }
+        if (c == 0) {
+            if (!jumped) {
+                pos = cur + 1;
+            }
+            return true;
+        }
+        if (cur + 1 + c > len) {
+            return false;
+        }
+        if (!name.empty()) {
+            name.push_back('.');
+        }
+        name.append((const char*)buf + cur + 1, c);
+        cur += 1 + c;
+    }
+}
+
+/*!
+ * @brief 解析应答报文
+ * @param rcode 应答码
+ * @param ttl 正应答为地址记录的最小 TTL，负应答为 SOA 给出的负缓存时间(没有 SOA 时不修改)
+ */
+static bool ParseResponse(const uint8_t* buf, size_t len, uint16_t id, const std::string& qname, uint16_t qtype,
+                          uint8_t& rcode, std::vector<IPAddress_ptr>& addrs, uint32_t& ttl) {
+    if (len < 12 || ReadU16(buf) != id || !(buf[2] & 0x80)) {
+        return false;
+    }
+    rcode = buf[3] & 0x0f;
+    uint16_t qdcount = ReadU16(buf + 4);
+    uint16_t ancount = ReadU16(buf + 6);
+    uint16_t nscount = ReadU16(buf + 8);
+    if (qdcount != 1) {
+        return false;
+    }
+
+    size_t pos = 12;
+    std::string name;
+    if (!ReadName(buf, len, pos, name) || pos + 4 > len
+        || ToLower(name) != qname || ReadU16(buf + pos) != qtype) {
+        return false;
+    }
+    pos += 4;
+
+    uint32_t min_ttl = ~0u;
+    for (uint32_t i = 0; i < (uint32_t)ancount + nscount; ++i) {
+        if (!ReadName(buf, len, pos, name) || pos + 10 > len) {
+            return false;
+        }
+        uint16_t type = ReadU16(buf + pos);
+        uint16_t klass = ReadU16(buf + pos + 2);
+        uint32_t rttl = ReadU32(buf + pos + 4);
+        uint16_t rdlen = ReadU16(buf + pos + 8);
+        pos += 10;
+        if (pos + rdlen > len) {
+            return false;
+        }
+        if (klass == DNS_CLASS_IN) {
+            if (i < ancount) {
+                // CNAME 链上的记录也参与 TTL 计算
+                min_ttl = std::min(min_ttl, rttl);
+                if (type == DNS_TYPE_A && qtype == DNS_TYPE_A && rdlen == 4) {
+                    sockaddr_in addr;
+                    memset(&addr, 0, sizeof(addr));
+                    addr.sin_family = AF_INET;
+                    memcpy(&addr.sin_addr, buf + pos, 4);
+                    addrs.push_back(std::dynamic_pointer_cast<IPAddress>(
+                        Address::Create((const sockaddr*)&addr, sizeof(addr))));
+                }
+                else if (type == DNS_TYPE_AAAA && qtype == DNS_TYPE_AAAA && rdlen == 16) {
+                    sockaddr_in6 addr;
+                    memset(&addr, 0, sizeof(addr));
+                    addr.sin6_family = AF_INET6;
+                    memcpy(&addr.sin6_addr, buf + pos, 16);
+                    addrs.push_back(std::dynamic_pointer_cast<IPAddress>(
+                        Address::Create((const sockaddr*)&addr, sizeof(addr))));
+                }
+            }
+            else if (type == DNS_TYPE_SOA) {
+                // RFC 2308: 负缓存时间取 SOA 记录 TTL 与 MINIMUM 中较小者
+                size_t rpos = pos;
+                if (ReadName(buf, len, rpos, name) && ReadName(buf, len, rpos, name)
+                    && rpos + 20 <= pos + rdlen) {
+                    min_ttl = std::min(rttl, ReadU32(buf + rpos + 16));
+                }
+            }
+        }
+        pos += rdlen;
+    }
+    if (min_ttl != ~0u) {
+        ttl = min_ttl;
+    }
+    return true;
+}
+
+/*!
+ * @brief 解析 ip[:port] 或 [ipv6]:port 形式的服务器地址
+ */
+static IPAddress_ptr ParseServer(const std::string& str) {
+    std::string ip = str;
+    uint16_t port = 53;
+    if (!str.empty() && str[0] == '[') {
+        size_t end = str.find(']');
+        if (end == std::string::npos) {
+            return nullptr;
+        }
+        ip = str.substr(1, end - 1);
+        if (end + 1 < str.size() && str[end + 1] == ':') {
+            port = (uint16_t)atoi(str.c_str() + end + 2);
+        }
+    }
+    else if (std::count(str.begin(), str.end(), ':') == 1) {
+        size_t colon = str.find(':');
+        ip = str.substr(0, colon);
+        port = (uint16_t)atoi(str.c_str() + colon + 1);
+    }
+    return IPAddress::Create(ip.c_str(), port);
+}
+
+static time_t FileMtime(const std::string& path) {
+    struct stat st;
+    if (stat(path.c_str(), &st)) {
+        return 0;
+    }
+    return st.st_mtime;
+}
+
+//****************************************************************************
+// Resolver
+//****************************************************************************
+
+bool Resolver::IsEnabled() {
+    return g_dns_enable->getValue();
+}
+
+bool Resolver::IsNumericHost(const std::string& host) {
+    in6_addr buf;
+    return inet_pton(AF_INET, host.c_str(), &buf) == 1
+        || inet_pton(AF_INET6, host.c_str(), &buf) == 1;
+}
+
+void Resolver::reloadIfChanged() {
+    uint64_t now_ms = Clock::NowMS();
+    uint64_t last = __lastCheckMS;
+    // 其他线程刚检查过或正在检查时沿用已加载的配置；
+    // 还没有加载过时不能用空的服务器列表去查询，自己加载一份
+    bool loaded = __loaded;
+    if (loaded && last && now_ms < last + 1000) {
+        return;
+    }
+    if (!__lastCheckMS.compare_exchange_strong(last, now_ms) && loaded) {
+        return;
+    }
+
+    std::string hosts_path = g_dns_hosts_file->getValue();
+    std::string resolv_path = g_dns_resolv_conf->getValue();
+    time_t hosts_mtime = FileMtime(hosts_path);
+    time_t resolv_mtime = FileMtime(resolv_path);
+    {
+        RWMutexType::ReadLock lock(__confMutex);
+        if (hosts_path == __hostsPath && hosts_mtime == __hostsMtime
+            && resolv_path == __resolvPath && resolv_mtime == __resolvMtime) {
+            return;
+        }
+    }
+
+    std::unordered_map<std::string, std::vector<IPAddress_ptr>> hosts;
+    std::ifstream hfs(hosts_path);
+    std::string line;
+    while (std::getline(hfs, line)) {
+        line = line.substr(0, line.find('#'));
+        std::stringstream ss(line);
+        std::string ip, name;
+        if (!(ss >> ip)) {
+            continue;
+        }
+        IPAddress_ptr addr = IPAddress::Create(ip.c_str());
+        if (!addr) {
+            continue;
+        }
+        while (ss >> name) {
+            hosts[ToLower(name)].push_back(addr);
+        }
+    }
+
+    std::vector<IPAddress_ptr> servers;
+    std::vector<std::string> search;
+    int ndots = 1, timeout_ms = 5000, attempts = 2;
+    std::ifstream rfs(resolv_path);
+    while (std::getline(rfs, line)) {
+        line = line.substr(0, line.find_first_of("#;"));
+        std::stringstream ss(line);
+        std::string key, value;
+        if (!(ss >> key)) {
+            continue;
+        }
+        if (key == "nameserver") {
+            IPAddress_ptr addr;
+            if (ss >> value && servers.size() < 3 && (addr = IPAddress::Create(value.c_str(), 53))) {
+                servers.push_back(addr);
+            }
+        }
+        else if (key == "search" || key == "domain") {
+            search.clear();
+            while (ss >> value) {
+                search.push_back(ToLower(value));
+            }
+        }
+        else if (key == "options") {
+            while (ss >> value) {
+                if (value.compare(0, 6, "ndots:") == 0) {
+                    ndots = std::min(atoi(value.c_str() + 6), 15);
+                }
+                else if (value.compare(0, 8, "timeout:") == 0) {
+                    timeout_ms = std::max(atoi(value.c_str() + 8), 1) * 1000;
+                }
+                else if (value.compare(0, 9, "attempts:") == 0) {
+                    attempts = std::max(atoi(value.c_str() + 9), 1);
+                }
+            }
+        }
+    }
+    if (servers.empty()) {
+        servers.push_back(IPAddress::Create("127.0.0.1", 53));
+    }
+
+    RWMutexType::WriteLock lock(__confMutex);
+    __hosts.swap(hosts);
+    __servers.swap(servers);
+    __search.swap(search);
+    __ndots = ndots;
+    __timeoutMS = timeout_ms;
+    __attempts = attempts;
+    __hostsPath = hosts_path;
+    __hostsMtime = hosts_mtime;
+    __resolvPath = resolv_path;
+    __resolvMtime = resolv_mtime;
+    __loaded = true;
+}
+
+bool Resolver::lookup(std::vector<IPAddress_ptr>& result, const std::string& name, int family) {
+    std::string key = ToLower(name);
+    if (!key.empty() && key.back() == '.') {
+        key.pop_back();
+    }
+    if (key.empty()) {
+        return false;
+    }
+    reloadIfChanged();
+
+    {
+        RWMutexType::ReadLock lock(__confMutex);
+        auto it = __hosts.find(key);
+        if (it != __hosts.end()) {
+            size_t size = result.size();
+            for (auto& addr : it->second) {
+                if (family == AF_UNSPEC || addr->getFamily() == family) {
+                    result.push_back(std::dynamic_pointer_cast<IPAddress>(
+                        Address::Create(addr->getAddr(), addr->getAddrLen())));
+                }
+            }
+            if (result.size() > size) {
+                return true;
+            }
+        }
+    }
+
+    if (family == AF_UNSPEC) {
+        bool v4 = lookupFamily(result, key, AF_INET);
+        bool v6 = lookupFamily(result, key, AF_INET6);
+        return v4 || v6;
+    }
+    if (family != AF_INET && family != AF_INET6) {
+        return false;
+    }
+    return lookupFamily(result, key, family);
+}
+
+bool Resolver::lookupFamily(std::vector<IPAddress_ptr>& result, const std::string& name, int family) {
+    std::string key = name + (family == AF_INET6 ? "/AAAA" : "/A");
+    Shard& shard = __shards[std::hash<std::string>()(key) % SHARDS];
+    std::shared_ptr<Pending> pending;
+    bool owner = false;
+    {
+        MutexType::Lock lock(shard.mutex);
+        auto it = shard.cache.find(key);
+        if (it != shard.cache.end()) {
+            if (it->second.expireMS > Clock::NowMS()) {
+                ++__hits;
+                for (auto& addr : it->second.addrs) {
+                    result.push_back(std::dynamic_pointer_cast<IPAddress>(
+                        Address::Create(addr->getAddr(), addr->getAddrLen())));
+                }
+                return !it->second.addrs.empty();
+            }
+            shard.cache.erase(it);
+        }
+        ++__misses;
+
+        // 只有协程可以挂起等待，其他线程直接各自查询
+        Scheduler* scheduler = Scheduler::GetThis();
+        auto pit = shard.pending.find(key);
+        if (pit == shard.pending.end()) {
+            pending = std::make_shared<Pending>();
+            shard.pending[key] = pending;
+            owner = true;
+        }
+        else if (scheduler && Fiber::GetThis().get() != Scheduler::GetMainFiber()) {
+            pending = pit->second;
+            pending->waiters.push_back(std::make_pair(scheduler, Fiber::GetThis()));
+            ++__coalesced;
+        }
+    }
+
+    if (!owner && pending) {
+        // 结果由发起查询的协程填好后再唤醒
+        Fiber::YieldToHold();
+        for (auto& addr : pending->addrs) {
+            result.push_back(std::dynamic_pointer_cast<IPAddress>(
+                Address::Create(addr->getAddr(), addr->getAddrLen())));
+        }
+        return pending->ok;
+    }
+
+    std::vector<IPAddress_ptr> addrs;
+    uint32_t ttl = 0;
+    Status status = query(name, family, addrs, ttl);
+    if (!owner) {
+        result.insert(result.end(), addrs.begin(), addrs.end());
+        return status == Status::OK;
+    }
+
+    std::vector<std::pair<Scheduler*, Fiber_ptr>> waiters;
+    {
+        MutexType::Lock lock(shard.mutex);
+        if (status != Status::FAIL) {
+            if (shard.cache.size() >= 1024) {
+                uint64_t now_ms = Clock::NowMS();
+                for (auto it = shard.cache.begin(); it != shard.cache.end();) {
+                    if (it->second.expireMS <= now_ms) {
+                        it = shard.cache.erase(it);
+                    }
+                    else {
+                        ++it;
+                    }
+                }
+            }
+            CacheEntry& entry = shard.cache[key];
+            entry.addrs = addrs;
+            entry.expireMS = Clock::NowMS() + std::min(ttl, g_dns_max_ttl->getValue()) * 1000ull;
+        }
+        shard.pending.erase(key);
+        pending->addrs = addrs;
+        pending->ok = status == Status::OK;
+        waiters.swap(pending->waiters);
+    }
+    for (auto& it : waiters) {
+        it.first->schedule(it.second);
+    }
+    for (auto& addr : addrs) {
+        result.push_back(std::dynamic_pointer_cast<IPAddress>(
+            Address::Create(addr->getAddr(), addr->getAddrLen())));
+    }
+    return status == Status::OK;
+}
+
+Resolver::Status Resolver::query(const std::string& name, int family,
+                                 std::vector<IPAddress_ptr>& addrs, uint32_t& ttl) {
+    std::vector<IPAddress_ptr> servers;
+    std::vector<std::string> search;
+    int ndots, timeout_ms, attempts;
+    {
+        RWMutexType::ReadLock lock(__confMutex);
+        servers = __servers;
+        search = __search;
+        ndots = __ndots;
+        timeout_ms = __timeoutMS;
+        attempts = __attempts;
+    }
+    const std::vector<std::string>& conf_servers = g_dns_nameservers->getValue();
+    if (!conf_servers.empty()) {
+        servers.clear();
+        for (auto& it : conf_servers) {
+            IPAddress_ptr addr = ParseServer(it);
+            if (addr) {
+                servers.push_back(addr);
+            }
+            else {
+                SYLAR_LOG_ERROR(SYLAR_LOG_ROOT()) << "invalid dns.nameservers entry: " << it;
+            }
+        }
+    }
+    if (g_dns_timeout_ms->getValue()) {
+        timeout_ms = g_dns_timeout_ms->getValue();
+    }
+
+    // 与 glibc 相同：点数不少于 ndots 时先查原名，否则先拼接搜索域
+    std::vector<std::string> names;
+    bool absolute = std::count(name.begin(), name.end(), '.') >= ndots;
+    if (absolute) {
+        names.push_back(name);
+    }
+    for (auto& it : search) {
+        names.push_back(name + "." + it);
+    }
+    if (!absolute) {
+        names.push_back(name);
+    }
+
+    uint16_t qtype = family == AF_INET6 ? DNS_TYPE_AAAA : DNS_TYPE_A;
+    uint32_t negative_ttl = g_dns_negative_ttl->getValue();
+    bool failed = false;
+    for (auto& qname : names) {
+        uint32_t rttl = negative_ttl;
+        Status status = queryName(servers, qname, qtype, timeout_ms, attempts, addrs, rttl);
+        if (status == Status::OK) {
+            ttl = rttl;
+            return status;
+        }
+        if (status == Status::FAIL) {
+            failed = true;
+        }
+        negative_ttl = std::min(negative_ttl, rttl);
+    }
+    ttl = negative_ttl;
+    return failed ? Status::FAIL : Status::NEGATIVE;
+}
+
+Resolver::Status Resolver::queryName(const std::vector<IPAddress_ptr>& servers, const std::string& qname,
+                                     uint16_t qtype, int timeout_ms, int attempts,
+                                     std::vector<IPAddress_ptr>& addrs, uint32_t& ttl) {
+    static thread_local std::mt19937 s_rand(std::random_device{}());
+    uint16_t id = (uint16_t)s_rand();
+    std::string req;
+    if (!BuildQuery(req, id, qname, qtype)) {
+        return Status::NEGATIVE;
+    }
+
+    uint8_t buf[4096];
+    for (int i = 0; i < attempts; ++i) {
+        for (auto& server : servers) {
+            Socket_ptr sock = Socket::CreateUDP(server);
+            sock->setRecvTimeout(timeout_ms);
+            if (!sock->connect(server)) {
+                continue;
+            }
+            ++__queries;
+            if (sock->send(req.data(), req.size()) != (int)req.size()) {
+                continue;
+            }
+            while (true) {
+                int n = sock->recv(buf, sizeof(buf));
+                if (n <= 0) {
+                    break;
+                }
+                uint8_t rcode = 0;
+                std::vector<IPAddress_ptr> answers;
+                uint32_t rttl = ttl;
+                if (!ParseResponse(buf, n, id, qname, qtype, rcode, answers, rttl)) {
+                    // 不是这次查询的应答，继续等待
+                    continue;
+                }
+                if (rcode == 0 && !answers.empty()) {
+                    addrs.swap(answers);
+                    ttl = rttl;
+                    return Status::OK;
+                }
+                if (rcode == 0 || rcode == DNS_RCODE_NXDOMAIN) {
+                    ttl = rttl;
+                    return Status::NEGATIVE;
+                }
+                // SERVFAIL、REFUSED 等，换下一个服务器
+                break;
+            }
+        }
+    }
+    SYLAR_LOG_DEBUG(SYLAR_LOG_ROOT()) << "dns query " << qname << " type=" << qtype << " failed";
+    return Status::FAIL;
+}
+
+void Resolver::clear() {
+    for (auto& shard : __shards) {
+        MutexType::Lock lock(shard.mutex);
+        shard.cache.clear();
+    }
+}
+
+std::ostream& Resolver::dump(std::ostream& os) {
+    size_t size = 0;
+    for (auto& shard : __shards) {
+        MutexType::Lock lock(shard.mutex);
+        size += shard.cache.size();
+    }
+    os << "[Resolver cache=" << size
+       << " hits=" << __hits
+       << " misses=" << __misses
+       << " coalesced=" << __coalesced
+       << " queries=" << __queries
+       << "]";
+    return os;
+}
+
+}; /* sylar */
@@ -0,0 +1,273 @@
+#include "RollingLog.h"
+#include "Thread.h"
+#include "Stream.h"
+#include "Clock.h"
+#include "Util.h"
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+namespace sylar {
+
+/*!
+ * @brief 写完 size 字节，处理部分写入
+ */
+static bool WriteFully(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = ::write(fd, data, size);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += n;
+        size -= n;
+    }
+    return true;
+}
+
+//****************************************************************************
+// RollingFileLogAppender
+//****************************************************************************
+
+RollingFileLogAppender::RollingFileLogAppender(const std::string& file_name, size_t max_size,
+                                               uint32_t interval, bool compress)
+    : __file_name(file_name)
+    , __maxSize(max_size ? max_size : 1)
+    , __interval(interval)
+    , __compress(compress) {
+    {
+        MutexType::Lock lock(__mutex);
+        // 上次运行留下的当前段先滚动出去
+        if (access(__file_name.c_str(), F_OK) == 0) {
+            Segment_ptr old = std::make_shared<Segment>();
+            old->path = __file_name;
+            struct stat st;
+            old->opened = stat(__file_name.c_str(), &st) == 0 ? st.st_mtime : time(0);
+            __active = old;
+        }
+        rotateLocked(Clock::WallSecond());
+    }
+    __worker = std::make_shared<Thread>(std::bind(&RollingFileLogAppender::run, this), "log_rolling");
+}
+
+RollingFileLogAppender::~RollingFileLogAppender() {
+    __stopping = true;
+    __semaphore.notify();
+    __worker->join();
+
+    MutexType::Lock lock(__mutex);
+    for (auto& i : __retired) {
+        finishSegment(i);
+    }
+    __retired.clear();
+    if (__spare) {
+        dropSegment(__spare);
+        __spare.reset();
+    }
+    if (__active) {
+        finishSegment(__active);
+        __active.reset();
+    }
+}
+
+RollingFileLogAppender::Segment_ptr RollingFileLogAppender::createSegment(const std::string& path) {
+    int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return nullptr;
+    }
+    // 真正分配磁盘空间，避免写映射区时因磁盘满收到 SIGBUS
+    void* data = MAP_FAILED;
+    if (posix_fallocate(fd, 0, __maxSize) == 0) {
+        data = mmap(nullptr, __maxSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    if (data == MAP_FAILED) {
+        close(fd);
+        unlink(path.c_str());
+        return nullptr;
+    }
+    Segment_ptr segment = std::make_shared<Segment>();
+    segment->path = path;
+    segment->fd = fd;
+    segment->data = (char*)data;
+    segment->capacity = __maxSize;
+    return segment;
+}
+
+void RollingFileLogAppender::finishSegment(Segment_ptr segment) {
+    if (segment->data) {
+        munmap(segment->data, segment->capacity);
+        segment->data = nullptr;
+    }
+    if (segment->fd >= 0) {
+        if (ftruncate(segment->fd, segment->size)) {
+            // 截断失败时文件末尾保留 0 字节
+        }
+        close(segment->fd);
+        segment->fd = -1;
+    }
+    if (__compress && segment->path != __file_name) {
+        std::string gz = segment->path + ".gz";
+        if (CompressFile(segment->path, gz)) {
+            unlink(segment->path.c_str());
+        } else {
+            unlink(gz.c_str());
+        }
+    }
+}
+
+void RollingFileLogAppender::dropSegment(Segment_ptr segment) {
+    munmap(segment->data, segment->capacity);
+    close(segment->fd);
+    unlink(segment->path.c_str());
+}
+
+void RollingFileLogAppender::rotateLocked(time_t now) {
+    Segment_ptr next = std::move(__spare);
+    if (!next) {
+        // 后台线程还没准备好，只能在当前线程上创建
+        next = createSegment(__file_name + ".next." + std::to_string(++__seq));
+    }
+    if (__active) {
+        std::string prefix = __file_name + "." + Time2Str(__active->opened, "%Y%m%d-%H%M%S") + ".";
+        std::string name;
+        do {
+            name = prefix + StringUtil::Format("%04u", ++__seq);
+        } while (access(name.c_str(), F_OK) == 0 || access((name + ".gz").c_str(), F_OK) == 0);
+        rename(__active->path.c_str(), name.c_str());
+        __active->path = name;
+        __retired.push_back(std::move(__active));
+        ++__rotations;
+    }
+    if (next) {
+        rename(next->path.c_str(), __file_name.c_str());
+        next->path = __file_name;
+        next->opened = now;
+        __active = std::move(next);
+    }
+    __semaphore.notify();
+}
+
+void RollingFileLogAppender::append(const char* data, size_t size, time_t now) {
+    if (!__active || !__active->data || (__interval && now - __active->opened >= (time_t)__interval)) {
+        rotateLocked(now);
+    }
+    while (size > 0) {
+        if (!__active) {
+            __dropped += size;
+            return;
+        }
+        size_t left = __active->capacity - __active->size;
+        // 放得下整条时不拆开，超过一整段的才跨段
+        if (size > left && (left == 0 || size <= __active->capacity)) {
+            rotateLocked(now);
+            continue;
+        }
+        size_t n = std::min(size, left);
+        memcpy(__active->data + __active->size, data, n);
+        __active->size += n;
+        data += n;
+        size -= n;
+    }
+}
+
+void RollingFileLogAppender::write(const char* data, size_t size) {
+    time_t now = Clock::WallSecond();
+    MutexType::Lock lock(__mutex);
+    append(data, size, now);
+}
+
+void RollingFileLogAppender::writeBatch(const iovec* iov, int count) {
+    time_t now = Clock::WallSecond();
+    MutexType::Lock lock(__mutex);
+    for (int i = 0; i < count; ++i) {
+        append((const char*)iov[i].iov_base, iov[i].iov_len, now);
+    }
+}
+
+void RollingFileLogAppender::rotate() {
+    MutexType::Lock lock(__mutex);
+    rotateLocked(Clock::WallSecond());
+}
+
+void RollingFileLogAppender::run() {
+    while (true) {
+        __semaphore.wait();
+        std::vector<Segment_ptr> retired;
+        bool need_spare = false;
+        {
+            MutexType::Lock lock(__mutex);
+            retired.swap(__retired);
+            need_spare = !__spare;
+        }
+        for (auto& i : retired) {
+            finishSegment(i);
+        }
+        if (__stopping) {
+            break;
+        }
+        if (need_spare) {
+            uint32_t seq = 0;
+            {
+                MutexType::Lock lock(__mutex);
+                seq = ++__seq;
+            }
+            Segment_ptr spare = createSegment(__file_name + ".next." + std::to_string(seq));
+            MutexType::Lock lock(__mutex);
+            if (!__spare) {
+                __spare = spare;
+            } else if (spare) {
+                lock.unlock();
+                dropSegment(spare);
+            }
+        }
+    }
+}
+
+bool RollingFileLogAppender::CompressFile(const std::string& src, const std::string& dst) {
+    int in = open(src.c_str(), O_RDONLY | O_CLOEXEC);
+    if (in < 0) {
+        return false;
+    }
+    int out = open(dst.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (out < 0) {
+        close(in);
+        return false;
+    }
+
+    const size_t BUFF_SIZE = 64 * 1024;
+    ZlibStream_ptr zs = ZlibStream::CreateGzip(true, BUFF_SIZE);
+    // 每次写入后把已压缩的数据写出并释放，内存占用不随文件大小增长
+    auto drain = [zs, out]() {
+        bool ok = true;
+        for (auto& i : zs->getBuffers()) {
+            ok = ok && WriteFully(out, (const char*)i.iov_base, i.iov_len);
+            free(i.iov_base);
+        }
+        zs->getBuffers().clear();
+        return ok;
+    };
+
+    bool ok = true;
+    std::vector<char> buff(BUFF_SIZE);
+    while (ok) {
+        ssize_t n = read(in, &buff[0], buff.size());
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            ok = n == 0;
+            break;
+        }
+        ok = zs->write(&buff[0], n) == Z_OK && drain();
+    }
+    ok = ok && zs->flush() == Z_OK && drain();
+    close(in);
+    ok = close(out) == 0 && ok;
+    return ok;
+}
+
+}; /* sylar */
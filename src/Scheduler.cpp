@@ -2,17 +2,19 @@
 #include "Log.h"
 #include "Util.h"
 #include "Macro.h"
+#include "Hook.h"
+#include "Rcu.h"
 
 namespace sylar
 {
 
 //****************************************************************************
-// Э̵ڲ
+// 协程调度器所需内部变量
 //****************************************************************************
 
-// ָЭ̵ָ
+// 指向协程调度器的指针
 static thread_local Scheduler* t_scheduler = nullptr;
-// Э
+// 主协程
 static thread_local Fiber* t_scheduler_fiber = nullptr;
 
 //****************************************************************************
@@ -52,6 +54,10 @@ void Scheduler::tickle() {
 	SYLAR_LOG_INFO(SYLAR_LOG_ROOT()) << "tickle";
 }
 
+void Scheduler::tickle(int thread) {
+	tickle();
+}
+
 void Scheduler::setThis() {
 	t_scheduler = this;
 }
@@ -60,6 +66,18 @@ bool Scheduler::hasIdleThreads() const {
 	return __idle_thread_count > 0;
 }
 
+bool Scheduler::hasQueuedFibers() const {
+	return __queued_count.load(std::memory_order_relaxed) > 0;
+}
+
+bool Scheduler::hasPendingFibers(int thread) {
+	MutexType::Lock lock(__mutex);
+	for (auto& ft : __fibers) {
+		if (ft.__thread_id == -1 || ft.__thread_id == thread) return true;
+	}
+	return false;
+}
+
 void Scheduler::run() {
 	SYLAR_LOG_DEBUG(SYLAR_LOG_ROOT()) << __name << " run ";
 	setThis();
@@ -72,14 +90,19 @@ void Scheduler::run() {
 	FiberAndThread ft;
 
 	while (true) {
+		// 回到调度协程时本线程不在任何读临界区内，借此回收过期的 RCU 快照
+		Rcu::Quiescent();
 		ft.reset();
 		bool tickle_me = false;
+		int tickle_thread = -1;
 		bool is_active = false;
 		{
 			MutexType::Lock lock(__mutex);
 			auto it = __fibers.begin();
 			while (it != __fibers.end()) {
 				if (it->__thread_id != -1 && it->__thread_id != GetThreadId()) {
+					// 只有一个线程的任务被跳过时定向唤醒该线程
+					tickle_thread = (!tickle_me || tickle_thread == it->__thread_id) ? it->__thread_id : -1;
 					++it;
 					tickle_me = true;
 					continue;
@@ -92,14 +115,18 @@ void Scheduler::run() {
 				
 				ft = *it;
 				__fibers.erase(it++);
+				--__queued_count;
 				++__active_thread_count;
 				is_active = true;
 				break;
 			}
-			tickle_me |= it != __fibers.end();
+			if (it != __fibers.end()) {
+				tickle_me = true;
+				tickle_thread = -1;
+			}
 		}
 
-		if (tickle_me) tickle();
+		if (tickle_me) tickle(tickle_thread);
 
 		if (ft.__fiber &&
 			(ft.__fiber->getState() != FiberState::TERM &&
@@ -161,6 +188,9 @@ void Scheduler::run() {
 			}
 		}
 	}
+	// hook 开关是线程局部的，调度结束后没有 IOManager 可以挂起协程，
+	// 否则调用线程之后(包括静态析构阶段)的 IO 仍会走 hook
+	set_hook_enable(false);
 }
 
 bool Scheduler::stopping() {
@@ -168,7 +198,16 @@ bool Scheduler::stopping() {
 	return __is_auto_stop &&
 		   __is_stopping && 
 		   __fibers.empty() && 
-		   (__active_thread_count == 0);
+		   (__active_thread_count == 0) &&
+		   (__external_count == 0);
+}
+
+void Scheduler::addExternalWaiter() {
+	++__external_count;
+}
+
+void Scheduler::delExternalWaiter() {
+	--__external_count;
 }
 
 void Scheduler::idle() {
@@ -192,21 +231,21 @@ Scheduler::Scheduler(std::size_t threads, bool use_caller, const std::string& na
 	SYLAR_ASSERT(threads > 0);
 
 	if (use_caller) {
-		// use_caller Ὣǰ Э̵ ̴߳ŵЭ̵
-		// ԣҪ thread һ
+		// use_caller 会将当前负责 协程调度器 的线程存放到协程调度器中
+		// 所以，需要创建的 thread 数量减一
 		--threads;  
-		// ûЭһЭ
+		// 如果没有协程则分配一个协程
 		Fiber::GetThis(); 
 
-		// ֻеǰ߳вЭ̵ GetThis() == nullptr ʱ
-		// ſڵǰ߳дЭ̵
+		// 只有当前线程中不存在协程调度器（即 GetThis() == nullptr ）的时候
+		// 才可以在当前线程中创建协程调度器
 		SYLAR_ASSERT(GetThis() == nullptr); 
-		// Э̵ָ
+		// 更新协程调度器指针
 		t_scheduler = this;
 
-		// һ run Э
+		// 创建一个绑定 run 方法的协程
 		__root_fiber.reset(new Fiber(std::bind(&Scheduler::run, this), 0, true));
-		// ߳
+		// 设置线程名称
 		Thread::SetName(__name);
 
 		t_scheduler_fiber = __root_fiber.get();
@@ -231,15 +270,15 @@ const std::string Scheduler::getName() const {
 }
 
 void Scheduler::start() {
-	// 
+	// 加锁
 	MutexType::Lock lock(__mutex);
-	// Ѿ
+	// 已经启动，则无需继续
 	if (!__is_stopping) return;
-	// Э̵״̬Ϊ
+	// 更改协程调度器状态为已启动
 	__is_stopping = false;
-	// ʱЭ̵е̳߳ӦΪ
+	// 此时协程调度器中的线程池应当为空
 	SYLAR_ASSERT(__threads.empty());
-	// Ӧִ̣߳к
+	// 分配对应数量的线程，并绑定执行函数
 	__threads.resize(__thread_count);
 	for (std::size_t i = 0; i < __thread_count; ++i) {
 		__threads[i].reset(
@@ -263,11 +302,11 @@ void Scheduler::stop() {
 		if (stopping()) return;
 	}
 
-	// use_caller ߳
+	// use_caller 线程
 	if (__root_thread != -1) {
 		SYLAR_ASSERT(GetThis() == this);
 	}
-	//  use_caller ߳
+	// 非 use_caller 线程
 	else {
 		SYLAR_ASSERT(GetThis() != this);
 	}
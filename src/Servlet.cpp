@@ -72,24 +72,27 @@ int32_t ServletDispatch::handle(HttpRequest_ptr request,
 }
 
 void ServletDispatch::addServlet(const std::string& uri, Servlet_ptr slt) {
-    RWMutexType::WriteLock lock(m_mutex);
-    m_datas[uri] = slt;
+    m_datas.update([&uri, &slt](ServletMap& datas) {
+        datas[uri] = slt;
+        return true;
+    });
 }
 
 void ServletDispatch::addServlet(const std::string& uri, FunctionServlet::callback cb) {
-    RWMutexType::WriteLock lock(m_mutex);
-    m_datas[uri].reset(new FunctionServlet(cb));
+    addServlet(uri, std::make_shared<FunctionServlet>(cb));
 }
 
 void ServletDispatch::addGlobServlet(const std::string& uri, Servlet_ptr slt) {
-    RWMutexType::WriteLock lock(m_mutex);
-    for (auto it = m_globs.begin(); it != m_globs.end(); ++it) {
-        if (it->first == uri) {
-            m_globs.erase(it);
-            break;
+    m_globs.update([&uri, &slt](GlobList& globs) {
+        for (auto it = globs.begin(); it != globs.end(); ++it) {
+            if (it->first == uri) {
+                globs.erase(it);
+                break;
+            }
         }
-    }
-    m_globs.push_back(std::make_pair(uri, slt));
+        globs.push_back(std::make_pair(uri, slt));
+        return true;
+    });
 }
 
 void ServletDispatch::addGlobServlet(const std::string& uri, FunctionServlet::callback cb) {
@@ -114,18 +117,21 @@ void ServletDispatch::addGlobServlet(const std::string& uri, FunctionServlet::ca
 //}
 
 void ServletDispatch::delServlet(const std::string& uri) {
-    RWMutexType::WriteLock lock(m_mutex);
-    m_datas.erase(uri);
+    m_datas.update([&uri](ServletMap& datas) {
+        return datas.erase(uri) > 0;
+    });
 }
 
 void ServletDispatch::delGlobServlet(const std::string& uri) {
-    RWMutexType::WriteLock lock(m_mutex);
-    for (auto it = m_globs.begin(); it != m_globs.end(); ++it) {
-        if (it->first == uri) {
-            m_globs.erase(it);
-            break;
+    m_globs.update([&uri](GlobList& globs) {
+        for (auto it = globs.begin(); it != globs.end(); ++it) {
+            if (it->first == uri) {
+                globs.erase(it);
+                return true;
+            }
         }
-    }
+        return false;
+    });
 }
 
 Servlet_ptr ServletDispatch::getDefault() const { 
@@ -137,14 +143,16 @@ void ServletDispatch::setDefault(Servlet_ptr v) {
 }
 
 Servlet_ptr ServletDispatch::getServlet(const std::string& uri) {
-    RWMutexType::ReadLock lock(m_mutex);
-    auto it = m_datas.find(uri);
-    return it == m_datas.end() ? nullptr : it->second;
+    Rcu::ReadLock lock;
+    const ServletMap* datas = m_datas.get();
+    auto it = datas->find(uri);
+    return it == datas->end() ? nullptr : it->second;
 }
 
 Servlet_ptr ServletDispatch::getGlobServlet(const std::string& uri) {
-    RWMutexType::ReadLock lock(m_mutex);
-    for (auto it = m_globs.begin(); it != m_globs.end(); ++it) {
+    Rcu::ReadLock lock;
+    const GlobList* globs = m_globs.get();
+    for (auto it = globs->begin(); it != globs->end(); ++it) {
         if (it->first == uri) {
             return it->second;
         }
@@ -153,12 +161,14 @@ Servlet_ptr ServletDispatch::getGlobServlet(const std::string& uri) {
 }
 
 Servlet_ptr ServletDispatch::getMatchedServlet(const std::string& uri) {
-    RWMutexType::ReadLock lock(m_mutex);
-    auto mit = m_datas.find(uri);
-    if (mit != m_datas.end()) {
+    Rcu::ReadLock lock;
+    const ServletMap* datas = m_datas.get();
+    auto mit = datas->find(uri);
+    if (mit != datas->end()) {
         return mit->second;
     }
-    for (auto it = m_globs.begin(); it != m_globs.end(); ++it) {
+    const GlobList* globs = m_globs.get();
+    for (auto it = globs->begin(); it != globs->end(); ++it) {
         if (!fnmatch(it->first.c_str(), uri.c_str(), 0)) {
             return it->second;
         }
@@ -5,12 +5,17 @@
 #include "Macro.h"
 #include "Hook.h"
 #include "Util.h"
+#include "Config.h"
+#include "Clock.h"
 
 namespace sylar
 {
 
+static ConfigVar_ptr<int> g_tcp_busy_poll =
+	Config::Lookup("tcp.busy_poll", 0, "SO_BUSY_POLL us for tcp sockets, 0 disables");
+
 //****************************************************************************
-// ʽ socket
+// 流式处理 socket
 //****************************************************************************
 
 std::ostream& operator<<(std::ostream& os, const Socket& sock) {
@@ -26,6 +31,11 @@ void Socket::initSock() {
 	setOption(SOL_SOCKET, SO_REUSEADDR, val);
 	if (__type == SOCK_STREAM) {
 		setOption(IPPROTO_TCP, TCP_NODELAY, val);
+		// 配合 IOManager 的自旋阶段，让内核在读时忙等网卡队列
+		int busy_poll = g_tcp_busy_poll->getValue();
+		if (busy_poll > 0) {
+			setOption(SOL_SOCKET, SO_BUSY_POLL, busy_poll);
+		}
 	}
 }
 
@@ -62,6 +72,9 @@ Socket_ptr Socket::CreateTCP(Address_ptr address) {
 
 Socket_ptr Socket::CreateUDP(Address_ptr address) {
 	Socket_ptr result(new Socket(address->getFamily(), UDP, 0));
+	// UDP 无连接，创建后即可收发
+	result->newSock();
+	result->__isConnected = true;
 	return result;
 }
 
@@ -72,6 +85,8 @@ Socket_ptr Socket::CreateTCPSocket() {
 
 Socket_ptr Socket::CreateUDPSocket() {
 	Socket_ptr result(new Socket(IPv4, UDP, 0));
+	result->newSock();
+	result->__isConnected = true;
 	return result;
 }
 
@@ -82,6 +97,8 @@ Socket_ptr Socket::CreateTCPSocket6() {
 
 Socket_ptr Socket::CreateUDPSocket6() {
 	Socket_ptr result(new Socket(IPv6, UDP, 0));
+	result->newSock();
+	result->__isConnected = true;
 	return result;
 }
 
@@ -92,6 +109,8 @@ Socket_ptr Socket::CreateUnixTCPSocket() {
 
 Socket_ptr Socket::CreateUnixUDPSocket() {
 	Socket_ptr result(new Socket(UNIX, UDP, 0));
+	result->newSock();
+	result->__isConnected = true;
 	return result;
 }
 
@@ -128,6 +147,27 @@ void Socket::setRecvTimeout(int64_t v) {
 	setOption(SOL_SOCKET, SO_RCVTIMEO, tv);
 }
 
+bool Socket::setReadDeadline(uint64_t ms) {
+	FDCtx_ptr ctx = FDManager_single::GetInstance()->get(__sock);
+	if (!ctx) return false;
+	ctx->setDeadline(SO_RCVTIMEO, ms ? Clock::NowUS() + ms * 1000 : ~0ull);
+	return true;
+}
+
+bool Socket::setWriteDeadline(uint64_t ms) {
+	FDCtx_ptr ctx = FDManager_single::GetInstance()->get(__sock);
+	if (!ctx) return false;
+	ctx->setDeadline(SO_SNDTIMEO, ms ? Clock::NowUS() + ms * 1000 : ~0ull);
+	return true;
+}
+
+bool Socket::setIdleTimeout(uint64_t ms) {
+	FDCtx_ptr ctx = FDManager_single::GetInstance()->get(__sock);
+	if (!ctx) return false;
+	ctx->setIdleTimeout(ms);
+	return true;
+}
+
 bool Socket::getOption(int level, int option, void* result, socklen_t* len) {
 	int rt = getsockopt(__sock, level, option, result, (socklen_t*)len);
 	if (rt) {
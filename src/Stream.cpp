@@ -1,5 +1,8 @@
 #include "Stream.h"
 #include "Macro.h"
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/sendfile.h>
 
 namespace sylar
 {
@@ -116,6 +119,49 @@ int SocketStream::write(ByteArray_ptr ba, size_t length) {
 	return rt;
 }
 
+int64_t SocketStream::sendFile(int fd, uint64_t offset, uint64_t length) {
+	if (!isConnected()) {
+		return -1;
+	}
+	if (length == (uint64_t)-1) {
+		struct stat st;
+		if (fstat(fd, &st)) {
+			return -1;
+		}
+		length = (uint64_t)st.st_size > offset ? st.st_size - offset : 0;
+	}
+
+	off_t off = offset;
+	uint64_t left = length;
+	while (left > 0) {
+		// 单次 sendfile 最多传输 0x7ffff000 字节
+		size_t count = left > 0x7ffff000 ? 0x7ffff000 : left;
+		ssize_t n = sendfile(__socket->getSocket(), fd, &off, count);
+		if (n < 0) {
+			// 已经发出部分数据时返回已发送的长度，由调用方决定如何继续
+			if (left < length) {
+				break;
+			}
+			return -1;
+		}
+		if (n == 0) {
+			break;
+		}
+		left -= n;
+	}
+	return length - left;
+}
+
+int64_t SocketStream::sendFile(const std::string& path, uint64_t offset, uint64_t length) {
+	int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		return -1;
+	}
+	int64_t rt = sendFile(fd, offset, length);
+	::close(fd);
+	return rt;
+}
+
 void SocketStream::close() {
 	if (__socket) {
 		__socket->close();
@@ -5,7 +5,7 @@ namespace sylar
 {
 
 //****************************************************************************
-// 
+// 杂项
 //****************************************************************************
 
 static ConfigVar_ptr<uint64_t> g_tcp_server_read_timeout =
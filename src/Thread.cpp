@@ -11,7 +11,7 @@ namespace sylar{
 static thread_local Thread* t_thread = nullptr;
 static thread_local std::string t_thread_name = "UNKNOW";
 
-//̶߳󣬴ص
+//构造线程对象，传入回调函数
 Thread::Thread(std::function<void()> cb, const std::string& name)
     :__cb(cb), __name(name) 
 {
@@ -26,28 +26,28 @@ Thread::Thread(std::function<void()> cb, const std::string& name)
             << "name = " << name;
         throw std::logic_error("pthread_create error");
     }
-    //δɵʱȴ...
+    //构造未完成的时候等待...
     __semaphore.wait();
 }
 
-//ʱ̷߳룬֤
+//析构时线程分离，保证其自我销毁
 Thread::~Thread() {
     if (__m_thread) {
         pthread_detach(__m_thread);
     }
 }
 
-//ȡǰ߳
+//获取当前线程
 Thread* Thread::GetThis() {
     return t_thread;
 }
 
-//ȡǰ߳
+//获取当前线程名字
 const std::string& Thread::GetName() {
     return t_thread_name;
 }
 
-//õǰ߳
+//设置当前线程名字
 void Thread::SetName(const std::string& name) {
     if(name.empty()) return;
     if (t_thread) {
@@ -56,17 +56,17 @@ void Thread::SetName(const std::string& name) {
     t_thread_name = name;
 }
 
-// ȡǰ̶߳ID
+// 获取当前线程对象ID
 pid_t Thread::getId() const{
     return __id;
 }
 
-// ȡǰ̶߳
+// 获取当前线程对象名字
 const std::string& Thread::getName() const{
     return __name;
 }
 
-//̣߳
+//连接线程，用于阻塞
 void Thread::join() {
     if (__m_thread) {
         int rt = pthread_join(__m_thread, nullptr);
@@ -1,9 +1,17 @@
 #include "Timer.h"
-#include "Util.h"
+#include "Clock.h"
+#include <algorithm>
 
 namespace sylar
 {
 
+/*!
+ * @brief 毫秒转微秒(溢出时取最大值)
+ */
+static uint64_t MsToUs(uint64_t ms) {
+	return ms > (~0ull / 1000) ? ~0ull : ms * 1000;
+}
+
 //****************************************************************************
 // TimerComparator
 //****************************************************************************
@@ -24,13 +32,14 @@ TimerComparator::operator()(const Timer_ptr& lhs, const Timer_ptr& rhs) const {
 // Timer
 //****************************************************************************
 
-Timer::Timer(uint64_t ms, std::function<void()> cb,
-			 bool recurring, TimerManager* manager)
-	: __ms(ms),
+Timer::Timer(uint64_t us, std::function<void()> cb,
+			 bool recurring, TimerManager* manager, uint64_t slack)
+	: __us(us),
+	__slack(slack),
 	__cb(cb),
 	__recurring(recurring),
 	__manager(manager) {
-	__next = GetCurrentMS() + __ms;
+	__next = __manager->applySlack(Clock::NowUS() + __us, __slack);
 }
 
 Timer::Timer(uint64_t next) : __next(next){}
@@ -52,59 +61,160 @@ bool Timer::refresh() {
 	auto it = __manager->__timers.find(shared_from_this());
 	if (it == __manager->__timers.end()) return false;
 	__manager->__timers.erase(it);
-	__next = GetCurrentMS() + __ms;
+	__next = __manager->applySlack(Clock::NowUS() + __us, __slack);
 	__manager->__timers.insert(shared_from_this());
 	return true;
 }
 
 bool Timer::reset(uint64_t ms, bool from_now) {
-	if (ms == __ms && !from_now) return true;
+	uint64_t us = MsToUs(ms);
+	if (us == __us && !from_now) return true;
 	TimerManager::RWMutexType::WriteLock lock(__manager->__mutex);
 	if (!__cb) return false;
 	auto it = __manager->__timers.find(shared_from_this());
 	if (it == __manager->__timers.end()) return false;
 	__manager->__timers.erase(it);
 	uint64_t start = 0;
-	if (from_now) start = GetCurrentMS();
-	else start = __next - __ms;
-	__ms = ms;
-	__next = start + __ms;
+	if (from_now) start = Clock::NowUS();
+	else start = __next - __us;
+	__us = us;
+	__next = __manager->applySlack(start + __us, __slack);
 	__manager->addTimer(shared_from_this(), lock);
 	return true;
 }
 
 //****************************************************************************
-// TimerManager
+// TimerNode
 //****************************************************************************
 
-bool TimerManager::detectClockRollover(uint64_t now_ms) {
-	bool rollover = false;
-	if (now_ms < __previouseTime &&
-		now_ms < (__previouseTime - 60 * 60 * 1000)) {
-		rollover = true;
-	}
-	__previouseTime = now_ms;
-	return rollover;
+TimerNode::TimerNode(Callback cb) : __cb(cb) {}
+
+TimerNode::~TimerNode() {
+	cancel();
 }
 
+bool TimerNode::isArmed() const {
+	return __index != (size_t)-1;
+}
+
+bool TimerNode::cancel() {
+	// 未挂载的节点不访问管理器，管理器可能已经析构。
+	// 回调执行完才清空 __manager，因此不为空时加锁会等到回调结束
+	TimerManager* manager = __manager;
+	if (!manager) return false;
+	TimerManager::RWMutexType::WriteLock lock(manager->__mutex);
+	if (__manager != manager) return false;
+	__manager = nullptr;
+	if (__index == (size_t)-1) return false;
+	manager->nodeRemove(__index);
+	return true;
+}
+
+void TimerNode::deferTo(uint64_t next_us) {
+	__deferTo = next_us;
+}
+
+//****************************************************************************
+// TimerManager
+//****************************************************************************
+
 void TimerManager::addTimer(Timer_ptr val, RWMutexType::WriteLock& lock) {
 	auto it = __timers.insert(val).first;
-	bool at_front = (it == __timers.begin()) && !__tickled;
-	if (at_front) __tickled = true;
+	bool at_front = (it == __timers.begin()) &&
+		(__nodes.empty() || val->__next < __nodes.front()->__next) &&
+		checkFrontNotify(val->__next, val->__slack);
 	lock.unlock();
 	if (at_front) onTimerInsertedAtFront();
 }
 
+void TimerManager::nodeSiftUp(size_t idx) {
+	TimerNode* node = __nodes[idx];
+	while (idx > 0) {
+		size_t parent = (idx - 1) / 2;
+		if (__nodes[parent]->__next <= node->__next) break;
+		__nodes[idx] = __nodes[parent];
+		__nodes[idx]->__index = idx;
+		idx = parent;
+	}
+	__nodes[idx] = node;
+	node->__index = idx;
+}
+
+void TimerManager::nodeSiftDown(size_t idx) {
+	TimerNode* node = __nodes[idx];
+	size_t size = __nodes.size();
+	while (true) {
+		size_t child = idx * 2 + 1;
+		if (child >= size) break;
+		if (child + 1 < size && __nodes[child + 1]->__next < __nodes[child]->__next) {
+			++child;
+		}
+		if (node->__next <= __nodes[child]->__next) break;
+		__nodes[idx] = __nodes[child];
+		__nodes[idx]->__index = idx;
+		idx = child;
+	}
+	__nodes[idx] = node;
+	node->__index = idx;
+}
+
+void TimerManager::nodeRemove(size_t idx) {
+	TimerNode* node = __nodes[idx];
+	TimerNode* last = __nodes.back();
+	__nodes.pop_back();
+	node->__index = (size_t)-1;
+	if (last == node) return;
+	__nodes[idx] = last;
+	last->__index = idx;
+	if (idx > 0 && last->__next < __nodes[(idx - 1) / 2]->__next) {
+		nodeSiftUp(idx);
+	}
+	else {
+		nodeSiftDown(idx);
+	}
+}
+
+uint64_t TimerManager::applySlack(uint64_t next, uint64_t slack) {
+	if (slack == 0 || next > ~0ull - slack) return next;
+	uint64_t bucket = (next + slack - 1) / slack * slack;
+	if (bucket != next) ++__bucketed;
+	return bucket;
+}
+
+bool TimerManager::checkFrontNotify(uint64_t next, uint64_t slack) {
+	if (__tickled) return false;
+	uint64_t wait = __waitDeadline;
+	if (slack && wait != ~0ull && wait <= next + slack) {
+		++__savedWakeups;
+		return false;
+	}
+	__tickled = true;
+	return true;
+}
+
 TimerManager::TimerManager() {
-	__previouseTime = GetCurrentMS();
+	__nodes.reserve(64);
 }
 
-TimerManager::~TimerManager() {}
+TimerManager::~TimerManager() {
+	RWMutexType::WriteLock lock(__mutex);
+	for (TimerNode* node : __nodes) {
+		node->__index = (size_t)-1;
+		node->__manager = nullptr;
+	}
+	__nodes.clear();
+}
 
 Timer_ptr
 TimerManager::addTimer(uint64_t ms, std::function<void()> cb,
 					   bool recurring) {
-	Timer_ptr timer(new Timer(ms, cb, recurring, this));
+	return addTimerUS(MsToUs(ms), cb, recurring);
+}
+
+Timer_ptr
+TimerManager::addTimerUS(uint64_t us, std::function<void()> cb,
+						 bool recurring, uint64_t slack_us) {
+	Timer_ptr timer(new Timer(us, cb, recurring, this, slack_us));
 	RWMutexType::WriteLock lock(__mutex);
 	addTimer(timer, lock); 
 	return timer;
@@ -118,22 +228,123 @@ static void OnTimer(std::weak_ptr<void> weak_cond, std::function<void()> cb) {
 Timer_ptr
 TimerManager::addConditionTimer(uint64_t ms, std::function<void()> cb,
 								std::weak_ptr<void> weak_cond, bool recurring) {
-	return addTimer(ms, std::bind(&OnTimer, weak_cond, cb), recurring);
+	return addConditionTimerUS(MsToUs(ms), cb, weak_cond, recurring);
+}
+
+Timer_ptr
+TimerManager::addConditionTimerUS(uint64_t us, std::function<void()> cb,
+								  std::weak_ptr<void> weak_cond, bool recurring) {
+	return addTimerUS(us, std::bind(&OnTimer, weak_cond, cb), recurring);
+}
+
+void TimerManager::addTimerNode(TimerNode* node, uint64_t ms) {
+	addTimerNodeUS(node, MsToUs(ms));
+}
+
+void TimerManager::addTimerNodeUS(TimerNode* node, uint64_t us, uint64_t slack_us) {
+	uint64_t next = Clock::NowUS() + us;
+	// 节点挂在其他管理器上时先摘下，避免在错误的堆中删除
+	TimerManager* manager = node->__manager;
+	if (manager && manager != this) node->cancel();
+	RWMutexType::WriteLock lock(__mutex);
+	if (node->__index != (size_t)-1) nodeRemove(node->__index);
+	node->__manager = this;
+	node->__slack = slack_us;
+	node->__next = applySlack(next, slack_us);
+	__nodes.push_back(node);
+	nodeSiftUp(__nodes.size() - 1);
+
+	bool at_front = node->__index == 0 &&
+		(__timers.empty() || node->__next < (*__timers.begin())->__next) &&
+		checkFrontNotify(node->__next, node->__slack);
+	lock.unlock();
+	if (at_front) onTimerInsertedAtFront();
+}
+
+bool TimerManager::armTimerNodeBefore(TimerNode* node, uint64_t deadline_us) {
+	// 节点挂在其他管理器上时先摘下，避免在错误的堆中删除
+	TimerManager* manager = node->__manager;
+	if (manager && manager != this) node->cancel();
+	RWMutexType::WriteLock lock(__mutex);
+	if (node->__index != (size_t)-1) {
+		if (node->__next <= deadline_us) return false;
+		nodeRemove(node->__index);
+	}
+	node->__manager = this;
+	node->__slack = 0;
+	node->__next = deadline_us;
+	__nodes.push_back(node);
+	nodeSiftUp(__nodes.size() - 1);
+
+	bool at_front = node->__index == 0 &&
+		(__timers.empty() || node->__next < (*__timers.begin())->__next) &&
+		checkFrontNotify(node->__next, node->__slack);
+	lock.unlock();
+	if (at_front) onTimerInsertedAtFront();
+	return true;
+}
+
+void TimerManager::triggerExpiredNodes() {
+	{
+		RWMutexType::ReadLock lock(__mutex);
+		if (__nodes.empty()) return;
+	}
+	uint64_t now_us = Clock::CachedUS();
+	bool deferred = false;
+	RWMutexType::WriteLock lock(__mutex);
+	// 回调在锁内执行，保证 cancel() 返回后节点所在的栈帧可以安全销毁
+	while (!__nodes.empty() && __nodes.front()->__next <= now_us) {
+		TimerNode* node = __nodes.front();
+		nodeRemove(0);
+		if (node->__cb) node->__cb(node);
+		if (node->__deferTo) {
+			node->__next = std::max(node->__deferTo, now_us + 1);
+			node->__deferTo = 0;
+			__nodes.push_back(node);
+			nodeSiftUp(__nodes.size() - 1);
+			deferred = true;
+		}
+		else {
+			node->__manager = nullptr;
+		}
+	}
+
+	bool at_front = deferred && !__nodes.empty() &&
+		(__timers.empty() || __nodes.front()->__next < (*__timers.begin())->__next) &&
+		checkFrontNotify(__nodes.front()->__next, __nodes.front()->__slack);
+	lock.unlock();
+	if (at_front) onTimerInsertedAtFront();
 }
 
 uint64_t TimerManager::getNextTimer() {
+	uint64_t us = getNextTimerUS();
+	if (us == ~0ull) return ~0ull;
+	else return (us + 999) / 1000;
+}
+
+uint64_t TimerManager::getNextTimerUS() {
+	uint64_t next = getNextDeadlineUS();
+	if (next == ~0ull) return ~0ull;
+
+	uint64_t now_us = Clock::NowUS();
+	if (now_us >= next) return 0;
+	else return next - now_us;
+}
+
+uint64_t TimerManager::getNextDeadlineUS() {
 	RWMutexType::ReadLock lock(__mutex);
 	__tickled = false;
-	if (__timers.empty()) return ~0ull;
-
-	const Timer_ptr& next = *__timers.begin();
-	uint64_t now_ms = GetCurrentMS();
-	if (now_ms >= next->__next) return 0;
-	else return next->__next - now_ms;
+	uint64_t next = ~0ull;
+	if (!__timers.empty()) next = (*__timers.begin())->__next;
+	if (!__nodes.empty() && __nodes.front()->__next < next) {
+		next = __nodes.front()->__next;
+	}
+	__waitDeadline = next;
+	return next;
 }
 
 void TimerManager::listExpiredCb(std::vector<std::function<void()>>& cbs) {
-	uint64_t now_ms = GetCurrentMS();
+	uint64_t now_us = Clock::CachedUS();
 	std::vector<Timer_ptr> expired;
 	{
 		RWMutexType::ReadLock lock(__mutex);
@@ -141,12 +352,11 @@ void TimerManager::listExpiredCb(std::vector<std::function<void()>>& cbs) {
 	}
 	RWMutexType::WriteLock lock(__mutex);
 	if (__timers.empty()) return;
-	bool rollover = detectClockRollover(now_ms);
-	if (!rollover && ((*__timers.begin())->__next > now_ms)) return;
+	if ((*__timers.begin())->__next > now_us) return;
 
-	Timer_ptr now_timer(new Timer(now_ms));
-	auto it = rollover ? __timers.end() : __timers.lower_bound(now_timer);
-	while (it != __timers.end() && (*it)->__next == now_ms) {
+	Timer_ptr now_timer(new Timer(now_us));
+	auto it = __timers.lower_bound(now_timer);
+	while (it != __timers.end() && (*it)->__next == now_us) {
 		++it;
 	}
 	expired.insert(expired.begin(), __timers.begin(), it);
@@ -156,7 +366,7 @@ void TimerManager::listExpiredCb(std::vector<std::function<void()>>& cbs) {
 	for (auto& timer : expired) {
 		cbs.push_back(timer->__cb);
 		if (timer->__recurring) {
-			timer->__next = now_ms + timer->__ms;
+			timer->__next = applySlack(now_us + timer->__us, timer->__slack);
 			__timers.insert(timer);
 		}
 		else {
@@ -167,7 +377,14 @@ void TimerManager::listExpiredCb(std::vector<std::function<void()>>& cbs) {
 
 bool TimerManager::hasTimer() {
 	RWMutexType::ReadLock lock(__mutex);
-	return !__timers.empty();
+	return !__timers.empty() || !__nodes.empty();
+}
+
+TimerStats TimerManager::getStats() const {
+	TimerStats stats;
+	stats.bucketed = __bucketed;
+	stats.savedWakeups = __savedWakeups;
+	return stats;
 }
 
 }; /* sylar */
\ No newline at end of file
@@ -2,8 +2,16 @@
 #define SYLAR_TEST_ADDRESS_H
 
 #include "Address.h"
+#include "Resolver.h"
+#include "Socket.h"
+#include "IOManager.h"
+#include "Hook.h"
+#include "Config.h"
+#include "Macro.h"
 #include "Log.h"
 #include <iostream>
+#include <sstream>
+#include <atomic>
 
 using std::cout;
 using std::endl;
@@ -12,7 +20,7 @@ using namespace sylar;
 namespace Test
 {
 
-// ̬ܹͨͨIPöӦAddress
+// 通过静态方法能够通过域名、IP、主机名获得对应Address
 void test_address_test() {
     SYLAR_LOG_ERROR(SYLAR_LOG_ROOT()) << "test_address_test";
     std::vector<sylar::Address_ptr> addrs;
@@ -27,7 +35,7 @@ void test_address_test() {
     }
 }
 
-// ̬ͨñAddress
+// 通过静态方法获得本机的Address
 void test_address_iface() {
     SYLAR_LOG_ERROR(SYLAR_LOG_ROOT()) << "test_address_iface";
     std::multimap<std::string, std::pair<sylar::Address_ptr, uint32_t> > results;
@@ -46,7 +54,7 @@ void test_address_iface() {
     }
 }
 
-// ̬ͨȡIPAddress
+// 通过静态方法获取IPAddress
 void test_address_ip() {
     SYLAR_LOG_ERROR(SYLAR_LOG_ROOT()) << "test_address_ip";
     auto addr = sylar::IPAddress::Create("www.baidu.com");
@@ -55,7 +63,7 @@ void test_address_ip() {
     }
 }
 
-//  IPv4 ַ
+// 创建 IPv4 地址
 void test_address_ipv4() {
     SYLAR_LOG_ERROR(SYLAR_LOG_ROOT()) << "test_address_ipv4";
     auto addr = sylar::IPv4Address::Create("172.23.253.254", 80);
@@ -76,7 +84,7 @@ void test_address_ipv4() {
     }
 }
 
-//  IPv6 ַ
+// 创建 IPv6 地址
 void test_address_ipv6() {
     SYLAR_LOG_ERROR(SYLAR_LOG_ROOT()) << "test_address_ipv6";
     auto addr = sylar::IPv6Address::Create("fe80::215:5dff:fec7:b3dd", 8020);
@@ -100,6 +108,123 @@ void test_address_ipv6() {
     }
 }
 
+//****************************************************************************
+// 本地 DNS 替身服务器
+//****************************************************************************
+
+static std::atomic<int> s_dns_queries{ 0 };
+
+/*!
+ * @brief a.test 应答 A 10.0.0.1(TTL 1 秒)，其他名字应答 NXDOMAIN 并带 SOA(MINIMUM 60 秒)
+ */
+void fake_dns_server(Socket_ptr sock) {
+    set_hook_enable(true);
+    uint8_t buf[512];
+    while (true) {
+        Address_ptr from(new IPv4Address);
+        int n = sock->recvFrom(buf, sizeof(buf), from);
+        // 收到不足一个报头的数据报表示测试结束
+        if (n <= 12) {
+            break;
+        }
+        ++s_dns_queries;
+        // 放慢应答，让并发的查询有机会合并
+        usleep(50 * 1000);
+
+        // 问题部分原样带回
+        size_t pos = 12;
+        std::string qname;
+        while (pos < (size_t)n && buf[pos]) {
+            if (!qname.empty()) qname += ".";
+            qname.append((const char*)buf + pos + 1, buf[pos]);
+            pos += buf[pos] + 1;
+        }
+        pos += 5;
+        std::string resp((const char*)buf, pos);
+        resp[2] = (char)0x81;
+        resp[3] = (char)0x80;
+        resp[6] = resp[7] = resp[8] = resp[9] = 0;
+        const char* ptr_name = "\xc0\x0c";
+        if (qname == "a.test" && buf[pos - 3] == 1) {
+            resp[7] = 1;
+            resp.append(ptr_name, 2);
+            resp.append("\x00\x01\x00\x01\x00\x00\x00\x01\x00\x04\x0a\x00\x00\x01", 14);
+        }
+        else {
+            resp[3] = (char)0x83;
+            resp[9] = 1;
+            resp.append(ptr_name, 2);
+            resp.append("\x00\x06\x00\x01\x00\x00\x0e\x10\x00\x1e", 10);
+            resp.append("\x02ns\xc0\x0c\x02hm\xc0\x0c", 10);
+            resp.append("\x00\x00\x00\x01\x00\x00\x00\x01\x00\x00\x00\x01\x00\x00\x00\x01\x00\x00\x00\x3c", 20);
+        }
+        sock->sendTo(resp.data(), resp.size(), from);
+    }
+    sock->close();
+}
+
+void test_address_resolver() {
+    set_hook_enable(true);
+    Socket_ptr server = Socket::CreateUDPSocket();
+    SYLAR_ASSERT(server->bind(IPv4Address::Create("127.0.0.1", 0)));
+    std::stringstream ss;
+    ss << "127.0.0.1:" << std::dynamic_pointer_cast<IPAddress>(server->getLocalAddress())->getPort();
+    Config::Lookup<std::vector<std::string>>("dns.nameservers")->setValue({ ss.str() });
+    Config::Lookup<uint32_t>("dns.timeout_ms")->setValue(500);
+    IOManager::GetThis()->schedule(std::bind(fake_dns_server, server));
+
+    // 并发查询同一个名字，只发出一次请求
+    static std::atomic<int> s_done{ 0 };
+    for (int i = 0; i < 10; ++i) {
+        IOManager::GetThis()->schedule([]() {
+            set_hook_enable(true);
+            IPAddress_ptr addr = Address::LookupAnyIPAddress("a.test:80");
+            SYLAR_ASSERT(addr);
+            SYLAR_ASSERT2(addr->toString() == "10.0.0.1:80", addr->toString());
+            ++s_done;
+        });
+    }
+    while (s_done < 10) {
+        usleep(10 * 1000);
+    }
+    SYLAR_ASSERT2(s_dns_queries == 1, "queries = " << s_dns_queries);
+
+    // 命中缓存，返回的地址可以随意修改
+    IPAddress_ptr addr = Address::LookupAnyIPAddress("A.test:8080");
+    SYLAR_ASSERT(addr && addr->toString() == "10.0.0.1:8080");
+    SYLAR_ASSERT(s_dns_queries == 1);
+
+    // NXDOMAIN 按 SOA 做负缓存
+    SYLAR_ASSERT(!Address::LookupAnyIPAddress("missing.test"));
+    SYLAR_ASSERT(!Address::LookupAnyIPAddress("missing.test"));
+    SYLAR_ASSERT2(s_dns_queries == 2, "queries = " << s_dns_queries);
+
+    // hosts 文件不经过 DNS
+    addr = Address::LookupAnyIPAddress("localhost:81");
+    SYLAR_ASSERT(addr && addr->toString() == "127.0.0.1:81");
+    SYLAR_ASSERT(s_dns_queries == 2);
+
+    // 正缓存按 TTL 过期
+    usleep(1100 * 1000);
+    SYLAR_ASSERT(Address::LookupAnyIPAddress("a.test"));
+    SYLAR_ASSERT2(s_dns_queries == 3, "queries = " << s_dns_queries);
+
+    std::stringstream os;
+    Resolver_single::GetInstance()->dump(os);
+    SYLAR_LOG_INFO(SYLAR_LOG_ROOT()) << os.str();
+    Config::Lookup<std::vector<std::string>>("dns.nameservers")->setValue({});
+    Config::Lookup<uint32_t>("dns.timeout_ms")->setValue(0);
+    Socket::CreateUDPSocket()->sendTo("q", 1, server->getLocalAddress());
+}
+
+void test_resolver() {
+    cout << "-------------------------------- test resolver ----------------------------" << endl;
+    // hook 开关是线程局部的，单线程避免协程换线程后丢失 hook
+    IOManager iom(1);
+    iom.schedule(test_address_resolver);
+    cout << "-------------------------------- test over ----------------------------" << endl;
+}
+
 void test_address() {
     cout << "-------------------------------- test address ----------------------------" << endl;
     test_address_test();
@@ -3,8 +3,15 @@
 
 #include "IOManager.h"
 #include "Timer.h"
+#include "Hook.h"
+#include "FDManager.h"
 #include "Log.h"
+#include "Macro.h"
+#include "Clock.h"
+#include "Config.h"
 #include <iostream>
+#include <sstream>
+#include <sys/socket.h>
 
 using std::cout;
 using std::endl;
@@ -27,6 +34,149 @@ void test_iomanager() {
 	cout << "------------------------------------- test over ----------------------------------" << endl;
 }
 
+void test_iomanager_stats() {
+	cout << "------------------------------------- test Iomanager stats ----------------------------------" << endl;
+	IOManager iom(2);
+	iom.schedule([]() {
+		set_hook_enable(true);
+		IOManager* iom = IOManager::GetThis();
+		int fds[2];
+		int rt = socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+		SYLAR_ASSERT(!rt);
+		FDManager_single::GetInstance()->get(fds[0], true);
+		FDManager_single::GetInstance()->get(fds[1], true);
+
+		IOManager::LoopStats before;
+		iom->getLoopStats(before);
+
+		// 触发一次读事件、一次取消、一次删除
+		for (int i = 0; i < 10; ++i) {
+			write(fds[1], "x", 1);
+			char c;
+			read(fds[0], &c, 1);
+		}
+		iom->addEvent(fds[0], IOManager::READ, []() {});
+		iom->cancelEvent(fds[0], IOManager::READ);
+		iom->addEvent(fds[1], IOManager::READ, []() {});
+		iom->delEvent(fds[1], IOManager::READ);
+		usleep(10 * 1000);
+
+		IOManager::LoopStats after;
+		iom->getLoopStats(after);
+		SYLAR_ASSERT(after.wakeups > before.wakeups);
+		SYLAR_ASSERT(after.addEvents >= before.addEvents + 2);
+		SYLAR_ASSERT(after.cancelEvents == before.cancelEvents + 1);
+		SYLAR_ASSERT(after.delEvents == before.delEvents + 1);
+		SYLAR_ASSERT(after.epollCtlErrors == before.epollCtlErrors);
+
+		std::stringstream ss;
+		iom->dump(ss);
+		SYLAR_LOG_INFO(SYLAR_LOG_ROOT()) << ss.str();
+
+		close(fds[0]);
+		close(fds[1]);
+	});
+	cout << "------------------------------------- test over ----------------------------------" << endl;
+}
+
+void test_iomanager_wakeup() {
+	cout << "------------------------------------- test Iomanager wakeup ----------------------------------" << endl;
+	static std::atomic<int> s_done{ 0 };
+	static std::atomic<int> s_wrong_thread{ 0 };
+	uint64_t begin = 0;
+	{
+		IOManager iom(4, false);
+		// 等待所有线程进入 idle
+		usleep(50 * 1000);
+		std::vector<int> ids;
+		std::stringstream ss;
+		iom.dump(ss);
+		SYLAR_LOG_INFO(SYLAR_LOG_ROOT()) << ss.str();
+
+		// 不指定线程的任务
+		for (int i = 0; i < 200; ++i) {
+			iom.schedule([]() { ++s_done; });
+			if (i % 10 == 0) usleep(1000);
+		}
+		// 指定线程的任务只能由该线程执行
+		iom.schedule([&ids]() {
+			int tid = GetThreadId();
+			for (int i = 0; i < 100; ++i) {
+				IOManager::GetThis()->schedule([tid]() {
+					if (GetThreadId() != tid) ++s_wrong_thread;
+					++s_done;
+				}, tid);
+			}
+		});
+		usleep(50 * 1000);
+
+		IOManager::LoopStats stats;
+		iom.getLoopStats(stats);
+		ss.str("");
+		iom.dump(ss);
+		SYLAR_LOG_INFO(SYLAR_LOG_ROOT()) << ss.str();
+		SYLAR_ASSERT(s_done == 300);
+		SYLAR_ASSERT(s_wrong_thread == 0);
+		begin = Clock::NowUS();
+	}
+	// 停止时所有阻塞的线程都应被唤醒，而不是等待 MAX_TIMEOUT
+	uint64_t cost = Clock::NowUS() - begin;
+	SYLAR_LOG_INFO(SYLAR_LOG_ROOT()) << "stop cost " << cost << "us";
+	SYLAR_ASSERT(cost < 1000 * 1000);
+	cout << "------------------------------------- test over ----------------------------------" << endl;
+}
+
+/*!
+ * @brief 每隔 gap_us 投递一个任务，返回任务从投递到执行的平均延迟
+ */
+uint64_t schedule_latency(uint32_t spin_us, IOManager::LoopStats& stats) {
+	Config::Lookup<uint32_t>("iomanager.spin_us")->setValue(spin_us);
+	static std::atomic<uint64_t> s_latency{ 0 };
+	static std::atomic<int> s_count{ 0 };
+	s_latency = 0;
+	s_count = 0;
+	const int N = 2000;
+	{
+		IOManager iom(2, false);
+		usleep(10 * 1000);
+		for (int i = 0; i < N; ++i) {
+			uint64_t begin = Clock::NowUS();
+			iom.schedule([begin]() {
+				s_latency += Clock::NowUS() - begin;
+				++s_count;
+			});
+			while (Clock::NowUS() - begin < 20);
+		}
+		usleep(10 * 1000);
+		iom.getLoopStats(stats);
+	}
+	SYLAR_ASSERT(s_count == N);
+	return s_latency / N;
+}
+
+void test_iomanager_spin() {
+	cout << "------------------------------------- test Iomanager spin ----------------------------------" << endl;
+	IOManager::LoopStats park_stats;
+	uint64_t park = schedule_latency(0, park_stats);
+	IOManager::LoopStats spin_stats;
+	uint64_t spin = schedule_latency(200, spin_stats);
+	Config::Lookup<uint32_t>("iomanager.spin_us")->setValue(0);
+
+	SYLAR_LOG_INFO(SYLAR_LOG_ROOT()) << "park: avg latency " << park << "us wakeups="
+		<< park_stats.tickleWakeups << " spin: avg latency " << spin << "us wakeups="
+		<< spin_stats.tickleWakeups << " hits=" << spin_stats.spinHits
+		<< " misses=" << spin_stats.spinMisses;
+	SYLAR_ASSERT(park_stats.spinHits == 0 && park_stats.spinMisses == 0);
+	// 单核时不会自旋
+	if (sysconf(_SC_NPROCESSORS_ONLN) > 1) {
+		SYLAR_ASSERT(spin_stats.spinHits > 0);
+	}
+	else {
+		SYLAR_ASSERT(spin_stats.spinHits == 0 && spin_stats.spinMisses == 0);
+	}
+	cout << "------------------------------------- test over ----------------------------------" << endl;
+}
+
 }; /* Test */
 
 #endif /* SYLAR_TEST_IO_MANAGER_H */
\ No newline at end of file
@@ -0,0 +1,180 @@
+#ifndef SYLAR_TEST_MUTEX_H
+#define SYLAR_TEST_MUTEX_H
+
+#include "Mutex.h"
+#include "Thread.h"
+#include "Clock.h"
+#include "Log.h"
+#include "Macro.h"
+#include <iostream>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <unistd.h>
+
+using std::cout;
+using std::endl;
+using namespace sylar;
+
+namespace Test
+{
+
+//****************************************************************************
+// 锁的微基准测试
+//****************************************************************************
+
+/*!
+ * @brief threads 个线程各加锁 iters 次并递增计数，返回每次加解锁的平均耗时(ns)
+ */
+template<class MutexType>
+double bench_mutex(const std::string& name, int threads, int iters) {
+    MutexType mutex;
+    uint64_t counter = 0;
+    std::vector<Thread_ptr> vecs;
+    uint64_t begin = Clock::NowUS();
+    for (int i = 0; i < threads; ++i) {
+        vecs.push_back(std::make_shared<Thread>([&mutex, &counter, iters]() {
+            for (int j = 0; j < iters; ++j) {
+                typename MutexType::Lock lock(mutex);
+                ++counter;
+            }
+        }, name + "_" + std::to_string(i)));
+    }
+    for (auto& i : vecs) {
+        i->join();
+    }
+    uint64_t cost = Clock::NowUS() - begin;
+    SYLAR_ASSERT2(counter == (uint64_t)threads * iters, name << " counter = " << counter);
+    double ns = cost * 1000.0 / ((double)threads * iters);
+    SYLAR_LOG_INFO(SYLAR_LOG_ROOT()) << name << " threads=" << threads << " " << ns << " ns/op";
+    return ns;
+}
+
+/*!
+ * @brief 读多写少：每 write_every 次操作有一次写，写者同时修改两个值，读者校验二者相等
+ */
+template<class RWMutexType>
+double bench_rwmutex(const std::string& name, int threads, int iters, int write_every) {
+    RWMutexType mutex;
+    uint64_t a = 0, b = 0;
+    std::vector<Thread_ptr> vecs;
+    uint64_t begin = Clock::NowUS();
+    for (int i = 0; i < threads; ++i) {
+        vecs.push_back(std::make_shared<Thread>([&mutex, &a, &b, iters, write_every]() {
+            for (int j = 0; j < iters; ++j) {
+                if (j % write_every == 0) {
+                    typename RWMutexType::WriteLock lock(mutex);
+                    ++a;
+                    ++b;
+                }
+                else {
+                    typename RWMutexType::ReadLock lock(mutex);
+                    SYLAR_ASSERT(a == b);
+                }
+            }
+        }, name + "_" + std::to_string(i)));
+    }
+    for (auto& i : vecs) {
+        i->join();
+    }
+    uint64_t cost = Clock::NowUS() - begin;
+    uint64_t writes = (uint64_t)threads * ((iters + write_every - 1) / write_every);
+    SYLAR_ASSERT2(a == writes && b == writes, name << " a = " << a << " writes = " << writes);
+    double ns = cost * 1000.0 / ((double)threads * iters);
+    SYLAR_LOG_INFO(SYLAR_LOG_ROOT()) << name << " threads=" << threads
+        << " write_every=" << write_every << " " << ns << " ns/op";
+    return ns;
+}
+
+void test_mutex() {
+    cout << "------------------------- test Mutex -------------------------------" << endl;
+    const int ITERS = 200000;
+    const int THREADS[] = { 1, 2, 4, 8 };
+    for (int t : THREADS) {
+        bench_mutex<SpinLock>("SpinLock", t, ITERS);
+        bench_mutex<CASLock>("CASLock", t, ITERS);
+        bench_mutex<Mutex>("Mutex", t, ITERS);
+        bench_mutex<FutexMutex>("FutexMutex", t, ITERS);
+    }
+    for (int t : THREADS) {
+        for (int write_every : { 1000, 10 }) {
+            bench_rwmutex<RWMutex>("RWMutex", t, ITERS, write_every);
+            bench_rwmutex<FutexRWMutex>("FutexRWMutex", t, ITERS, write_every);
+        }
+    }
+    cout << "------------------------- test over -------------------------------" << endl;
+}
+
+//****************************************************************************
+// 锁竞争统计
+//****************************************************************************
+
+void test_lock_profile() {
+    cout << "------------------------- test LockProfiler -------------------------------" << endl;
+    LockProfiler::SetEnabled(true);
+    LockProfiler::Reset();
+
+    // 持有 1ms 的热点锁，与一把只有单线程使用的锁对比
+    Mutex hot("test.hot");
+    FutexRWMutex rw("test.rw");
+    Mutex cold;
+    std::vector<Thread_ptr> vecs;
+    for (int i = 0; i < 4; ++i) {
+        vecs.push_back(std::make_shared<Thread>([&hot, &rw]() {
+            for (int j = 0; j < 20; ++j) {
+                {
+                    Mutex::Lock lock(hot);
+                    usleep(1000);
+                }
+                {
+                    FutexRWMutex::ReadLock lock(rw);
+                }
+                {
+                    FutexRWMutex::WriteLock lock(rw);
+                    usleep(100);
+                }
+            }
+        }, "lock_profile_" + std::to_string(i)));
+    }
+    for (int i = 0; i < 100; ++i) {
+        Mutex::Lock lock(cold);
+    }
+    for (auto& i : vecs) {
+        i->join();
+    }
+
+    std::stringstream ss;
+    LockProfiler::Dump(ss, 5);
+    SYLAR_LOG_INFO(SYLAR_LOG_ROOT()) << "\n" << ss.str();
+
+    auto report = LockProfiler::GetReport();
+    std::shared_ptr<LockStats> hot_stats, rw_stats, cold_stats;
+    for (auto& i : report) {
+        if (i->name == "test.hot") {
+            hot_stats = i;
+        }
+        else if (i->name == "test.rw") {
+            rw_stats = i;
+        }
+        else if (i->name.find("test_Mutex.h:") == 0 && i->acquisitions == 100) {
+            cold_stats = i;
+        }
+    }
+    SYLAR_ASSERT(hot_stats && rw_stats && cold_stats);
+    SYLAR_ASSERT2(hot_stats->acquisitions == 80, "hot acquisitions = " << hot_stats->acquisitions);
+    SYLAR_ASSERT(hot_stats->contended > 0 && hot_stats->waitNS > 0);
+    SYLAR_ASSERT(hot_stats->maxHoldNS >= 1000 * 1000);
+    SYLAR_ASSERT(rw_stats->acquisitions == 160);
+    SYLAR_ASSERT(rw_stats->maxHoldNS >= 100 * 1000);
+    SYLAR_ASSERT(cold_stats->contended == 0 && cold_stats->waitNS == 0);
+    for (size_t i = 1; i < report.size(); ++i) {
+        SYLAR_ASSERT(report[i - 1]->waitNS >= report[i]->waitNS);
+    }
+
+    LockProfiler::SetEnabled(false);
+    cout << "------------------------- test over -------------------------------" << endl;
+}
+
+}; /* Test */
+
+#endif /* SYLAR_TEST_MUTEX_H */
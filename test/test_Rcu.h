@@ -0,0 +1,138 @@
+#ifndef SYLAR_TEST_RCU_H
+#define SYLAR_TEST_RCU_H
+
+#include "Rcu.h"
+#include "Servlet.h"
+#include "IOManager.h"
+#include "Thread.h"
+#include "Log.h"
+#include "Macro.h"
+#include <iostream>
+#include <atomic>
+#include <vector>
+
+using std::cout;
+using std::endl;
+using namespace sylar;
+
+namespace Test
+{
+
+/*!
+ * @brief 析构后置为 DEAD，读者据此发现读到了已释放的快照
+ */
+struct RcuSnapshot {
+    static const uint64_t LIVE = 0x1122334455667788ull;
+    static const uint64_t DEAD = 0xdeaddeaddeaddeadull;
+    static std::atomic<int64_t> s_alive;
+
+    volatile uint64_t magic = LIVE;
+    std::vector<uint64_t> values = std::vector<uint64_t>(8, 0);
+
+    RcuSnapshot() { ++s_alive; }
+    RcuSnapshot(const RcuSnapshot& o) : values(o.values) { ++s_alive; }
+    ~RcuSnapshot() { magic = DEAD; --s_alive; }
+};
+
+std::atomic<int64_t> RcuSnapshot::s_alive = { 0 };
+
+void test_rcu_stress() {
+    RcuPtr<RcuSnapshot> ptr;
+    std::atomic<bool> stop = { false };
+    std::vector<Thread_ptr> vecs;
+    std::atomic<uint64_t> reads = { 0 };
+    for (int i = 0; i < 4; ++i) {
+        vecs.push_back(std::make_shared<Thread>([&ptr, &stop, &reads]() {
+            uint64_t n = 0;
+            while (!stop) {
+                Rcu::ReadLock lock;
+                const RcuSnapshot* s = ptr.get();
+                uint64_t v = s->values[0];
+                for (auto i : s->values) {
+                    SYLAR_ASSERT2(i == v, "torn snapshot " << i << " != " << v);
+                }
+                SYLAR_ASSERT2(s->magic == RcuSnapshot::LIVE, "snapshot used after free");
+                ++n;
+            }
+            reads += n;
+        }, "rcu_reader_" + std::to_string(i)));
+    }
+
+    const int UPDATES = 20000;
+    for (int i = 1; i <= UPDATES; ++i) {
+        ptr.update([i](RcuSnapshot& s) {
+            for (auto& v : s.values) {
+                v = i;
+            }
+            return true;
+        });
+    }
+    stop = true;
+    for (auto& i : vecs) {
+        i->join();
+    }
+    Rcu::Quiescent();
+    SYLAR_LOG_INFO(SYLAR_LOG_ROOT()) << "reads = " << reads << " updates = " << UPDATES
+        << " pending = " << Rcu::GetPending() << " alive = " << RcuSnapshot::s_alive;
+    SYLAR_ASSERT(Rcu::GetPending() == 0);
+    SYLAR_ASSERT(RcuSnapshot::s_alive == 1);
+}
+
+void test_rcu_quiescent() {
+    RcuPtr<RcuSnapshot> ptr;
+    Semaphore entered, leave;
+
+    // 读者停在临界区内时旧快照不能释放
+    Thread reader([&ptr, &entered, &leave]() {
+        Rcu::ReadLock lock;
+        const RcuSnapshot* s = ptr.get();
+        entered.notify();
+        leave.wait();
+        SYLAR_ASSERT(s->magic == RcuSnapshot::LIVE);
+    }, "rcu_reader");
+    entered.wait();
+    ptr.update([](RcuSnapshot& s) { return true; });
+    SYLAR_ASSERT(Rcu::GetPending() >= 1);
+    SYLAR_ASSERT(RcuSnapshot::s_alive == 2);
+    leave.notify();
+    reader.join();
+
+    // 调度器回到调度协程时回收
+    {
+        IOManager iom(1);
+        iom.schedule([]() {});
+    }
+    SYLAR_LOG_INFO(SYLAR_LOG_ROOT()) << "pending = " << Rcu::GetPending()
+        << " alive = " << RcuSnapshot::s_alive;
+    SYLAR_ASSERT(Rcu::GetPending() == 0);
+    SYLAR_ASSERT(RcuSnapshot::s_alive == 1);
+}
+
+void test_rcu_dispatch() {
+    http::ServletDispatch dispatch;
+    dispatch.addServlet("/a", [](http::HttpRequest_ptr, http::HttpResponse_ptr, http::HttpSession_ptr) {
+        return 0;
+    });
+    dispatch.addGlobServlet("/g/*", [](http::HttpRequest_ptr, http::HttpResponse_ptr, http::HttpSession_ptr) {
+        return 0;
+    });
+    SYLAR_ASSERT(dispatch.getServlet("/a"));
+    SYLAR_ASSERT(dispatch.getGlobServlet("/g/*"));
+    SYLAR_ASSERT(dispatch.getMatchedServlet("/g/x") == dispatch.getGlobServlet("/g/*"));
+    dispatch.delServlet("/a");
+    dispatch.delGlobServlet("/g/*");
+    SYLAR_ASSERT(!dispatch.getServlet("/a"));
+    SYLAR_ASSERT(dispatch.getMatchedServlet("/g/x") == dispatch.getDefault());
+}
+
+void test_rcu() {
+    cout << "------------------------- test Rcu -------------------------------" << endl;
+    test_rcu_stress();
+    test_rcu_quiescent();
+    test_rcu_dispatch();
+    cout << "------------------------- test over -------------------------------" << endl;
+}
+
+}; /* Test */
+
+#endif /* SYLAR_TEST_RCU_H */
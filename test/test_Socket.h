@@ -2,9 +2,17 @@
 #define SYLAR_TEST_SOCKET_H
 
 #include "Socket.h"
+#include "Stream.h"
 #include "IOManager.h"
+#include "Hook.h"
+#include "FDManager.h"
 #include "Log.h"
+#include "Macro.h"
+#include "Clock.h"
 #include <iostream>
+#include <atomic>
+#include <fcntl.h>
+#include <signal.h>
 
 using std::cout;
 using std::endl;
@@ -89,6 +97,229 @@ void test_socket_func2() {
     }
 }
 
+void test_socket_func3() {
+    set_hook_enable(true);
+    // 4MB 的临时文件，远大于 socket 发送缓冲区，保证 sendfile 会遇到 EAGAIN
+    const size_t SIZE = 4 * 1024 * 1024;
+    const uint64_t OFFSET = 100;
+    std::string path = "/tmp/sylar_test_sendfile";
+    std::string data(SIZE, 0);
+    for (size_t i = 0; i < SIZE; ++i) data[i] = (char)(i * 131 + 7);
+    int fd = open(path.c_str(), O_CREAT | O_TRUNC | O_WRONLY, 0644);
+    SYLAR_ASSERT(fd >= 0);
+    SYLAR_ASSERT(write(fd, data.data(), SIZE) == (ssize_t)SIZE);
+    close(fd);
+
+    Socket_ptr server = Socket::CreateTCPSocket();
+    SYLAR_ASSERT(server->bind(IPv4Address::Create("127.0.0.1", 0)));
+    SYLAR_ASSERT(server->listen());
+    Address_ptr addr = server->getLocalAddress();
+
+    IOManager::GetThis()->schedule([server, path, OFFSET]() {
+        set_hook_enable(true);
+        Socket_ptr client = server->accept();
+        SYLAR_ASSERT(client);
+        SocketStream stream(client);
+        int64_t rt = stream.sendFile(path, OFFSET);
+        SYLAR_ASSERT2(rt == (int64_t)(SIZE - OFFSET), "sendFile rt = " << rt << " errno = " << errno);
+    });
+
+    Socket_ptr sock = Socket::CreateTCPSocket();
+    SYLAR_ASSERT(sock->connect(addr));
+
+    // 先用 splice 将前 64KB 从 socket 搬到管道
+    int pipes[2];
+    SYLAR_ASSERT(pipe(pipes) == 0);
+    std::string recved;
+    size_t left = 64 * 1024;
+    while (left > 0) {
+        ssize_t n = splice(sock->getSocket(), nullptr, pipes[1], nullptr, left, SPLICE_F_MOVE);
+        SYLAR_ASSERT(n > 0);
+        std::string buf(n, 0);
+        SYLAR_ASSERT(read(pipes[0], &buf[0], n) == n);
+        recved += buf;
+        left -= n;
+    }
+    close(pipes[0]);
+    close(pipes[1]);
+
+    // 剩余部分直接读取
+    std::string buf(64 * 1024, 0);
+    while (true) {
+        int n = sock->recv(&buf[0], buf.size());
+        if (n <= 0) break;
+        recved.append(buf.data(), n);
+    }
+    SYLAR_LOG_INFO(SYLAR_LOG_ROOT()) << "recv " << recved.size() << " bytes";
+    SYLAR_ASSERT(recved.size() == SIZE - OFFSET);
+    SYLAR_ASSERT(recved == data.substr(OFFSET));
+    unlink(path.c_str());
+}
+
+/*!
+ * @brief 对端在传输中途重置连接时，sendFile 返回已发送的长度而不是 -1
+ */
+void test_socket_func6() {
+    set_hook_enable(true);
+    const size_t SIZE = 4 * 1024 * 1024;
+    std::string path = "/tmp/sylar_test_sendfile_reset";
+    int fd = open(path.c_str(), O_CREAT | O_TRUNC | O_WRONLY, 0644);
+    SYLAR_ASSERT(fd >= 0);
+    SYLAR_ASSERT(ftruncate(fd, SIZE) == 0);
+    close(fd);
+
+    Socket_ptr server = Socket::CreateTCPSocket();
+    SYLAR_ASSERT(server->bind(IPv4Address::Create("127.0.0.1", 0)));
+    SYLAR_ASSERT(server->listen());
+    Address_ptr addr = server->getLocalAddress();
+
+    static std::atomic<int64_t> s_sent = { 0 };
+    static std::atomic<bool> s_done = { false };
+    s_done = false;
+    IOManager::GetThis()->schedule([server, path]() {
+        set_hook_enable(true);
+        Socket_ptr client = server->accept();
+        SYLAR_ASSERT(client);
+        SocketStream stream(client);
+        s_sent = stream.sendFile(path);
+        s_done = true;
+    });
+
+    Socket_ptr sock = Socket::CreateTCPSocket();
+    SYLAR_ASSERT(sock->connect(addr));
+    std::string buf(64 * 1024, 0);
+    size_t recved = 0;
+    while (recved < buf.size()) {
+        int n = sock->recv(&buf[0], buf.size() - recved);
+        SYLAR_ASSERT(n > 0);
+        recved += n;
+    }
+    // SO_LINGER 为 0 时关闭发送 RST
+    linger lg = { 1, 0 };
+    sock->setOption(SOL_SOCKET, SO_LINGER, lg);
+    sock->close();
+    while (!s_done) {
+        usleep(10 * 1000);
+    }
+    SYLAR_LOG_INFO(SYLAR_LOG_ROOT()) << "sendFile after reset rt = " << s_sent;
+    SYLAR_ASSERT2(s_sent >= (int64_t)recved && s_sent < (int64_t)SIZE, "sendFile rt = " << s_sent);
+    unlink(path.c_str());
+}
+
+void test_socket_func4() {
+    set_hook_enable(true);
+    Socket_ptr server = Socket::CreateTCPSocket();
+    SYLAR_ASSERT(server->bind(IPv4Address::Create("127.0.0.1", 0)));
+    SYLAR_ASSERT(server->listen());
+    Address_ptr addr = server->getLocalAddress();
+
+    // 每 20ms 写一个字节共 5 次，300ms 时再写一次
+    IOManager::GetThis()->schedule([server]() {
+        set_hook_enable(true);
+        Socket_ptr client = server->accept();
+        SYLAR_ASSERT(client);
+        for (int i = 0; i < 5; ++i) {
+            usleep(20 * 1000);
+            SYLAR_ASSERT(client->send("x", 1) == 1);
+        }
+        usleep(200 * 1000);
+        SYLAR_ASSERT(client->send("z", 1) == 1);
+        usleep(50 * 1000);
+    });
+
+    Socket_ptr sock = Socket::CreateTCPSocket();
+    SYLAR_ASSERT(sock->connect(addr));
+    char c;
+
+    // 空闲超时：持续有数据时不断顺延，数据停止 60ms 后超时
+    SYLAR_ASSERT(sock->setIdleTimeout(60));
+    for (int i = 0; i < 5; ++i) {
+        SYLAR_ASSERT(sock->recv(&c, 1) == 1 && c == 'x');
+    }
+    uint64_t begin = Clock::NowMS();
+    SYLAR_ASSERT(sock->recv(&c, 1) == -1 && errno == ETIMEDOUT);
+    uint64_t cost = Clock::NowMS() - begin;
+    SYLAR_LOG_INFO(SYLAR_LOG_ROOT()) << "idle timeout cost " << cost << "ms";
+    SYLAR_ASSERT(cost >= 55 && cost < 150);
+    SYLAR_ASSERT(sock->setIdleTimeout(0));
+
+    // 读截止时间：到期后的读立即返回 ETIMEDOUT
+    SYLAR_ASSERT(sock->setReadDeadline(50));
+    begin = Clock::NowMS();
+    SYLAR_ASSERT(sock->recv(&c, 1) == -1 && errno == ETIMEDOUT);
+    SYLAR_ASSERT(Clock::NowMS() - begin >= 45);
+    begin = Clock::NowMS();
+    SYLAR_ASSERT(sock->recv(&c, 1) == -1 && errno == ETIMEDOUT);
+    SYLAR_ASSERT(Clock::NowMS() - begin < 5);
+
+    // 取消截止时间后恢复阻塞读
+    SYLAR_ASSERT(sock->setReadDeadline(0));
+    SYLAR_ASSERT(sock->recv(&c, 1) == 1 && c == 'z');
+
+    FDCtx_ptr ctx = FDManager_single::GetInstance()->get(sock->getSocket());
+    SYLAR_ASSERT(ctx && ctx->getStats().get(FDStats::TIMEOUTS) == 3);
+}
+
+/*!
+ * @brief 同一个 fd 的读、写等待者在不同的 IOManager 上，各自按自己的截止时间超时；
+ *        FDCtx 比 IOManager 活得久时析构不再访问已析构的定时器管理器
+ */
+void test_socket_func5() {
+	int fds[2];
+	SYLAR_ASSERT(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+	FDCtx_ptr ctx = FDManager_single::GetInstance()->get(fds[0], true);
+	FDManager_single::GetInstance()->get(fds[1], true);
+	// 写满发送缓冲区，之后的写会阻塞
+	char buf[4096] = { 0 };
+	while (write(fds[0], buf, sizeof(buf)) > 0);
+	SYLAR_ASSERT(errno == EAGAIN);
+
+	uint64_t now = Clock::NowUS();
+	ctx->setDeadline(SO_RCVTIMEO, now + 50 * 1000);
+	ctx->setDeadline(SO_SNDTIMEO, now + 80 * 1000);
+	static std::atomic<uint64_t> s_read_cost = { 0 }, s_write_cost = { 0 };
+	{
+		IOManager reader(1, false, "reader");
+		IOManager writer(1, false, "writer");
+		reader.schedule([fds, now]() {
+			set_hook_enable(true);
+			char c;
+			SYLAR_ASSERT(read(fds[0], &c, 1) == -1 && errno == ETIMEDOUT);
+			s_read_cost = Clock::NowUS() - now;
+		});
+		writer.schedule([fds, now]() {
+			set_hook_enable(true);
+			char data[4096] = { 0 };
+			SYLAR_ASSERT(write(fds[0], data, sizeof(data)) == -1 && errno == ETIMEDOUT);
+			s_write_cost = Clock::NowUS() - now;
+		});
+	}
+	SYLAR_LOG_INFO(SYLAR_LOG_ROOT()) << "read deadline cost " << s_read_cost
+		<< "us write deadline cost " << s_write_cost << "us";
+	SYLAR_ASSERT(s_read_cost >= 50 * 1000 && s_read_cost < 500 * 1000);
+	SYLAR_ASSERT(s_write_cost >= 80 * 1000 && s_write_cost < 500 * 1000);
+
+	// 删除后截止时间被清除，不会留给复用该 fd 的连接
+	FDManager_single::GetInstance()->del(fds[0]);
+	FDManager_single::GetInstance()->del(fds[1]);
+	SYLAR_ASSERT(ctx->getDeadline(SO_RCVTIMEO) == ~0ull && ctx->getDeadline(SO_SNDTIMEO) == ~0ull);
+	ctx.reset();
+	close(fds[0]);
+	close(fds[1]);
+}
+
+void test_socket_deadline() {
+	cout << "------------------------------------- test deadline ----------------------------" << endl;
+
+	{
+		IOManager iom(1);
+		iom.schedule(&test_socket_func4);
+	}
+	test_socket_func5();
+
+	cout << "------------------------------------- test over ----------------------------" << endl;
+}
+
 void test_socket() {
 	cout << "------------------------------------- test socket ----------------------------" << endl;
 
@@ -99,6 +330,21 @@ void test_socket() {
 	cout << "------------------------------------- test over ----------------------------" << endl;
 }
 
+void test_socket_sendfile() {
+	cout << "------------------------------------- test sendfile ----------------------------" << endl;
+
+	// 对端重置连接时写 socket 可能产生 SIGPIPE
+	sighandler_t old_handler = signal(SIGPIPE, SIG_IGN);
+	{
+		IOManager iom(2);
+		iom.schedule(&test_socket_func3);
+		iom.schedule(&test_socket_func6);
+	}
+	signal(SIGPIPE, old_handler);
+
+	cout << "------------------------------------- test over ----------------------------" << endl;
+}
+
 }; /* Test */
 
 
@@ -15,21 +15,21 @@ namespace Test
 int count = 0;
 Mutex s_mutex;
 
-// ص1
+// 回调函数1
 void test_thread_func1(){
     for(std::size_t i = 0; i < 5; ++i){
         SYLAR_LOG_INFO(SYLAR_LOG_ROOT()) << "XXXXXXXXXXXXXXXXXXXX";
     }
 }
 
-// ص2
+// 回调函数2
 void test_thread_func2(){
     for(std::size_t i = 0; i < 5; ++i){
         SYLAR_LOG_INFO(SYLAR_LOG_ROOT()) << "====================";
     }
 }
 
-// ص3
+// 回调函数3
 void test_thread_func3(){
     SYLAR_LOG_INFO(SYLAR_LOG_ROOT())
         << "\n"
@@ -48,16 +48,16 @@ void test_thread_func3(){
 
 void test_thread(){
     std::cout << "------------------- test Thread -----------------------" << std::endl;
-    //  vector ߳
+    // 利用 vector 管理线程
     std::vector<Thread_ptr> vecs;
-    // ߳
+    // 创建线程
     Thread_ptr thread1 = std::make_shared<Thread>(&test_thread_func1, "name_1");
     Thread_ptr thread2 = std::make_shared<Thread>(&test_thread_func2, "name_2");
     Thread_ptr thread3 = std::make_shared<Thread>(&test_thread_func3, "name_3");
     vecs.push_back(thread1);
     vecs.push_back(thread2);
     vecs.push_back(thread3);
-    // ߳
+    // 运行线程
     for (std::size_t i = 0; i < vecs.size(); ++i) {
         vecs[i]->join();
     }
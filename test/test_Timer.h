@@ -0,0 +1,160 @@
+#ifndef SYLAR_TEST_TIMER_H
+#define SYLAR_TEST_TIMER_H
+
+#include "IOManager.h"
+#include "FDManager.h"
+#include "Hook.h"
+#include "Timer.h"
+#include "Clock.h"
+#include "Log.h"
+#include "Macro.h"
+#include <iostream>
+#include <atomic>
+#include <fcntl.h>
+#include <sys/socket.h>
+
+using std::cout;
+using std::endl;
+using namespace sylar;
+
+namespace Test
+{
+
+/*!
+ * @brief 读一次，返回 read 的结果，err 为读之后的 errno，cost 为耗时(us)
+ */
+ssize_t blocked_read(int fd, int& err, uint64_t& cost) {
+    char buf[16];
+    uint64_t begin = Clock::NowUS();
+    errno = 0;
+    ssize_t rt = read(fd, buf, sizeof(buf));
+    err = errno;
+    cost = Clock::NowUS() - begin;
+    SYLAR_LOG_INFO(SYLAR_LOG_ROOT()) << "read rt = " << rt << " errno = " << err
+        << " cost = " << cost << "us";
+    return rt;
+}
+
+void test_timer_node() {
+    set_hook_enable(true);
+    int fds[2];
+    int rt = socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    SYLAR_ASSERT(!rt);
+    FDManager_single::GetInstance()->get(fds[0], true);
+    FDManager_single::GetInstance()->get(fds[1], true);
+
+    timeval tv = { 0, 100 * 1000 };
+    setsockopt(fds[0], SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    // 超时路径：SO_RCVTIMEO 到期后返回 -1，errno 为 ETIMEDOUT。
+    // 两条路径都不分配内存，由单独的 sylar_test_alloc 程序验证
+    int err = 0;
+    uint64_t cost = 0;
+    ssize_t n = blocked_read(fds[0], err, cost);
+    SYLAR_ASSERT2(n == -1 && err == ETIMEDOUT, "timeout path rt = " << n << " errno = " << err);
+    SYLAR_ASSERT2(cost >= 100 * 1000, "timeout path returned early, cost = " << cost);
+
+    // 就绪路径：另一个协程 50ms 后写入数据，超时定时器被取消
+    IOManager::GetThis()->schedule([fds]() {
+        set_hook_enable(true);
+        usleep(50 * 1000);
+        write(fds[1], "x", 1);
+    });
+    n = blocked_read(fds[0], err, cost);
+    SYLAR_ASSERT2(n == 1, "ready path rt = " << n << " errno = " << err);
+    SYLAR_ASSERT2(cost < 100 * 1000, "ready path waited for the timeout, cost = " << cost);
+
+    // 用户设置了 O_NONBLOCK 时不挂起，没有数据直接返回 EAGAIN
+    int flags = fcntl(fds[0], F_GETFL, 0);
+    fcntl(fds[0], F_SETFL, flags | O_NONBLOCK);
+    n = blocked_read(fds[0], err, cost);
+    SYLAR_ASSERT2(n == -1 && err == EAGAIN, "nonblock path rt = " << n << " errno = " << err);
+    fcntl(fds[0], F_SETFL, flags);
+
+    close(fds[0]);
+    close(fds[1]);
+}
+
+void test_timer_precision() {
+    set_hook_enable(true);
+    const useconds_t sleeps[] = { 200, 500, 1500 };
+    for (useconds_t us : sleeps) {
+        uint64_t begin = Clock::NowUS();
+        usleep(us);
+        uint64_t cost = Clock::NowUS() - begin;
+        SYLAR_LOG_INFO(SYLAR_LOG_ROOT()) << "usleep(" << us << ") cost " << cost << "us";
+        SYLAR_ASSERT2(cost >= us, "usleep returned early, cost = " << cost);
+    }
+
+    timespec ts = { 0, 300 * 1000 };
+    uint64_t begin = Clock::NowUS();
+    nanosleep(&ts, nullptr);
+    uint64_t cost = Clock::NowUS() - begin;
+    SYLAR_LOG_INFO(SYLAR_LOG_ROOT()) << "nanosleep(300us) cost " << cost << "us";
+    SYLAR_ASSERT(cost >= 300);
+
+    // 负的秒数与 nanosleep 原本的行为一致，返回 EINVAL 而不是几乎永远休眠
+    timespec bad = { -1, 0 };
+    errno = 0;
+    SYLAR_ASSERT(nanosleep(&bad, nullptr) == -1 && errno == EINVAL);
+}
+
+void test_timer_slack() {
+    IOManager* iom = IOManager::GetThis();
+    TimerStats before = iom->getStats();
+
+    // 事件循环先等待 60ms 后的定时器
+    iom->addTimer(60, []() {});
+
+    // 40ms 后到期、slack 20ms 的定时器向上取整后仍早于 60ms，
+    // 但在 slack 内，不需要提前唤醒事件循环
+    static std::atomic<int> s_fired{ 0 };
+    static std::atomic<uint64_t> s_min_us{ ~0ull };
+    static std::atomic<uint64_t> s_max_us{ 0 };
+    const int N = 100;
+    uint64_t begin = Clock::NowUS();
+    for (int i = 0; i < N; ++i) {
+        iom->addTimerUS(40 * 1000 + i * 10, [begin]() {
+            uint64_t cost = Clock::NowUS() - begin;
+            uint64_t v = s_min_us;
+            while (cost < v && !s_min_us.compare_exchange_weak(v, cost));
+            v = s_max_us;
+            while (cost > v && !s_max_us.compare_exchange_weak(v, cost));
+            ++s_fired;
+        }, false, 20 * 1000);
+    }
+    usleep(100 * 1000);
+
+    TimerStats after = iom->getStats();
+    SYLAR_LOG_INFO(SYLAR_LOG_ROOT()) << "fired = " << s_fired
+        << " spread = " << (s_max_us - s_min_us) << "us"
+        << " bucketed = " << (after.bucketed - before.bucketed)
+        << " saved_wakeups = " << (after.savedWakeups - before.savedWakeups);
+    SYLAR_ASSERT(s_fired == N);
+    SYLAR_ASSERT(s_min_us >= 40 * 1000);
+    SYLAR_ASSERT(after.savedWakeups > before.savedWakeups);
+}
+
+void test_timer() {
+    cout << "------------------------- test Timer -------------------------------" << endl;
+    {
+        IOManager iom(1);
+        iom.schedule(test_timer_node);
+    }
+    {
+        IOManager iom(2);
+        iom.schedule(test_timer_precision);
+    }
+    {
+        IOManager iom(1);
+        iom.schedule([]() {
+            set_hook_enable(true);
+            test_timer_slack();
+        });
+    }
+    cout << "------------------------- test over -------------------------------" << endl;
+}
+
+}; /* Test */
+
+#endif /* SYLAR_TEST_TIMER_H */
@@ -0,0 +1,114 @@
+//*****************************************************************************
+//
+//
+//   分配计数测试：替换全局 operator new，只统计指定协程内的堆内存分配。
+//   单独成一个程序，替换不影响主测试程序
+//
+//
+//*****************************************************************************
+
+#include "IOManager.h"
+#include "FDManager.h"
+#include "Hook.h"
+#include "Fiber.h"
+#include "Log.h"
+#include "Macro.h"
+#include <iostream>
+#include <cstdlib>
+#include <new>
+#include <unistd.h>
+#include <sys/socket.h>
+
+using namespace sylar;
+
+//****************************************************************************
+// 统计指定协程内的堆内存分配次数
+//****************************************************************************
+
+// 只在本线程上被统计的协程运行时累加，其他线程与协程不受影响
+static thread_local uint64_t t_count_fiber_id = 0;
+static thread_local uint64_t t_alloc_count = 0;
+
+void* operator new(size_t size) {
+    if (t_count_fiber_id && t_count_fiber_id == Fiber::GetFiberId()) {
+        ++t_alloc_count;
+    }
+    void* p = malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
+/*!
+ * @brief 阻塞读一次(带超时)，返回本协程在读期间的分配次数
+ */
+static uint64_t blocked_read_allocs(int fd) {
+    char buf[16];
+    t_alloc_count = 0;
+    t_count_fiber_id = Fiber::GetFiberId();
+    ssize_t rt = read(fd, buf, sizeof(buf));
+    int err = errno;
+    uint64_t allocs = t_alloc_count;
+    t_count_fiber_id = 0;
+    SYLAR_LOG_INFO(SYLAR_LOG_ROOT()) << "read rt = " << rt << " errno = " << err
+        << " allocs = " << allocs;
+    return allocs;
+}
+
+/*!
+ * @brief 带超时的阻塞读，无论超时还是就绪返回都不分配内存
+ */
+static void test_timer_node_allocs() {
+    set_hook_enable(true);
+    int fds[2];
+    SYLAR_ASSERT(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+    FDManager_single::GetInstance()->get(fds[0], true);
+    FDManager_single::GetInstance()->get(fds[1], true);
+
+    timeval tv = { 0, 100 * 1000 };
+    setsockopt(fds[0], SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    // 计数本身有效
+    t_alloc_count = 0;
+    t_count_fiber_id = Fiber::GetFiberId();
+    int* volatile p = new int(0);
+    delete p;
+    t_count_fiber_id = 0;
+    SYLAR_ASSERT(t_alloc_count == 1);
+
+    // 预热：让定时器堆、fd 上下文等完成首次扩容
+    blocked_read_allocs(fds[0]);
+
+    // 超时路径
+    uint64_t allocs = blocked_read_allocs(fds[0]);
+    SYLAR_ASSERT2(allocs == 0, "timeout path allocs = " << allocs);
+
+    // 就绪路径：另一个协程 50ms 后写入数据
+    IOManager::GetThis()->schedule([fds]() {
+        set_hook_enable(true);
+        usleep(50 * 1000);
+        write(fds[1], "x", 1);
+    });
+    allocs = blocked_read_allocs(fds[0]);
+    SYLAR_ASSERT2(allocs == 0, "ready path allocs = " << allocs);
+
+    close(fds[0]);
+    close(fds[1]);
+}
+
+int main() {
+    std::cout << "------------------------- test allocs -------------------------------" << std::endl;
+    {
+        IOManager iom(1);
+        iom.schedule(test_timer_node_allocs);
+    }
+    std::cout << "------------------------- test over -------------------------------" << std::endl;
+    return 0;
+}
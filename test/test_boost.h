@@ -12,7 +12,7 @@ using std::endl;
 namespace Test
 {
 
-//  boost İ汾ûϢ
+// 输出 boost 库的版本与配置基本信息
 void test_boost_information() {
 	cout << "boost information" << endl;
 
@@ -24,7 +24,7 @@ void test_boost_information() {
 	cout << endl;
 }
 
-//  boost  lexical_cast<>() Ļʹ
+// 测试 boost 库的 lexical_cast<>() 函数的基本使用
 void test_lexical_cast() {
 	cout << "test lexical_cast<>()" << endl;
 	const char* ptr = "32768";
@@ -4,10 +4,18 @@
 #include "Log.h"
 #include "LexicalCast.h"
 #include "Config.h"
+#include "ConfigWatcher.h"
+#include "IOManager.h"
+#include "Hook.h"
+#include "Util.h"
+#include "Clock.h"
+#include "Macro.h"
 
 #include <iostream>
 #include <string>
 #include <fstream>
+#include <vector>
+#include <atomic>
 #include <yaml-cpp/yaml.h>
 namespace sylar{
 
@@ -33,7 +41,7 @@ public:
 };
 
 /**
-  *ת-personƫػ汾
+  *数据类型转换-person偏特化版本
   * string -> person
   */
 template <>
@@ -51,7 +59,7 @@ public:
 };
 
 /**
- * ת-Personƫػ汾
+ * 数据类型转换-Person偏特化版本
  * Person -> string
  */
 template <>
@@ -80,7 +88,7 @@ void test_config() {
 
     ConfigVar_ptr<Person> person_ptr = Config::Lookup("my_class_person", Person(), "class person");
 
-    // ʹlambdaʽص
+    // 使用lambda表达式定义回调函数
     auto func = [](const Person& old_value, const Person& new_value) {
         SYLAR_LOG_INFO(SYLAR_LOG_ROOT())
             << endl
@@ -91,8 +99,8 @@ void test_config() {
 
     person_ptr->addListener(func);
 
-    const string file_name = R"(test\test_config.yaml)";
-    // д
+    const std::string file_name = R"(test\test_config.yaml)";
+    // 写数据
     YAML::Node person_data;
     person_data["my_class_person"]["name"] = "moper";
     person_data["my_class_person"]["age"] = 10;
@@ -100,9 +108,9 @@ void test_config() {
     std::ofstream file(file_name);
     file << person_data;
     file.close();
-    // 
+    // 读数据
     YAML::Node root = YAML::LoadFile(file_name);
-    // 
+    // 更新数据
     Config::LoadFromYaml(root);
 
     SYLAR_LOG_INFO(SYLAR_LOG_ROOT())
@@ -115,6 +123,275 @@ void test_config() {
     cout << endl;
 }
 
+//****************************************************************************
+// 无锁读取配置值
+//****************************************************************************
+
+void test_config_snapshot() {
+    cout << "----------------------- test config snapshot ---------------------" << endl;
+    ConfigVar_ptr<uint32_t> value = Config::Lookup("test.snapshot.value", (uint32_t)1, "snapshot test");
+
+    // 监听器在新值发布前调用，此时读到的仍是旧值
+    std::vector<std::pair<uint32_t, uint32_t> > changes;
+    uint64_t key = value->addListener([&changes, value](const uint32_t& old_value, const uint32_t& new_value) {
+        SYLAR_ASSERT(value->getValue() == old_value);
+        changes.emplace_back(old_value, new_value);
+    });
+    static thread_local ConfigVarCache<uint32_t> t_value(value);
+    SYLAR_ASSERT(t_value.get() == 1);
+    uint64_t version = value->getVersion();
+    value->setValue(1);
+    SYLAR_ASSERT(value->getVersion() == version && changes.empty());
+    value->setValue(2);
+    SYLAR_ASSERT(value->getVersion() == version + 1);
+    SYLAR_ASSERT(changes.size() == 1 && changes[0].first == 1 && changes[0].second == 2);
+    SYLAR_ASSERT(value->getValue() == 2 && t_value.get() == 2);
+    value->delListener(key);
+
+    // 读者看到的总是某一次完整写入的值
+    ConfigVar_ptr<std::vector<int> > vec = Config::Lookup("test.snapshot.vector", std::vector<int>(16, 0), "snapshot test");
+    std::atomic<bool> stop = { false };
+    std::atomic<uint64_t> reads = { 0 };
+    std::vector<Thread_ptr> threads;
+    for (int i = 0; i < 3; ++i) {
+        threads.push_back(std::make_shared<Thread>([vec, &stop, &reads]() {
+            ConfigVarCache<std::vector<int> > cache(vec);
+            uint64_t n = 0;
+            while (!stop) {
+                std::vector<int> v = vec->getValue();
+                SYLAR_ASSERT(v.size() == 16 && v.front() == v.back());
+                bool same = vec->read([](const std::vector<int>& v) {
+                    return v.front() == v.back();
+                });
+                SYLAR_ASSERT(same);
+                const std::vector<int>& c = cache.get();
+                SYLAR_ASSERT(c.front() == c.back());
+                ++n;
+            }
+            reads += n;
+        }, "config_reader_" + std::to_string(i)));
+    }
+    for (int i = 1; i <= 2000; ++i) {
+        vec->setValue(std::vector<int>(16, i));
+    }
+    stop = true;
+    for (auto& i : threads) {
+        i->join();
+    }
+
+    const int COUNT = 1000000;
+    uint64_t sum = 0;
+    uint64_t begin = Clock::NowUS();
+    for (int i = 0; i < COUNT; ++i) {
+        sum += value->getValue();
+    }
+    double get_ns = (Clock::NowUS() - begin) * 1000.0 / COUNT;
+    begin = Clock::NowUS();
+    for (int i = 0; i < COUNT; ++i) {
+        sum += t_value.get();
+    }
+    double cache_ns = (Clock::NowUS() - begin) * 1000.0 / COUNT;
+    SYLAR_ASSERT(sum == 2ull * 2 * COUNT);
+    SYLAR_LOG_INFO(SYLAR_LOG_ROOT()) << "reads = " << reads << " getValue " << get_ns
+        << " ns, cached " << cache_ns << " ns";
+    cout << "----------------------- test over ---------------------" << endl;
+}
+
+//****************************************************************************
+// 配置目录热加载
+//****************************************************************************
+
+/*!
+ * @brief 写入文件；rename 为 true 时先写临时文件再改名(编辑器常用的保存方式)
+ */
+void write_config_file(const std::string& path, const std::string& content, bool rename = false) {
+    std::string tmp = rename ? path + ".tmp" : path;
+    {
+        std::ofstream ofs(tmp);
+        ofs << content;
+    }
+    if (rename) {
+        ::rename(tmp.c_str(), path.c_str());
+    }
+}
+
+void test_config_watch() {
+    cout << "----------------------- test config watch ---------------------" << endl;
+    const std::string dir = "/tmp/sylar_conf";
+    FSUtil::Rm(dir);
+    FSUtil::Mkdir(dir);
+    write_config_file(dir + "/a.yml", "test:\n  watch:\n    a: 1\n    list: [1, 2]\n");
+    write_config_file(dir + "/b.yml", "test:\n  watch:\n    b: x\n");
+
+    auto a = Config::Lookup("test.watch.a", 0, "watch test");
+    auto list = Config::Lookup("test.watch.list", std::vector<int>(), "watch test");
+    auto b = Config::Lookup("test.watch.b", std::string(), "watch test");
+    static std::atomic<int> s_a_changes = { 0 }, s_list_changes = { 0 }, s_b_changes = { 0 };
+    a->addListener([](const int&, const int&) { ++s_a_changes; });
+    list->addListener([](const std::vector<int>&, const std::vector<int>&) { ++s_list_changes; });
+    b->addListener([](const std::string&, const std::string&) { ++s_b_changes; });
+
+    // 首次加载全部，之后文件未变时跳过，强制加载也只比较文本
+    SYLAR_ASSERT(Config::LoadFromConfDir(dir) == 3);
+    SYLAR_ASSERT(a->getValue() == 1 && list->getValue().size() == 2 && b->getValue() == "x");
+    SYLAR_ASSERT(Config::LoadFromConfDir(dir) == 0);
+    SYLAR_ASSERT(Config::LoadFromConfDir(dir, true) == 0);
+    SYLAR_ASSERT(s_a_changes == 1 && s_list_changes == 1 && s_b_changes == 1);
+
+    FSUtil::Mkdir(dir + "/sub");
+    auto c = Config::Lookup("test.watch.c", 0, "watch test");
+    auto d = Config::Lookup("test.watch.d", 0, "watch test");
+
+    IOManager iom(1);
+    iom.schedule([dir, a, list, b, c, d]() {
+        set_hook_enable(true);
+        auto watcher = std::make_shared<ConfigWatcher>(dir, 100);
+        SYLAR_ASSERT(watcher->start());
+
+        // 连续修改只加载一次，只有变化的 key 通知监听器
+        for (int i = 2; i <= 4; ++i) {
+            write_config_file(dir + "/a.yml", "test:\n  watch:\n    a: " + std::to_string(i) + "\n    list: [1, 2]\n");
+            usleep(20 * 1000);
+        }
+        write_config_file(dir + "/ignored.txt", "test.watch.b: y\n");
+        usleep(300 * 1000);
+        SYLAR_ASSERT2(watcher->getReloads() == 1, "reloads = " << watcher->getReloads());
+        SYLAR_ASSERT(a->getValue() == 4 && s_a_changes == 2);
+        SYLAR_ASSERT(s_list_changes == 1 && s_b_changes == 1);
+
+        // 改名方式保存
+        write_config_file(dir + "/b.yml", "test:\n  watch:\n    b: z\n", true);
+        usleep(300 * 1000);
+        SYLAR_ASSERT2(watcher->getReloads() == 2, "reloads = " << watcher->getReloads());
+        SYLAR_ASSERT(b->getValue() == "z" && s_b_changes == 2 && s_a_changes == 2);
+
+        // 启动时已有的子目录与之后新建的子目录都被监视
+        write_config_file(dir + "/sub/c.yml", "test:\n  watch:\n    c: 1\n");
+        usleep(300 * 1000);
+        SYLAR_ASSERT2(watcher->getReloads() == 3, "reloads = " << watcher->getReloads());
+        SYLAR_ASSERT(c->getValue() == 1);
+        FSUtil::Mkdir(dir + "/sub/deep");
+        write_config_file(dir + "/sub/deep/d.yml", "test:\n  watch:\n    d: 1\n");
+        usleep(300 * 1000);
+        SYLAR_ASSERT2(watcher->getReloads() == 4, "reloads = " << watcher->getReloads());
+        SYLAR_ASSERT(d->getValue() == 1);
+        write_config_file(dir + "/sub/deep/d.yml", "test:\n  watch:\n    d: 2\n", true);
+        usleep(300 * 1000);
+        SYLAR_ASSERT2(watcher->getReloads() == 5, "reloads = " << watcher->getReloads());
+        SYLAR_ASSERT(d->getValue() == 2);
+
+        // 停止后不再加载
+        watcher->stop();
+        write_config_file(dir + "/b.yml", "test:\n  watch:\n    b: w\n");
+        usleep(300 * 1000);
+        SYLAR_ASSERT(b->getValue() == "z" && watcher->getReloads() == 5);
+    });
+    iom.stop();
+
+    // 用 setValue 改过的值在重新加载时恢复为文件中的值，即使文本未变
+    SYLAR_ASSERT(Config::LoadFromConfDir(dir) == 1 && b->getValue() == "w");
+    b->setValue("override");
+    SYLAR_ASSERT(Config::LoadFromConfDir(dir, true) == 1);
+    SYLAR_ASSERT(b->getValue() == "w");
+    FSUtil::Rm(dir);
+    cout << "----------------------- test over ---------------------" << endl;
+}
+
+//****************************************************************************
+// 二进制配置快照
+//****************************************************************************
+
+void test_config_binary() {
+    cout << "----------------------- test config binary ---------------------" << endl;
+    const std::string dir = "/tmp/sylar_conf_bin";
+    const std::string snapshot = "/tmp/sylar_conf_bin.snapshot";
+    FSUtil::Rm(dir);
+    FSUtil::Mkdir(dir);
+    unlink(snapshot.c_str());
+
+    // 大量配置项，模拟路由与上游配置
+    std::string big = "test:\n  bin:\n    routes:\n";
+    for (int i = 0; i < 2000; ++i) {
+        big += "      r" + std::to_string(i) + ": { path: /api/v1/item" + std::to_string(i)
+            + ", upstream: [10.0.0.1:80, 10.0.0.2:80], timeout: " + std::to_string(i % 100) + " }\n";
+    }
+    write_config_file(dir + "/a.yml", "test:\n  bin:\n    port: 80\n    list: [1, 2, 3]\n    late: hello\n");
+    write_config_file(dir + "/b.yml", "test:\n  bin:\n    port: 8080\n");
+    write_config_file(dir + "/c.yml", big);
+
+    auto port = Config::Lookup("test.bin.port", 0, "snapshot test");
+    auto list = Config::Lookup("test.bin.list", std::vector<int>(), "snapshot test");
+    auto timeout = Config::Lookup("test.bin.routes.r1999.timeout", 0, "snapshot test");
+
+    // 没有快照时解析 YAML 并生成快照，后面的文件覆盖前面的
+    SYLAR_ASSERT(Config::LoadFromSnapshot(dir, snapshot) == -1);
+    SYLAR_ASSERT(Config::LoadWithSnapshot(dir, snapshot) == 3);
+    SYLAR_ASSERT(port->getValue() == 8080 && list->getValue().size() == 3 && timeout->getValue() == 99);
+    SYLAR_ASSERT(access(snapshot.c_str(), F_OK) == 0);
+
+    // 快照有效，值未变化；之后注册的配置项也能从快照取值
+    SYLAR_ASSERT(Config::LoadFromSnapshot(dir, snapshot) == 0);
+    auto late = Config::Lookup("test.bin.late", std::string(), "snapshot test");
+    SYLAR_ASSERT(Config::LoadFromSnapshot(dir, snapshot) == 1);
+    SYLAR_ASSERT(late->getValue() == "hello");
+    // 快照加载后文件修改时间已记录，热加载不会重复解析
+    SYLAR_ASSERT(Config::LoadFromConfDir(dir) == 0);
+    // 生成快照时未注册的非标量结点没有保存值，之后注册则快照过期，重新解析
+    auto route = Config::Lookup("test.bin.routes.r0", std::map<std::string, std::string>(), "snapshot test");
+    SYLAR_ASSERT(Config::LoadFromSnapshot(dir, snapshot) == -1);
+    SYLAR_ASSERT(Config::LoadWithSnapshot(dir, snapshot) == 1);
+    SYLAR_ASSERT(route->getValue().at("path") == "/api/v1/item0");
+    SYLAR_ASSERT(Config::LoadFromSnapshot(dir, snapshot) == 0);
+
+    // 对比两种加载方式的耗时，文本都未变化，差别只在读取与展开
+    const int N = 5;
+    uint64_t start = Clock::NowUS();
+    for (int i = 0; i < N; ++i) {
+        Config::LoadFromConfDir(dir, true);
+    }
+    uint64_t yaml_us = (Clock::NowUS() - start) / N;
+    start = Clock::NowUS();
+    for (int i = 0; i < N; ++i) {
+        SYLAR_ASSERT(Config::LoadFromSnapshot(dir, snapshot) == 0);
+    }
+    uint64_t snapshot_us = (Clock::NowUS() - start) / N;
+    cout << "yaml load " << yaml_us << "us, snapshot load " << snapshot_us << "us" << endl;
+
+    // 文件变化后快照过期，重新生成
+    usleep(10 * 1000);
+    write_config_file(dir + "/b.yml", "test:\n  bin:\n    port: 9090\n");
+    SYLAR_ASSERT(Config::LoadFromSnapshot(dir, snapshot) == -1);
+    SYLAR_ASSERT(port->getValue() == 8080);
+    SYLAR_ASSERT(Config::LoadWithSnapshot(dir, snapshot) == 1);
+    SYLAR_ASSERT(port->getValue() == 9090);
+    SYLAR_ASSERT(Config::LoadFromSnapshot(dir, snapshot) == 0);
+
+    // 删除文件同样过期
+    unlink((dir + "/c.yml").c_str());
+    SYLAR_ASSERT(Config::LoadFromSnapshot(dir, snapshot) == -1);
+    SYLAR_ASSERT(Config::SaveSnapshot(dir, snapshot));
+    SYLAR_ASSERT(Config::LoadFromSnapshot(dir, snapshot) == 0);
+
+    // 内容损坏时校验失败
+    {
+        std::fstream fs(snapshot, std::ios::in | std::ios::out | std::ios::binary);
+        fs.seekp(-1, std::ios::end);
+        fs.put('#');
+    }
+    SYLAR_ASSERT(Config::LoadFromSnapshot(dir, snapshot) == -1);
+
+    // 有文件解析失败时不生成快照
+    write_config_file(dir + "/d.yml", "test: [unclosed\n");
+    unlink(snapshot.c_str());
+    SYLAR_ASSERT(!Config::SaveSnapshot(dir, snapshot));
+    Config::LoadWithSnapshot(dir, snapshot);
+    SYLAR_ASSERT(access(snapshot.c_str(), F_OK) != 0);
+    SYLAR_ASSERT(port->getValue() == 9090);
+
+    FSUtil::Rm(dir);
+    cout << "----------------------- test over ---------------------" << endl;
+}
+
 }; /* Test */
 
 #endif /* SYLAR_TEST_CONFIG_H */
@@ -4,9 +4,21 @@
 #include "Hook.h"
 #include "Log.h"
 #include "IOManager.h"
+#include "FileIO.h"
+#include "FDManager.h"
+#include "Clock.h"
+#include "Config.h"
+#include "Macro.h"
 #include <string>
+#include <atomic>
+#include <sstream>
 #include <iostream>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/select.h>
+#include <sys/epoll.h>
 #include <sys/socket.h>
+#include <netinet/in.h>
 #include <arpa/inet.h>
 
 using std::cout;
@@ -70,6 +82,333 @@ void test_hook_sock() {
     SYLAR_LOG_INFO(SYLAR_LOG_ROOT()) << buff;
 }
 
+void test_hook_file() {
+    set_hook_enable(true);
+    Config::Lookup<bool>("fileio.offload")->setValue(true);
+    Config::Lookup<uint32_t>("fileio.device_concurrency")->setValue(1);
+    uint64_t submitted = FileIOPool_single::GetInstance()->getSubmitted();
+
+    const char* path = "/tmp/sylar_test_fileio";
+    int fd = open(path, O_CREAT | O_TRUNC | O_RDWR, 0644);
+    SYLAR_ASSERT(fd >= 0);
+
+    std::string data(1024 * 1024, 0);
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = (char)('a' + i % 26);
+    }
+    ssize_t rt = write(fd, data.data(), data.size());
+    SYLAR_ASSERT(rt == (ssize_t)data.size());
+
+    // 多个协程并发覆写不同的块，同一设备同时只有一个请求在执行
+    static std::atomic<int> s_done{ 0 };
+    const int N = 8;
+    for (int i = 0; i < N; ++i) {
+        IOManager::GetThis()->schedule([fd, i]() {
+            set_hook_enable(true);
+            std::string block(4096, (char)('A' + i));
+            ssize_t n = pwrite(fd, block.data(), block.size(), i * 4096);
+            SYLAR_ASSERT(n == (ssize_t)block.size());
+            SYLAR_ASSERT(fsync(fd) == 0);
+            ++s_done;
+        });
+    }
+    while (s_done != N) {
+        usleep(1000);
+    }
+
+    std::string buf(data.size(), 0);
+    rt = pread(fd, &buf[0], buf.size(), 0);
+    SYLAR_ASSERT(rt == (ssize_t)buf.size());
+    for (int i = 0; i < N; ++i) {
+        SYLAR_ASSERT(buf.compare(i * 4096, 4096, std::string(4096, (char)('A' + i))) == 0);
+    }
+    SYLAR_ASSERT(buf.compare(N * 4096, std::string::npos, data, N * 4096, std::string::npos) == 0);
+
+    // 错误码与直接调用一致
+    rt = pread(fd, &buf[0], 16, -1);
+    SYLAR_ASSERT(rt == -1 && errno == EINVAL);
+
+    close(fd);
+    unlink(path);
+
+    uint64_t count = FileIOPool_single::GetInstance()->getSubmitted() - submitted;
+    std::stringstream ss;
+    FileIOPool_single::GetInstance()->dump(ss);
+    SYLAR_LOG_INFO(SYLAR_LOG_ROOT()) << ss.str();
+    SYLAR_ASSERT2(count == 2 + 2 * N + 1, "submitted = " << count);
+    Config::Lookup<bool>("fileio.offload")->setValue(false);
+}
+
+void test_hook_fdstats() {
+    set_hook_enable(true);
+    int fds[2];
+    int rt = socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    SYLAR_ASSERT(!rt);
+    FDCtx_ptr reader = FDManager_single::GetInstance()->get(fds[0], true);
+    FDCtx_ptr writer = FDManager_single::GetInstance()->get(fds[1], true);
+
+    timeval tv = { 0, 50 * 1000 };
+    setsockopt(fds[0], SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    // 小块写入：10 次系统调用共 100 字节
+    for (int i = 0; i < 10; ++i) {
+        SYLAR_ASSERT(write(fds[1], "0123456789", 10) == 10);
+    }
+    char buf[256];
+    SYLAR_ASSERT(read(fds[0], buf, sizeof(buf)) == 100);
+
+    // 无数据可读：EAGAIN 后挂起，50ms 后超时
+    SYLAR_ASSERT(read(fds[0], buf, sizeof(buf)) == -1 && errno == ETIMEDOUT);
+
+    FDStats r = reader->getStats();
+    FDStats w = writer->getStats();
+    SYLAR_ASSERT(w.get(FDStats::BYTES_WRITTEN) == 100);
+    SYLAR_ASSERT(w.get(FDStats::SYSCALLS) == 10);
+    SYLAR_ASSERT(r.get(FDStats::BYTES_READ) == 100);
+    SYLAR_ASSERT(r.get(FDStats::SYSCALLS) == 2);
+    SYLAR_ASSERT(r.get(FDStats::EAGAINS) == 1);
+    SYLAR_ASSERT(r.get(FDStats::TIMEOUTS) == 1);
+    SYLAR_ASSERT(r.get(FDStats::SUSPEND_US) >= 50 * 1000);
+
+    FDStats::Metric metric;
+    SYLAR_ASSERT(FDStats::FromString("syscalls", metric) && metric == FDStats::SYSCALLS);
+    std::vector<FDStats> top = FDManager_single::GetInstance()->top(metric, 1);
+    SYLAR_ASSERT(top.size() == 1 && top[0].fd == fds[1]);
+
+    std::stringstream ss;
+    FDManager_single::GetInstance()->dumpTop(ss, FDStats::SUSPEND_US, 3);
+    SYLAR_LOG_INFO(SYLAR_LOG_ROOT()) << ss.str();
+
+    close(fds[0]);
+    close(fds[1]);
+}
+
+void test_hook_stats() {
+	cout << "------------------------- test Hook fd stats -------------------------------" << endl;
+    {
+        IOManager iom(1);
+        iom.schedule(test_hook_fdstats);
+    }
+	cout << "------------------------- test over -------------------------------" << endl;
+}
+
+/*!
+ * @brief delay_ms 后向 fd 写一个字节，等待期间 ticks 持续增长说明工作线程没有被阻塞
+ */
+static std::atomic<int> s_ticks{ 0 };
+
+void schedule_write(int fd, int delay_ms) {
+    IOManager::GetThis()->schedule([fd, delay_ms]() {
+        set_hook_enable(true);
+        for (int i = 0; i < delay_ms; ++i) {
+            usleep(1000);
+            ++s_ticks;
+        }
+        SYLAR_ASSERT(write(fd, "x", 1) == 1);
+    });
+}
+
+void test_hook_pollfd() {
+    set_hook_enable(true);
+    int fds[2];
+    int rt = socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    SYLAR_ASSERT(!rt);
+    char c;
+
+    // poll: 单线程下等待期间其他协程仍在运行
+    s_ticks = 0;
+    schedule_write(fds[1], 30);
+    struct pollfd pfd = { fds[0], POLLIN, 0 };
+    uint64_t begin = Clock::NowMS();
+    rt = poll(&pfd, 1, 1000);
+    SYLAR_LOG_INFO(SYLAR_LOG_ROOT()) << "poll rt = " << rt << " cost = " << Clock::NowMS() - begin
+        << "ms ticks = " << s_ticks;
+    SYLAR_ASSERT(rt == 1 && (pfd.revents & POLLIN));
+    SYLAR_ASSERT(s_ticks > 0);
+    SYLAR_ASSERT(read(fds[0], &c, 1) == 1);
+
+    // poll 超时
+    begin = Clock::NowMS();
+    rt = poll(&pfd, 1, 30);
+    SYLAR_ASSERT(rt == 0 && Clock::NowMS() - begin >= 30);
+
+    // ppoll 超时
+    timespec ts = { 0, 20 * 1000 * 1000 };
+    begin = Clock::NowMS();
+    rt = ppoll(&pfd, 1, &ts, nullptr);
+    SYLAR_ASSERT(rt == 0 && Clock::NowMS() - begin >= 20);
+
+    // select: fds[1] 立即可写，fds[0] 稍后可读
+    schedule_write(fds[1], 20);
+    fd_set rset, wset;
+    FD_ZERO(&rset);
+    FD_ZERO(&wset);
+    FD_SET(fds[0], &rset);
+    FD_SET(fds[1], &wset);
+    timeval tv = { 1, 0 };
+    rt = select(std::max(fds[0], fds[1]) + 1, &rset, &wset, nullptr, &tv);
+    SYLAR_ASSERT(rt == 1 && FD_ISSET(fds[1], &wset) && !FD_ISSET(fds[0], &rset));
+
+    FD_ZERO(&rset);
+    FD_SET(fds[0], &rset);
+    tv = { 1, 0 };
+    rt = select(fds[0] + 1, &rset, nullptr, nullptr, &tv);
+    SYLAR_ASSERT(rt == 1 && FD_ISSET(fds[0], &rset));
+    SYLAR_ASSERT(tv.tv_sec == 0 && tv.tv_usec > 0);
+    SYLAR_ASSERT(read(fds[0], &c, 1) == 1);
+
+    // 嵌套的 epoll_wait
+    int epfd = epoll_create1(0);
+    SYLAR_ASSERT(epfd >= 0);
+    epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.fd = fds[0];
+    SYLAR_ASSERT(epoll_ctl(epfd, EPOLL_CTL_ADD, fds[0], &ev) == 0);
+    s_ticks = 0;
+    schedule_write(fds[1], 20);
+    epoll_event out[4];
+    rt = epoll_wait(epfd, out, 4, 1000);
+    SYLAR_ASSERT(rt == 1 && out[0].data.fd == fds[0]);
+    SYLAR_ASSERT(s_ticks > 0);
+    SYLAR_ASSERT(read(fds[0], &c, 1) == 1);
+
+    begin = Clock::NowMS();
+    rt = epoll_wait(epfd, out, 4, 20);
+    SYLAR_ASSERT(rt == 0 && Clock::NowMS() - begin >= 20);
+
+    close(epfd);
+    close(fds[0]);
+    close(fds[1]);
+
+    // select 遇到无效 fd 返回 EBADF，调用方的集合保持不变
+    FD_ZERO(&rset);
+    FD_SET(fds[0], &rset);
+    tv = { 0, 1000 };
+    rt = select(fds[0] + 1, &rset, nullptr, nullptr, &tv);
+    SYLAR_ASSERT(rt == -1 && errno == EBADF && FD_ISSET(fds[0], &rset));
+}
+
+/*!
+ * @brief 建立一对回环 TCP 连接(带外数据只有 TCP 支持)
+ */
+void tcp_pair(int fds[2]) {
+    set_hook_enable(false);
+    int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    SYLAR_ASSERT(bind(listen_fd, (sockaddr*)&addr, len) == 0 && listen(listen_fd, 1) == 0);
+    SYLAR_ASSERT(getsockname(listen_fd, (sockaddr*)&addr, &len) == 0);
+    fds[0] = socket(AF_INET, SOCK_STREAM, 0);
+    SYLAR_ASSERT(connect(fds[0], (sockaddr*)&addr, len) == 0);
+    fds[1] = accept(listen_fd, nullptr, nullptr);
+    SYLAR_ASSERT(fds[1] >= 0);
+    close(listen_fd);
+    set_hook_enable(true);
+}
+
+void test_hook_pollpri() {
+    set_hook_enable(true);
+    int fds[2];
+    tcp_pair(fds);
+    auto send_oob = [](int fd) {
+        IOManager::GetThis()->schedule([fd]() {
+            set_hook_enable(true);
+            usleep(20 * 1000);
+            SYLAR_ASSERT(send(fd, "!", 1, MSG_OOB) == 1);
+        });
+    };
+    char c;
+
+    // poll: 只关注 POLLPRI，带外数据到达时立即返回，而不是等到超时
+    send_oob(fds[1]);
+    struct pollfd pfd = { fds[0], POLLPRI, 0 };
+    uint64_t begin = Clock::NowMS();
+    int rt = poll(&pfd, 1, 1000);
+    uint64_t cost = Clock::NowMS() - begin;
+    SYLAR_LOG_INFO(SYLAR_LOG_ROOT()) << "poll(POLLPRI) rt = " << rt << " cost = " << cost << "ms";
+    SYLAR_ASSERT(rt == 1 && (pfd.revents & POLLPRI) && cost < 500);
+    SYLAR_ASSERT(recv(fds[0], &c, 1, MSG_OOB) == 1 && c == '!');
+
+    // select: exceptfds 同样对应带外数据
+    send_oob(fds[1]);
+    fd_set eset;
+    FD_ZERO(&eset);
+    FD_SET(fds[0], &eset);
+    timeval tv = { 1, 0 };
+    begin = Clock::NowMS();
+    rt = select(fds[0] + 1, nullptr, nullptr, &eset, &tv);
+    cost = Clock::NowMS() - begin;
+    SYLAR_LOG_INFO(SYLAR_LOG_ROOT()) << "select(exceptfds) rt = " << rt << " cost = " << cost << "ms";
+    SYLAR_ASSERT(rt == 1 && FD_ISSET(fds[0], &eset) && cost < 500);
+    SYLAR_ASSERT(recv(fds[0], &c, 1, MSG_OOB) == 1 && c == '!');
+
+    close(fds[0]);
+    close(fds[1]);
+}
+
+/*!
+ * @brief poll 醒来后只删除自己的注册，不影响其他协程在同一 fd 上新注册的事件
+ */
+void test_hook_poll_reregister() {
+    set_hook_enable(true);
+    int a[2], b[2];
+    SYLAR_ASSERT(socketpair(AF_UNIX, SOCK_STREAM, 0, a) == 0);
+    SYLAR_ASSERT(socketpair(AF_UNIX, SOCK_STREAM, 0, b) == 0);
+    IOManager* iom = IOManager::GetThis();
+    static std::atomic<int> s_fired{ 0 };
+    s_fired = 0;
+
+    // 另一个协程与 poll 同时醒来，在 poll 清理之前就在 a[0] 上注册读事件
+    iom->schedule([a, b, iom]() {
+        iom->addEvent(b[0], IOManager::READ);
+        Fiber::YieldToHold();
+        iom->addEvent(a[0], IOManager::READ, []() { ++s_fired; });
+    });
+    iom->schedule([a, b]() {
+        set_hook_enable(true);
+        usleep(20 * 1000);
+        SYLAR_ASSERT(write(a[1], "x", 1) == 1 && write(b[1], "x", 1) == 1);
+    });
+
+    struct pollfd pfd = { a[0], POLLIN, 0 };
+    SYLAR_ASSERT(poll(&pfd, 1, 1000) == 1);
+    usleep(20 * 1000);
+    SYLAR_ASSERT2(s_fired == 1, "registration removed by poll, fired = " << s_fired);
+
+    close(a[0]);
+    close(a[1]);
+    close(b[0]);
+    close(b[1]);
+}
+
+void test_hook_poll() {
+	cout << "------------------------- test Hook poll -------------------------------" << endl;
+    {
+        IOManager iom(1);
+        iom.schedule(test_hook_pollfd);
+    }
+    {
+        IOManager iom(1);
+        iom.schedule(test_hook_pollpri);
+    }
+    {
+        IOManager iom(1);
+        iom.schedule(test_hook_poll_reregister);
+    }
+	cout << "------------------------- test over -------------------------------" << endl;
+}
+
+void test_hook_fileio() {
+	cout << "------------------------- test Hook file io -------------------------------" << endl;
+    {
+        IOManager iom(1);
+        iom.schedule(test_hook_file);
+    }
+	cout << "------------------------- test over -------------------------------" << endl;
+}
+
 void test_hook() {
 	cout << "------------------------- test Hook -------------------------------" << endl;
     test_hook_sleep();
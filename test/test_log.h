@@ -2,9 +2,24 @@
 #define SYLAR_TEST_LOG_H
 
 #include "Log.h"
+#include "AsyncLog.h"
+#include "BinaryLog.h"
+#include "RollingLog.h"
+#include "Stream.h"
+#include "Util.h"
+#include "Config.h"
+#include "Thread.h"
+#include "Clock.h"
+#include "Macro.h"
 
 #include <iostream>
+#include <fstream>
+#include <sstream>
 #include <thread>
+#include <vector>
+#include <algorithm>
+#include <unistd.h>
+#include <sys/stat.h>
 
 using std::cout;
 using std::endl;
@@ -17,27 +32,575 @@ void test_log() {
     std::cout << "-------------- test log.h -------------------" << std::endl;
 
     Logger_ptr logger(new Logger("XYZ"));
-    LogEvent_ptr event(new LogEvent(
-        logger->getName(),              //־
-        LogLevel::INFO,		            //־
-        __FILE__, 			            //ļ
-        __LINE__, 			            //к
-        1234567, 			            //ʱ
-        GetThreadId(),		            //߳ID
-        "default_thread",               //߳ name
-        3, 					            //ЭID
-        time(0)				            //ǰʱ
-    ));
+    LogEvent event(
+        logger->getName(),              //日志器名称
+        LogLevel::INFO,		            //日志级别
+        __FILE__, 			            //文件名称
+        __LINE__, 			            //行号
+        1234567, 			            //程序运行时间
+        GetThreadId(),		            //线程ID
+        "default_thread",               //线程 name
+        3, 					            //协程ID
+        time(0)				            //当前时间
+    );
 
     LogFormatter_ptr formatter(new LogFormatter());
     StdOutLogAppender_ptr stdApp(new StdOutLogAppender());
     stdApp->setFormatter(formatter);
     logger->addAppender(stdApp);
     SYLAR_LOG_INFO(logger) << "Hello Info";
+    event.setMessage("Hello Event", 11);
+    logger->log(event);
     cout << "---------------- test over ---------------------" << endl;
     cout << endl;
 }
 
+//****************************************************************************
+// 异步日志
+//****************************************************************************
+
+/*!
+ * @brief 读取日志文件的所有行
+ */
+std::vector<std::string> read_log_lines(const std::string& path) {
+    std::vector<std::string> lines;
+    std::ifstream ifs(path);
+    std::string line;
+    while (std::getline(ifs, line)) {
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+/*!
+ * @brief threads 个线程各输出 count 条日志，返回每条的平均耗时(ns)
+ */
+double log_lines(Logger_ptr logger, int threads, int count) {
+    std::vector<Thread_ptr> vecs;
+    uint64_t begin = Clock::NowUS();
+    for (int i = 0; i < threads; ++i) {
+        vecs.push_back(std::make_shared<Thread>([logger, i, count]() {
+            for (int j = 0; j < count; ++j) {
+                SYLAR_LOG_INFO(logger) << "t" << i << " " << j;
+            }
+        }, "log_" + std::to_string(i)));
+    }
+    for (auto& i : vecs) {
+        i->join();
+    }
+    return (Clock::NowUS() - begin) * 1000.0 / ((double)threads * count);
+}
+
+void test_log_async() {
+    std::cout << "-------------- test async log -------------------" << std::endl;
+    const std::string path = "/tmp/sylar_async_log.txt";
+    const int THREADS = 4;
+    const int COUNT = 5000;
+    auto async_logger = AsyncLogger_single::GetInstance();
+
+    unlink(path.c_str());
+    Logger_ptr logger(new Logger("async"));
+    FileLogAppender_ptr file_app(new FileLogAppender(path));
+    file_app->setFormatter(std::make_shared<LogFormatter>("%m%n"));
+    logger->addAppender(file_app);
+
+    // 同步输出先进入用户态缓冲，ERROR 及以上的日志连同此前缓冲的内容立即写出
+    Config::Lookup<uint32_t>("log.file.flush_interval")->setValue(0);
+    SYLAR_LOG_INFO(logger) << "buffered";
+    SYLAR_ASSERT(read_log_lines(path).empty());
+    SYLAR_LOG_ERROR(logger) << "urgent";
+    SYLAR_ASSERT(read_log_lines(path) == std::vector<std::string>({ "buffered", "urgent" }));
+    unlink(path.c_str());
+    file_app->reopen();
+
+    // 之后不再有日志，缓冲也会由刷写线程定时写出
+    Config::Lookup<uint32_t>("log.file.flush_interval")->setValue(100);
+    SYLAR_LOG_INFO(logger) << "idle";
+    usleep(300 * 1000);
+    SYLAR_ASSERT(read_log_lines(path) == std::vector<std::string>({ "idle" }));
+    Config::Lookup<uint32_t>("log.file.flush_interval")->setValue(1000);
+    unlink(path.c_str());
+    file_app->reopen();
+
+    // 同步输出作为对照
+    double sync_ns = log_lines(logger, THREADS, COUNT);
+    file_app->flush();
+    SYLAR_ASSERT(read_log_lines(path).size() == (size_t)THREADS * COUNT);
+    unlink(path.c_str());
+    file_app->reopen();
+
+    // block 策略：一条不丢，同一线程内保持顺序
+    Config::Lookup<bool>("log.async.enable")->setValue(true);
+    double async_ns = log_lines(logger, THREADS, COUNT);
+    async_logger->drain();
+    auto lines = read_log_lines(path);
+    SYLAR_ASSERT2(lines.size() == (size_t)THREADS * COUNT, "lines = " << lines.size());
+    std::vector<int> next(THREADS, 0);
+    for (auto& line : lines) {
+        int t = 0, j = 0;
+        SYLAR_ASSERT(sscanf(line.c_str(), "t%d %d", &t, &j) == 2);
+        SYLAR_ASSERT2(next[t] == j, "thread " << t << " expect " << next[t] << " got " << j);
+        ++next[t];
+    }
+    SYLAR_LOG_INFO(SYLAR_LOG_ROOT()) << "sync " << sync_ns << " ns/line, async " << async_ns << " ns/line";
+
+    // FATAL 返回时此前的日志都已写出
+    unlink(path.c_str());
+    file_app->reopen();
+    for (int i = 0; i < 100; ++i) {
+        SYLAR_LOG_INFO(logger) << "before fatal " << i;
+    }
+    SYLAR_LOG_FATAL(logger) << "fatal";
+    lines = read_log_lines(path);
+    SYLAR_ASSERT2(lines.size() == 101 && lines.back() == "fatal", "lines = " << lines.size());
+
+    // drop 策略：队列很小时丢弃并计数，写出与丢弃之和等于总数
+    unlink(path.c_str());
+    file_app->reopen();
+    Config::Lookup<uint32_t>("log.async.ring_size")->setValue(16);
+    Config::Lookup<std::string>("log.async.full_policy")->setValue("drop");
+    uint64_t dropped = async_logger->getDropped();
+    log_lines(logger, 1, COUNT);
+    async_logger->drain();
+    dropped = async_logger->getDropped() - dropped;
+    lines = read_log_lines(path);
+    SYLAR_LOG_INFO(SYLAR_LOG_ROOT()) << "drop policy: written " << lines.size() << " dropped " << dropped;
+    SYLAR_ASSERT(lines.size() + dropped == (size_t)COUNT);
+
+    std::stringstream ss;
+    async_logger->dump(ss);
+    SYLAR_LOG_INFO(SYLAR_LOG_ROOT()) << ss.str();
+
+    Config::Lookup<bool>("log.async.enable")->setValue(false);
+    Config::Lookup<uint32_t>("log.async.ring_size")->setValue(4096);
+    Config::Lookup<std::string>("log.async.full_policy")->setValue("block");
+    unlink(path.c_str());
+    cout << "---------------- test over ---------------------" << endl;
+}
+
+//****************************************************************************
+// 格式化路径耗时
+//****************************************************************************
+
+/*!
+ * @brief 只计数不输出的输出地，用于单独测量格式化开销
+ */
+class NullLogAppender : public LogAppender {
+public:
+    uint64_t lines = 0;
+    uint64_t bytes = 0;
+
+    void write(const char* data, size_t size) override {
+        ++lines;
+        bytes += size;
+    }
+};
+
+/*!
+ * @brief 单线程输出 count 条日志，返回每条的平均耗时(ns)
+ */
+double log_bench(Logger_ptr logger, int count) {
+    uint64_t begin = Clock::NowUS();
+    for (int i = 0; i < count; ++i) {
+        SYLAR_LOG_INFO(logger) << "bench line " << i << " value " << 3.14;
+    }
+    return (Clock::NowUS() - begin) * 1000.0 / count;
+}
+
+void test_log_bench() {
+    std::cout << "-------------- test log bench -------------------" << std::endl;
+    const int COUNT = 200000;
+
+    // 级别过滤掉的日志不应构造事件
+    Logger_ptr logger(new Logger("bench"));
+    auto null_app = std::make_shared<NullLogAppender>();
+    null_app->setFormatter(std::make_shared<LogFormatter>());
+    logger->addAppender(null_app);
+    logger->setLevel(LogLevel::ERROR);
+    double filtered_ns = log_bench(logger, COUNT);
+    SYLAR_ASSERT(null_app->lines == 0);
+
+    // 只格式化不写出
+    logger->setLevel(LogLevel::DEBUG);
+    double null_ns = log_bench(logger, COUNT);
+    SYLAR_ASSERT(null_app->lines == (uint64_t)COUNT);
+
+    // 两个输出地共用同一个格式器时只格式化一次，内容相同
+    auto null_app2 = std::make_shared<NullLogAppender>();
+    null_app2->setFormatter(null_app->getFormatter());
+    logger->addAppender(null_app2);
+    uint64_t bytes = null_app->bytes;
+    double shared_ns = log_bench(logger, COUNT);
+    SYLAR_ASSERT(null_app2->lines == (uint64_t)COUNT);
+    SYLAR_ASSERT(null_app2->bytes == null_app->bytes - bytes);
+    logger->delAppender(null_app);
+    logger->delAppender(null_app2);
+
+    // 写入 /dev/null
+    FileLogAppender_ptr file_app(new FileLogAppender("/dev/null"));
+    file_app->setFormatter(std::make_shared<LogFormatter>());
+    logger->addAppender(file_app);
+    double file_ns = log_bench(logger, COUNT);
+
+    SYLAR_LOG_INFO(SYLAR_LOG_ROOT()) << "filtered " << filtered_ns << " ns/line, null "
+        << null_ns << " ns/line, shared formatter " << shared_ns << " ns/line, /dev/null "
+        << file_ns << " ns/line";
+    cout << "---------------- test over ---------------------" << endl;
+}
+
+//****************************************************************************
+// 日期时间格式
+//****************************************************************************
+
+/*!
+ * @brief 用 localtime_r + strftime 得到的期望结果
+ */
+std::string expect_datetime(const char* format, time_t second) {
+    struct tm tm;
+    localtime_r(&second, &tm);
+    char tmp[64];
+    size_t n = strftime(tmp, sizeof(tmp), format, &tm);
+    return std::string(tmp, n);
+}
+
+void test_log_datetime() {
+    std::cout << "-------------- test log datetime -------------------" << std::endl;
+    std::string name = "datetime";
+    LogFormatter sub_second("%d{%Y-%m-%d %H:%M:%S.%3N|%6N|%N|%%|%j}");
+    LogFormatter plain("%d{%H:%M:%S}");
+    time_t now = time(0);
+
+    // 同一秒内只改写亚秒数字，换秒后重新格式化；两个格式器交替使用互不干扰
+    const uint32_t usecs[] = { 123456, 7, 999999, 5000 };
+    for (time_t second = now; second < now + 3; ++second) {
+        for (uint32_t usec : usecs) {
+            LogEvent event(name, LogLevel::INFO, __FILE__, __LINE__, 0, 0, "", 0, second, usec);
+            char digits[32];
+            snprintf(digits, sizeof(digits), ".%03u|%06u|%06u000|%%|", usec / 1000, usec, usec);
+            std::string expect = expect_datetime("%Y-%m-%d %H:%M:%S", second) + digits
+                + expect_datetime("%j", second);
+            std::string result = sub_second.format(event);
+            SYLAR_ASSERT2(result == expect, result << " != " << expect);
+            SYLAR_ASSERT(plain.format(event) == expect_datetime("%H:%M:%S", second));
+        }
+    }
+
+    // 格式器释放后新格式器不能用到旧缓存
+    for (int i = 0; i < 20; ++i) {
+        LogFormatter tmp(i % 2 ? "%d{%S}" : "%d{%M.%3N}");
+        LogEvent event(name, LogLevel::INFO, __FILE__, __LINE__, 0, 0, "", 0, now, 42000);
+        std::string expect = expect_datetime(i % 2 ? "%S" : "%M", now) + (i % 2 ? "" : ".042");
+        SYLAR_ASSERT2(tmp.format(event) == expect, tmp.format(event) << " != " << expect);
+    }
+
+    const int COUNT = 200000;
+    LogEvent event(name, LogLevel::INFO, __FILE__, __LINE__, 0, 0, "", 0, now, 0);
+    std::string buf;
+    uint64_t begin = Clock::NowUS();
+    for (int i = 0; i < COUNT; ++i) {
+        buf.clear();
+        sub_second.format(buf, event);
+    }
+    SYLAR_LOG_INFO(SYLAR_LOG_ROOT()) << "cached datetime " << (Clock::NowUS() - begin) * 1000.0 / COUNT
+        << " ns/line: " << buf;
+    cout << "---------------- test over ---------------------" << endl;
+}
+
+//****************************************************************************
+// 二进制日志
+//****************************************************************************
+
+/*!
+ * @brief 把格式化结果按行保存在内存中的输出地
+ */
+class StringLogAppender : public LogAppender {
+public:
+    std::vector<std::string> lines;
+
+    void write(const char* data, size_t size) override {
+        MutexType::Lock lock(__mutex);
+        lines.emplace_back(data, size);
+    }
+
+    /*!
+     * @brief 其他线程可能同时写入时读取已有的行
+     */
+    std::vector<std::string> getLines() {
+        MutexType::Lock lock(__mutex);
+        return lines;
+    }
+};
+
+void test_log_binary() {
+    std::cout << "-------------- test binary log -------------------" << std::endl;
+    const std::string path = "/tmp/sylar_binary_log.bin";
+    const std::string pattern = "%d{%Y-%m-%d %H:%M:%S.%6N}%T%t%T%N%T%F%T[%p]%T[%c]%T%f:%l%T%r%T%m%n";
+    const int THREADS = 2;
+    const int COUNT = 2000;
+
+    unlink(path.c_str());
+    Logger_ptr logger(new Logger("binary"));
+    auto bin_app = std::make_shared<BinaryLogAppender>(path);
+    auto text_app = std::make_shared<StringLogAppender>();
+    text_app->setFormatter(std::make_shared<LogFormatter>(pattern));
+    logger->addAppender(bin_app);
+    logger->addAppender(text_app);
+
+    std::vector<Thread_ptr> vecs;
+    for (int i = 0; i < THREADS; ++i) {
+        vecs.push_back(std::make_shared<Thread>([logger, i, COUNT]() {
+            for (int j = 0; j < COUNT; ++j) {
+                if (j % 3) {
+                    SYLAR_LOG_INFO(logger) << "t" << i << " " << j;
+                } else {
+                    SYLAR_LOG_WARN(logger) << "warn t" << i << " " << j << " " << std::string(j % 50, 'x');
+                }
+            }
+        }, "bin_" + std::to_string(i)));
+    }
+    for (auto& i : vecs) {
+        i->join();
+    }
+    // 重新打开后追加新的一段，字典重新开始
+    bin_app->reopen();
+    for (int j = 0; j < 10; ++j) {
+        SYLAR_LOG_ERROR(logger) << "after reopen " << j;
+    }
+    // 异步输出时缓冲在每批末尾刷出
+    Config::Lookup<bool>("log.async.enable")->setValue(true);
+    for (int j = 0; j < 10; ++j) {
+        SYLAR_LOG_INFO(logger) << "async " << j;
+    }
+    AsyncLogger_single::GetInstance()->drain();
+    Config::Lookup<bool>("log.async.enable")->setValue(false);
+
+    // 同一批的多条日志交给不合并的输出地时逐条 write，与刷写线程何时取走无关
+    {
+        auto batch_app = std::make_shared<StringLogAppender>();
+        auto batch_formatter = std::make_shared<LogFormatter>("%m%n");
+        const char* messages[] = { "a", "b", "c" };
+        std::vector<LogEvent> events(3);
+        LogBatch batch;
+        for (size_t i = 0; i < events.size(); ++i) {
+            events[i].setMessage(messages[i], 1);
+            batch.append(batch_app, batch_formatter, events[i]);
+        }
+        batch.flush();
+        SYLAR_ASSERT(batch_app->lines == std::vector<std::string>({ "a\n", "b\n", "c\n" }));
+    }
+
+    // 解码结果与同时输出的文本一致
+    LogFormatter formatter(pattern);
+    BinaryLogReader reader;
+    SYLAR_ASSERT(reader.open(path));
+    std::vector<std::string> decoded;
+    LogEvent event;
+    while (reader.next(event)) {
+        decoded.push_back(formatter.format(event));
+    }
+    SYLAR_ASSERT2(reader.getError().empty(), reader.getError());
+    std::vector<std::string> expect = text_app->lines;
+    SYLAR_ASSERT2(decoded.size() == expect.size(), decoded.size() << " != " << expect.size());
+    SYLAR_ASSERT2(decoded.back() == expect.back(), decoded.back() << " != " << expect.back());
+    std::sort(decoded.begin(), decoded.end());
+    std::sort(expect.begin(), expect.end());
+    for (size_t i = 0; i < expect.size(); ++i) {
+        SYLAR_ASSERT2(decoded[i] == expect[i], decoded[i] << " != " << expect[i]);
+    }
+
+    size_t text_bytes = 0;
+    for (auto& i : expect) {
+        text_bytes += i.size();
+    }
+    struct stat st;
+    stat(path.c_str(), &st);
+    SYLAR_LOG_INFO(SYLAR_LOG_ROOT()) << "records " << expect.size() << " binary " << st.st_size
+        << " bytes, text " << text_bytes << " bytes";
+    SYLAR_ASSERT((size_t)st.st_size < text_bytes / 3);
+
+    // 末尾不完整的记录报告错误，之前的记录照常解码
+    SYLAR_ASSERT(truncate(path.c_str(), st.st_size - 2) == 0);
+    SYLAR_ASSERT(reader.open(path));
+    size_t count = 0;
+    while (reader.next(event)) {
+        ++count;
+    }
+    SYLAR_ASSERT(count == expect.size() - 1);
+    SYLAR_ASSERT(!reader.getError().empty());
+
+    unlink(path.c_str());
+    cout << "---------------- test over ---------------------" << endl;
+}
+
+//****************************************************************************
+// 滚动日志文件
+//****************************************************************************
+
+/*!
+ * @brief 读取整个文件，.gz 文件先解压
+ */
+std::string read_log_file(const std::string& path) {
+    std::ifstream ifs(path, std::ios::binary);
+    std::string data((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+    if (path.size() > 3 && path.substr(path.size() - 3) == ".gz") {
+        ZlibStream_ptr zs = ZlibStream::CreateGzip(false);
+        zs->write(data.data(), data.size());
+        zs->flush();
+        data = zs->getResult();
+    }
+    return data;
+}
+
+void test_log_rolling_once(bool compress) {
+    const std::string dir = "/tmp/sylar_rolling";
+    const std::string path = dir + "/rolling.log";
+    const int THREADS = 2;
+    const int COUNT = 3000;
+    FSUtil::Rm(dir);
+    FSUtil::Mkdir(dir);
+    // 上次运行留下的文件在启动时滚动出去
+    {
+        std::ofstream ofs(path);
+        ofs << "old line" << std::endl;
+    }
+
+    Logger_ptr logger(new Logger("rolling"));
+    auto app = std::make_shared<RollingFileLogAppender>(path, 16 * 1024, 0, compress);
+    app->setFormatter(std::make_shared<LogFormatter>("%m%n"));
+    logger->addAppender(app);
+    double ns = log_lines(logger, THREADS, COUNT);
+    app->rotate();
+    SYLAR_LOG_INFO(logger) << "after rotate";
+    uint64_t rotations = app->getRotations();
+    SYLAR_ASSERT(app->getDropped() == 0);
+    logger->delAppender(app);
+    app.reset();
+
+    std::vector<std::string> files;
+    FSUtil::ListAllFile(files, dir, "");
+    std::sort(files.begin(), files.end());
+    // 当前段名字最短，排在最前，内容却是最新的
+    SYLAR_ASSERT(files.size() >= 4 && files[0] == path);
+    files.push_back(files[0]);
+    files.erase(files.begin());
+
+    std::string data;
+    for (auto& i : files) {
+        SYLAR_ASSERT2(i.find(".next") == std::string::npos, "spare left: " << i);
+        if (i != path) {
+            SYLAR_ASSERT2(compress == (i.substr(i.size() - 3) == ".gz"), i);
+        }
+        std::string content = read_log_file(i);
+        SYLAR_ASSERT2(content.find('\0') == std::string::npos, "zero bytes in " << i);
+        data += content;
+    }
+    std::stringstream ss(data);
+    std::vector<std::string> lines;
+    std::string line;
+    while (std::getline(ss, line)) {
+        lines.push_back(line);
+    }
+    SYLAR_ASSERT2(lines.size() == (size_t)THREADS * COUNT + 2, "lines = " << lines.size());
+    SYLAR_ASSERT(lines.front() == "old line" && lines.back() == "after rotate");
+    std::vector<int> next(THREADS, 0);
+    for (size_t i = 1; i + 1 < lines.size(); ++i) {
+        int t = 0, j = 0;
+        SYLAR_ASSERT(sscanf(lines[i].c_str(), "t%d %d", &t, &j) == 2);
+        SYLAR_ASSERT2(next[t] == j, "thread " << t << " expect " << next[t] << " got " << j);
+        ++next[t];
+    }
+    SYLAR_LOG_INFO(SYLAR_LOG_ROOT()) << "compress = " << compress << " files = " << files.size()
+        << " rotations = " << rotations << " " << ns << " ns/line";
+    FSUtil::Rm(dir);
+}
+
+void test_log_rolling() {
+    std::cout << "-------------- test rolling log -------------------" << std::endl;
+    test_log_rolling_once(false);
+    test_log_rolling_once(true);
+    cout << "---------------- test over ---------------------" << endl;
+}
+
+//****************************************************************************
+// 采样与限流
+//****************************************************************************
+
+static int s_limit_evaluated = 0;
+
+/*!
+ * @brief 记录日志参数被求值的次数
+ */
+int limit_arg(int v) {
+    ++s_limit_evaluated;
+    return v;
+}
+
+void test_log_limit() {
+    std::cout << "-------------- test log limit -------------------" << std::endl;
+    const int COUNT = 1000;
+    Logger_ptr logger(new Logger("limit"));
+    auto app = std::make_shared<StringLogAppender>();
+    app->setFormatter(std::make_shared<LogFormatter>("%m%n"));
+    logger->addAppender(app);
+    logger->setLevel(LogLevel::INFO);
+    LogLimiter::Summary();
+
+    // 前 5 条，之后每 100 条一条；被抑制的日志不求值参数
+    for (int i = 0; i < COUNT; ++i) {
+        SYLAR_LOG_SAMPLE(logger, LogLevel::INFO, 5, 100) << limit_arg(i);
+    }
+    SYLAR_ASSERT2(app->lines.size() == 15, "lines = " << app->lines.size());
+    SYLAR_ASSERT(app->lines[4] == "4\n" && app->lines[5] == "5\n" && app->lines[6] == "105\n");
+    SYLAR_ASSERT(s_limit_evaluated == 15);
+
+    // 级别过滤掉的不计数
+    for (int i = 0; i < COUNT; ++i) {
+        SYLAR_LOG_SAMPLE(logger, LogLevel::DEBUG, 0, 0) << limit_arg(i);
+    }
+    SYLAR_ASSERT(s_limit_evaluated == 15);
+
+    // 每秒最多 10 条，循环可能跨过一秒
+    app->lines.clear();
+    uint64_t begin = Clock::NowUS();
+    for (int i = 0; i < COUNT; ++i) {
+        SYLAR_LOG_RATE(logger, LogLevel::WARN, 10) << limit_arg(i);
+    }
+    double ns = (Clock::NowUS() - begin) * 1000.0 / COUNT;
+    size_t rated = app->lines.size();
+    SYLAR_ASSERT2(rated >= 10 && rated <= 20, "lines = " << rated);
+    SYLAR_ASSERT(s_limit_evaluated == (int)(15 + rated));
+
+    // 汇总报告所有被抑制的条数
+    uint64_t suppressed = LogLimiter::Summary();
+    SYLAR_ASSERT2(suppressed == (COUNT - 15) + (COUNT - rated), "suppressed = " << suppressed);
+    SYLAR_ASSERT(LogLimiter::Summary() == 0);
+    SYLAR_LOG_INFO(SYLAR_LOG_ROOT()) << "suppressed " << suppressed << ", " << ns << " ns/line";
+
+    // 调用处之后不再执行，汇总也会由刷写线程定时输出
+    auto root_app = std::make_shared<StringLogAppender>();
+    root_app->setFormatter(std::make_shared<LogFormatter>("%m%n"));
+    SYLAR_LOG_ROOT()->addAppender(root_app);
+    Config::Lookup<uint32_t>("log.limit.summary_interval")->setValue(1);
+    Config::Lookup<uint32_t>("log.file.flush_interval")->setValue(100);
+    LogLimiter::Summary();
+    for (int i = 0; i < COUNT; ++i) {
+        SYLAR_LOG_RATE(logger, LogLevel::WARN, 10) << limit_arg(i);
+    }
+    bool reported = false;
+    for (int i = 0; i < 50 && !reported; ++i) {
+        usleep(100 * 1000);
+        for (auto& line : root_app->getLines()) {
+            reported = reported || line.find("suppressed ") == 0;
+        }
+    }
+    SYLAR_LOG_ROOT()->delAppender(root_app);
+    Config::Lookup<uint32_t>("log.limit.summary_interval")->setValue(10);
+    Config::Lookup<uint32_t>("log.file.flush_interval")->setValue(1000);
+    SYLAR_ASSERT(reported);
+    SYLAR_ASSERT(LogLimiter::Summary() == 0);
+    cout << "---------------- test over ---------------------" << endl;
+}
+
 }; /* Test */
 
 #endif /* SYLAR_TEST_LOG_H */
@@ -15,10 +15,10 @@ using std::endl;
 namespace Test
 {
 
-// ȡļ·
+// 读取文件的路径
 const string FileName = R"(test\test_yaml.yaml)";
 
-// yaml-cpp ļ
+// yaml-cpp 读文件测试
 void test_yaml_read() {
 	cout << "--------- test yaml read -------------" << endl;
 
@@ -34,11 +34,11 @@ void test_yaml_read() {
 	cout << endl;
 }
 
-// yaml-cpp дļ
+// yaml-cpp 写文件测试
 void test_yaml_write() {
 	cout << "--------- test yaml write -------------" << endl;
 
-	// һַ֡ݵYAMLڵ
+	// 创建一个包含数字、字符串和数组数据的YAML节点
 	YAML::Node data;
 	data["name"] = "John Doe";
 	data["sex"] = "man";
@@ -46,14 +46,14 @@ void test_yaml_write() {
 	data["system"]["port"] = 88;
 	data["system"]["value"] = 100;
 
-	// һYAMLڵ
+	// 创建一个包含数组的YAML节点
 	YAML::Node hobbies;
 	hobbies.push_back(1);
 	hobbies.push_back(2);
 	hobbies.push_back(3);
 	data["system"]["vecs"] = hobbies;
 
-	 // дļ
+	 // 将数据写入文件
 	ofstream file(FileName);
 	file << data;
 	file.close();
@@ -0,0 +1,43 @@
+//*****************************************************************************
+//
+//
+//   二进制日志解码工具：把 BinaryLogAppender 写出的文件还原为文本日志
+//
+//   用法: sylar_logdecode <file> [pattern]
+//   pattern 与 LogFormatter 相同，默认使用日志系统的默认格式
+//
+//
+//*****************************************************************************
+
+#include "BinaryLog.h"
+#include <iostream>
+#include <stdio.h>
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "usage: " << argv[0] << " <file> [pattern]" << std::endl;
+        return 1;
+    }
+
+    sylar::LogFormatter formatter = argc > 2 ? sylar::LogFormatter(argv[2]) : sylar::LogFormatter();
+    sylar::BinaryLogReader reader;
+    if (!reader.open(argv[1])) {
+        std::cerr << reader.getError() << std::endl;
+        return 1;
+    }
+
+    sylar::LogEvent event;
+    std::string buf;
+    uint64_t count = 0;
+    while (reader.next(event)) {
+        buf.clear();
+        formatter.format(buf, event);
+        fwrite(buf.data(), 1, buf.size(), stdout);
+        ++count;
+    }
+    if (!reader.getError().empty()) {
+        std::cerr << argv[1] << ": " << reader.getError() << " (" << count << " records decoded)" << std::endl;
+        return 2;
+    }
+    return 0;
+}